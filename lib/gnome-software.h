@@ -21,9 +21,11 @@
 #include <gs-desktop-data.h>
 #include <gs-enums.h>
 #include <gs-icon.h>
+#include <gs-icon-atlas.h>
 #include <gs-metered.h>
 #include <gs-os-release.h>
 #include <gs-plugin.h>
 #include <gs-plugin-vfuncs.h>
 #include <gs-remote-icon.h>
+#include <gs-trace.h>
 #include <gs-utils.h>
@@ -33,6 +33,8 @@ typedef enum {
 	GS_APP_LIST_FLAG_LAST  /*< skip >*/
 } GsAppListFlags;
 
+typedef struct _GsAppListFilterChain GsAppListFilterChain;
+
 GsAppList	*gs_app_list_copy		(GsAppList	*list);
 guint		 gs_app_list_get_size_peak	(GsAppList	*list);
 void		 gs_app_list_filter_duplicates	(GsAppList	*list,
@@ -41,6 +43,14 @@ void		 gs_app_list_randomize		(GsAppList	*list);
 void		 gs_app_list_remove_all		(GsAppList	*list);
 void		 gs_app_list_truncate		(GsAppList	*list,
 						 guint		 length);
+void		 gs_app_list_sort_truncate	(GsAppList	*list,
+						 GsAppListSortFunc func,
+						 gpointer	 user_data,
+						 guint		 length);
+void		 gs_app_list_sort_by_key_truncate (GsAppList	*list,
+						   GsAppListSortKeyFunc func,
+						   gpointer	 user_data,
+						   guint	 length);
 gboolean	 gs_app_list_has_flag		(GsAppList	*list,
 						 GsAppListFlags	 flag);
 void		 gs_app_list_add_flag		(GsAppList	*list,
@@ -48,4 +58,18 @@ void		 gs_app_list_add_flag		(GsAppList	*list,
 GsAppState	 gs_app_list_get_state		(GsAppList	*list);
 guint		 gs_app_list_get_progress	(GsAppList	*list);
 
+GsAppListFilterChain *gs_app_list_filter_chain_new	(void);
+void		 gs_app_list_filter_chain_free	(GsAppListFilterChain *chain);
+void		 gs_app_list_filter_chain_add	(GsAppListFilterChain *chain,
+						 const gchar	*name,
+						 GsAppListFilterFunc func,
+						 gpointer	 user_data);
+guint		 gs_app_list_filter_chain_get_n_rejected (GsAppListFilterChain *chain,
+							  const gchar	*name);
+gchar		*gs_app_list_filter_chain_to_string (GsAppListFilterChain *chain);
+void		 gs_app_list_filter_chain	(GsAppList	*list,
+						 GsAppListFilterChain *chain);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsAppListFilterChain, gs_app_list_filter_chain_free)
+
 G_END_DECLS
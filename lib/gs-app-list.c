@@ -578,6 +578,175 @@ gs_app_list_filter (GsAppList *list, GsAppListFilterFunc func, gpointer user_dat
 	}
 }
 
+typedef struct {
+	const gchar		*name;
+	GsAppListFilterFunc	 func;
+	gpointer		 user_data;
+	guint			 n_rejected;
+} GsAppListFilterChainLink;
+
+struct _GsAppListFilterChain {
+	GArray			*links;		/* (element-type GsAppListFilterChainLink) */
+};
+
+/**
+ * gs_app_list_filter_chain_new:
+ *
+ * Creates a new, empty, filter chain.
+ *
+ * Returns: (transfer full): a #GsAppListFilterChain
+ *
+ * Since: 40
+ **/
+GsAppListFilterChain *
+gs_app_list_filter_chain_new (void)
+{
+	GsAppListFilterChain *chain = g_slice_new0 (GsAppListFilterChain);
+	chain->links = g_array_new (FALSE, FALSE, sizeof (GsAppListFilterChainLink));
+	return chain;
+}
+
+/**
+ * gs_app_list_filter_chain_free:
+ * @chain: a #GsAppListFilterChain
+ *
+ * Frees the filter chain.
+ *
+ * Since: 40
+ **/
+void
+gs_app_list_filter_chain_free (GsAppListFilterChain *chain)
+{
+	g_array_unref (chain->links);
+	g_slice_free (GsAppListFilterChain, chain);
+}
+
+/**
+ * gs_app_list_filter_chain_add:
+ * @chain: a #GsAppListFilterChain
+ * @name: a static name for the filter, used for debugging
+ * @func: A #GsAppListFilterFunc
+ * @user_data: the user pointer to pass to @func
+ *
+ * Appends a filter to the chain. Filters are run in the order they were
+ * added, and an app is kept only if they all return %TRUE for it.
+ *
+ * Since: 40
+ **/
+void
+gs_app_list_filter_chain_add (GsAppListFilterChain *chain,
+			      const gchar *name,
+			      GsAppListFilterFunc func,
+			      gpointer user_data)
+{
+	GsAppListFilterChainLink link = { name, func, user_data, 0 };
+	g_return_if_fail (func != NULL);
+	g_array_append_val (chain->links, link);
+}
+
+/**
+ * gs_app_list_filter_chain_get_n_rejected:
+ * @chain: a #GsAppListFilterChain
+ * @name: the name of a filter
+ *
+ * Gets how many apps the filter called @name has removed, so far.
+ *
+ * Returns: number of apps
+ *
+ * Since: 40
+ **/
+guint
+gs_app_list_filter_chain_get_n_rejected (GsAppListFilterChain *chain,
+					 const gchar *name)
+{
+	for (guint i = 0; i < chain->links->len; i++) {
+		GsAppListFilterChainLink *link = &g_array_index (chain->links, GsAppListFilterChainLink, i);
+		if (g_strcmp0 (link->name, name) == 0)
+			return link->n_rejected;
+	}
+	return 0;
+}
+
+/**
+ * gs_app_list_filter_chain_to_string:
+ * @chain: a #GsAppListFilterChain
+ *
+ * Describes how many apps each filter has removed, for debugging.
+ *
+ * Returns: (transfer full): a string, e.g. `app-is-valid=3 qt-for-gtk=0`
+ *
+ * Since: 40
+ **/
+gchar *
+gs_app_list_filter_chain_to_string (GsAppListFilterChain *chain)
+{
+	GString *str = g_string_new (NULL);
+	for (guint i = 0; i < chain->links->len; i++) {
+		GsAppListFilterChainLink *link = &g_array_index (chain->links, GsAppListFilterChainLink, i);
+		if (str->len > 0)
+			g_string_append_c (str, ' ');
+		g_string_append_printf (str, "%s=%u", link->name, link->n_rejected);
+	}
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * gs_app_list_filter_chain:
+ * @list: A #GsAppList
+ * @chain: a #GsAppListFilterChain
+ *
+ * Runs all the filters in @chain over @list in a single pass, keeping the
+ * apps for which every filter returns %TRUE. Filters after the first one to
+ * reject an app are not called for it.
+ *
+ * This is equivalent to calling gs_app_list_filter() for each filter in turn,
+ * but only walks and compacts the list once.
+ *
+ * Since: 40
+ **/
+void
+gs_app_list_filter_chain (GsAppList *list, GsAppListFilterChain *chain)
+{
+	guint n_kept = 0;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GPtrArray) rejected = NULL;
+
+	g_return_if_fail (GS_IS_APP_LIST (list));
+	g_return_if_fail (chain != NULL);
+
+	locker = g_mutex_locker_new (&list->mutex);
+	rejected = g_ptr_array_new ();
+	for (guint i = 0; i < list->array->len; i++) {
+		GsApp *app = g_ptr_array_index (list->array, i);
+		gboolean keep = TRUE;
+
+		for (guint j = 0; j < chain->links->len; j++) {
+			GsAppListFilterChainLink *link = &g_array_index (chain->links, GsAppListFilterChainLink, j);
+			if (!link->func (app, link->user_data)) {
+				link->n_rejected++;
+				keep = FALSE;
+				break;
+			}
+		}
+		if (keep)
+			list->array->pdata[n_kept++] = app;
+		else
+			g_ptr_array_add (rejected, app);
+	}
+	if (rejected->len == 0)
+		return;
+
+	/* move the rejected apps to the end so they get unreffed */
+	for (guint i = 0; i < rejected->len; i++) {
+		GsApp *app = g_ptr_array_index (rejected, i);
+		gs_app_list_maybe_unwatch_app (list, app);
+		list->array->pdata[n_kept + i] = app;
+	}
+	g_ptr_array_set_size (list->array, n_kept);
+	gs_app_list_invalidate_state (list);
+	gs_app_list_invalidate_progress (list);
+}
+
 typedef struct {
 	GsAppListSortFunc	 func;
 	gpointer		 user_data;
@@ -589,7 +758,7 @@ gs_app_list_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
 	GsApp *app1 = GS_APP (*(GsApp **) a);
 	GsApp *app2 = GS_APP (*(GsApp **) b);
 	GsAppListSortHelper *helper = (GsAppListSortHelper *) user_data;
-	return helper->func (app1, app2, user_data);
+	return helper->func (app1, app2, helper->user_data);
 }
 
 /**
@@ -646,19 +815,255 @@ gs_app_list_truncate (GsAppList *list, guint length)
 	g_ptr_array_set_size (list->array, length);
 }
 
+typedef struct {
+	GsApp		*app;
+	gchar		*key;
+	guint		 idx;
+} GsAppListSortKeyItem;
+
+/* compares with @helper->func if set, or else the keys */
+static gint
+gs_app_list_sort_item_cmp (const GsAppListSortKeyItem *item1,
+			   const GsAppListSortKeyItem *item2,
+			   GsAppListSortHelper *helper)
+{
+	gint rc;
+
+	if (helper->func != NULL)
+		rc = helper->func (item1->app, item2->app, helper->user_data);
+	else
+		rc = g_strcmp0 (item1->key, item2->key);
+	if (rc != 0)
+		return rc;
+
+	/* keep the sort stable */
+	if (item1->idx < item2->idx)
+		return -1;
+	if (item1->idx > item2->idx)
+		return 1;
+	return 0;
+}
+
 static gint
-gs_app_list_randomize_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+gs_app_list_sort_item_cb (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	GsApp *app1 = GS_APP (*(GsApp **) a);
-	GsApp *app2 = GS_APP (*(GsApp **) b);
-	const gchar *k1;
-	const gchar *k2;
-	g_autofree gchar *key = NULL;
+	return gs_app_list_sort_item_cmp (a, b, user_data);
+}
+
+/* sorts the apps by @keys, which has one key for each app in the same order,
+ * then frees the keys; the list mutex must be held */
+static void
+gs_app_list_sort_by_keys_locked (GsAppList *list, gchar **keys)
+{
+	GsAppListSortHelper helper = { NULL, NULL };
+	guint len = list->array->len;
+	g_autofree GsAppListSortKeyItem *items = g_new (GsAppListSortKeyItem, len);
+
+	for (guint i = 0; i < len; i++) {
+		items[i].app = g_ptr_array_index (list->array, i);
+		items[i].key = keys[i];
+		items[i].idx = i;
+	}
+	g_qsort_with_data (items, (gint) len, sizeof (GsAppListSortKeyItem),
+			   gs_app_list_sort_item_cb, &helper);
+
+	/* permute once; the array keeps the references it already holds */
+	for (guint i = 0; i < len; i++) {
+		list->array->pdata[i] = items[i].app;
+		g_free (items[i].key);
+	}
+}
+
+static void
+gs_app_list_heap_sift_up (GsAppListSortKeyItem *heap, guint idx, GsAppListSortHelper *helper)
+{
+	while (idx > 0) {
+		guint parent = (idx - 1) / 2;
+		GsAppListSortKeyItem tmp;
+		if (gs_app_list_sort_item_cmp (&heap[idx], &heap[parent], helper) <= 0)
+			break;
+		tmp = heap[idx];
+		heap[idx] = heap[parent];
+		heap[parent] = tmp;
+		idx = parent;
+	}
+}
+
+static void
+gs_app_list_heap_sift_down (GsAppListSortKeyItem *heap, guint len, GsAppListSortHelper *helper)
+{
+	guint idx = 0;
+	for (;;) {
+		guint largest = idx;
+		guint left = 2 * idx + 1;
+		guint right = 2 * idx + 2;
+		GsAppListSortKeyItem tmp;
+		if (left < len && gs_app_list_sort_item_cmp (&heap[left], &heap[largest], helper) > 0)
+			largest = left;
+		if (right < len && gs_app_list_sort_item_cmp (&heap[right], &heap[largest], helper) > 0)
+			largest = right;
+		if (largest == idx)
+			break;
+		tmp = heap[idx];
+		heap[idx] = heap[largest];
+		heap[largest] = tmp;
+		idx = largest;
+	}
+}
+
+/* keeps only the first @length apps in sorted order, using a bounded max-heap
+ * so that the apps being dropped are never fully sorted; @keys is freed if
+ * set, and the list mutex must be held */
+static void
+gs_app_list_sort_truncate_locked (GsAppList *list,
+				  gchar **keys,
+				  GsAppListSortHelper *helper,
+				  guint length)
+{
+	guint len = list->array->len;
+	guint heap_len = 0;
+	guint n_moved;
+	g_autofree GsAppListSortKeyItem *items = g_new (GsAppListSortKeyItem, len);
+	g_autofree GsAppListSortKeyItem *heap = g_new (GsAppListSortKeyItem, MIN (length, len));
+	g_autofree gboolean *kept = g_new0 (gboolean, len);
+
+	for (guint i = 0; i < len; i++) {
+		items[i].app = g_ptr_array_index (list->array, i);
+		items[i].key = (keys != NULL) ? keys[i] : NULL;
+		items[i].idx = i;
+	}
+
+	/* the worst app kept so far is always at the root */
+	for (guint i = 0; i < len; i++) {
+		if (heap_len < length) {
+			heap[heap_len] = items[i];
+			gs_app_list_heap_sift_up (heap, heap_len, helper);
+			heap_len++;
+			continue;
+		}
+		if (heap_len == 0 ||
+		    gs_app_list_sort_item_cmp (&items[i], &heap[0], helper) >= 0)
+			continue;
+		heap[0] = items[i];
+		gs_app_list_heap_sift_down (heap, heap_len, helper);
+	}
+	g_qsort_with_data (heap, (gint) heap_len, sizeof (GsAppListSortKeyItem),
+			   gs_app_list_sort_item_cb, helper);
+
+	/* move the dropped apps after the kept ones so they get unreffed */
+	for (guint i = 0; i < heap_len; i++) {
+		list->array->pdata[i] = heap[i].app;
+		kept[heap[i].idx] = TRUE;
+	}
+	n_moved = heap_len;
+	for (guint i = 0; i < len; i++) {
+		g_free (items[i].key);
+		if (kept[i])
+			continue;
+		gs_app_list_maybe_unwatch_app (list, items[i].app);
+		list->array->pdata[n_moved++] = items[i].app;
+	}
+	if (heap_len == len)
+		return;
 
-	key = g_strdup_printf ("Plugin::sort-key[%p]", user_data);
-	k1 = gs_app_get_metadata_item (app1, key);
-	k2 = gs_app_get_metadata_item (app2, key);
-	return g_strcmp0 (k1, k2);
+	/* mark this list as unworthy */
+	list->flags |= GS_APP_LIST_FLAG_IS_TRUNCATED;
+	g_ptr_array_set_size (list->array, heap_len);
+	gs_app_list_invalidate_state (list);
+	gs_app_list_invalidate_progress (list);
+}
+
+/**
+ * gs_app_list_sort_truncate:
+ * @list: A #GsAppList
+ * @func: A #GsAppListSortFunc
+ * @user_data: user data to pass to @func
+ * @length: the new length
+ *
+ * Sorts the application list and truncates it to at most @length apps.
+ * This gives the same result as gs_app_list_sort() followed by
+ * gs_app_list_truncate(), but only does O(n log @length) comparisons.
+ *
+ * Since: 40
+ **/
+void
+gs_app_list_sort_truncate (GsAppList *list,
+			   GsAppListSortFunc func,
+			   gpointer user_data,
+			   guint length)
+{
+	GsAppListSortHelper helper = { func, user_data };
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_APP_LIST (list));
+	g_return_if_fail (func != NULL);
+
+	locker = g_mutex_locker_new (&list->mutex);
+	gs_app_list_sort_truncate_locked (list, NULL, &helper, length);
+}
+
+/**
+ * gs_app_list_sort_by_key_truncate:
+ * @list: A #GsAppList
+ * @func: A #GsAppListSortKeyFunc
+ * @user_data: user data to pass to @func
+ * @length: the new length
+ *
+ * Sorts the application list by key, as gs_app_list_sort_by_key() does,
+ * and truncates it to at most @length apps.
+ *
+ * Since: 40
+ **/
+void
+gs_app_list_sort_by_key_truncate (GsAppList *list,
+				  GsAppListSortKeyFunc func,
+				  gpointer user_data,
+				  guint length)
+{
+	GsAppListSortHelper helper = { NULL, NULL };
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autofree gchar **keys = NULL;
+
+	g_return_if_fail (GS_IS_APP_LIST (list));
+	g_return_if_fail (func != NULL);
+
+	locker = g_mutex_locker_new (&list->mutex);
+	keys = g_new (gchar *, list->array->len);
+	for (guint i = 0; i < list->array->len; i++)
+		keys[i] = func (g_ptr_array_index (list->array, i), user_data);
+	gs_app_list_sort_truncate_locked (list, keys, &helper, length);
+}
+
+/**
+ * gs_app_list_sort_by_key:
+ * @list: A #GsAppList
+ * @func: A #GsAppListSortKeyFunc
+ * @user_data: user data to pass to @func
+ *
+ * Sorts the application list by the key returned by @func, which is
+ * called exactly once for each application. Keys are compared with
+ * strcmp(), so they sort in ascending byte order, and applications with
+ * equal keys keep their relative order.
+ *
+ * This is much cheaper than gs_app_list_sort() when the comparison would
+ * otherwise have to build a key for both applications each time.
+ *
+ * Since: 40
+ **/
+void
+gs_app_list_sort_by_key (GsAppList *list, GsAppListSortKeyFunc func, gpointer user_data)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autofree gchar **keys = NULL;
+
+	g_return_if_fail (GS_IS_APP_LIST (list));
+	g_return_if_fail (func != NULL);
+
+	locker = g_mutex_locker_new (&list->mutex);
+	keys = g_new (gchar *, list->array->len);
+	for (guint i = 0; i < list->array->len; i++)
+		keys[i] = func (g_ptr_array_index (list->array, i), user_data);
+	gs_app_list_sort_by_keys_locked (list, keys);
 }
 
 /**
@@ -673,12 +1078,9 @@ gs_app_list_randomize_cb (gconstpointer a, gconstpointer b, gpointer user_data)
 void
 gs_app_list_randomize (GsAppList *list)
 {
-	guint i;
 	GRand *rand;
-	GsApp *app;
-	gchar sort_key[] = { '\0', '\0', '\0', '\0' };
+	g_autofree gchar **keys = NULL;
 	g_autoptr(GDateTime) date = NULL;
-	g_autofree gchar *key = NULL;
 	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_if_fail (GS_IS_APP_LIST (list));
@@ -688,22 +1090,13 @@ gs_app_list_randomize (GsAppList *list)
 	/* mark this list as random */
 	list->flags |= GS_APP_LIST_FLAG_IS_RANDOMIZED;
 
-	key = g_strdup_printf ("Plugin::sort-key[%p]", list);
 	rand = g_rand_new ();
 	date = g_date_time_new_now_utc ();
 	g_rand_set_seed (rand, (guint32) g_date_time_get_day_of_year (date));
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		app = gs_app_list_index (list, i);
-		sort_key[0] = (gchar) g_rand_int_range (rand, (gint32) 'A', (gint32) 'Z');
-		sort_key[1] = (gchar) g_rand_int_range (rand, (gint32) 'A', (gint32) 'Z');
-		sort_key[2] = (gchar) g_rand_int_range (rand, (gint32) 'A', (gint32) 'Z');
-		gs_app_set_metadata (app, key, sort_key);
-	}
-	g_ptr_array_sort_with_data (list->array, gs_app_list_randomize_cb, list);
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		app = gs_app_list_index (list, i);
-		gs_app_set_metadata (app, key, NULL);
-	}
+	keys = g_new (gchar *, list->array->len);
+	for (guint i = 0; i < list->array->len; i++)
+		keys[i] = g_strdup_printf ("%08x", g_rand_int (rand));
+	gs_app_list_sort_by_keys_locked (list, keys);
 	g_rand_free (rand);
 }
 
@@ -49,6 +49,8 @@ G_DECLARE_FINAL_TYPE (GsAppList, gs_app_list, GS, APP_LIST, GObject)
 typedef gboolean (*GsAppListSortFunc)		(GsApp		*app1,
 						 GsApp		*app2,
 						 gpointer	 user_data);
+typedef gchar	*(*GsAppListSortKeyFunc)		(GsApp		*app,
+						 gpointer	 user_data);
 typedef gboolean (*GsAppListFilterFunc)		(GsApp		*app,
 						 gpointer	 user_data);
 
@@ -67,6 +69,9 @@ guint		 gs_app_list_length		(GsAppList	*list);
 void		 gs_app_list_sort		(GsAppList	*list,
 						 GsAppListSortFunc func,
 						 gpointer	 user_data);
+void		 gs_app_list_sort_by_key	(GsAppList	*list,
+						 GsAppListSortKeyFunc func,
+						 gpointer	 user_data);
 void		 gs_app_list_filter		(GsAppList	*list,
 						 GsAppListFilterFunc func,
 						 gpointer	 user_data);
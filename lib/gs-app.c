@@ -59,14 +59,14 @@ typedef struct
 	gchar			*id;
 	gchar			*unique_id;
 	gboolean		 unique_id_valid;
-	gchar			*branch;
+	const gchar		*branch;  /* (interned) */
 	gchar			*name;
 	gchar			*renamed_from;
 	GsAppQuality		 name_quality;
 	GPtrArray		*icons;  /* (nullable) (owned) (element-type AsIcon), sorted by pixel size, smallest first */
 	GPtrArray		*sources;
 	GPtrArray		*source_ids;
-	gchar			*project_group;
+	const gchar		*project_group;  /* (interned) */
 	gchar			*developer_name;
 	gchar			*agreement;
 	gchar			*version;
@@ -79,22 +79,22 @@ typedef struct
 	GPtrArray		*screenshots;
 	GPtrArray		*categories;
 	GArray			*key_colors;  /* (nullable) (element-type GdkRGBA) */
-	GHashTable		*urls;
-	GHashTable		*launchables;
+	GHashTable		*urls;  /* (nullable) (owned) until first set */
+	GHashTable		*launchables;  /* (nullable) (owned) until first set */
 	gchar			*url_missing;
-	gchar			*license;
+	const gchar		*license;  /* (interned) */
 	GsAppQuality		 license_quality;
 	gchar			**menu_path;
-	gchar			*origin;
-	gchar			*origin_ui;
-	gchar			*origin_appstream;
-	gchar			*origin_hostname;
+	const gchar		*origin;  /* (interned) */
+	const gchar		*origin_ui;  /* (interned) */
+	const gchar		*origin_appstream;  /* (interned) */
+	const gchar		*origin_hostname;  /* (interned) */
 	gchar			*update_version;
 	gchar			*update_version_ui;
 	gchar			*update_details;
 	AsUrgencyKind		 update_urgency;
 	GsAppPermissions         update_permissions;
-	gchar			*management_plugin;
+	const gchar		*management_plugin;  /* (interned) */
 	guint			 match_value;
 	guint			 priority;
 	gint			 rating;
@@ -111,10 +111,10 @@ typedef struct
 	AsBundleKind		 bundle_kind;
 	guint			 progress;  /* integer 0–100 (inclusive), or %GS_APP_PROGRESS_UNKNOWN */
 	gboolean		 allow_cancel;
-	GHashTable		*metadata;
-	GsAppList		*addons;
-	GsAppList		*related;
-	GsAppList		*history;
+	GHashTable		*metadata;  /* (nullable) (owned) until first set */
+	GsAppList		*addons;  /* (nullable) (owned) until first add */
+	GsAppList		*related;  /* (nullable) (owned) until first add */
+	GsAppList		*history;  /* (nullable) (owned) until first add */
 	guint64			 install_date;
 	guint64			 release_date;
 	guint64			 kudos;
@@ -169,6 +169,31 @@ _g_set_str (gchar **str_ptr, const gchar *new_str)
 	return TRUE;
 }
 
+/* for strings which are shared by many apps, such as origins and licenses,
+ * which are kept once for the whole process rather than once per app */
+static gboolean
+_g_set_interned_str (const gchar **str_ptr, const gchar *new_str)
+{
+	if (*str_ptr == new_str || g_strcmp0 (*str_ptr, new_str) == 0)
+		return FALSE;
+	*str_ptr = g_intern_string (new_str);
+	return TRUE;
+}
+
+/* returned for the lists which have not been added to yet, so that most apps
+ * do not need an addons, related and history list of their own */
+static GsAppList *
+gs_app_get_empty_list (void)
+{
+	static gsize empty_list = 0;
+
+	if (g_once_init_enter (&empty_list)) {
+		GsAppList *list = gs_app_list_new ();
+		g_once_init_leave (&empty_list, (gsize) list);
+	}
+	return (GsAppList *) empty_list;
+}
+
 static gboolean
 _g_set_strv (gchar ***strv_ptr, gchar **new_strv)
 {
@@ -596,17 +621,21 @@ gs_app_to_string_append (GsApp *app, GString *str)
 		gs_app_kv_lpad (str, "content-rating",
 				as_content_rating_get_kind (priv->content_rating));
 	}
-	tmp = g_hash_table_lookup (priv->urls, as_url_kind_to_string (AS_URL_KIND_HOMEPAGE));
-	if (tmp != NULL)
-		gs_app_kv_lpad (str, "url{homepage}", tmp);
-	keys = g_hash_table_get_keys (priv->launchables);
-	for (GList *l = keys; l != NULL; l = l->next) {
-		g_autofree gchar *key = NULL;
-		key = g_strdup_printf ("launchable{%s}", (const gchar *) l->data);
-		tmp = g_hash_table_lookup (priv->launchables, l->data);
-		gs_app_kv_lpad (str, key, tmp);
+	if (priv->urls != NULL) {
+		tmp = g_hash_table_lookup (priv->urls, as_url_kind_to_string (AS_URL_KIND_HOMEPAGE));
+		if (tmp != NULL)
+			gs_app_kv_lpad (str, "url{homepage}", tmp);
+	}
+	if (priv->launchables != NULL) {
+		keys = g_hash_table_get_keys (priv->launchables);
+		for (GList *l = keys; l != NULL; l = l->next) {
+			g_autofree gchar *key = NULL;
+			key = g_strdup_printf ("launchable{%s}", (const gchar *) l->data);
+			tmp = g_hash_table_lookup (priv->launchables, l->data);
+			gs_app_kv_lpad (str, key, tmp);
+		}
+		g_list_free (keys);
 	}
-	g_list_free (keys);
 	if (priv->license != NULL) {
 		gs_app_kv_lpad (str, "license", priv->license);
 		gs_app_kv_lpad (str, "license-is-free",
@@ -663,14 +692,14 @@ gs_app_to_string_append (GsApp *app, GString *str)
 		gs_app_kv_size (str, "size-installed", priv->size_installed);
 	if (priv->size_download != 0)
 		gs_app_kv_size (str, "size-download", gs_app_get_size_download (app));
-	for (i = 0; i < gs_app_list_length (priv->related); i++) {
+	for (i = 0; priv->related != NULL && i < gs_app_list_length (priv->related); i++) {
 		GsApp *app_tmp = gs_app_list_index (priv->related, i);
 		const gchar *id = gs_app_get_unique_id (app_tmp);
 		if (id == NULL)
 			id = gs_app_get_source_default (app_tmp);
 		gs_app_kv_lpad (str, "related", id);
 	}
-	for (i = 0; i < gs_app_list_length (priv->history); i++) {
+	for (i = 0; priv->history != NULL && i < gs_app_list_length (priv->history); i++) {
 		GsApp *app_tmp = gs_app_list_index (priv->history, i);
 		gs_app_kv_lpad (str, "history", gs_app_get_unique_id (app_tmp));
 	}
@@ -687,7 +716,7 @@ gs_app_to_string_append (GsApp *app, GString *str)
 				  color->green * 255.f,
 				  color->blue * 255.f);
 	}
-	keys = g_hash_table_get_keys (priv->metadata);
+	keys = priv->metadata != NULL ? g_hash_table_get_keys (priv->metadata) : NULL;
 	for (GList *l = keys; l != NULL; l = l->next) {
 		GVariant *val;
 		const GVariantType *val_type;
@@ -1507,7 +1536,7 @@ gs_app_set_branch (GsApp *app, const gchar *branch)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
-	if (_g_set_str (&priv->branch, branch))
+	if (_g_set_interned_str (&priv->branch, branch))
 		priv->unique_id_valid = FALSE;
 }
 
@@ -1759,7 +1788,7 @@ gs_app_set_project_group (GsApp *app, const gchar *project_group)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
-	_g_set_str (&priv->project_group, project_group);
+	_g_set_interned_str (&priv->project_group, project_group);
 }
 
 /**
@@ -2472,6 +2501,8 @@ gs_app_get_url (GsApp *app, AsUrlKind kind)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 	locker = g_mutex_locker_new (&priv->mutex);
+	if (priv->urls == NULL)
+		return NULL;
 	return g_hash_table_lookup (priv->urls, as_url_kind_to_string (kind));
 }
 
@@ -2492,6 +2523,9 @@ gs_app_set_url (GsApp *app, AsUrlKind kind, const gchar *url)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
+	if (priv->urls == NULL)
+		priv->urls = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, g_free);
 	g_hash_table_insert (priv->urls,
 			     g_strdup (as_url_kind_to_string (kind)),
 			     g_strdup (url));
@@ -2561,6 +2595,8 @@ gs_app_get_launchable (GsApp *app, AsLaunchableKind kind)
 	g_autoptr(GMutexLocker) locker = NULL;
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 	locker = g_mutex_locker_new (&priv->mutex);
+	if (priv->launchables == NULL)
+		return NULL;
 	return g_hash_table_lookup (priv->launchables,
 				    as_launchable_kind_to_string (kind));
 }
@@ -2585,6 +2621,9 @@ gs_app_set_launchable (GsApp *app, AsLaunchableKind kind, const gchar *launchabl
 	g_return_if_fail (GS_IS_APP (app));
 	locker = g_mutex_locker_new (&priv->mutex);
 	key = as_launchable_kind_to_string (kind);
+	if (priv->launchables == NULL)
+		priv->launchables = g_hash_table_new_full (g_str_hash, g_str_equal,
+							   NULL, g_free);
 	if (g_hash_table_lookup_extended (priv->launchables, key, NULL, &current_value)) {
 		if (g_strcmp0 ((const gchar *) current_value, launchable) != 0)
 			g_debug ("Preventing app '%s' replace of %s's launchable '%s' with '%s'",
@@ -2661,7 +2700,7 @@ gs_app_set_license (GsApp *app, GsAppQuality quality, const gchar *license)
 
 	priv->license_is_free = as_license_is_free_license (license);
 
-	_g_set_str (&priv->license, license);
+	_g_set_interned_str (&priv->license, license);
 }
 
 /**
@@ -2839,8 +2878,7 @@ gs_app_set_origin (GsApp *app, const gchar *origin)
 		return;
 	}
 
-	g_free (priv->origin);
-	priv->origin = g_strdup (origin);
+	priv->origin = g_intern_string (origin);
 
 	/* no longer valid */
 	priv->unique_id_valid = FALSE;
@@ -2886,8 +2924,7 @@ gs_app_set_origin_appstream (GsApp *app, const gchar *origin_appstream)
 	if (g_strcmp0 (origin_appstream, priv->origin_appstream) == 0)
 		return;
 
-	g_free (priv->origin_appstream);
-	priv->origin_appstream = g_strdup (origin_appstream);
+	priv->origin_appstream = g_intern_string (origin_appstream);
 }
 
 /**
@@ -2939,7 +2976,6 @@ gs_app_set_origin_hostname (GsApp *app, const gchar *origin_hostname)
 	/* same */
 	if (g_strcmp0 (origin_hostname, priv->origin_hostname) == 0)
 		return;
-	g_free (priv->origin_hostname);
 
 	/* use libsoup to convert a URL */
 	uri = soup_uri_new (origin_hostname);
@@ -2957,7 +2993,7 @@ gs_app_set_origin_hostname (GsApp *app, const gchar *origin_hostname)
 		origin_hostname = "localhost";
 
 	/* success */
-	priv->origin_hostname = g_strdup (origin_hostname);
+	priv->origin_hostname = g_intern_string (origin_hostname);
 }
 
 /**
@@ -3214,8 +3250,7 @@ gs_app_set_management_plugin (GsApp *app, const gchar *management_plugin)
 		return;
 	}
 
-	g_free (priv->management_plugin);
-	priv->management_plugin = g_strdup (management_plugin);
+	priv->management_plugin = g_intern_string (management_plugin);
 }
 
 /**
@@ -3458,7 +3493,7 @@ gs_app_get_size_download (GsApp *app)
 	}
 
 	/* add related apps */
-	for (guint i = 0; i < gs_app_list_length (priv->related); i++) {
+	for (guint i = 0; priv->related != NULL && i < gs_app_list_length (priv->related); i++) {
 		GsApp *app_related = gs_app_list_index (priv->related, i);
 		sz += gs_app_get_size_download (app_related);
 	}
@@ -3509,7 +3544,7 @@ gs_app_get_size_installed (GsApp *app)
 	sz = priv->size_installed;
 
 	/* add related apps */
-	for (guint i = 0; i < gs_app_list_length (priv->related); i++) {
+	for (guint i = 0; priv->related != NULL && i < gs_app_list_length (priv->related); i++) {
 		GsApp *app_related = gs_app_list_index (priv->related, i);
 		sz += gs_app_get_size_installed (app_related);
 	}
@@ -3601,6 +3636,8 @@ gs_app_get_metadata_variant (GsApp *app, const gchar *key)
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
 	g_return_val_if_fail (key != NULL, NULL);
+	if (priv->metadata == NULL)
+		return NULL;
 	return g_hash_table_lookup (priv->metadata, key);
 }
 
@@ -3629,11 +3666,17 @@ gs_app_set_metadata_variant (GsApp *app, const gchar *key, GVariant *value)
 
 	/* if no value, then remove the key */
 	if (value == NULL) {
-		g_hash_table_remove (priv->metadata, key);
+		if (priv->metadata != NULL)
+			g_hash_table_remove (priv->metadata, key);
 		return;
 	}
 
 	/* check we're not overwriting */
+	if (priv->metadata == NULL) {
+		priv->metadata = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free,
+							(GDestroyNotify) g_variant_unref);
+	}
 	found = g_hash_table_lookup (priv->metadata, key);
 	if (found != NULL) {
 		if (g_variant_equal (found, value))
@@ -3659,7 +3702,8 @@ gs_app_set_metadata_variant (GsApp *app, const gchar *key, GVariant *value)
  * gs_app_get_addons:
  * @app: a #GsApp
  *
- * Gets the list of addons for the application.
+ * Gets the list of addons for the application. The list must not be
+ * modified; use gs_app_add_addon() and gs_app_remove_addon() instead.
  *
  * Returns: (transfer none): a list of addons
  *
@@ -3670,6 +3714,8 @@ gs_app_get_addons (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
+	if (priv->addons == NULL)
+		return gs_app_get_empty_list ();
 	return priv->addons;
 }
 
@@ -3692,6 +3738,8 @@ gs_app_add_addon (GsApp *app, GsApp *addon)
 	g_return_if_fail (GS_IS_APP (addon));
 
 	locker = g_mutex_locker_new (&priv->mutex);
+	if (priv->addons == NULL)
+		priv->addons = gs_app_list_new ();
 	gs_app_list_add (priv->addons, addon);
 }
 
@@ -3712,14 +3760,16 @@ gs_app_remove_addon (GsApp *app, GsApp *addon)
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (addon));
 	locker = g_mutex_locker_new (&priv->mutex);
-	gs_app_list_remove (priv->addons, addon);
+	if (priv->addons != NULL)
+		gs_app_list_remove (priv->addons, addon);
 }
 
 /**
  * gs_app_get_related:
  * @app: a #GsApp
  *
- * Gets any related applications.
+ * Gets any related applications. The list must not be modified; use
+ * gs_app_add_related() instead.
  *
  * Returns: (transfer none): a list of applications
  *
@@ -3730,6 +3780,8 @@ gs_app_get_related (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
+	if (priv->related == NULL)
+		return gs_app_get_empty_list ();
 	return priv->related;
 }
 
@@ -3760,6 +3812,8 @@ gs_app_add_related (GsApp *app, GsApp *app2)
 	    priv2->state == GS_APP_STATE_UPDATABLE)
 		priv->state = priv2->state;
 
+	if (priv->related == NULL)
+		priv->related = gs_app_list_new ();
 	gs_app_list_add (priv->related, app2);
 }
 
@@ -3767,7 +3821,8 @@ gs_app_add_related (GsApp *app, GsApp *app2)
  * gs_app_get_history:
  * @app: a #GsApp
  *
- * Gets the history of this application.
+ * Gets the history of this application. The list must not be modified; use
+ * gs_app_add_history() instead.
  *
  * Returns: (transfer none): a list
  *
@@ -3778,6 +3833,8 @@ gs_app_get_history (GsApp *app)
 {
 	GsAppPrivate *priv = gs_app_get_instance_private (app);
 	g_return_val_if_fail (GS_IS_APP (app), NULL);
+	if (priv->history == NULL)
+		return gs_app_get_empty_list ();
 	return priv->history;
 }
 
@@ -3798,6 +3855,8 @@ gs_app_add_history (GsApp *app, GsApp *app2)
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (app2));
 	locker = g_mutex_locker_new (&priv->mutex);
+	if (priv->history == NULL)
+		priv->history = gs_app_list_new ();
 	gs_app_list_add (priv->history, app2);
 }
 
@@ -4806,21 +4865,14 @@ gs_app_finalize (GObject *object)
 	g_mutex_clear (&priv->mutex);
 	g_free (priv->id);
 	g_free (priv->unique_id);
-	g_free (priv->branch);
 	g_free (priv->name);
 	g_free (priv->renamed_from);
 	g_free (priv->url_missing);
-	g_hash_table_unref (priv->urls);
-	g_hash_table_unref (priv->launchables);
-	g_free (priv->license);
+	g_clear_pointer (&priv->urls, g_hash_table_unref);
+	g_clear_pointer (&priv->launchables, g_hash_table_unref);
 	g_strfreev (priv->menu_path);
-	g_free (priv->origin);
-	g_free (priv->origin_ui);
-	g_free (priv->origin_appstream);
-	g_free (priv->origin_hostname);
 	g_ptr_array_unref (priv->sources);
 	g_ptr_array_unref (priv->source_ids);
-	g_free (priv->project_group);
 	g_free (priv->developer_name);
 	g_free (priv->agreement);
 	g_free (priv->version);
@@ -4831,8 +4883,7 @@ gs_app_finalize (GObject *object)
 	g_free (priv->update_version);
 	g_free (priv->update_version_ui);
 	g_free (priv->update_details);
-	g_free (priv->management_plugin);
-	g_hash_table_unref (priv->metadata);
+	g_clear_pointer (&priv->metadata, g_hash_table_unref);
 	g_ptr_array_unref (priv->categories);
 	g_clear_pointer (&priv->key_colors, g_array_unref);
 	g_clear_object (&priv->cancellable);
@@ -5016,24 +5067,9 @@ gs_app_init (GsApp *app)
 	priv->sources = g_ptr_array_new_with_free_func (g_free);
 	priv->source_ids = g_ptr_array_new_with_free_func (g_free);
 	priv->categories = g_ptr_array_new_with_free_func (g_free);
-	priv->addons = gs_app_list_new ();
-	priv->related = gs_app_list_new ();
-	priv->history = gs_app_list_new ();
 	priv->screenshots = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->reviews = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->provided = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	priv->metadata = g_hash_table_new_full (g_str_hash,
-	                                        g_str_equal,
-	                                        g_free,
-	                                        (GDestroyNotify) g_variant_unref);
-	priv->urls = g_hash_table_new_full (g_str_hash,
-	                                    g_str_equal,
-	                                    g_free,
-	                                    g_free);
-	priv->launchables = g_hash_table_new_full (g_str_hash,
-	                                           g_str_equal,
-	                                           NULL,
-	                                           g_free);
 	priv->allow_cancel = TRUE;
 	g_mutex_init (&priv->mutex);
 }
@@ -5210,8 +5246,7 @@ gs_app_set_origin_ui (GsApp *app,
 	if (g_strcmp0 (priv->origin_ui, origin_ui) == 0)
 		return;
 
-	g_free (priv->origin_ui);
-	priv->origin_ui = g_strdup (origin_ui);
+	priv->origin_ui = g_intern_string (origin_ui);
 }
 
 /**
@@ -5288,6 +5323,9 @@ gs_app_subsume_metadata (GsApp *app, GsApp *donor)
 	g_return_if_fail (GS_IS_APP (app));
 	g_return_if_fail (GS_IS_APP (donor));
 
+	if (priv->metadata == NULL)
+		return;
+
 	keys = g_hash_table_get_keys (priv->metadata);
 	for (GList *l = keys; l != NULL; l = l->next) {
 		const gchar *key = l->data;
@@ -0,0 +1,409 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-icon-atlas
+ * @short_description: A memory-mappable store of pre-decoded icons
+ *
+ * A #GsIconAtlas is a single file containing many icons, already decoded and
+ * scaled to one size and scale, plus an index from the icon URI to the
+ * location of its pixels in the file.
+ *
+ * Atlases are built with gs_icon_atlas_build(), typically by a plugin when
+ * it compiles its metadata, and loaded with gs_icon_atlas_new_from_file().
+ * Loading maps the file into memory, so looking up an icon with
+ * gs_icon_atlas_lookup() does no I/O or decoding: the returned #GdkPixbuf
+ * points straight into the mapped file.
+ *
+ * The file is a serialised #GVariant of type `(suua{s(uut)}ay)`, containing
+ * the GUID of the metadata the atlas was built from, the icon size and scale,
+ * the index mapping each URI to its width, height and offset, and the RGBA
+ * pixel data.
+ *
+ * #GsIconAtlas is immutable after construction and hence is entirely thread
+ * safe.
+ *
+ * Since: 40
+ */
+
+#include "config.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include "gs-icon-atlas.h"
+#include "gs-remote-icon.h"
+
+#define GS_ICON_ATLAS_VARIANT_TYPE	"(suua{s(uut)}ay)"
+
+/* icons are stored with 8-bit RGBA pixels and no row padding */
+#define GS_ICON_ATLAS_N_CHANNELS	4
+
+typedef struct {
+	guint		 width;
+	guint		 height;
+	guint64		 offset;
+} GsIconAtlasEntry;
+
+struct _GsIconAtlas
+{
+	GObject		 parent_instance;
+
+	GVariant	*data;		/* (owned), the whole mapped file */
+	GVariant	*pixels;	/* (owned), child of @data */
+	const guint8	*pixels_data;	/* (unowned), points into @pixels */
+	gsize		 pixels_size;
+	const gchar	*guid;		/* (unowned), points into @data */
+	guint		 size;
+	guint		 scale;
+	GHashTable	*index;		/* (owned) URI : GsIconAtlasEntry */
+};
+
+G_DEFINE_TYPE (GsIconAtlas, gs_icon_atlas, G_TYPE_OBJECT)
+
+static void
+gs_icon_atlas_finalize (GObject *object)
+{
+	GsIconAtlas *self = GS_ICON_ATLAS (object);
+
+	g_hash_table_unref (self->index);
+	g_clear_pointer (&self->pixels, g_variant_unref);
+	g_clear_pointer (&self->data, g_variant_unref);
+
+	G_OBJECT_CLASS (gs_icon_atlas_parent_class)->finalize (object);
+}
+
+static void
+gs_icon_atlas_class_init (GsIconAtlasClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gs_icon_atlas_finalize;
+}
+
+static void
+gs_icon_atlas_init (GsIconAtlas *self)
+{
+	self->index = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+}
+
+/**
+ * gs_icon_atlas_new_from_file:
+ * @filename: the atlas file, as written by gs_icon_atlas_build()
+ * @error: return location for a #GError, or %NULL
+ *
+ * Maps an icon atlas into memory and loads its index.
+ *
+ * Returns: (transfer full): a #GsIconAtlas, or %NULL on error
+ *
+ * Since: 40
+ **/
+GsIconAtlas *
+gs_icon_atlas_new_from_file (const gchar *filename, GError **error)
+{
+	GVariantIter iter;
+	const gchar *uri;
+	guint width, height;
+	guint64 offset;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autoptr(GVariant) index = NULL;
+	g_autoptr(GsIconAtlas) self = NULL;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+	bytes = g_mapped_file_get_bytes (mapped);
+
+	self = g_object_new (GS_TYPE_ICON_ATLAS, NULL);
+	self->data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GS_ICON_ATLAS_VARIANT_TYPE),
+								   bytes, FALSE));
+	g_variant_get (self->data, "(&suu@a{s(uut)}@ay)",
+		       &self->guid, &self->size, &self->scale,
+		       &index, &self->pixels);
+	if (self->size == 0 || self->scale == 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s is not a valid icon atlas", filename);
+		return NULL;
+	}
+	self->pixels_data = g_variant_get_fixed_array (self->pixels,
+						       &self->pixels_size,
+						       sizeof (guint8));
+
+	/* skip anything which would point outside the pixel data */
+	g_variant_iter_init (&iter, index);
+	while (g_variant_iter_next (&iter, "{&s(uut)}", &uri, &width, &height, &offset)) {
+		GsIconAtlasEntry *entry;
+
+		if (width == 0 || width > self->size * self->scale ||
+		    height == 0 || height > self->size * self->scale ||
+		    offset > self->pixels_size ||
+		    (guint64) width * height * GS_ICON_ATLAS_N_CHANNELS > self->pixels_size - offset) {
+			g_debug ("ignoring invalid entry for %s in %s", uri, filename);
+			continue;
+		}
+		entry = g_new0 (GsIconAtlasEntry, 1);
+		entry->width = width;
+		entry->height = height;
+		entry->offset = offset;
+		g_hash_table_replace (self->index, (gpointer) uri, entry);
+	}
+
+	return g_steal_pointer (&self);
+}
+
+static gboolean
+gs_icon_atlas_append_pixbuf (GByteArray *pixels, GdkPixbuf *pixbuf_in)
+{
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	const guint8 *data;
+	gint width, height, rowstride;
+
+	if (gdk_pixbuf_get_colorspace (pixbuf_in) != GDK_COLORSPACE_RGB ||
+	    gdk_pixbuf_get_bits_per_sample (pixbuf_in) != 8)
+		return FALSE;
+	if (gdk_pixbuf_get_has_alpha (pixbuf_in))
+		pixbuf = g_object_ref (pixbuf_in);
+	else
+		pixbuf = gdk_pixbuf_add_alpha (pixbuf_in, FALSE, 0, 0, 0);
+	if (pixbuf == NULL ||
+	    gdk_pixbuf_get_n_channels (pixbuf) != GS_ICON_ATLAS_N_CHANNELS)
+		return FALSE;
+
+	/* drop any row padding */
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+	rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+	data = gdk_pixbuf_read_pixels (pixbuf);
+	for (gint y = 0; y < height; y++)
+		g_byte_array_append (pixels, data + y * rowstride,
+				     (guint) width * GS_ICON_ATLAS_N_CHANNELS);
+	return TRUE;
+}
+
+/**
+ * gs_icon_atlas_build:
+ * @filename: the atlas file to write
+ * @guid: the GUID of the metadata @icons came from, or %NULL
+ * @size: size of the icons, in logical pixels
+ * @scale: scale of the icons
+ * @icons: (element-type GIcon): the icons to add
+ * @size_max: the maximum size of the pixel data, in bytes, or 0 for unlimited
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Decodes @icons at @size×@scale device pixels and writes them all to a
+ * single atlas file, replacing @filename atomically.
+ *
+ * Only icons backed by a local file can be added; others are ignored, as are
+ * icons which fail to load. Icons are added in order until the pixel data
+ * would exceed @size_max; the rest are left out of the atlas.
+ *
+ * @guid is stored in the atlas so that callers can check whether it is up to
+ * date, using gs_icon_atlas_get_guid().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 40
+ **/
+gboolean
+gs_icon_atlas_build (const gchar *filename,
+		     const gchar *guid,
+		     guint size,
+		     guint scale,
+		     GPtrArray *icons,
+		     gsize size_max,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	GVariantBuilder index;
+	guint n_icons = 0;
+	g_autoptr(GByteArray) pixels = g_byte_array_new ();
+	g_autoptr(GHashTable) uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_autoptr(GVariant) data = NULL;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (size > 0, FALSE);
+	g_return_val_if_fail (scale >= 1, FALSE);
+	g_return_val_if_fail (icons != NULL, FALSE);
+
+	g_variant_builder_init (&index, G_VARIANT_TYPE ("a{s(uut)}"));
+	for (guint i = 0; i < icons->len; i++) {
+		GIcon *icon = g_ptr_array_index (icons, i);
+		guint old_len = pixels->len;
+		g_autofree gchar *path = NULL;
+		g_autofree gchar *uri = NULL;
+		g_autoptr(GdkPixbuf) pixbuf = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			g_variant_builder_clear (&index);
+			return FALSE;
+		}
+
+		/* remote icons are looked up by their remote URI, which says
+		 * nothing about whether they have been downloaded yet */
+		if (!G_IS_FILE_ICON (icon) || GS_IS_REMOTE_ICON (icon))
+			continue;
+		path = g_file_get_path (g_file_icon_get_file (G_FILE_ICON (icon)));
+		if (path == NULL)
+			continue;
+		uri = g_file_get_uri (g_file_icon_get_file (G_FILE_ICON (icon)));
+		if (g_hash_table_contains (uris, uri))
+			continue;
+
+		pixbuf = gdk_pixbuf_new_from_file_at_size (path,
+							   (gint) (size * scale),
+							   (gint) (size * scale),
+							   &error_local);
+		if (pixbuf == NULL) {
+			g_debug ("not adding %s to icon atlas: %s",
+				 path, error_local->message);
+			continue;
+		}
+		if (size_max > 0 &&
+		    pixels->len + (gsize) gdk_pixbuf_get_width (pixbuf) *
+		    gdk_pixbuf_get_height (pixbuf) * GS_ICON_ATLAS_N_CHANNELS > size_max) {
+			g_debug ("icon atlas %s full after %u icons", filename, n_icons);
+			break;
+		}
+		if (!gs_icon_atlas_append_pixbuf (pixels, pixbuf)) {
+			g_debug ("not adding %s to icon atlas: unsupported format", path);
+			continue;
+		}
+		g_variant_builder_add (&index, "{s(uut)}", uri,
+				       (guint) gdk_pixbuf_get_width (pixbuf),
+				       (guint) gdk_pixbuf_get_height (pixbuf),
+				       (guint64) old_len);
+		g_hash_table_add (uris, g_steal_pointer (&uri));
+		n_icons++;
+	}
+
+	data = g_variant_ref_sink (g_variant_new ("(suua{s(uut)}@ay)",
+						  guid != NULL ? guid : "",
+						  size, scale, &index,
+						  g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+									     pixels->data,
+									     pixels->len,
+									     sizeof (guint8))));
+	g_debug ("writing %u icons to %s", n_icons, filename);
+	return g_file_set_contents (filename,
+				    g_variant_get_data (data),
+				    (gssize) g_variant_get_size (data),
+				    error);
+}
+
+/**
+ * gs_icon_atlas_get_guid:
+ * @self: a #GsIconAtlas
+ *
+ * Gets the GUID passed to gs_icon_atlas_build() when the atlas was built.
+ *
+ * Returns: the GUID, which may be empty
+ *
+ * Since: 40
+ **/
+const gchar *
+gs_icon_atlas_get_guid (GsIconAtlas *self)
+{
+	g_return_val_if_fail (GS_IS_ICON_ATLAS (self), NULL);
+	return self->guid;
+}
+
+/**
+ * gs_icon_atlas_get_size:
+ * @self: a #GsIconAtlas
+ *
+ * Gets the size of the icons in the atlas, in logical pixels.
+ *
+ * Returns: the size
+ *
+ * Since: 40
+ **/
+guint
+gs_icon_atlas_get_size (GsIconAtlas *self)
+{
+	g_return_val_if_fail (GS_IS_ICON_ATLAS (self), 0);
+	return self->size;
+}
+
+/**
+ * gs_icon_atlas_get_scale:
+ * @self: a #GsIconAtlas
+ *
+ * Gets the scale of the icons in the atlas.
+ *
+ * Returns: the scale
+ *
+ * Since: 40
+ **/
+guint
+gs_icon_atlas_get_scale (GsIconAtlas *self)
+{
+	g_return_val_if_fail (GS_IS_ICON_ATLAS (self), 0);
+	return self->scale;
+}
+
+/**
+ * gs_icon_atlas_get_n_icons:
+ * @self: a #GsIconAtlas
+ *
+ * Gets the number of icons in the atlas.
+ *
+ * Returns: the number of icons
+ *
+ * Since: 40
+ **/
+guint
+gs_icon_atlas_get_n_icons (GsIconAtlas *self)
+{
+	g_return_val_if_fail (GS_IS_ICON_ATLAS (self), 0);
+	return g_hash_table_size (self->index);
+}
+
+static void
+gs_icon_atlas_pixbuf_destroy_cb (guchar *pixels, gpointer user_data)
+{
+	g_variant_unref (user_data);
+}
+
+/**
+ * gs_icon_atlas_lookup:
+ * @self: a #GsIconAtlas
+ * @uri: the URI of the icon file
+ *
+ * Looks up an icon in the atlas. The returned pixbuf shares its pixels with
+ * the mapped atlas file and must not be modified.
+ *
+ * Returns: (transfer full) (nullable): a #GdkPixbuf, or %NULL if @uri is
+ *     not in the atlas
+ *
+ * Since: 40
+ **/
+GdkPixbuf *
+gs_icon_atlas_lookup (GsIconAtlas *self, const gchar *uri)
+{
+	GsIconAtlasEntry *entry;
+
+	g_return_val_if_fail (GS_IS_ICON_ATLAS (self), NULL);
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	entry = g_hash_table_lookup (self->index, uri);
+	if (entry == NULL)
+		return NULL;
+	return gdk_pixbuf_new_from_data ((guchar *) self->pixels_data + entry->offset,
+					 GDK_COLORSPACE_RGB, TRUE, 8,
+					 (gint) entry->width,
+					 (gint) entry->height,
+					 (gint) entry->width * GS_ICON_ATLAS_N_CHANNELS,
+					 gs_icon_atlas_pixbuf_destroy_cb,
+					 g_variant_ref (self->pixels));
+}
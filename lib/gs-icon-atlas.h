@@ -0,0 +1,40 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_ICON_ATLAS (gs_icon_atlas_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsIconAtlas, gs_icon_atlas, GS, ICON_ATLAS, GObject)
+
+GsIconAtlas	*gs_icon_atlas_new_from_file	(const gchar		 *filename,
+						 GError			**error);
+gboolean	 gs_icon_atlas_build		(const gchar		 *filename,
+						 const gchar		 *guid,
+						 guint			  size,
+						 guint			  scale,
+						 GPtrArray		 *icons,
+						 gsize			  size_max,
+						 GCancellable		 *cancellable,
+						 GError			**error);
+
+const gchar	*gs_icon_atlas_get_guid		(GsIconAtlas		 *self);
+guint		 gs_icon_atlas_get_size		(GsIconAtlas		 *self);
+guint		 gs_icon_atlas_get_scale	(GsIconAtlas		 *self);
+guint		 gs_icon_atlas_get_n_icons	(GsIconAtlas		 *self);
+GdkPixbuf	*gs_icon_atlas_lookup		(GsIconAtlas		 *self,
+						 const gchar		 *uri);
+
+G_END_DECLS
@@ -35,6 +35,7 @@
 #include <gtk/gtk.h>
 
 #include "gs-icon.h"
+#include "gs-icon-atlas.h"
 #include "gs-remote-icon.h"
 
 /**
@@ -313,3 +314,289 @@ gs_icon_new_for_appstream_icon (AsIcon *appstream_icon)
 
 	return g_steal_pointer (&icon);
 }
+
+/* Decoded icons are shared between all the widgets and #GsApps using the same
+ * icon at the same size. The most recently used ones are kept alive up to a
+ * budget; older ones remain available for as long as something else still
+ * holds a reference to them. */
+#define GS_ICON_PIXBUF_CACHE_SIZE_MAX	(16 * 1024 * 1024) /* bytes */
+
+typedef struct {
+	gchar		*key;
+	GWeakRef	 pixbuf_weak;
+	GdkPixbuf	*pixbuf;	/* (nullable) (owned), set while in the LRU queue */
+	GList		*link;		/* (nullable), in pixbuf_cache_lru */
+	gsize		 size;
+} GsIconPixbufCacheEntry;
+
+G_LOCK_DEFINE_STATIC (pixbuf_cache);
+static GHashTable *pixbuf_cache = NULL;		/* (owned) key : GsIconPixbufCacheEntry */
+static GQueue pixbuf_cache_lru = G_QUEUE_INIT;	/* most recently used first */
+static gsize pixbuf_cache_size = 0;
+static GPtrArray *icon_atlases = NULL;		/* (owned) (element-type GsIconAtlas) */
+
+static void
+gs_icon_pixbuf_cache_entry_free (GsIconPixbufCacheEntry *entry)
+{
+	g_assert (entry->link == NULL);
+	g_weak_ref_clear (&entry->pixbuf_weak);
+	g_clear_object (&entry->pixbuf);
+	g_free (entry->key);
+	g_slice_free (GsIconPixbufCacheEntry, entry);
+}
+
+/* must be called with the lock held */
+static void
+gs_icon_pixbuf_cache_promote (GsIconPixbufCacheEntry *entry, GdkPixbuf *pixbuf)
+{
+	if (entry->link != NULL) {
+		g_queue_unlink (&pixbuf_cache_lru, entry->link);
+		g_queue_push_head_link (&pixbuf_cache_lru, entry->link);
+		return;
+	}
+	entry->pixbuf = g_object_ref (pixbuf);
+	g_queue_push_head (&pixbuf_cache_lru, entry);
+	entry->link = pixbuf_cache_lru.head;
+	pixbuf_cache_size += entry->size;
+}
+
+/* must be called with the lock held */
+static void
+gs_icon_pixbuf_cache_trim (gsize size_max)
+{
+	GHashTableIter iter;
+	gpointer value;
+	gboolean trimmed = FALSE;
+
+	while (pixbuf_cache_size > size_max && !g_queue_is_empty (&pixbuf_cache_lru)) {
+		GsIconPixbufCacheEntry *entry = g_queue_pop_tail (&pixbuf_cache_lru);
+		entry->link = NULL;
+		pixbuf_cache_size -= entry->size;
+		g_clear_object (&entry->pixbuf);
+		trimmed = TRUE;
+	}
+	if (!trimmed || pixbuf_cache == NULL)
+		return;
+
+	/* drop the entries which nothing is using any more */
+	g_hash_table_iter_init (&iter, pixbuf_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GsIconPixbufCacheEntry *entry = value;
+		g_autoptr(GdkPixbuf) pixbuf = NULL;
+
+		if (entry->link != NULL)
+			continue;
+		pixbuf = g_weak_ref_get (&entry->pixbuf_weak);
+		if (pixbuf == NULL)
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
+static GdkPixbuf *
+gs_icon_pixbuf_cache_lookup (const gchar *key)
+{
+	GsIconPixbufCacheEntry *entry;
+	GdkPixbuf *pixbuf;
+
+	G_LOCK (pixbuf_cache);
+	entry = pixbuf_cache != NULL ? g_hash_table_lookup (pixbuf_cache, key) : NULL;
+	if (entry == NULL) {
+		G_UNLOCK (pixbuf_cache);
+		return NULL;
+	}
+	pixbuf = g_weak_ref_get (&entry->pixbuf_weak);
+	if (pixbuf != NULL) {
+		gs_icon_pixbuf_cache_promote (entry, pixbuf);
+		gs_icon_pixbuf_cache_trim (GS_ICON_PIXBUF_CACHE_SIZE_MAX);
+	}
+	G_UNLOCK (pixbuf_cache);
+	return pixbuf;
+}
+
+/* returns the pixbuf to use, which may be one added concurrently by another
+ * thread rather than @pixbuf */
+static GdkPixbuf *
+gs_icon_pixbuf_cache_insert (const gchar *key, GdkPixbuf *pixbuf)
+{
+	GsIconPixbufCacheEntry *entry;
+	GdkPixbuf *pixbuf_existing = NULL;
+
+	G_LOCK (pixbuf_cache);
+	if (pixbuf_cache == NULL) {
+		pixbuf_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+						      NULL, (GDestroyNotify) gs_icon_pixbuf_cache_entry_free);
+	}
+	entry = g_hash_table_lookup (pixbuf_cache, key);
+	if (entry != NULL)
+		pixbuf_existing = g_weak_ref_get (&entry->pixbuf_weak);
+	if (pixbuf_existing != NULL) {
+		pixbuf = pixbuf_existing;
+	} else {
+		if (entry == NULL) {
+			entry = g_slice_new0 (GsIconPixbufCacheEntry);
+			entry->key = g_strdup (key);
+			g_weak_ref_init (&entry->pixbuf_weak, NULL);
+			g_hash_table_insert (pixbuf_cache, entry->key, entry);
+		}
+		g_weak_ref_set (&entry->pixbuf_weak, pixbuf);
+		entry->size = (gsize) gdk_pixbuf_get_rowstride (pixbuf) *
+			      (gsize) gdk_pixbuf_get_height (pixbuf);
+		g_object_ref (pixbuf);
+	}
+	gs_icon_pixbuf_cache_promote (entry, pixbuf);
+	gs_icon_pixbuf_cache_trim (GS_ICON_PIXBUF_CACHE_SIZE_MAX);
+	G_UNLOCK (pixbuf_cache);
+
+	return pixbuf;
+}
+
+static GsIconAtlas *
+gs_icon_get_atlas (guint size, guint scale)
+{
+	GsIconAtlas *atlas = NULL;
+
+	G_LOCK (pixbuf_cache);
+	for (guint i = 0; icon_atlases != NULL && i < icon_atlases->len; i++) {
+		GsIconAtlas *atlas_tmp = g_ptr_array_index (icon_atlases, i);
+		if (gs_icon_atlas_get_size (atlas_tmp) == size &&
+		    gs_icon_atlas_get_scale (atlas_tmp) == scale) {
+			atlas = g_object_ref (atlas_tmp);
+			break;
+		}
+	}
+	G_UNLOCK (pixbuf_cache);
+	return atlas;
+}
+
+/**
+ * gs_icon_add_atlas:
+ * @atlas: a #GsIconAtlas
+ *
+ * Makes the icons in @atlas available to gs_icon_load_pixbuf(), replacing
+ * any atlas previously added for the same size and scale.
+ *
+ * This can be called from any thread.
+ *
+ * Since: 40
+ */
+void
+gs_icon_add_atlas (GsIconAtlas *atlas)
+{
+	g_return_if_fail (GS_IS_ICON_ATLAS (atlas));
+
+	G_LOCK (pixbuf_cache);
+	if (icon_atlases == NULL)
+		icon_atlases = g_ptr_array_new_with_free_func (g_object_unref);
+	for (guint i = 0; i < icon_atlases->len; i++) {
+		GsIconAtlas *atlas_tmp = g_ptr_array_index (icon_atlases, i);
+		if (gs_icon_atlas_get_size (atlas_tmp) == gs_icon_atlas_get_size (atlas) &&
+		    gs_icon_atlas_get_scale (atlas_tmp) == gs_icon_atlas_get_scale (atlas)) {
+			g_ptr_array_remove_index_fast (icon_atlases, i);
+			break;
+		}
+	}
+	g_ptr_array_add (icon_atlases, g_object_ref (atlas));
+	G_UNLOCK (pixbuf_cache);
+}
+
+/**
+ * gs_icon_load_pixbuf:
+ * @icon: a #GIcon
+ * @size: size (width or height, square) of the icon, in logical pixels
+ * @scale: scale of the icon, typically from gtk_widget_get_scale_factor()
+ * @error: return location for a #GError, or %NULL
+ *
+ * Loads @icon at @size×@scale device pixels, sharing the decoded pixbuf with
+ * every other caller loading the same icon file at the same size. This avoids
+ * decoding the same icon once per #GsApp and once per widget when it is shown
+ * on several pages. Icons found in an atlas added with gs_icon_add_atlas() are
+ * not decoded at all.
+ *
+ * The returned pixbuf is shared and must not be modified.
+ *
+ * Only icons backed by a local file are supported, including #GsRemoteIcon
+ * once gs_remote_icon_ensure_cached() has been called. For other icons, such
+ * as themed icons, %G_IO_ERROR_NOT_SUPPORTED is returned and the caller should
+ * fall back to loading @icon with the icon theme.
+ *
+ * This can be called from any thread.
+ *
+ * Returns: (transfer full): a #GdkPixbuf, or %NULL on error
+ * Since: 40
+ */
+GdkPixbuf *
+gs_icon_load_pixbuf (GIcon   *icon,
+		     guint    size,
+		     guint    scale,
+		     GError **error)
+{
+	GFile *file;
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *path = NULL;
+	g_autofree gchar *uri = NULL;
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_autoptr(GsIconAtlas) atlas = NULL;
+
+	g_return_val_if_fail (G_IS_ICON (icon), NULL);
+	g_return_val_if_fail (size > 0, NULL);
+	g_return_val_if_fail (scale >= 1, NULL);
+
+	if (!G_IS_FILE_ICON (icon)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			     "Icon of type %s is not backed by a file",
+			     G_OBJECT_TYPE_NAME (icon));
+		return NULL;
+	}
+	file = g_file_icon_get_file (G_FILE_ICON (icon));
+	path = g_file_get_path (file);
+	if (path == NULL) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+				     "Icon is not a local file");
+		return NULL;
+	}
+
+	/* remote icons are keyed by the remote URI rather than the cache
+	 * location, which may differ between the system and user caches */
+	if (GS_IS_REMOTE_ICON (icon))
+		uri = g_strdup (gs_remote_icon_get_uri (GS_REMOTE_ICON (icon)));
+	else
+		uri = g_file_get_uri (file);
+	key = g_strdup_printf ("%u@%u:%s", size, scale, uri);
+
+	pixbuf = gs_icon_pixbuf_cache_lookup (key);
+	if (pixbuf != NULL)
+		return g_steal_pointer (&pixbuf);
+
+	/* pre-decoded by a plugin; this needs no I/O at all */
+	atlas = gs_icon_get_atlas (size, scale);
+	if (atlas != NULL) {
+		pixbuf = gs_icon_atlas_lookup (atlas, uri);
+		if (pixbuf != NULL)
+			return g_steal_pointer (&pixbuf);
+	}
+
+	pixbuf = gdk_pixbuf_new_from_file_at_size (path,
+						   (gint) (size * scale),
+						   (gint) (size * scale),
+						   error);
+	if (pixbuf == NULL)
+		return NULL;
+	return gs_icon_pixbuf_cache_insert (key, pixbuf);
+}
+
+/**
+ * gs_icon_pixbuf_cache_clear:
+ *
+ * Drops the references held by the shared pixbuf cache used by
+ * gs_icon_load_pixbuf(). Pixbufs still in use elsewhere continue to be
+ * shared until they are freed.
+ *
+ * Since: 40
+ */
+void
+gs_icon_pixbuf_cache_clear (void)
+{
+	G_LOCK (pixbuf_cache);
+	gs_icon_pixbuf_cache_trim (0);
+	G_UNLOCK (pixbuf_cache);
+}
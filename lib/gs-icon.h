@@ -11,10 +11,13 @@
 #pragma once
 
 #include <appstream.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gio/gio.h>
 #include <glib.h>
 #include <glib-object.h>
 
+#include "gs-icon-atlas.h"
+
 G_BEGIN_DECLS
 
 guint		 gs_icon_get_width			(GIcon			 *icon);
@@ -29,4 +32,11 @@ void		 gs_icon_set_scale			(GIcon			 *icon,
 
 GIcon		*gs_icon_new_for_appstream_icon		(AsIcon			 *appstream_icon);
 
+GdkPixbuf	*gs_icon_load_pixbuf			(GIcon			 *icon,
+							 guint			  size,
+							 guint			  scale,
+							 GError			**error);
+void		 gs_icon_pixbuf_cache_clear		(void);
+void		 gs_icon_add_atlas			(GsIconAtlas		 *atlas);
+
 G_END_DECLS
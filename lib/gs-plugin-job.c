@@ -28,6 +28,7 @@ struct _GsPluginJob
 	GsPlugin		*plugin;
 	GsPluginAction		 action;
 	GsAppListSortFunc	 sort_func;
+	GsAppListSortKeyFunc	 sort_key_func;
 	gpointer		 sort_func_data;
 	gchar			*search;
 	GsApp			*app;
@@ -282,6 +283,20 @@ gs_plugin_job_get_sort_func (GsPluginJob *self)
 	return self->sort_func;
 }
 
+void
+gs_plugin_job_set_sort_key_func (GsPluginJob *self, GsAppListSortKeyFunc sort_key_func)
+{
+	g_return_if_fail (GS_IS_PLUGIN_JOB (self));
+	self->sort_key_func = sort_key_func;
+}
+
+GsAppListSortKeyFunc
+gs_plugin_job_get_sort_key_func (GsPluginJob *self)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_JOB (self), NULL);
+	return self->sort_key_func;
+}
+
 void
 gs_plugin_job_set_sort_func_data (GsPluginJob *self, gpointer sort_func_data)
 {
@@ -29,6 +29,7 @@
 #include "gs-plugin-event.h"
 #include "gs-plugin-job-private.h"
 #include "gs-plugin-private.h"
+#include "gs-trace.h"
 #include "gs-utils.h"
 
 #define GS_PLUGIN_LOADER_UPDATES_CHANGED_DELAY	3	/* s */
@@ -65,6 +66,9 @@ struct _GsPluginLoader
 	guint			 updates_changed_cnt;
 	guint			 reload_id;
 	GHashTable		*disallow_updates;	/* GsPlugin : const char *name */
+	GMutex			 setups_mutex;
+	GCond			 setups_cond;
+	GHashTable		*setups;		/* GsPlugin : GsPluginLoaderSetup */
 
 	GNetworkMonitor		*network_monitor;
 	gulong			 network_changed_handler;
@@ -79,6 +83,8 @@ struct _GsPluginLoader
 };
 
 static void gs_plugin_loader_monitor_network (GsPluginLoader *plugin_loader);
+static gboolean gs_plugin_loader_ensure_setup (GsPluginLoader *plugin_loader, GsPlugin *plugin);
+static gboolean gs_plugin_loader_setup_is_deferred (GsPluginLoader *plugin_loader, GsPlugin *plugin);
 static void add_app_to_install_queue (GsPluginLoader *plugin_loader, GsApp *app);
 static void gs_plugin_loader_process_in_thread_pool_cb (gpointer data, gpointer user_data);
 
@@ -290,10 +296,12 @@ gs_plugin_loader_job_debug (GsPluginLoaderHelper *helper)
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GsPluginLoaderHelper, gs_plugin_loader_helper_free)
 
-static gint
-gs_plugin_loader_app_sort_name_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+gs_plugin_loader_app_sort_key_name_cb (GsApp *app, gpointer user_data)
 {
-	return gs_utils_sort_strcmp (gs_app_get_name (app1), gs_app_get_name (app2));
+	if (gs_app_get_name (app) == NULL)
+		return NULL;
+	return gs_utils_sort_key (gs_app_get_name (app));
 }
 
 GsPlugin *
@@ -527,6 +535,23 @@ gs_plugin_loader_call_vfunc (GsPluginLoaderHelper *helper,
 	if (func == NULL)
 		return TRUE;
 
+	/* the refresh at startup only wants metadata which is already on
+	 * disk, so do not run a deferred setup just to get it */
+	if (action == GS_PLUGIN_ACTION_REFRESH &&
+	    gs_plugin_job_get_age (helper->plugin_job) == G_MAXUINT &&
+	    gs_plugin_loader_setup_is_deferred (plugin_loader, plugin)) {
+		g_debug ("not refreshing %s as its setup is deferred",
+			 gs_plugin_get_name (plugin));
+		return TRUE;
+	}
+
+	/* wait for, or run, the plugin's setup; skip the plugin if it failed */
+	if (action != GS_PLUGIN_ACTION_INITIALIZE &&
+	    action != GS_PLUGIN_ACTION_SETUP &&
+	    action != GS_PLUGIN_ACTION_DESTROY &&
+	    !gs_plugin_loader_ensure_setup (plugin_loader, plugin))
+		return TRUE;
+
 	/* at least one plugin supports this vfunc */
 	helper->anything_ran = TRUE;
 
@@ -1050,28 +1075,43 @@ out:
 	return ret;
 }
 
+/* sorts @list using the sort key function or sort function of @plugin_job,
+ * returning %FALSE if neither is set */
+static gboolean
+gs_plugin_loader_job_sort (GsPluginJob *plugin_job, GsAppList *list)
+{
+	GsAppListSortKeyFunc sort_key_func = gs_plugin_job_get_sort_key_func (plugin_job);
+	GsAppListSortFunc sort_func = gs_plugin_job_get_sort_func (plugin_job);
+	gpointer sort_func_data = gs_plugin_job_get_sort_func_data (plugin_job);
+
+	if (sort_key_func != NULL) {
+		gs_app_list_sort_by_key (list, sort_key_func, sort_func_data);
+		return TRUE;
+	}
+	if (sort_func != NULL) {
+		gs_app_list_sort (list, sort_func, sort_func_data);
+		return TRUE;
+	}
+	return FALSE;
+}
+
 static void
 gs_plugin_loader_job_sorted_truncation_again (GsPluginLoaderHelper *helper)
 {
-	GsAppListSortFunc sort_func;
-	gpointer sort_func_data;
-
 	/* not valid */
 	if (gs_plugin_job_get_list (helper->plugin_job) == NULL)
 		return;
 
-	/* unset */
-	sort_func = gs_plugin_job_get_sort_func (helper->plugin_job);
-	if (sort_func == NULL)
-		return;
-	sort_func_data = gs_plugin_job_get_sort_func_data (helper->plugin_job);
-	gs_app_list_sort (gs_plugin_job_get_list (helper->plugin_job), sort_func, sort_func_data);
+	gs_plugin_loader_job_sort (helper->plugin_job,
+				   gs_plugin_job_get_list (helper->plugin_job));
 }
 
 static void
 gs_plugin_loader_job_sorted_truncation (GsPluginLoaderHelper *helper)
 {
+	GsAppListSortKeyFunc sort_key_func;
 	GsAppListSortFunc sort_func;
+	gpointer sort_func_data;
 	guint max_results;
 	GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
 
@@ -1088,21 +1128,24 @@ gs_plugin_loader_job_sorted_truncation (GsPluginLoaderHelper *helper)
 	if (gs_app_list_length (list) <= max_results)
 		return;
 
-	/* nothing set */
+	/* only the apps being kept need to be fully sorted */
 	g_debug ("truncating results to %u from %u",
 		 max_results, gs_app_list_length (list));
+	sort_key_func = gs_plugin_job_get_sort_key_func (helper->plugin_job);
 	sort_func = gs_plugin_job_get_sort_func (helper->plugin_job);
-	if (sort_func == NULL) {
+	sort_func_data = gs_plugin_job_get_sort_func_data (helper->plugin_job);
+	if (sort_key_func != NULL) {
+		gs_app_list_sort_by_key_truncate (list, sort_key_func, sort_func_data, max_results);
+	} else if (sort_func != NULL) {
+		gs_app_list_sort_truncate (list, sort_func, sort_func_data, max_results);
+	} else {
+		/* nothing set */
 		GsPluginAction action = gs_plugin_job_get_action (helper->plugin_job);
 		g_debug ("no ->sort_func() set for %s, using random!",
 			 gs_plugin_action_to_string (action));
 		gs_app_list_randomize (list);
-	} else {
-		gpointer sort_func_data;
-		sort_func_data = gs_plugin_job_get_sort_func_data (helper->plugin_job);
-		gs_app_list_sort (list, sort_func, sort_func_data);
+		gs_app_list_truncate (list, max_results);
 	}
-	gs_app_list_truncate (list, max_results);
 }
 
 static gboolean
@@ -1410,24 +1453,20 @@ gs_plugin_loader_featured_debug (GsApp *app, gpointer user_data)
 	return FALSE;
 }
 
-static gint
-gs_plugin_loader_app_sort_kind_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+gs_plugin_loader_app_sort_key_kind_cb (GsApp *app, gpointer user_data)
 {
-	if (gs_app_get_kind (app1) == AS_COMPONENT_KIND_DESKTOP_APP)
-		return -1;
-	if (gs_app_get_kind (app2) == AS_COMPONENT_KIND_DESKTOP_APP)
-		return 1;
-	return 0;
+	/* desktop apps first */
+	if (gs_app_get_kind (app) == AS_COMPONENT_KIND_DESKTOP_APP)
+		return g_strdup ("0");
+	return g_strdup ("1");
 }
 
-static gint
-gs_plugin_loader_app_sort_match_value_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+gs_plugin_loader_app_sort_key_match_value_cb (GsApp *app, gpointer user_data)
 {
-	if (gs_app_get_match_value (app1) > gs_app_get_match_value (app2))
-		return -1;
-	if (gs_app_get_match_value (app1) < gs_app_get_match_value (app2))
-		return 1;
-	return 0;
+	/* highest match value first */
+	return g_strdup_printf ("%08x", G_MAXUINT - gs_app_get_match_value (app));
 }
 
 static gint
@@ -1711,6 +1750,20 @@ gs_plugin_loader_pending_apps_remove (GsPluginLoader *plugin_loader,
 	g_idle_add (emit_pending_apps_idle, g_object_ref (plugin_loader));
 }
 
+static void
+load_install_queue_refine_cb (GObject *source_object,
+			      GAsyncResult *res,
+			      gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
+	g_autoptr(GsAppList) list = NULL;
+	g_autoptr(GError) error = NULL;
+
+	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
+	if (list == NULL)
+		g_warning ("failed to refine the install queue: %s", error->message);
+}
+
 static gboolean
 load_install_queue (GsPluginLoader *plugin_loader, GError **error)
 {
@@ -1751,14 +1804,16 @@ load_install_queue (GsPluginLoader *plugin_loader, GError **error)
 	}
 	g_mutex_unlock (&plugin_loader->pending_apps_mutex);
 
-	/* refine */
+	/* refine in a worker thread, as it has to wait for any setups which
+	 * gs_plugin_loader_setup() carried on without */
 	if (gs_app_list_length (list) > 0) {
-		g_autoptr(GsPluginLoaderHelper) helper = NULL;
 		g_autoptr(GsPluginJob) plugin_job = NULL;
-		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE, NULL);
-		helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job);
-		if (!gs_plugin_loader_run_refine (helper, list, NULL, error))
-			return FALSE;
+		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+						 "list", list,
+						 NULL);
+		gs_plugin_loader_job_process_async (plugin_loader, plugin_job, NULL,
+						    load_install_queue_refine_cb,
+						    NULL);
 	}
 	return TRUE;
 }
@@ -2267,6 +2322,249 @@ gs_plugin_loader_clear_caches (GsPluginLoader *plugin_loader)
 	}
 }
 
+/* how long gs_plugin_loader_setup() waits for each plugin's setup to finish
+ * before carrying on without it; jobs which need the plugin wait for it */
+#define GS_PLUGIN_LOADER_SETUP_TIMEOUT		5 /* s */
+
+typedef enum {
+	GS_PLUGIN_LOADER_SETUP_STATE_PENDING,
+	GS_PLUGIN_LOADER_SETUP_STATE_RUNNING,
+	GS_PLUGIN_LOADER_SETUP_STATE_DONE,
+} GsPluginLoaderSetupState;
+
+typedef struct {
+	GsPlugin		*plugin;	/* (unowned) */
+	gboolean		 deferred;
+	gint			 state;		/* (atomic) GsPluginLoaderSetupState */
+	gint64			 start_time;	/* monotonic, once running */
+	GPtrArray		*deps;		/* (element-type GsPluginLoaderSetup) (unowned) */
+} GsPluginLoaderSetup;
+
+static GsPluginLoaderSetup *
+plugin_setup_new (GsPlugin *plugin, gboolean deferred)
+{
+	GsPluginLoaderSetup *setup = g_slice_new0 (GsPluginLoaderSetup);
+	setup->plugin = plugin;
+	setup->deferred = deferred;
+	setup->state = GS_PLUGIN_LOADER_SETUP_STATE_PENDING;
+	setup->deps = g_ptr_array_new ();
+	return setup;
+}
+
+static void
+plugin_setup_free (GsPluginLoaderSetup *setup)
+{
+	g_ptr_array_unref (setup->deps);
+	g_slice_free (GsPluginLoaderSetup, setup);
+}
+
+/* called with setups_mutex held, and with the state already set to running
+ * by the caller so that nobody else starts the same setup */
+static void
+gs_plugin_loader_run_setup_locked (GsPluginLoader *plugin_loader,
+				   GsPluginLoaderSetup *setup)
+{
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsPluginLoaderHelper) helper = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autofree gchar *trace_name = NULL;
+
+	setup->start_time = g_get_monotonic_time ();
+	g_mutex_unlock (&plugin_loader->setups_mutex);
+
+	/* not tied to the cancellable of any one caller, as the result is
+	 * shared by all later jobs and plugins do not expect setup to be run
+	 * twice */
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_SETUP, NULL);
+	helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job);
+	if (!gs_plugin_loader_call_vfunc (helper, setup->plugin, NULL, NULL,
+					  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+					  NULL, &error_local)) {
+		g_debug ("disabling %s as setup failed: %s",
+			 gs_plugin_get_name (setup->plugin),
+			 error_local->message);
+		gs_plugin_set_enabled (setup->plugin, FALSE);
+	}
+	trace_name = g_strconcat ("setup:", gs_plugin_get_name (setup->plugin), NULL);
+	gs_trace_add_span (setup->start_time, "plugin", trace_name,
+			   setup->deferred ? "deferred" : NULL);
+
+	g_mutex_lock (&plugin_loader->setups_mutex);
+	g_atomic_int_set (&setup->state, GS_PLUGIN_LOADER_SETUP_STATE_DONE);
+	g_cond_broadcast (&plugin_loader->setups_cond);
+}
+
+static void gs_plugin_loader_ensure_setup_locked (GsPluginLoader *plugin_loader,
+						  GsPluginLoaderSetup *setup);
+
+/* called with setups_mutex held; makes sure the setup of each plugin @setup
+ * is ordered after has finished, running any which were deferred */
+static void
+gs_plugin_loader_ensure_deps_locked (GsPluginLoader *plugin_loader,
+				     GsPluginLoaderSetup *setup)
+{
+	for (guint i = 0; i < setup->deps->len; i++) {
+		GsPluginLoaderSetup *dep = g_ptr_array_index (setup->deps, i);
+		gs_plugin_loader_ensure_setup_locked (plugin_loader, dep);
+	}
+}
+
+/* called with setups_mutex held; runs @setup now if it was deferred and
+ * nobody has started it yet, then waits for it to finish */
+static void
+gs_plugin_loader_ensure_setup_locked (GsPluginLoader *plugin_loader,
+				      GsPluginLoaderSetup *setup)
+{
+	if (g_atomic_int_get (&setup->state) == GS_PLUGIN_LOADER_SETUP_STATE_DONE)
+		return;
+
+	if (setup->deferred && g_atomic_int_get (&setup->state) == GS_PLUGIN_LOADER_SETUP_STATE_PENDING) {
+		gs_plugin_loader_ensure_deps_locked (plugin_loader, setup);
+
+		/* the lock was dropped while waiting, so check again */
+		if (g_atomic_int_get (&setup->state) == GS_PLUGIN_LOADER_SETUP_STATE_PENDING) {
+			g_debug ("running deferred setup of %s",
+				 gs_plugin_get_name (setup->plugin));
+			g_atomic_int_set (&setup->state, GS_PLUGIN_LOADER_SETUP_STATE_RUNNING);
+			gs_plugin_loader_run_setup_locked (plugin_loader, setup);
+		}
+	}
+	while (g_atomic_int_get (&setup->state) != GS_PLUGIN_LOADER_SETUP_STATE_DONE)
+		g_cond_wait (&plugin_loader->setups_cond, &plugin_loader->setups_mutex);
+}
+
+typedef struct {
+	GsPluginLoader		*plugin_loader;	/* (owned) */
+	GsPluginLoaderSetup	*setup;		/* (unowned) */
+} GsPluginLoaderSetupThreadData;
+
+static gpointer
+gs_plugin_loader_setup_thread_cb (gpointer user_data)
+{
+	GsPluginLoaderSetupThreadData *data = user_data;
+	GsPluginLoader *plugin_loader = data->plugin_loader;
+	GsPluginLoaderSetup *setup = data->setup;
+
+	g_mutex_lock (&plugin_loader->setups_mutex);
+	gs_plugin_loader_ensure_deps_locked (plugin_loader, setup);
+	g_atomic_int_set (&setup->state, GS_PLUGIN_LOADER_SETUP_STATE_RUNNING);
+	gs_plugin_loader_run_setup_locked (plugin_loader, setup);
+	g_mutex_unlock (&plugin_loader->setups_mutex);
+
+	g_object_unref (data->plugin_loader);
+	g_slice_free (GsPluginLoaderSetupThreadData, data);
+	return NULL;
+}
+
+/* called with setups_mutex held; a setup is late if it has been running for
+ * longer than the timeout, or if it is still waiting for a late dependency */
+static gboolean
+gs_plugin_loader_setup_is_late_locked (GsPluginLoaderSetup *setup, gint64 now)
+{
+	switch (g_atomic_int_get (&setup->state)) {
+	case GS_PLUGIN_LOADER_SETUP_STATE_RUNNING:
+		return now >= setup->start_time + GS_PLUGIN_LOADER_SETUP_TIMEOUT * G_USEC_PER_SEC;
+	case GS_PLUGIN_LOADER_SETUP_STATE_PENDING:
+		for (guint i = 0; i < setup->deps->len; i++) {
+			GsPluginLoaderSetup *dep = g_ptr_array_index (setup->deps, i);
+			if (gs_plugin_loader_setup_is_late_locked (dep, now))
+				return TRUE;
+		}
+		return FALSE;
+	default:
+		return FALSE;
+	}
+}
+
+/* Waits until every setup started at startup has either finished or is late,
+ * or, if @wait_for_late is set, until they have all finished. */
+static void
+gs_plugin_loader_wait_for_setups (GsPluginLoader *plugin_loader,
+				  gboolean wait_for_late)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->setups_mutex);
+
+	while (TRUE) {
+		GHashTableIter iter;
+		GsPluginLoaderSetup *setup;
+		gboolean settled = TRUE;
+		gint64 deadline = G_MAXINT64;
+		gint64 now = g_get_monotonic_time ();
+
+		g_hash_table_iter_init (&iter, plugin_loader->setups);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &setup)) {
+			GsPluginLoaderSetupState state = g_atomic_int_get (&setup->state);
+			if (state == GS_PLUGIN_LOADER_SETUP_STATE_DONE)
+				continue;
+			if (setup->deferred && state == GS_PLUGIN_LOADER_SETUP_STATE_PENDING)
+				continue;
+			if (!wait_for_late && gs_plugin_loader_setup_is_late_locked (setup, now))
+				continue;
+			settled = FALSE;
+			if (state == GS_PLUGIN_LOADER_SETUP_STATE_RUNNING) {
+				deadline = MIN (deadline, setup->start_time +
+						GS_PLUGIN_LOADER_SETUP_TIMEOUT * G_USEC_PER_SEC);
+			}
+		}
+		if (settled)
+			break;
+		if (wait_for_late || deadline == G_MAXINT64)
+			g_cond_wait (&plugin_loader->setups_cond, &plugin_loader->setups_mutex);
+		else
+			g_cond_wait_until (&plugin_loader->setups_cond, &plugin_loader->setups_mutex, deadline);
+	}
+
+	/* only log once we know which setups are still outstanding */
+	if (!wait_for_late) {
+		GHashTableIter iter;
+		GsPluginLoaderSetup *setup;
+		gint64 now = g_get_monotonic_time ();
+
+		g_hash_table_iter_init (&iter, plugin_loader->setups);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &setup)) {
+			if (gs_plugin_loader_setup_is_late_locked (setup, now)) {
+				g_debug ("setup of %s is taking too long, continuing without it",
+					 gs_plugin_get_name (setup->plugin));
+			}
+		}
+	}
+}
+
+/* Returns %TRUE if @plugin set %GS_PLUGIN_FLAGS_DEFER_SETUP and nothing has
+ * needed it to be set up yet. */
+static gboolean
+gs_plugin_loader_setup_is_deferred (GsPluginLoader *plugin_loader, GsPlugin *plugin)
+{
+	GsPluginLoaderSetup *setup;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->setups_mutex);
+
+	setup = g_hash_table_lookup (plugin_loader->setups, plugin);
+	return setup != NULL && setup->deferred &&
+	       g_atomic_int_get (&setup->state) == GS_PLUGIN_LOADER_SETUP_STATE_PENDING;
+}
+
+/* Makes sure gs_plugin_setup() has finished for @plugin before another of its
+ * vfuncs is called. If the plugin set %GS_PLUGIN_FLAGS_DEFER_SETUP then the
+ * setup is run now, the first time this is called for it, after those of the
+ * plugins it is ordered after; otherwise this waits for a setup which
+ * gs_plugin_loader_setup() carried on without.
+ *
+ * Returns %FALSE if the setup failed and the plugin has been disabled. */
+static gboolean
+gs_plugin_loader_ensure_setup (GsPluginLoader *plugin_loader, GsPlugin *plugin)
+{
+	GsPluginLoaderSetup *setup;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&plugin_loader->setups_mutex);
+
+	/* gs_plugin_loader_setup_again() empties the table */
+	setup = g_hash_table_lookup (plugin_loader->setups, plugin);
+	if (setup == NULL || g_atomic_int_get (&setup->state) == GS_PLUGIN_LOADER_SETUP_STATE_DONE)
+		return gs_plugin_get_enabled (plugin);
+
+	gs_plugin_loader_ensure_setup_locked (plugin_loader, setup);
+	return gs_plugin_get_enabled (plugin);
+}
+
 /**
  * gs_plugin_loader_setup_again:
  * @plugin_loader: a #GsPluginLoader
@@ -2286,6 +2584,9 @@ gs_plugin_loader_setup_again (GsPluginLoader *plugin_loader)
 	gint64 begin_time_nsec G_GNUC_UNUSED = SYSPROF_CAPTURE_CURRENT_TIME;
 #endif
 
+	/* do not race with setups which are still running */
+	gs_plugin_loader_wait_for_setups (plugin_loader, TRUE);
+
 	/* clear global cache */
 	gs_plugin_loader_clear_caches (plugin_loader);
 
@@ -2317,6 +2618,11 @@ gs_plugin_loader_setup_again (GsPluginLoader *plugin_loader)
 		}
 	}
 
+	/* setup has now been run for every plugin, deferred or not */
+	g_mutex_lock (&plugin_loader->setups_mutex);
+	g_hash_table_remove_all (plugin_loader->setups);
+	g_mutex_unlock (&plugin_loader->setups_mutex);
+
 #ifdef HAVE_SYSPROF
 	if (plugin_loader->sysprof_writer != NULL) {
 		sysprof_capture_writer_add_mark (plugin_loader->sysprof_writer,
@@ -2383,6 +2689,8 @@ gs_plugin_loader_setup (GsPluginLoader *plugin_loader,
 	guint dep_loop_check = 0;
 	guint i;
 	guint j;
+	gint64 trace_begin_time = g_get_monotonic_time ();
+	gint64 trace_initialize_time;
 	g_autoptr(GsPluginLoaderHelper) helper = NULL;
 	g_autoptr(GsPluginJob) plugin_job = NULL;
 #ifdef HAVE_SYSPROF
@@ -2459,11 +2767,15 @@ gs_plugin_loader_setup (GsPluginLoader *plugin_loader,
 		}
 	}
 
+	gs_trace_add_span (trace_begin_time, "startup", "open-plugins", NULL);
+
 	/* run the plugins */
+	trace_initialize_time = g_get_monotonic_time ();
 	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_INITIALIZE, NULL);
 	helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job);
 	if (!gs_plugin_loader_run_results (helper, cancellable, error))
 		return FALSE;
+	gs_trace_add_span (trace_initialize_time, "startup", "initialize-plugins", NULL);
 
 	/* order by deps */
 	do {
@@ -2584,26 +2896,73 @@ gs_plugin_loader_setup (GsPluginLoader *plugin_loader,
 		}
 	} while (changes);
 
-	/* run setup */
-	gs_plugin_job_set_action (helper->plugin_job, GS_PLUGIN_ACTION_SETUP);
-	helper->function_name = "gs_plugin_setup";
+	/* track the setup of every plugin which has one; plugins which are not
+	 * needed for the first page are set up when one of their vfuncs is
+	 * first used */
 	for (i = 0; i < plugin_loader->plugins->len; i++) {
-		g_autoptr(GError) error_local = NULL;
+		gboolean deferred;
 		plugin = g_ptr_array_index (plugin_loader->plugins, i);
-		if (!gs_plugin_loader_call_vfunc (helper, plugin, NULL, NULL,
-						  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
-						  cancellable, &error_local)) {
-			g_debug ("disabling %s as setup failed: %s",
-				 gs_plugin_get_name (plugin),
-				 error_local->message);
-			gs_plugin_set_enabled (plugin, FALSE);
+		if (gs_plugin_get_symbol (plugin, "gs_plugin_setup") == NULL)
+			continue;
+		deferred = gs_plugin_has_flags (plugin, GS_PLUGIN_FLAGS_DEFER_SETUP);
+		if (deferred) {
+			g_debug ("deferring setup of %s until first use",
+				 gs_plugin_get_name (plugin));
+		}
+		g_hash_table_insert (plugin_loader->setups, plugin,
+				     plugin_setup_new (plugin, deferred));
+	}
+
+	/* each setup waits for those of the plugins it is ordered after, and a
+	 * deferred one is run early if a plugin ordered after it needs it; the
+	 * order was resolved above, so only look backwards to avoid cycles */
+	for (i = 0; i < plugin_loader->plugins->len; i++) {
+		GsPluginLoaderSetup *setup;
+		plugin = g_ptr_array_index (plugin_loader->plugins, i);
+		setup = g_hash_table_lookup (plugin_loader->setups, plugin);
+		if (setup == NULL)
+			continue;
+		for (j = 0; j < i; j++) {
+			GsPluginLoaderSetup *setup_dep;
+			dep = g_ptr_array_index (plugin_loader->plugins, j);
+			setup_dep = g_hash_table_lookup (plugin_loader->setups, dep);
+			if (setup_dep == NULL)
+				continue;
+			if (gs_plugin_get_order (dep) >= gs_plugin_get_order (plugin))
+				continue;
+			if (g_ptr_array_find_with_equal_func (gs_plugin_get_rules (plugin, GS_PLUGIN_RULE_RUN_AFTER),
+							      gs_plugin_get_name (dep), g_str_equal, NULL) ||
+			    g_ptr_array_find_with_equal_func (gs_plugin_get_rules (dep, GS_PLUGIN_RULE_RUN_BEFORE),
+							      gs_plugin_get_name (plugin), g_str_equal, NULL))
+				g_ptr_array_add (setup->deps, setup_dep);
 		}
 	}
 
+	/* run the setups concurrently, in order so that dependencies start first */
+	for (i = 0; i < plugin_loader->plugins->len; i++) {
+		GsPluginLoaderSetup *setup;
+		GsPluginLoaderSetupThreadData *data;
+		plugin = g_ptr_array_index (plugin_loader->plugins, i);
+		setup = g_hash_table_lookup (plugin_loader->setups, plugin);
+		if (setup == NULL || setup->deferred)
+			continue;
+		data = g_slice_new0 (GsPluginLoaderSetupThreadData);
+		data->plugin_loader = g_object_ref (plugin_loader);
+		data->setup = setup;
+		g_thread_unref (g_thread_new ("gs-plugin-setup",
+					      gs_plugin_loader_setup_thread_cb,
+					      data));
+	}
+
+	/* slow backends are not waited for; their jobs block until ready */
+	gs_plugin_loader_wait_for_setups (plugin_loader, FALSE);
+
 	/* now we can load the install-queue */
 	if (!load_install_queue (plugin_loader, error))
 		return FALSE;
 
+	gs_trace_add_span (trace_begin_time, "startup", "gs_plugin_loader_setup", NULL);
+
 #ifdef HAVE_SYSPROF
 	if (plugin_loader->sysprof_writer != NULL) {
 		sysprof_capture_writer_add_mark (plugin_loader->sysprof_writer,
@@ -2743,6 +3102,9 @@ gs_plugin_loader_finalize (GObject *object)
 	g_ptr_array_unref (plugin_loader->file_monitors);
 	g_hash_table_unref (plugin_loader->events_by_id);
 	g_hash_table_unref (plugin_loader->disallow_updates);
+	g_hash_table_unref (plugin_loader->setups);
+	g_mutex_clear (&plugin_loader->setups_mutex);
+	g_cond_clear (&plugin_loader->setups_cond);
 	g_clear_object (&plugin_loader->as_pool);
 
 	g_mutex_clear (&plugin_loader->pending_apps_mutex);
@@ -2821,6 +3183,13 @@ gs_plugin_loader_allow_updates_recheck (GsPluginLoader *plugin_loader)
 	}
 }
 
+static void
+gs_plugin_loader_update_download_rate_limit (GsPluginLoader *plugin_loader)
+{
+	guint64 limit = g_settings_get_uint (plugin_loader->settings, "download-rate-limit-metered");
+	gs_plugin_download_set_rate_limit (limit * 1024);
+}
+
 static void
 gs_plugin_loader_settings_changed_cb (GSettings *settings,
 				      const gchar *key,
@@ -2828,6 +3197,8 @@ gs_plugin_loader_settings_changed_cb (GSettings *settings,
 {
 	if (g_strcmp0 (key, "allow-updates") == 0)
 		gs_plugin_loader_allow_updates_recheck (plugin_loader);
+	if (g_strcmp0 (key, "download-rate-limit-metered") == 0)
+		gs_plugin_loader_update_download_rate_limit (plugin_loader);
 }
 
 static gint
@@ -2865,6 +3236,7 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 	plugin_loader->settings = g_settings_new ("org.gnome.software");
 	g_signal_connect (plugin_loader->settings, "changed",
 			  G_CALLBACK (gs_plugin_loader_settings_changed_cb), plugin_loader);
+	gs_plugin_loader_update_download_rate_limit (plugin_loader);
 	plugin_loader->events_by_id = g_hash_table_new_full ((GHashFunc) as_utils_data_id_hash,
 							     (GEqualFunc) as_utils_data_id_equal,
 							     g_free,
@@ -2889,6 +3261,10 @@ gs_plugin_loader_init (GsPluginLoader *plugin_loader)
 
 	/* the settings key sets the initial override */
 	plugin_loader->disallow_updates = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_mutex_init (&plugin_loader->setups_mutex);
+	g_cond_init (&plugin_loader->setups_cond);
+	plugin_loader->setups = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+							NULL, (GDestroyNotify) plugin_setup_free);
 	gs_plugin_loader_allow_updates_recheck (plugin_loader);
 
 	/* get the language from the locale (i.e. strip the territory, codeset
@@ -3089,6 +3465,8 @@ gs_plugin_loader_generic_update (GsPluginLoader *plugin_loader,
 		plugin_app_func = gs_plugin_get_symbol (plugin, helper->function_name);
 		if (plugin_app_func == NULL)
 			continue;
+		if (!gs_plugin_loader_ensure_setup (plugin_loader, plugin))
+			continue;
 
 		/* for each app */
 		for (guint j = 0; j < gs_app_list_length (list); j++) {
@@ -3135,6 +3513,119 @@ gs_plugin_loader_generic_update (GsPluginLoader *plugin_loader,
 	return TRUE;
 }
 
+/* refine with the job's filter flags, which the job's sort function needs,
+ * before the list is truncated to max_results; if nothing will be truncated
+ * the sort only happens after the main refine, so ask that for the extra data
+ * instead */
+static gboolean
+gs_plugin_loader_run_refine_for_sort (GsPluginLoaderHelper *helper,
+				      GsAppList *list,
+				      GCancellable *cancellable,
+				      GError **error)
+{
+	GsPluginRefineFlags filter_flags = gs_plugin_job_get_filter_flags (helper->plugin_job);
+	guint max_results = gs_plugin_job_get_max_results (helper->plugin_job);
+	gboolean has_sort;
+	g_autoptr(GsPluginLoaderHelper) helper2 = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+
+	has_sort = gs_plugin_job_get_sort_func (helper->plugin_job) != NULL ||
+		   gs_plugin_job_get_sort_key_func (helper->plugin_job) != NULL;
+	if (filter_flags == 0 || max_results == 0 || !has_sort)
+		return TRUE;
+	if (gs_app_list_length (list) <= max_results) {
+		gs_plugin_job_add_refine_flags (helper->plugin_job, filter_flags);
+		return TRUE;
+	}
+
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					 "list", list,
+					 "refine-flags", filter_flags,
+					 NULL);
+	helper2 = gs_plugin_loader_helper_new (helper->plugin_loader, plugin_job);
+	helper2->function_name_parent = helper->function_name;
+	g_debug ("running filter flags with early refine");
+	return gs_plugin_loader_run_refine_filter (helper2, list, filter_flags,
+						   cancellable, error);
+}
+
+/* filters the refined results in one pass, along with setting the priority
+ * used by the deduplication */
+static void
+gs_plugin_loader_filter_results (GsPluginLoaderHelper *helper, GsAppList *list)
+{
+	GsPluginAction action = gs_plugin_job_get_action (helper->plugin_job);
+	GsPluginLoader *plugin_loader = helper->plugin_loader;
+	guint n_unfiltered;
+	g_autoptr(GsAppListFilterChain) filter_chain = gs_app_list_filter_chain_new ();
+
+	switch (action) {
+	case GS_PLUGIN_ACTION_URL_TO_APP:
+	case GS_PLUGIN_ACTION_REFINE:
+		gs_app_list_filter_chain_add (filter_chain, "app-is-valid",
+					      gs_plugin_loader_app_is_valid, helper);
+		break;
+	case GS_PLUGIN_ACTION_SEARCH:
+	case GS_PLUGIN_ACTION_SEARCH_FILES:
+	case GS_PLUGIN_ACTION_SEARCH_PROVIDES:
+	case GS_PLUGIN_ACTION_GET_ALTERNATES:
+	case GS_PLUGIN_ACTION_GET_CATEGORY_APPS:
+	case GS_PLUGIN_ACTION_GET_POPULAR:
+		gs_app_list_filter_chain_add (filter_chain, "app-is-valid",
+					      gs_plugin_loader_app_is_valid, helper);
+		gs_app_list_filter_chain_add (filter_chain, "qt-for-gtk",
+					      gs_plugin_loader_filter_qt_for_gtk, NULL);
+		gs_app_list_filter_chain_add (filter_chain, "app-is-compatible",
+					      gs_plugin_loader_get_app_is_compatible, plugin_loader);
+		break;
+	case GS_PLUGIN_ACTION_GET_INSTALLED:
+		gs_app_list_filter_chain_add (filter_chain, "app-is-valid",
+					      gs_plugin_loader_app_is_valid, helper);
+		gs_app_list_filter_chain_add (filter_chain, "app-is-valid-installed",
+					      gs_plugin_loader_app_is_valid_installed, helper);
+		break;
+	case GS_PLUGIN_ACTION_GET_FEATURED:
+		if (g_getenv ("GNOME_SOFTWARE_FEATURED") != NULL) {
+			gs_app_list_filter_chain_add (filter_chain, "featured-debug",
+						      gs_plugin_loader_featured_debug, NULL);
+		} else {
+			gs_app_list_filter_chain_add (filter_chain, "app-is-valid",
+						      gs_plugin_loader_app_is_valid, helper);
+			gs_app_list_filter_chain_add (filter_chain, "app-is-compatible",
+						      gs_plugin_loader_get_app_is_compatible, plugin_loader);
+		}
+		break;
+	case GS_PLUGIN_ACTION_GET_UPDATES:
+		gs_app_list_filter_chain_add (filter_chain, "app-is-valid-updatable",
+					      gs_plugin_loader_app_is_valid_updatable, helper);
+		break;
+	case GS_PLUGIN_ACTION_GET_RECENT:
+		gs_app_list_filter_chain_add (filter_chain, "app-is-non-compulsory",
+					      gs_plugin_loader_app_is_non_compulsory, NULL);
+		gs_app_list_filter_chain_add (filter_chain, "app-is-valid",
+					      gs_plugin_loader_app_is_valid, helper);
+		gs_app_list_filter_chain_add (filter_chain, "qt-for-gtk",
+					      gs_plugin_loader_filter_qt_for_gtk, NULL);
+		gs_app_list_filter_chain_add (filter_chain, "app-is-compatible",
+					      gs_plugin_loader_get_app_is_compatible, plugin_loader);
+		break;
+	default:
+		break;
+	}
+
+	/* this never rejects anything, so goes last */
+	gs_app_list_filter_chain_add (filter_chain, "set-prio",
+				      gs_plugin_loader_app_set_prio, plugin_loader);
+	n_unfiltered = gs_app_list_length (list);
+	gs_app_list_filter_chain (list, filter_chain);
+	if (gs_app_list_length (list) != n_unfiltered) {
+		g_autofree gchar *str = gs_app_list_filter_chain_to_string (filter_chain);
+		g_debug ("filtered %u of %u %s results: %s",
+			 n_unfiltered - gs_app_list_length (list), n_unfiltered,
+			 gs_plugin_action_to_string (action), str);
+	}
+}
+
 static void
 gs_plugin_loader_process_thread_cb (GTask *task,
 				    gpointer object,
@@ -3147,11 +3638,8 @@ gs_plugin_loader_process_thread_cb (GTask *task,
 	GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
 	GsPluginAction action = gs_plugin_job_get_action (helper->plugin_job);
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
-	GsPluginRefineFlags filter_flags;
 	GsPluginRefineFlags refine_flags;
 	gboolean add_to_pending_array = FALSE;
-	guint max_results;
-	GsAppListSortFunc sort_func;
 	g_autoptr(GMainContext) context = g_main_context_new ();
 	g_autoptr(GsMainContextPusher) pusher = gs_main_context_pusher_new (context);
 #ifdef HAVE_SYSPROF
@@ -3270,26 +3758,10 @@ gs_plugin_loader_process_thread_cb (GTask *task,
 
 	/* refine with enough data so that the sort_func in
 	 * gs_plugin_loader_job_sorted_truncation() can do what it needs */
-	filter_flags = gs_plugin_job_get_filter_flags (helper->plugin_job);
-	max_results = gs_plugin_job_get_max_results (helper->plugin_job);
-	sort_func = gs_plugin_job_get_sort_func (helper->plugin_job);
-	if (filter_flags > 0 && max_results > 0 && sort_func != NULL) {
-		g_autoptr(GsPluginLoaderHelper) helper2 = NULL;
-		g_autoptr(GsPluginJob) plugin_job = NULL;
-		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
-						 "list", list,
-						 "refine-flags", filter_flags,
-						 NULL);
-		helper2 = gs_plugin_loader_helper_new (helper->plugin_loader, plugin_job);
-		helper2->function_name_parent = helper->function_name;
-		g_debug ("running filter flags with early refine");
-		if (!gs_plugin_loader_run_refine_filter (helper2, list,
-							 filter_flags,
-							 cancellable, &error)) {
-			gs_utils_error_convert_gio (&error);
-			g_task_return_error (task, error);
-			return;
-		}
+	if (!gs_plugin_loader_run_refine_for_sort (helper, list, cancellable, &error)) {
+		gs_utils_error_convert_gio (&error);
+		g_task_return_error (task, error);
+		return;
 	}
 
 	/* filter to reduce to a sane set */
@@ -3365,55 +3837,7 @@ gs_plugin_loader_process_thread_cb (GTask *task,
 	}
 
 	/* filter package list */
-	switch (action) {
-	case GS_PLUGIN_ACTION_URL_TO_APP:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		break;
-	case GS_PLUGIN_ACTION_SEARCH:
-	case GS_PLUGIN_ACTION_SEARCH_FILES:
-	case GS_PLUGIN_ACTION_SEARCH_PROVIDES:
-	case GS_PLUGIN_ACTION_GET_ALTERNATES:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		gs_app_list_filter (list, gs_plugin_loader_filter_qt_for_gtk, NULL);
-		gs_app_list_filter (list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-		break;
-	case GS_PLUGIN_ACTION_GET_CATEGORY_APPS:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		gs_app_list_filter (list, gs_plugin_loader_filter_qt_for_gtk, NULL);
-		gs_app_list_filter (list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-		break;
-	case GS_PLUGIN_ACTION_GET_INSTALLED:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid_installed, helper);
-		break;
-	case GS_PLUGIN_ACTION_GET_FEATURED:
-		if (g_getenv ("GNOME_SOFTWARE_FEATURED") != NULL) {
-			gs_app_list_filter (list, gs_plugin_loader_featured_debug, NULL);
-		} else {
-			gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-			gs_app_list_filter (list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-		}
-		break;
-	case GS_PLUGIN_ACTION_GET_UPDATES:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid_updatable, helper);
-		break;
-	case GS_PLUGIN_ACTION_GET_RECENT:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_non_compulsory, NULL);
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		gs_app_list_filter (list, gs_plugin_loader_filter_qt_for_gtk, NULL);
-		gs_app_list_filter (list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-		break;
-	case GS_PLUGIN_ACTION_REFINE:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		break;
-	case GS_PLUGIN_ACTION_GET_POPULAR:
-		gs_app_list_filter (list, gs_plugin_loader_app_is_valid, helper);
-		gs_app_list_filter (list, gs_plugin_loader_filter_qt_for_gtk, NULL);
-		gs_app_list_filter (list, gs_plugin_loader_get_app_is_compatible, plugin_loader);
-		break;
-	default:
-		break;
-	}
+	gs_plugin_loader_filter_results (helper, list);
 
 	/* only allow one result */
 	if (action == GS_PLUGIN_ACTION_URL_TO_APP ||
@@ -3439,7 +3863,6 @@ gs_plugin_loader_process_thread_cb (GTask *task,
 
 	/* filter duplicates with priority, taking into account the source name
 	 * & version, so we combine available updates with the installed app */
-	gs_app_list_filter (list, gs_plugin_loader_app_set_prio, plugin_loader);
 	dedupe_flags = gs_plugin_job_get_dedupe_flags (helper->plugin_job);
 	if (dedupe_flags != GS_APP_LIST_FILTER_FLAG_NONE)
 		gs_app_list_filter_duplicates (list, dedupe_flags);
@@ -3536,6 +3959,91 @@ gs_plugin_loader_schedule_task (GsPluginLoader *plugin_loader,
 	g_thread_pool_push (plugin_loader->queued_ops_pool, g_object_ref (task), NULL);
 }
 
+/* fixes up @plugin_job in the ways that all jobs processed with @plugin_loader
+ * need, before any plugin runs */
+static void
+gs_plugin_loader_job_prepare (GsPluginLoader *plugin_loader, GsPluginJob *plugin_job)
+{
+	GsPluginAction action = gs_plugin_job_get_action (plugin_job);
+
+	/* hardcoded, so resolve a set list */
+	if (action == GS_PLUGIN_ACTION_GET_POPULAR) {
+		g_auto(GStrv) apps = NULL;
+		if (g_getenv ("GNOME_SOFTWARE_POPULAR") != NULL) {
+			apps = g_strsplit (g_getenv ("GNOME_SOFTWARE_POPULAR"), ",", 0);
+		} else {
+			apps = g_settings_get_strv (plugin_loader->settings, "popular-overrides");
+		}
+		if (apps != NULL && g_strv_length (apps) > 0) {
+			GsAppList *list = gs_plugin_job_get_list (plugin_job);
+			for (guint i = 0; apps[i] != NULL; i++) {
+				g_autoptr(GsApp) app = gs_app_new (apps[i]);
+				gs_app_add_quirk (app, GS_APP_QUIRK_IS_WILDCARD);
+				gs_app_list_add (list, app);
+			}
+			gs_plugin_job_set_action (plugin_job, GS_PLUGIN_ACTION_REFINE);
+		}
+	}
+
+	/* FIXME: the plugins should specify this, rather than hardcoding */
+	if (gs_plugin_job_has_refine_flags (plugin_job,
+					    GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_UI)) {
+		gs_plugin_job_add_refine_flags (plugin_job,
+						GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN);
+	}
+	if (gs_plugin_job_has_refine_flags (plugin_job,
+					    GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_HOSTNAME)) {
+		gs_plugin_job_add_refine_flags (plugin_job,
+						GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN);
+	}
+	if (gs_plugin_job_has_refine_flags (plugin_job,
+					    GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE)) {
+		gs_plugin_job_add_refine_flags (plugin_job,
+						GS_PLUGIN_REFINE_FLAGS_REQUIRE_RUNTIME);
+	}
+
+	/* sorting fallbacks */
+	switch (action) {
+	case GS_PLUGIN_ACTION_SEARCH:
+		if (gs_plugin_job_get_sort_func (plugin_job) == NULL &&
+		    gs_plugin_job_get_sort_key_func (plugin_job) == NULL) {
+			gs_plugin_job_set_sort_key_func (plugin_job,
+							 gs_plugin_loader_app_sort_key_match_value_cb);
+		}
+		break;
+	case GS_PLUGIN_ACTION_GET_RECENT:
+		if (gs_plugin_job_get_sort_func (plugin_job) == NULL &&
+		    gs_plugin_job_get_sort_key_func (plugin_job) == NULL) {
+			gs_plugin_job_set_sort_key_func (plugin_job,
+							 gs_plugin_loader_app_sort_key_kind_cb);
+		}
+		break;
+	case GS_PLUGIN_ACTION_GET_CATEGORY_APPS:
+		if (gs_plugin_job_get_sort_func (plugin_job) == NULL &&
+		    gs_plugin_job_get_sort_key_func (plugin_job) == NULL) {
+			gs_plugin_job_set_sort_key_func (plugin_job,
+							 gs_plugin_loader_app_sort_key_name_cb);
+		}
+		break;
+	case GS_PLUGIN_ACTION_GET_ALTERNATES:
+		if (gs_plugin_job_get_sort_func (plugin_job) == NULL &&
+		    gs_plugin_job_get_sort_key_func (plugin_job) == NULL) {
+			gs_plugin_job_set_sort_func (plugin_job,
+						     gs_plugin_loader_app_sort_prio_cb);
+		}
+		break;
+	case GS_PLUGIN_ACTION_GET_DISTRO_UPDATES:
+		if (gs_plugin_job_get_sort_func (plugin_job) == NULL &&
+		    gs_plugin_job_get_sort_key_func (plugin_job) == NULL) {
+			gs_plugin_job_set_sort_func (plugin_job,
+						     gs_plugin_loader_app_sort_version_cb);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
 /**
  * gs_plugin_loader_job_process_async:
  * @plugin_loader: A #GsPluginLoader
@@ -3597,41 +4105,8 @@ gs_plugin_loader_job_process_async (GsPluginLoader *plugin_loader,
 		}
 	}
 
-	/* hardcoded, so resolve a set list */
-	if (action == GS_PLUGIN_ACTION_GET_POPULAR) {
-		g_auto(GStrv) apps = NULL;
-		if (g_getenv ("GNOME_SOFTWARE_POPULAR") != NULL) {
-			apps = g_strsplit (g_getenv ("GNOME_SOFTWARE_POPULAR"), ",", 0);
-		} else {
-			apps = g_settings_get_strv (plugin_loader->settings, "popular-overrides");
-		}
-		if (apps != NULL && g_strv_length (apps) > 0) {
-			GsAppList *list = gs_plugin_job_get_list (plugin_job);
-			for (guint i = 0; apps[i] != NULL; i++) {
-				g_autoptr(GsApp) app = gs_app_new (apps[i]);
-				gs_app_add_quirk (app, GS_APP_QUIRK_IS_WILDCARD);
-				gs_app_list_add (list, app);
-			}
-			gs_plugin_job_set_action (plugin_job, GS_PLUGIN_ACTION_REFINE);
-		}
-	}
-
-	/* FIXME: the plugins should specify this, rather than hardcoding */
-	if (gs_plugin_job_has_refine_flags (plugin_job,
-					    GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_UI)) {
-		gs_plugin_job_add_refine_flags (plugin_job,
-						GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN);
-	}
-	if (gs_plugin_job_has_refine_flags (plugin_job,
-					    GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_HOSTNAME)) {
-		gs_plugin_job_add_refine_flags (plugin_job,
-						GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN);
-	}
-	if (gs_plugin_job_has_refine_flags (plugin_job,
-					    GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE)) {
-		gs_plugin_job_add_refine_flags (plugin_job,
-						GS_PLUGIN_REFINE_FLAGS_REQUIRE_RUNTIME);
-	}
+	/* hardcoded lists, implied refine flags and default sorting */
+	gs_plugin_loader_job_prepare (plugin_loader, plugin_job);
 
 	/* FIXME: this is probably a bug */
 	if (action == GS_PLUGIN_ACTION_GET_DISTRO_UPDATES ||
@@ -3684,42 +4159,6 @@ gs_plugin_loader_job_process_async (GsPluginLoader *plugin_loader,
 		break;
 	}
 
-	/* sorting fallbacks */
-	switch (action) {
-	case GS_PLUGIN_ACTION_SEARCH:
-		if (gs_plugin_job_get_sort_func (plugin_job) == NULL) {
-			gs_plugin_job_set_sort_func (plugin_job,
-						     gs_plugin_loader_app_sort_match_value_cb);
-		}
-		break;
-	case GS_PLUGIN_ACTION_GET_RECENT:
-		if (gs_plugin_job_get_sort_func (plugin_job) == NULL) {
-			gs_plugin_job_set_sort_func (plugin_job,
-						     gs_plugin_loader_app_sort_kind_cb);
-		}
-		break;
-	case GS_PLUGIN_ACTION_GET_CATEGORY_APPS:
-		if (gs_plugin_job_get_sort_func (plugin_job) == NULL) {
-			gs_plugin_job_set_sort_func (plugin_job,
-						     gs_plugin_loader_app_sort_name_cb);
-		}
-		break;
-	case GS_PLUGIN_ACTION_GET_ALTERNATES:
-		if (gs_plugin_job_get_sort_func (plugin_job) == NULL) {
-			gs_plugin_job_set_sort_func (plugin_job,
-						     gs_plugin_loader_app_sort_prio_cb);
-		}
-		break;
-	case GS_PLUGIN_ACTION_GET_DISTRO_UPDATES:
-		if (gs_plugin_job_get_sort_func (plugin_job) == NULL) {
-			gs_plugin_job_set_sort_func (plugin_job,
-						     gs_plugin_loader_app_sort_version_cb);
-		}
-		break;
-	default:
-		break;
-	}
-
 	/* save helper */
 	helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job);
 	g_task_set_task_data (task, helper, (GDestroyNotify) gs_plugin_loader_helper_free);
@@ -3796,6 +4235,448 @@ gs_plugin_loader_job_process_async (GsPluginLoader *plugin_loader,
 
 /******************************************************************************/
 
+/* the jobs of gs_plugin_loader_job_process_many_async() each have a helper,
+ * plus one more for the combined refine, whose cancellable is cancelled by the
+ * caller and which in turn cancels each job's */
+typedef struct {
+	GsPluginLoaderHelper	*helper;	/* (owned) */
+	GPtrArray		*helpers;	/* (owned) (element-type GsPluginLoaderHelper) */
+} GsPluginLoaderManyData;
+
+static void
+gs_plugin_loader_many_data_free (GsPluginLoaderManyData *data)
+{
+	g_ptr_array_unref (data->helpers);
+	gs_plugin_loader_helper_free (data->helper);
+	g_slice_free (GsPluginLoaderManyData, data);
+}
+
+static void
+gs_plugin_loader_job_process_many_return_cancelled (GTask *task,
+						    GsPluginLoaderHelper *helper)
+{
+	if (helper->timeout_triggered) {
+		g_task_return_new_error (task,
+					 GS_PLUGIN_ERROR,
+					 GS_PLUGIN_ERROR_TIMED_OUT,
+					 "Timeout was reached as the jobs took "
+					 "longer than %u seconds",
+					 gs_plugin_job_get_timeout (helper->plugin_job));
+		return;
+	}
+	g_task_return_new_error (task,
+				 GS_PLUGIN_ERROR,
+				 GS_PLUGIN_ERROR_CANCELLED,
+				 "The jobs were cancelled");
+}
+
+/* resolves the wildcards of all the jobs at once, adding the apps each one
+ * resolves to into the #GsAppList it maps to in @wildcards */
+static gboolean
+gs_plugin_loader_run_refine_wildcards (GsPluginLoaderHelper *helper,
+				       GHashTable *wildcards,
+				       GCancellable *cancellable,
+				       GError **error)
+{
+	GsPluginLoader *plugin_loader = helper->plugin_loader;
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_hash_table_iter_init (&iter, wildcards);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		gs_app_list_add (list, GS_APP (key));
+
+	for (guint i = 0; i < plugin_loader->plugins->len; i++) {
+		GsPlugin *plugin = g_ptr_array_index (plugin_loader->plugins, i);
+
+		helper->function_name = "gs_plugin_refine";
+		if (!gs_plugin_loader_call_vfunc (helper, plugin, NULL, list,
+						  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+						  cancellable, error))
+			return FALSE;
+
+		if (gs_plugin_get_symbol (plugin, "gs_plugin_refine_wildcard") != NULL) {
+			helper->function_name = "gs_plugin_refine_wildcard";
+			g_hash_table_iter_init (&iter, wildcards);
+			while (g_hash_table_iter_next (&iter, &key, &value)) {
+				if (!gs_plugin_loader_call_vfunc (helper, plugin,
+								  GS_APP (key),
+								  GS_APP_LIST (value),
+								  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+								  cancellable, error))
+					return FALSE;
+			}
+		}
+
+		gs_plugin_status_update (plugin, NULL, GS_PLUGIN_STATUS_FINISHED);
+	}
+	return TRUE;
+}
+
+/* the fallback when refining all the jobs together failed, so that only
+ * the jobs which fail on their own are left empty */
+static void
+gs_plugin_loader_job_process_many_refine_each (GPtrArray *helpers,
+					       gboolean wildcards_only,
+					       GCancellable *cancellable)
+{
+	for (guint i = 0; i < helpers->len; i++) {
+		GsPluginLoaderHelper *helper = g_ptr_array_index (helpers, i);
+		GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
+		GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_DEFAULT;
+		g_autoptr(GsPluginLoaderHelper) helper2 = NULL;
+		g_autoptr(GsPluginJob) plugin_job = NULL;
+		g_autoptr(GError) error_local = NULL;
+		gboolean ret;
+
+		if (gs_app_list_length (list) == 0)
+			continue;
+		if (!wildcards_only)
+			refine_flags = gs_plugin_job_get_refine_flags (helper->plugin_job);
+		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+						 "list", list,
+						 "refine-flags", refine_flags,
+						 NULL);
+		helper2 = gs_plugin_loader_helper_new (helper->plugin_loader, plugin_job);
+		helper2->function_name_parent = helper->function_name;
+		if (wildcards_only) {
+			ret = gs_plugin_loader_run_refine_filter (helper2, list,
+								  GS_PLUGIN_REFINE_FLAGS_DEFAULT,
+								  cancellable, &error_local);
+		} else {
+			ret = gs_plugin_loader_run_refine (helper2, list, cancellable, &error_local);
+		}
+		if (!ret) {
+			g_warning ("failed to refine %s results: %s",
+				   gs_plugin_action_to_string (gs_plugin_job_get_action (helper->plugin_job)),
+				   error_local->message);
+			gs_app_list_remove_all (list);
+		}
+	}
+}
+
+static void
+gs_plugin_loader_job_process_many_thread_cb (GTask *task,
+					     gpointer object,
+					     gpointer task_data,
+					     GCancellable *cancellable)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (object);
+	GsPluginLoaderManyData *data = task_data;
+	GPtrArray *helpers = data->helpers;
+	GsPluginRefineFlags refine_flags = GS_PLUGIN_REFINE_FLAGS_DEFAULT;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GHashTable) apps_seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_autoptr(GHashTable) wildcards = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+								 NULL, g_object_unref);
+	g_autoptr(GPtrArray) lists = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	guint n_apps = 0;
+	g_autoptr(GPtrArray) results = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GsMainContextPusher) pusher = gs_main_context_pusher_new (context);
+#ifdef HAVE_SYSPROF
+	gint64 begin_time_nsec G_GNUC_UNUSED = SYSPROF_CAPTURE_CURRENT_TIME;
+#endif
+
+	/* run each query, reducing each to a sane set before refining; each
+	 * has its own cancellable, so one which takes longer than its timeout
+	 * is left empty rather than holding up the others */
+	for (guint i = 0; i < helpers->len; i++) {
+		GsPluginLoaderHelper *helper = g_ptr_array_index (helpers, i);
+		GsPluginAction action = gs_plugin_job_get_action (helper->plugin_job);
+		GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
+		g_autoptr(GError) error_job = NULL;
+
+		if ((action != GS_PLUGIN_ACTION_REFINE &&
+		     !gs_plugin_loader_run_results (helper, helper->cancellable, &error_job)) ||
+		    !gs_plugin_loader_run_refine_for_sort (helper, list, helper->cancellable, &error_job)) {
+			if (g_cancellable_is_cancelled (cancellable)) {
+				gs_plugin_loader_job_process_many_return_cancelled (task, data->helper);
+				return;
+			}
+			gs_utils_error_convert_gio (&error_job);
+			g_debug ("failed to get %s results: %s",
+				   gs_plugin_action_to_string (action),
+				   error_job->message);
+			gs_app_list_remove_all (list);
+			continue;
+		}
+		gs_plugin_loader_job_sorted_truncation (helper);
+
+		/* wildcards are replaced by the refine, which would lose track
+		 * of which query they belong to, so resolve them first */
+		for (guint j = 0; j < gs_app_list_length (list); j++) {
+			GsApp *app = gs_app_list_index (list, j);
+			if (gs_app_has_quirk (app, GS_APP_QUIRK_IS_WILDCARD))
+				g_hash_table_insert (wildcards, app, gs_app_list_new ());
+		}
+		refine_flags |= gs_plugin_job_get_refine_flags (helper->plugin_job);
+	}
+
+	/* resolve the wildcards of all the queries together */
+	if (g_hash_table_size (wildcards) > 0) {
+		if (gs_plugin_loader_run_refine_wildcards (data->helper, wildcards,
+							   cancellable, &error_local)) {
+			for (guint i = 0; i < helpers->len; i++) {
+				GsPluginLoaderHelper *helper = g_ptr_array_index (helpers, i);
+				GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
+				g_autoptr(GsAppList) resolved = gs_app_list_new ();
+
+				for (guint j = 0; j < gs_app_list_length (list); j++) {
+					GsAppList *apps = g_hash_table_lookup (wildcards, gs_app_list_index (list, j));
+					if (apps != NULL)
+						gs_app_list_add_list (resolved, apps);
+				}
+				gs_app_list_add_list (list, resolved);
+				gs_app_list_filter (list, gs_plugin_loader_app_is_non_wildcard, NULL);
+			}
+		} else if (g_cancellable_is_cancelled (cancellable)) {
+			gs_plugin_loader_job_process_many_return_cancelled (task, data->helper);
+			return;
+		} else {
+			g_debug ("failed to resolve wildcards together, "
+				 "resolving them for each query: %s",
+				 error_local->message);
+			g_clear_error (&error_local);
+			gs_plugin_loader_job_process_many_refine_each (helpers, TRUE, cancellable);
+		}
+	}
+
+	/* add each app once; a list drops other objects with the same unique
+	 * ID, which still need refining, so each of those goes into the first
+	 * list which does not have one yet */
+	for (guint i = 0; i < helpers->len; i++) {
+		GsPluginLoaderHelper *helper = g_ptr_array_index (helpers, i);
+		GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
+
+		for (guint j = 0; j < gs_app_list_length (list); j++) {
+			GsApp *app = gs_app_list_index (list, j);
+			if (!g_hash_table_add (apps_seen, app))
+				continue;
+			for (guint k = 0;; k++) {
+				GsAppList *list_refine;
+				guint len;
+
+				if (k == lists->len)
+					g_ptr_array_add (lists, gs_app_list_new ());
+				list_refine = g_ptr_array_index (lists, k);
+				len = gs_app_list_length (list_refine);
+				gs_app_list_add (list_refine, app);
+				if (gs_app_list_length (list_refine) > len)
+					break;
+			}
+			n_apps++;
+		}
+	}
+
+	/* refine everything in as few goes as possible */
+	g_debug ("refining %u apps for %u queries in %u lists",
+		 n_apps, helpers->len, lists->len);
+	for (guint i = 0; i < lists->len; i++) {
+		GsAppList *list = g_ptr_array_index (lists, i);
+		g_autoptr(GsPluginLoaderHelper) helper = NULL;
+		g_autoptr(GsPluginJob) plugin_job = NULL;
+
+		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+						 "list", list,
+						 "refine-flags", refine_flags,
+						 NULL);
+		helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job);
+		if (!gs_plugin_loader_run_refine (helper, list, cancellable, &error_local))
+			break;
+	}
+	if (error_local != NULL) {
+		if (g_cancellable_is_cancelled (cancellable)) {
+			gs_plugin_loader_job_process_many_return_cancelled (task, data->helper);
+			return;
+		}
+		g_debug ("failed to refine together, refining each query: %s",
+			 error_local->message);
+		g_clear_error (&error_local);
+		gs_plugin_loader_job_process_many_refine_each (helpers, FALSE, cancellable);
+	}
+
+	/* split the results back up */
+	for (guint i = 0; i < helpers->len; i++) {
+		GsPluginLoaderHelper *helper = g_ptr_array_index (helpers, i);
+		GsAppList *list = gs_plugin_job_get_list (helper->plugin_job);
+		GsAppListFilterFlags dedupe_flags;
+
+		gs_plugin_loader_filter_results (helper, list);
+		dedupe_flags = gs_plugin_job_get_dedupe_flags (helper->plugin_job);
+		if (dedupe_flags != GS_APP_LIST_FILTER_FLAG_NONE)
+			gs_app_list_filter_duplicates (list, dedupe_flags);
+		gs_plugin_loader_job_sorted_truncation_again (helper);
+		gs_plugin_loader_job_debug (helper);
+		g_ptr_array_add (results, g_object_ref (list));
+	}
+
+	/* if the plugin used updates-changed actually schedule it now */
+	if (plugin_loader->updates_changed_cnt > 0)
+		gs_plugin_loader_updates_changed (plugin_loader);
+
+#ifdef HAVE_SYSPROF
+	if (plugin_loader->sysprof_writer != NULL) {
+		g_autofree gchar *sysprof_message = g_strdup_printf ("%u jobs", helpers->len);
+		sysprof_capture_writer_add_mark (plugin_loader->sysprof_writer,
+						 begin_time_nsec,
+						 sched_getcpu (),
+						 getpid (),
+						 SYSPROF_CAPTURE_CURRENT_TIME - begin_time_nsec,
+						 "gnome-software",
+						 "process-many-thread",
+						 sysprof_message);
+	}
+#endif  /* HAVE_SYSPROF */
+
+	/* success */
+	g_task_return_pointer (task, g_steal_pointer (&results), (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * gs_plugin_loader_job_process_many_async:
+ * @plugin_loader: A #GsPluginLoader
+ * @plugin_jobs: (element-type GsPluginJob): jobs to process
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: function to call when complete
+ * @user_data: user data to pass to @callback
+ *
+ * Processes several jobs which each return a list of apps, such as the
+ * sections of the overview page, in one thread. The results of all the jobs
+ * are refined together, so an app in more than one of them is only refined
+ * once, and then filtered and sorted for each job as
+ * gs_plugin_loader_job_process_async() would.
+ *
+ * Each job's timeout applies as it would for
+ * gs_plugin_loader_job_process_async(), except that a job which takes too
+ * long, or fails, gets an empty list rather than failing the others.
+ *
+ * Only %GS_PLUGIN_ACTION_GET_FEATURED, %GS_PLUGIN_ACTION_GET_POPULAR,
+ * %GS_PLUGIN_ACTION_GET_RECENT and %GS_PLUGIN_ACTION_GET_CATEGORY_APPS jobs
+ * are supported.
+ *
+ * Since: 40
+ **/
+void
+gs_plugin_loader_job_process_many_async (GsPluginLoader *plugin_loader,
+					 GPtrArray *plugin_jobs,
+					 GCancellable *cancellable,
+					 GAsyncReadyCallback callback,
+					 gpointer user_data)
+{
+	GsPluginLoaderManyData *data;
+	guint timeout_max = 0;
+	gboolean timeout_unlimited = FALSE;
+	g_autoptr(GsPluginJob) plugin_job_refine = NULL;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader));
+	g_return_if_fail (plugin_jobs != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	for (guint i = 0; i < plugin_jobs->len; i++) {
+		GsPluginJob *plugin_job = g_ptr_array_index (plugin_jobs, i);
+
+		switch (gs_plugin_job_get_action (plugin_job)) {
+		case GS_PLUGIN_ACTION_GET_FEATURED:
+		case GS_PLUGIN_ACTION_GET_POPULAR:
+		case GS_PLUGIN_ACTION_GET_RECENT:
+		case GS_PLUGIN_ACTION_GET_CATEGORY_APPS:
+			break;
+		default:
+			g_return_if_reached ();
+		}
+	}
+
+	/* jobs always have a valid cancellable, so proxy the caller */
+	data = g_slice_new0 (GsPluginLoaderManyData);
+	plugin_job_refine = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE, NULL);
+	data->helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job_refine);
+	data->helper->cancellable = g_cancellable_new ();
+	if (cancellable != NULL) {
+		data->helper->cancellable_caller = g_object_ref (cancellable);
+		data->helper->cancellable_id =
+			g_cancellable_connect (data->helper->cancellable_caller,
+					       G_CALLBACK (gs_plugin_loader_cancelled_cb),
+					       data->helper, NULL);
+	}
+
+	data->helpers = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_plugin_loader_helper_free);
+	for (guint i = 0; i < plugin_jobs->len; i++) {
+		GsPluginJob *plugin_job = g_ptr_array_index (plugin_jobs, i);
+		GsPluginLoaderHelper *helper;
+		guint timeout;
+
+		gs_plugin_loader_job_prepare (plugin_loader, plugin_job);
+		helper = gs_plugin_loader_helper_new (plugin_loader, plugin_job);
+		helper->cancellable = g_cancellable_new ();
+		helper->cancellable_caller = g_object_ref (data->helper->cancellable);
+		helper->cancellable_id =
+			g_cancellable_connect (helper->cancellable_caller,
+					       G_CALLBACK (gs_plugin_loader_cancelled_cb),
+					       helper, NULL);
+
+		/* set up a hang handler for each job, and one for the refine
+		 * they share which allows as long as the most patient job */
+		timeout = gs_plugin_job_get_timeout (plugin_job);
+		if (timeout > 0) {
+			helper->timeout_id = g_timeout_add_seconds (timeout,
+								    gs_plugin_loader_job_timeout_cb,
+								    helper);
+		}
+		if (timeout == 0)
+			timeout_unlimited = TRUE;
+		timeout_max = MAX (timeout_max, timeout);
+		g_ptr_array_add (data->helpers, helper);
+	}
+	if (!timeout_unlimited && timeout_max > 0) {
+		gs_plugin_job_set_timeout (plugin_job_refine, timeout_max);
+		data->helper->timeout_id = g_timeout_add_seconds (timeout_max,
+								  gs_plugin_loader_job_timeout_cb,
+								  data->helper);
+	}
+
+	task = g_task_new (plugin_loader, data->helper->cancellable, callback, user_data);
+	g_task_set_source_tag (task, gs_plugin_loader_job_process_many_async);
+	g_task_set_task_data (task, data, (GDestroyNotify) gs_plugin_loader_many_data_free);
+
+	/* let the task cancel itself */
+	g_task_set_check_cancellable (task, FALSE);
+	g_task_set_return_on_cancel (task, FALSE);
+
+	g_task_run_in_thread (task, gs_plugin_loader_job_process_many_thread_cb);
+}
+
+/**
+ * gs_plugin_loader_job_process_many_finish:
+ * @plugin_loader: A #GsPluginLoader
+ * @res: a #GAsyncResult
+ * @error: A #GError, or %NULL
+ *
+ * Gets the results of gs_plugin_loader_job_process_many_async(). A job which
+ * failed on its own gets an empty list, so that it does not stop the others
+ * from being shown.
+ *
+ * Returns: (element-type GsAppList) (transfer container): one list of
+ *   applications for each job, in the same order as the jobs
+ *
+ * Since: 40
+ **/
+GPtrArray *
+gs_plugin_loader_job_process_many_finish (GsPluginLoader *plugin_loader,
+					  GAsyncResult *res,
+					  GError **error)
+{
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, plugin_loader), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/******************************************************************************/
+
 /**
  * gs_plugin_loader_get_plugin_supported:
  * @plugin_loader: A #GsPluginLoader
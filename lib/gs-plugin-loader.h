@@ -35,6 +35,14 @@ GsAppList	*gs_plugin_loader_job_process_finish	(GsPluginLoader	*plugin_loader,
 gboolean	 gs_plugin_loader_job_action_finish	(GsPluginLoader	*plugin_loader,
 							 GAsyncResult	*res,
 							 GError		**error);
+void		 gs_plugin_loader_job_process_many_async (GsPluginLoader *plugin_loader,
+							 GPtrArray	*plugin_jobs,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*gs_plugin_loader_job_process_many_finish (GsPluginLoader *plugin_loader,
+							 GAsyncResult	*res,
+							 GError		**error);
 void		 gs_plugin_loader_job_get_categories_async (GsPluginLoader *plugin_loader,
 							 GsPluginJob	*plugin_job,
 							 GCancellable	*cancellable,
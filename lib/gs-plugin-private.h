@@ -50,5 +50,6 @@ void		 gs_plugin_interactive_dec		(GsPlugin	*plugin);
 gchar		*gs_plugin_refine_flags_to_string	(GsPluginRefineFlags refine_flags);
 void		 gs_plugin_set_network_monitor		(GsPlugin		*plugin,
 							 GNetworkMonitor	*monitor);
+void		 gs_plugin_download_set_rate_limit	(guint64		 bytes_per_second);
 
 G_END_DECLS
@@ -41,12 +41,14 @@ typedef enum {
  * GsPluginFlags:
  * @GS_PLUGIN_FLAGS_NONE:		No flags set
  * @GS_PLUGIN_FLAGS_INTERACTIVE:	User initiated the job
+ * @GS_PLUGIN_FLAGS_DEFER_SETUP:	Run setup on first use rather than at startup
  *
  * The flags for the plugin at this point in time.
  **/
 typedef enum {
 	GS_PLUGIN_FLAGS_NONE = 0,
 	GS_PLUGIN_FLAGS_INTERACTIVE = 1 << 4,
+	GS_PLUGIN_FLAGS_DEFER_SETUP = 1 << 5,
 } GsPluginFlags;
 
 /**
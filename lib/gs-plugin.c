@@ -34,6 +34,7 @@
 
 #include <gio/gdesktopappinfo.h>
 #include <gdk/gdk.h>
+#include <glib/gstdio.h>
 #include <string.h>
 
 #ifdef USE_VALGRIND
@@ -1024,12 +1025,146 @@ gs_plugin_reload (GsPlugin *plugin)
 	g_idle_add (gs_plugin_reload_cb, plugin);
 }
 
+/* downloads are written to a file with this suffix in the cache, and only
+ * moved into place once complete, so they can be resumed; they are kept out
+ * of the destination directory, which a plugin may be watching for changes */
+#define GS_PLUGIN_DOWNLOAD_PARTIAL_SUFFIX	".partial"
+#define GS_PLUGIN_DOWNLOAD_PARTIAL_KIND		"downloads"
+
+/* the size of a completed download, so one which has been truncated since is
+ * not revalidated and kept */
+#define GS_PLUGIN_DOWNLOAD_SIZE_ATTRIBUTE	"xattr::gnome-software::size"
+
+static GMutex download_rate_mutex;
+static guint64 download_rate_limit = 0;		/* bytes per second, or 0 */
+static gint64 download_rate_next = 0;		/* monotonic, in µs */
+
+/**
+ * gs_plugin_download_set_rate_limit:
+ * @bytes_per_second: the limit, or 0 for unlimited
+ *
+ * Sets the maximum rate of all downloads done with gs_plugin_download_file()
+ * and gs_plugin_download_data(), combined, while the network is metered.
+ * Downloads on unmetered networks are not limited.
+ **/
+void
+gs_plugin_download_set_rate_limit (guint64 bytes_per_second)
+{
+	g_mutex_lock (&download_rate_mutex);
+	download_rate_limit = bytes_per_second;
+	g_mutex_unlock (&download_rate_mutex);
+}
+
+/* blocks until @length more bytes can be downloaded within the limit */
+static void
+gs_plugin_download_throttle (GsPlugin *plugin, gsize length)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
+	gint64 now;
+	gint64 start;
+
+	if (priv->network_monitor == NULL ||
+	    !g_network_monitor_get_network_metered (priv->network_monitor))
+		return;
+
+	/* each chunk reserves the next free slot of time on a clock shared by
+	 * all downloads, so the limit holds however many run in parallel */
+	g_mutex_lock (&download_rate_mutex);
+	if (download_rate_limit == 0) {
+		g_mutex_unlock (&download_rate_mutex);
+		return;
+	}
+	now = g_get_monotonic_time ();
+	start = MAX (now, download_rate_next);
+	download_rate_next = start + (gint64) (length * G_USEC_PER_SEC / download_rate_limit);
+	g_mutex_unlock (&download_rate_mutex);
+
+	if (start > now)
+		g_usleep ((gulong) (start - now));
+}
+
 typedef struct {
 	GsPlugin	*plugin;
-	GsApp		*app;
+	GsApp		*app;		/* (nullable) */
 	GCancellable	*cancellable;
+	const gchar	*filename;	/* (nullable), the partial file to write to */
+	GOutputStream	*output;	/* (nullable) (owned) */
+	goffset		 offset;	/* bytes of @filename being resumed from */
+	goffset		 received;
+	goffset		 expected_size;	/* of the whole file, or -1 if unknown */
+	GError		*error;		/* (nullable) (owned) */
 } GsPluginDownloadHelper;
 
+static void
+gs_plugin_download_helper_clear (GsPluginDownloadHelper *helper)
+{
+	g_clear_object (&helper->output);
+	g_clear_error (&helper->error);
+}
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (GsPluginDownloadHelper, gs_plugin_download_helper_clear)
+
+static void
+gs_plugin_download_got_headers_cb (SoupMessage *msg,
+				   GsPluginDownloadHelper *helper)
+{
+	GsPluginPrivate *priv = gs_plugin_get_instance_private (helper->plugin);
+	g_autoptr(GFile) file = g_file_new_for_path (helper->filename);
+
+	if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+		goffset start = 0;
+		goffset end = 0;
+		goffset total = 0;
+
+		if (!soup_message_headers_get_content_range (msg->response_headers,
+							     &start, &end, &total) ||
+		    start != helper->offset) {
+			g_set_error (&helper->error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "unexpected range in response");
+			g_file_delete (file, NULL, NULL);
+			soup_session_cancel_message (priv->soup_session, msg,
+						     SOUP_STATUS_CANCELLED);
+			return;
+		}
+		g_debug ("resuming download at %" G_GOFFSET_FORMAT " bytes", start);
+		helper->expected_size = total > 0 ? total : -1;
+		helper->output = G_OUTPUT_STREAM (g_file_append_to (file,
+								    G_FILE_CREATE_NONE,
+								    helper->cancellable,
+								    &helper->error));
+	} else if (msg->status_code == SOUP_STATUS_OK) {
+		/* start again, remembering which version of the resource this
+		 * is so that it can be resumed or revalidated later */
+		helper->offset = 0;
+		if (soup_message_headers_get_encoding (msg->response_headers) == SOUP_ENCODING_CONTENT_LENGTH)
+			helper->expected_size = soup_message_headers_get_content_length (msg->response_headers);
+		else
+			helper->expected_size = -1;
+		g_file_delete (file, NULL, NULL);
+		helper->output = G_OUTPUT_STREAM (g_file_create (file,
+								 G_FILE_CREATE_NONE,
+								 helper->cancellable,
+								 &helper->error));
+		if (helper->output != NULL) {
+			gs_utils_set_file_etag (helper->filename,
+						soup_message_headers_get_one (msg->response_headers, "ETag"),
+						helper->cancellable);
+		}
+	} else {
+		return;
+	}
+	if (helper->output == NULL) {
+		soup_session_cancel_message (priv->soup_session, msg,
+					     SOUP_STATUS_CANCELLED);
+		return;
+	}
+
+	/* stream the body to disk rather than holding it all in memory */
+	soup_message_body_set_accumulate (msg->response_body, FALSE);
+}
+
 static void
 gs_plugin_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk,
 			     GsPluginDownloadHelper *helper)
@@ -1037,12 +1172,11 @@ gs_plugin_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk,
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (helper->plugin);
 	guint percentage;
 	goffset header_size;
-	goffset body_length;
 
 	/* cancelled? */
 	if (g_cancellable_is_cancelled (helper->cancellable)) {
 		g_debug ("cancelling download of %s",
-			 gs_app_get_id (helper->app));
+			 helper->app != NULL ? gs_app_get_id (helper->app) : "data");
 		soup_session_cancel_message (priv->soup_session,
 					     msg,
 					     SOUP_STATUS_CANCELLED);
@@ -1050,22 +1184,34 @@ gs_plugin_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk,
 	}
 
 	/* if it's returning "Found" or an error, ignore the percentage */
-	if (msg->status_code != SOUP_STATUS_OK) {
+	if (msg->status_code != SOUP_STATUS_OK &&
+	    msg->status_code != SOUP_STATUS_PARTIAL_CONTENT) {
 		g_debug ("ignoring status code %u (%s)",
 			 msg->status_code, msg->reason_phrase);
 		return;
 	}
 
-	/* get data */
-	body_length = msg->response_body->length;
-	header_size = soup_message_headers_get_content_length (msg->response_headers);
+	gs_plugin_download_throttle (helper->plugin, chunk->length);
+	helper->received += (goffset) chunk->length;
+	if (helper->output != NULL &&
+	    !g_output_stream_write_all (helper->output, chunk->data, chunk->length,
+					NULL, helper->cancellable, &helper->error)) {
+		soup_session_cancel_message (priv->soup_session,
+					     msg,
+					     SOUP_STATUS_CANCELLED);
+		return;
+	}
+	if (helper->app == NULL)
+		return;
 
 	/* size is not known */
-	if (header_size < body_length)
+	header_size = soup_message_headers_get_content_length (msg->response_headers);
+	if (header_size < helper->received || header_size == 0)
 		return;
 
 	/* calculate percentage */
-	percentage = (guint) ((100 * body_length) / header_size);
+	percentage = (guint) ((100 * (helper->offset + helper->received)) /
+			      (helper->offset + header_size));
 	g_debug ("%s progress: %u%%", gs_app_get_id (helper->app), percentage);
 	gs_app_set_progress (helper->app, percentage);
 	gs_plugin_status_update (helper->plugin,
@@ -1073,6 +1219,25 @@ gs_plugin_download_chunk_cb (SoupMessage *msg, SoupBuffer *chunk,
 				 GS_PLUGIN_STATUS_DOWNLOADING);
 }
 
+static void
+gs_plugin_download_set_error_for_status (GError **error,
+					 const gchar *uri,
+					 SoupMessage *msg,
+					 guint status_code)
+{
+	g_autoptr(GString) str = g_string_new (NULL);
+	g_string_append (str, soup_status_get_phrase (status_code));
+	if (msg->response_body->data != NULL) {
+		g_string_append (str, ": ");
+		g_string_append (str, msg->response_body->data);
+	}
+	g_set_error (error,
+		     GS_PLUGIN_ERROR,
+		     GS_PLUGIN_ERROR_DOWNLOAD_FAILED,
+		     "failed to download %s: %s",
+		     uri, str->str);
+}
+
 /**
  * gs_plugin_download_data:
  * @plugin: a #GsPlugin
@@ -1095,7 +1260,7 @@ gs_plugin_download_data (GsPlugin *plugin,
 			 GError **error)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
-	GsPluginDownloadHelper helper;
+	g_auto(GsPluginDownloadHelper) helper = { NULL, };
 	guint status_code;
 	g_autoptr(SoupMessage) msg = NULL;
 
@@ -1123,33 +1288,47 @@ gs_plugin_download_data (GsPlugin *plugin,
 	/* remote */
 	g_debug ("downloading %s from plugin %s", uri, priv->name);
 	msg = soup_message_new (SOUP_METHOD_GET, uri);
-	if (app != NULL) {
-		helper.plugin = plugin;
-		helper.app = app;
-		helper.cancellable = cancellable;
-		g_signal_connect (msg, "got-chunk",
-				  G_CALLBACK (gs_plugin_download_chunk_cb),
-				  &helper);
-	}
-	status_code = soup_session_send_message (priv->soup_session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_autoptr(GString) str = g_string_new (NULL);
-		g_string_append (str, soup_status_get_phrase (status_code));
-		if (msg->response_body->data != NULL) {
-			g_string_append (str, ": ");
-			g_string_append (str, msg->response_body->data);
-		}
+	if (msg == NULL) {
 		g_set_error (error,
 			     GS_PLUGIN_ERROR,
 			     GS_PLUGIN_ERROR_DOWNLOAD_FAILED,
-			     "failed to download %s: %s",
-			     uri, str->str);
+			     "failed to parse URI %s", uri);
+		return NULL;
+	}
+	helper.plugin = plugin;
+	helper.app = app;
+	helper.cancellable = cancellable;
+	g_signal_connect (msg, "got-chunk",
+			  G_CALLBACK (gs_plugin_download_chunk_cb),
+			  &helper);
+	status_code = soup_session_send_message (priv->soup_session, msg);
+	if (status_code != SOUP_STATUS_OK) {
+		gs_plugin_download_set_error_for_status (error, uri, msg, status_code);
 		return NULL;
 	}
 	return g_bytes_new (msg->response_body->data,
 			    (gsize) msg->response_body->length);
 }
 
+/* whether a previous download is complete, so a 304 for it can be trusted */
+static gboolean
+gs_plugin_download_file_is_valid (GFileInfo *info)
+{
+	const gchar *size_str;
+	guint64 size;
+
+	if (g_file_info_get_size (info) == 0)
+		return FALSE;
+
+	/* files from older versions or without xattr support have no size */
+	size_str = g_file_info_get_attribute_string (info, GS_PLUGIN_DOWNLOAD_SIZE_ATTRIBUTE);
+	if (size_str == NULL || *size_str == '\0')
+		return TRUE;
+	if (!g_ascii_string_to_unsigned (size_str, 10, 0, G_MAXUINT64, &size, NULL))
+		return FALSE;
+	return size == (guint64) g_file_info_get_size (info);
+}
+
 /**
  * gs_plugin_download_file:
  * @plugin: a #GsPlugin
@@ -1161,6 +1340,15 @@ gs_plugin_download_data (GsPlugin *plugin,
  *
  * Downloads data and saves it to a file.
  *
+ * If @filename already exists, it is only downloaded again if the remote
+ * file has changed since, using its ETag where the server provided one. In
+ * either case the modification time of @filename is updated, so
+ * gs_utils_get_file_age() can be used to decide when to call this again.
+ *
+ * The data is streamed to a temporary file next to @filename, and an
+ * interrupted download is resumed from where it stopped on the next call if
+ * the server supports it.
+ *
  * Returns: %TRUE for success
  *
  * Since: 3.22
@@ -1174,9 +1362,16 @@ gs_plugin_download_file (GsPlugin *plugin,
 			 GError **error)
 {
 	GsPluginPrivate *priv = gs_plugin_get_instance_private (plugin);
-	GsPluginDownloadHelper helper;
+	g_auto(GsPluginDownloadHelper) helper = { NULL, };
 	guint status_code;
+	g_autofree gchar *filename_partial = NULL;
+	g_autofree gchar *resource_partial = NULL;
+	g_autofree gchar *size_str = NULL;
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFile) file_partial = NULL;
+	g_autoptr(GFileInfo) info = NULL;
+	g_autoptr(GFileInfo) info_partial = NULL;
 	g_autoptr(SoupMessage) msg = NULL;
 
 	g_return_val_if_fail (GS_IS_PLUGIN (plugin), FALSE);
@@ -1218,35 +1413,131 @@ gs_plugin_download_file (GsPlugin *plugin,
 			     "failed to parse URI %s", uri);
 		return FALSE;
 	}
-	if (app != NULL) {
-		helper.plugin = plugin;
-		helper.app = app;
-		helper.cancellable = cancellable;
-		g_signal_connect (msg, "got-chunk",
-				  G_CALLBACK (gs_plugin_download_chunk_cb),
-				  &helper);
+	if (!gs_mkdir_parent (filename, error))
+		return FALSE;
+	resource_partial = g_strconcat (filename, GS_PLUGIN_DOWNLOAD_PARTIAL_SUFFIX, NULL);
+	filename_partial = gs_utils_get_cache_filename (GS_PLUGIN_DOWNLOAD_PARTIAL_KIND,
+							resource_partial,
+							GS_UTILS_CACHE_FLAG_WRITEABLE |
+							GS_UTILS_CACHE_FLAG_USE_HASH |
+							GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+							error);
+	if (filename_partial == NULL)
+		return FALSE;
+	file = g_file_new_for_path (filename);
+	file_partial = g_file_new_for_path (filename_partial);
+
+	/* a file which is incomplete is downloaded again in full, rather than
+	 * kept forever because the server says it has not changed */
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  GS_PLUGIN_DOWNLOAD_SIZE_ATTRIBUTE,
+				  G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+	if (info != NULL && !gs_plugin_download_file_is_valid (info)) {
+		g_debug ("%s is incomplete, so downloading it again", filename);
+		g_clear_object (&info);
 	}
-	status_code = soup_session_send_message (priv->soup_session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_autoptr(GString) str = g_string_new (NULL);
-		g_string_append (str, soup_status_get_phrase (status_code));
-		if (msg->response_body->data != NULL) {
-			g_string_append (str, ": ");
-			g_string_append (str, msg->response_body->data);
+
+	/* only download the file again if it has changed */
+	if (info != NULL) {
+		guint64 mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+		g_autofree gchar *etag = gs_utils_get_file_etag (filename, cancellable);
+		g_autoptr(SoupDate) date = soup_date_new_from_time_t ((time_t) mtime);
+		g_autofree gchar *date_str = soup_date_to_string (date, SOUP_DATE_HTTP);
+
+		if (etag != NULL)
+			soup_message_headers_append (msg->request_headers, "If-None-Match", etag);
+		soup_message_headers_append (msg->request_headers, "If-Modified-Since", date_str);
+	} else {
+		g_autofree gchar *etag = NULL;
+
+		/* resume an interrupted download, as long as the ETag shows
+		 * the remote file is exactly the same one */
+		info_partial = g_file_query_info (file_partial, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+						  G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+		if (info_partial != NULL && g_file_info_get_size (info_partial) > 0)
+			etag = gs_utils_get_file_etag (filename_partial, cancellable);
+		if (etag != NULL && !g_str_has_prefix (etag, "W/")) {
+			helper.offset = g_file_info_get_size (info_partial);
+			soup_message_headers_set_range (msg->request_headers, helper.offset, -1);
+			soup_message_headers_append (msg->request_headers, "If-Range", etag);
 		}
+	}
+
+	helper.plugin = plugin;
+	helper.app = app;
+	helper.cancellable = cancellable;
+	helper.filename = filename_partial;
+	g_signal_connect (msg, "got-headers",
+			  G_CALLBACK (gs_plugin_download_got_headers_cb),
+			  &helper);
+	g_signal_connect (msg, "got-chunk",
+			  G_CALLBACK (gs_plugin_download_chunk_cb),
+			  &helper);
+	status_code = soup_session_send_message (priv->soup_session, msg);
+	if (helper.output != NULL &&
+	    !g_output_stream_close (helper.output, NULL, &error_local) &&
+	    helper.error == NULL)
+		helper.error = g_steal_pointer (&error_local);
+	if (helper.error != NULL) {
 		g_set_error (error,
 			     GS_PLUGIN_ERROR,
-			     GS_PLUGIN_ERROR_DOWNLOAD_FAILED,
-			     "failed to download %s: %s",
-			     uri, str->str);
+			     GS_PLUGIN_ERROR_WRITE_FAILED,
+			     "Failed to save file: %s",
+			     helper.error->message);
 		return FALSE;
 	}
-	if (!gs_mkdir_parent (filename, error))
+
+	/* still valid, so start counting its age again */
+	if (status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_debug ("%s has not changed since it was downloaded", uri);
+		g_file_set_attribute_uint64 (file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+					     (guint64) g_get_real_time () / G_USEC_PER_SEC,
+					     G_FILE_QUERY_INFO_NONE, NULL, NULL);
+		return TRUE;
+	}
+
+	/* the partial file is no use, so do not try to resume it again */
+	if (status_code == SOUP_STATUS_REQUESTED_RANGE_NOT_SATISFIABLE)
+		g_unlink (filename_partial);
+
+	if (status_code != SOUP_STATUS_OK &&
+	    status_code != SOUP_STATUS_PARTIAL_CONTENT) {
+		gs_plugin_download_set_error_for_status (error, uri, msg, status_code);
 		return FALSE;
-	if (!g_file_set_contents (filename,
-				  msg->response_body->data,
-				  msg->response_body->length,
-				  &error_local)) {
+	}
+
+	/* the connection may have been closed early without an error */
+	g_clear_object (&info_partial);
+	info_partial = g_file_query_info (file_partial, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					  G_FILE_QUERY_INFO_NONE, cancellable, &error_local);
+	if (info_partial == NULL) {
+		g_set_error (error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_WRITE_FAILED,
+			     "Failed to save file: %s",
+			     error_local->message);
+		return FALSE;
+	}
+	if (helper.expected_size >= 0 &&
+	    g_file_info_get_size (info_partial) != helper.expected_size) {
+		g_set_error (error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_DOWNLOAD_FAILED,
+			     "%s was truncated: got %" G_GOFFSET_FORMAT " of %" G_GOFFSET_FORMAT " bytes",
+			     uri, g_file_info_get_size (info_partial), helper.expected_size);
+		g_unlink (filename_partial);
+		return FALSE;
+	}
+	size_str = g_strdup_printf ("%" G_GOFFSET_FORMAT, g_file_info_get_size (info_partial));
+	g_file_set_attribute_string (file_partial, GS_PLUGIN_DOWNLOAD_SIZE_ATTRIBUTE, size_str,
+				     G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+	/* this is a rename unless the cache is on a different file system */
+	if (!g_file_move (file_partial, file,
+			  G_FILE_COPY_OVERWRITE | G_FILE_COPY_ALL_METADATA,
+			  cancellable, NULL, NULL, &error_local)) {
 		g_set_error (error,
 			     GS_PLUGIN_ERROR,
 			     GS_PLUGIN_ERROR_WRITE_FAILED,
@@ -9,6 +9,9 @@
 
 #include "config.h"
 
+#include <glib/gstdio.h>
+#include <unistd.h>
+
 #include "gnome-software-private.h"
 
 #include "gs-debug.h"
@@ -772,6 +775,121 @@ gs_app_list_func (void)
 	g_assert_cmpint (gs_app_list_get_state (list), ==, GS_APP_STATE_UNKNOWN);
 }
 
+static gchar *
+gs_app_list_sort_key_name_cb (GsApp *app, gpointer user_data)
+{
+	guint *calls = user_data;
+	(*calls)++;
+	return g_strdup (gs_app_get_name (app));
+}
+
+static void
+gs_app_list_sort_key_func (void)
+{
+	const gchar *names[] = { "c", "a", NULL, "b", "a" };
+	guint calls = 0;
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+
+	for (guint i = 0; i < G_N_ELEMENTS (names); i++) {
+		g_autofree gchar *id = g_strdup_printf ("%u.desktop", i);
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_set_name (app, GS_APP_QUALITY_NORMAL, names[i]);
+		gs_app_list_add (list, app);
+	}
+
+	/* one key per app, NULL first, and equal keys keep their order */
+	gs_app_list_sort_by_key (list, gs_app_list_sort_key_name_cb, &calls);
+	g_assert_cmpint (calls, ==, G_N_ELEMENTS (names));
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 0)), ==, "2.desktop");
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 1)), ==, "1.desktop");
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 2)), ==, "4.desktop");
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 3)), ==, "3.desktop");
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 4)), ==, "0.desktop");
+}
+
+static gboolean
+gs_app_list_sort_truncate_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+{
+	return g_strcmp0 (gs_app_get_name (app1), gs_app_get_name (app2));
+}
+
+static void
+gs_app_list_sort_truncate_func (void)
+{
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsAppList) list_full = NULL;
+	guint calls = 0;
+
+	/* names in a scrambled but repeatable order */
+	for (guint i = 0; i < 100; i++) {
+		g_autofree gchar *id = g_strdup_printf ("%u.desktop", i);
+		g_autofree gchar *name = g_strdup_printf ("%02u", (i * 37) % 50);
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_set_name (app, GS_APP_QUALITY_NORMAL, name);
+		gs_app_list_add (list, app);
+	}
+	list_full = gs_app_list_copy (list);
+	gs_app_list_sort (list_full, gs_app_list_sort_truncate_cb, NULL);
+
+	/* the same as a stable full sort then truncate */
+	gs_app_list_sort_truncate (list, gs_app_list_sort_truncate_cb, NULL, 7);
+	g_assert_cmpint (gs_app_list_length (list), ==, 7);
+	g_assert_true (gs_app_list_has_flag (list, GS_APP_LIST_FLAG_IS_TRUNCATED));
+	for (guint i = 0; i < 7; i++) {
+		g_assert_true (gs_app_list_index (list, i) ==
+			       gs_app_list_index (list_full, i));
+	}
+
+	/* keyed, and longer than the list */
+	gs_app_list_sort_by_key_truncate (list_full, gs_app_list_sort_key_name_cb, &calls, 500);
+	g_assert_cmpint (calls, ==, 100);
+	g_assert_cmpint (gs_app_list_length (list_full), ==, 100);
+	g_assert_cmpstr (gs_app_get_name (gs_app_list_index (list_full, 0)), ==, "00");
+	g_assert_cmpstr (gs_app_get_name (gs_app_list_index (list_full, 99)), ==, "49");
+}
+
+static gboolean
+gs_app_list_filter_chain_is_desktop_cb (GsApp *app, gpointer user_data)
+{
+	return g_str_has_suffix (gs_app_get_id (app), ".desktop");
+}
+
+static gboolean
+gs_app_list_filter_chain_is_odd_cb (GsApp *app, gpointer user_data)
+{
+	guint *calls = user_data;
+	(*calls)++;
+	return g_ascii_strtoull (gs_app_get_id (app), NULL, 10) % 2 == 1;
+}
+
+static void
+gs_app_list_filter_chain_func (void)
+{
+	guint calls = 0;
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsAppListFilterChain) chain = gs_app_list_filter_chain_new ();
+	g_autofree gchar *str = NULL;
+
+	for (guint i = 0; i < 6; i++) {
+		g_autofree gchar *id = g_strdup_printf ("%u.%s", i, i < 4 ? "desktop" : "addon");
+		g_autoptr(GsApp) app = gs_app_new (id);
+		gs_app_list_add (list, app);
+	}
+
+	/* later filters are skipped for apps already rejected */
+	gs_app_list_filter_chain_add (chain, "is-desktop", gs_app_list_filter_chain_is_desktop_cb, NULL);
+	gs_app_list_filter_chain_add (chain, "is-odd", gs_app_list_filter_chain_is_odd_cb, &calls);
+	gs_app_list_filter_chain (list, chain);
+	g_assert_cmpint (calls, ==, 4);
+	g_assert_cmpint (gs_app_list_length (list), ==, 2);
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 0)), ==, "1.desktop");
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 1)), ==, "3.desktop");
+	g_assert_cmpint (gs_app_list_filter_chain_get_n_rejected (chain, "is-desktop"), ==, 2);
+	g_assert_cmpint (gs_app_list_filter_chain_get_n_rejected (chain, "is-odd"), ==, 2);
+	str = gs_app_list_filter_chain_to_string (chain);
+	g_assert_cmpstr (str, ==, "is-desktop=2 is-odd=2");
+}
+
 static void
 gs_app_list_performance_func (void)
 {
@@ -794,6 +912,71 @@ gs_app_list_performance_func (void)
 	g_print ("%.2fms ", g_timer_elapsed (timer, NULL) * 1000);
 }
 
+static gsize
+gs_test_get_resident_size (void)
+{
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) split = NULL;
+
+	if (!g_file_get_contents ("/proc/self/statm", &data, NULL, NULL))
+		return 0;
+	split = g_strsplit (data, " ", -1);
+	if (g_strv_length (split) < 2)
+		return 0;
+	return g_ascii_strtoull (split[1], NULL, 10) * sysconf (_SC_PAGESIZE);
+}
+
+static void
+gs_app_memory_func (void)
+{
+	g_autoptr(GPtrArray) apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	const guint n_apps = 10000;
+	gsize rss_before;
+	gsize rss_after;
+	GsApp *app1;
+	GsApp *app2;
+
+	rss_before = gs_test_get_resident_size ();
+	if (rss_before == 0) {
+		g_test_skip ("resident size is not available");
+		return;
+	}
+
+	/* create apps with the properties a typical appstream app has */
+	for (guint i = 0; i < n_apps; i++) {
+		g_autofree gchar *id = g_strdup_printf ("org.example.App%05u.desktop", i);
+		g_autofree gchar *name = g_strdup_printf ("Example %05u", i);
+		GsApp *app = gs_app_new (id);
+		gs_app_set_kind (app, AS_COMPONENT_KIND_DESKTOP_APP);
+		gs_app_set_name (app, GS_APP_QUALITY_NORMAL, name);
+		gs_app_set_summary (app, GS_APP_QUALITY_NORMAL, "An example app");
+		gs_app_set_origin (app, "flathub");
+		gs_app_set_origin_appstream (app, "flathub");
+		gs_app_set_origin_hostname (app, "https://dl.flathub.org/repo/");
+		gs_app_set_management_plugin (app, "flatpak");
+		gs_app_set_branch (app, "stable");
+		gs_app_set_project_group (app, "GNOME");
+		gs_app_set_license (app, GS_APP_QUALITY_NORMAL, "GPL-2.0+");
+		g_ptr_array_add (apps, app);
+	}
+	rss_after = gs_test_get_resident_size ();
+
+	/* low-cardinality strings are shared, and unused lists are not allocated */
+	app1 = g_ptr_array_index (apps, 0);
+	app2 = g_ptr_array_index (apps, 1);
+	g_assert_true (gs_app_get_origin (app1) == gs_app_get_origin (app2));
+	g_assert_true (gs_app_get_license (app1) == gs_app_get_license (app2));
+	g_assert_cmpstr (gs_app_get_origin_hostname (app1), ==, "dl.flathub.org");
+	g_assert_cmpint (gs_app_list_length (gs_app_get_addons (app1)), ==, 0);
+	g_assert_cmpint (gs_app_list_length (gs_app_get_related (app1)), ==, 0);
+	g_assert_cmpint (gs_app_list_length (gs_app_get_history (app1)), ==, 0);
+	g_assert_null (gs_app_get_url (app1, AS_URL_KIND_HOMEPAGE));
+	g_assert_null (gs_app_get_metadata_item (app1, "GnomeSoftware::Test"));
+
+	if (rss_after > rss_before)
+		g_print ("%" G_GSIZE_FORMAT " bytes/app ", (rss_after - rss_before) / n_apps);
+}
+
 static void
 gs_app_list_related_func (void)
 {
@@ -814,6 +997,139 @@ gs_app_list_related_func (void)
 	g_assert_cmpint (gs_app_list_get_progress (list), ==, 50);
 }
 
+static void
+gs_icon_pixbuf_cache_func (void)
+{
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GdkPixbuf) source = NULL;
+	g_autoptr(GdkPixbuf) pixbuf1 = NULL;
+	g_autoptr(GdkPixbuf) pixbuf2 = NULL;
+	g_autoptr(GdkPixbuf) pixbuf3 = NULL;
+	g_autoptr(GdkPixbuf) pixbuf4 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GIcon) icon = NULL;
+	g_autoptr(GIcon) icon_themed = g_themed_icon_new ("system-component-application");
+
+	/* write out a test icon */
+	fn = gs_utils_get_cache_filename ("icons", "test-icon.png",
+					  GS_UTILS_CACHE_FLAG_WRITEABLE |
+					  GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					  &error);
+	g_assert_no_error (error);
+	source = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 64, 64);
+	gdk_pixbuf_fill (source, 0xff0000ff);
+	gdk_pixbuf_save (source, fn, "png", &error, NULL);
+	g_assert_no_error (error);
+	file = g_file_new_for_path (fn);
+	icon = g_file_icon_new (file);
+
+	/* the same icon at the same size is only decoded once */
+	pixbuf1 = gs_icon_load_pixbuf (icon, 32, 1, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pixbuf1);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf1), ==, 32);
+	pixbuf2 = gs_icon_load_pixbuf (icon, 32, 1, &error);
+	g_assert_no_error (error);
+	g_assert_true (pixbuf1 == pixbuf2);
+
+	/* a different scale is a different pixbuf */
+	pixbuf3 = gs_icon_load_pixbuf (icon, 32, 2, &error);
+	g_assert_no_error (error);
+	g_assert_true (pixbuf3 != pixbuf1);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf3), ==, 64);
+
+	/* still shared after clearing the cache, as it is in use */
+	gs_icon_pixbuf_cache_clear ();
+	pixbuf4 = gs_icon_load_pixbuf (icon, 32, 1, &error);
+	g_assert_no_error (error);
+	g_assert_true (pixbuf4 == pixbuf1);
+
+	/* themed icons are left to the icon theme */
+	g_assert_null (gs_icon_load_pixbuf (icon_themed, 32, 1, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+
+	gs_icon_pixbuf_cache_clear ();
+}
+
+static void
+gs_icon_atlas_func (void)
+{
+	const guint8 *pixels;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *fn_atlas = NULL;
+	g_autofree gchar *uri = NULL;
+	g_autoptr(GdkPixbuf) source = NULL;
+	g_autoptr(GdkPixbuf) pixbuf1 = NULL;
+	g_autoptr(GdkPixbuf) pixbuf2 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GIcon) icon = NULL;
+	g_autoptr(GPtrArray) icons = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GsIconAtlas) atlas = NULL;
+
+	/* write out a test icon */
+	fn = gs_utils_get_cache_filename ("icons", "test-atlas.png",
+					  GS_UTILS_CACHE_FLAG_WRITEABLE |
+					  GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					  &error);
+	g_assert_no_error (error);
+	source = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, 64, 64);
+	gdk_pixbuf_fill (source, 0x00ff0000);
+	gdk_pixbuf_save (source, fn, "png", &error, NULL);
+	g_assert_no_error (error);
+	file = g_file_new_for_path (fn);
+	uri = g_file_get_uri (file);
+	icon = g_file_icon_new (file);
+	g_ptr_array_add (icons, g_object_ref (icon));
+	g_ptr_array_add (icons, g_themed_icon_new ("system-component-application"));
+
+	/* build it, ignoring the themed icon */
+	fn_atlas = gs_utils_get_cache_filename ("icons", "test.atlas",
+						GS_UTILS_CACHE_FLAG_WRITEABLE |
+						GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+						&error);
+	g_assert_no_error (error);
+	g_assert_true (gs_icon_atlas_build (fn_atlas, "guid", 24, 2, icons, 0, NULL, &error));
+	g_assert_no_error (error);
+
+	/* load it back */
+	atlas = gs_icon_atlas_new_from_file (fn_atlas, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (atlas);
+	g_assert_cmpstr (gs_icon_atlas_get_guid (atlas), ==, "guid");
+	g_assert_cmpint (gs_icon_atlas_get_size (atlas), ==, 24);
+	g_assert_cmpint (gs_icon_atlas_get_scale (atlas), ==, 2);
+	g_assert_cmpint (gs_icon_atlas_get_n_icons (atlas), ==, 1);
+	g_assert_null (gs_icon_atlas_lookup (atlas, "file:///does/not/exist.png"));
+	pixbuf1 = gs_icon_atlas_lookup (atlas, uri);
+	g_assert_nonnull (pixbuf1);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf1), ==, 48);
+	g_assert_cmpint (gdk_pixbuf_get_height (pixbuf1), ==, 48);
+	g_assert_true (gdk_pixbuf_get_has_alpha (pixbuf1));
+	pixels = gdk_pixbuf_read_pixels (pixbuf1);
+	g_assert_cmpint (pixels[0], ==, 0x00);
+	g_assert_cmpint (pixels[1], ==, 0xff);
+	g_assert_cmpint (pixels[2], ==, 0x00);
+	g_assert_cmpint (pixels[3], ==, 0xff);
+
+	/* once added, the source file is not needed any more */
+	gs_icon_add_atlas (atlas);
+	g_assert_cmpint (g_unlink (fn), ==, 0);
+	pixbuf2 = gs_icon_load_pixbuf (icon, 24, 2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pixbuf2);
+	g_assert_cmpint (gdk_pixbuf_get_width (pixbuf2), ==, 48);
+
+	/* too small to fit anything */
+	g_assert_true (gs_icon_atlas_build (fn_atlas, NULL, 24, 2, icons, 16, NULL, &error));
+	g_assert_no_error (error);
+	g_clear_object (&atlas);
+	atlas = gs_icon_atlas_new_from_file (fn_atlas, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (gs_icon_atlas_get_n_icons (atlas), ==, 0);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -836,6 +1152,8 @@ main (int argc, char **argv)
 	g_test_add_func ("/gnome-software/lib/utils{append-kv}", gs_utils_append_kv_func);
 	g_test_add_func ("/gnome-software/lib/utils{parse-evr}", gs_utils_parse_evr_func);
 	g_test_add_func ("/gnome-software/lib/os-release", gs_os_release_func);
+	g_test_add_func ("/gnome-software/lib/icon{pixbuf-cache}", gs_icon_pixbuf_cache_func);
+	g_test_add_func ("/gnome-software/lib/icon{atlas}", gs_icon_atlas_func);
 	g_test_add_func ("/gnome-software/lib/app", gs_app_func);
 	g_test_add_func ("/gnome-software/lib/app/progress-clamping", gs_app_progress_clamping_func);
 	g_test_add_func ("/gnome-software/lib/app{addons}", gs_app_addons_func);
@@ -843,8 +1161,12 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/lib/app{thread}", debug, gs_app_thread_func);
 	g_test_add_func ("/gnome-software/lib/app{list}", gs_app_list_func);
 	g_test_add_func ("/gnome-software/lib/app{list-wildcard-dedupe}", gs_app_list_wildcard_dedupe_func);
+	g_test_add_func ("/gnome-software/lib/app{list-sort-key}", gs_app_list_sort_key_func);
+	g_test_add_func ("/gnome-software/lib/app{list-sort-truncate}", gs_app_list_sort_truncate_func);
+	g_test_add_func ("/gnome-software/lib/app{list-filter-chain}", gs_app_list_filter_chain_func);
 	g_test_add_func ("/gnome-software/lib/app{list-performance}", gs_app_list_performance_func);
 	g_test_add_func ("/gnome-software/lib/app{list-related}", gs_app_list_related_func);
+	g_test_add_func ("/gnome-software/lib/app{memory}", gs_app_memory_func);
 	g_test_add_func ("/gnome-software/lib/plugin", gs_plugin_func);
 	g_test_add_func ("/gnome-software/lib/plugin{download-rewrite}", gs_plugin_download_rewrite_func);
 
@@ -0,0 +1,249 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-trace
+ * @short_description: A recorder for the timings of startup phases
+ *
+ * If the `GS_TRACE_STARTUP` environment variable is set to a file name, the
+ * phases of startup record when they started and how long they took using
+ * gs_trace_add_span() and gs_trace_add_instant(), and gs_trace_write() saves
+ * them to that file in the Chrome trace event format. The file can be opened
+ * in `chrome://tracing` or Perfetto, or compared between a cold and a warm
+ * start.
+ *
+ * Unlike the sysprof marks, this needs no capture to be running and no
+ * support at build time. If the variable is not set, all of these functions
+ * do nothing.
+ *
+ * All functions are thread safe.
+ *
+ * Since: 40
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include <unistd.h>
+
+#include "gs-trace.h"
+
+typedef struct {
+	gchar		*category;
+	gchar		*name;
+	gchar		*message;	/* (nullable) */
+	gint64		 timestamp;	/* monotonic, in µs */
+	gint64		 duration;	/* in µs, or -1 for an instant */
+	guint		 thread_id;
+} GsTraceEvent;
+
+G_LOCK_DEFINE_STATIC (trace);
+static gchar *trace_filename = NULL;	/* (owned) (nullable) */
+static GArray *trace_events = NULL;	/* (owned) (element-type GsTraceEvent) */
+static guint trace_thread_id_next = 1;
+static GPrivate trace_thread_id;
+
+/* small per-thread numbers read better in a trace viewer than addresses */
+static guint
+gs_trace_get_thread_id (void)
+{
+	guint thread_id = GPOINTER_TO_UINT (g_private_get (&trace_thread_id));
+	if (thread_id == 0) {
+		thread_id = g_atomic_int_add (&trace_thread_id_next, 1);
+		g_private_set (&trace_thread_id, GUINT_TO_POINTER (thread_id));
+	}
+	return thread_id;
+}
+
+/**
+ * gs_trace_is_enabled:
+ *
+ * Gets whether startup tracing was requested using `GS_TRACE_STARTUP`.
+ *
+ * Returns: %TRUE if events are being recorded
+ *
+ * Since: 40
+ **/
+gboolean
+gs_trace_is_enabled (void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		const gchar *tmp = g_getenv ("GS_TRACE_STARTUP");
+		if (tmp != NULL && tmp[0] != '\0') {
+			trace_filename = g_strdup (tmp);
+			trace_events = g_array_new (FALSE, FALSE, sizeof (GsTraceEvent));
+		}
+		g_once_init_leave (&initialized, 1);
+	}
+	return trace_filename != NULL;
+}
+
+static void
+gs_trace_add_event (gint64 timestamp,
+		    gint64 duration,
+		    const gchar *category,
+		    const gchar *name,
+		    const gchar *message)
+{
+	GsTraceEvent event;
+
+	event.category = g_strdup (category);
+	event.name = g_strdup (name);
+	event.message = g_strdup (message);
+	event.timestamp = timestamp;
+	event.duration = duration;
+	event.thread_id = gs_trace_get_thread_id ();
+
+	G_LOCK (trace);
+	g_array_append_val (trace_events, event);
+	G_UNLOCK (trace);
+}
+
+/**
+ * gs_trace_add_span:
+ * @begin_time: when the span started, from g_get_monotonic_time()
+ * @category: the category, e.g. `startup` or `plugin`
+ * @name: the name of the span
+ * @message: (nullable): extra details, or %NULL
+ *
+ * Records a span of time which started at @begin_time and ends now.
+ *
+ * Since: 40
+ **/
+void
+gs_trace_add_span (gint64 begin_time,
+		   const gchar *category,
+		   const gchar *name,
+		   const gchar *message)
+{
+	if (!gs_trace_is_enabled ())
+		return;
+	gs_trace_add_event (begin_time, g_get_monotonic_time () - begin_time,
+			    category, name, message);
+}
+
+/**
+ * gs_trace_add_instant:
+ * @category: the category, e.g. `startup` or `overview`
+ * @name: the name of the event
+ * @message: (nullable): extra details, or %NULL
+ *
+ * Records something which happened now, such as a first paint.
+ *
+ * Since: 40
+ **/
+void
+gs_trace_add_instant (const gchar *category,
+		      const gchar *name,
+		      const gchar *message)
+{
+	if (!gs_trace_is_enabled ())
+		return;
+	gs_trace_add_event (g_get_monotonic_time (), -1, category, name, message);
+}
+
+/**
+ * gs_trace_write:
+ * @error: a #GError, or %NULL
+ *
+ * Writes all the events recorded so far to the file named by
+ * `GS_TRACE_STARTUP`, replacing what was written there before. Timestamps are
+ * relative to the earliest recorded event.
+ *
+ * This may be called more than once, for example when startup has finished
+ * and again on shutdown.
+ *
+ * Returns: %TRUE for success, including if tracing is not enabled
+ *
+ * Since: 40
+ **/
+gboolean
+gs_trace_write (GError **error)
+{
+	gint64 start_time = G_MAXINT64;
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonBuilder) builder = NULL;
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	if (!gs_trace_is_enabled ())
+		return TRUE;
+
+	builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "displayTimeUnit");
+	json_builder_add_string_value (builder, "ms");
+	json_builder_set_member_name (builder, "traceEvents");
+	json_builder_begin_array (builder);
+
+	/* name the process in the viewer */
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "name");
+	json_builder_add_string_value (builder, "process_name");
+	json_builder_set_member_name (builder, "ph");
+	json_builder_add_string_value (builder, "M");
+	json_builder_set_member_name (builder, "pid");
+	json_builder_add_int_value (builder, getpid ());
+	json_builder_set_member_name (builder, "args");
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "name");
+	json_builder_add_string_value (builder, g_get_prgname ());
+	json_builder_end_object (builder);
+	json_builder_end_object (builder);
+
+	G_LOCK (trace);
+	for (guint i = 0; i < trace_events->len; i++) {
+		GsTraceEvent *event = &g_array_index (trace_events, GsTraceEvent, i);
+		start_time = MIN (start_time, event->timestamp);
+	}
+	for (guint i = 0; i < trace_events->len; i++) {
+		GsTraceEvent *event = &g_array_index (trace_events, GsTraceEvent, i);
+
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "name");
+		json_builder_add_string_value (builder, event->name);
+		json_builder_set_member_name (builder, "cat");
+		json_builder_add_string_value (builder, event->category);
+		json_builder_set_member_name (builder, "ph");
+		json_builder_add_string_value (builder, event->duration >= 0 ? "X" : "i");
+		json_builder_set_member_name (builder, "ts");
+		json_builder_add_int_value (builder, event->timestamp - start_time);
+		if (event->duration >= 0) {
+			json_builder_set_member_name (builder, "dur");
+			json_builder_add_int_value (builder, event->duration);
+		} else {
+			json_builder_set_member_name (builder, "s");
+			json_builder_add_string_value (builder, "p");
+		}
+		json_builder_set_member_name (builder, "pid");
+		json_builder_add_int_value (builder, getpid ());
+		json_builder_set_member_name (builder, "tid");
+		json_builder_add_int_value (builder, event->thread_id);
+		if (event->message != NULL) {
+			json_builder_set_member_name (builder, "args");
+			json_builder_begin_object (builder);
+			json_builder_set_member_name (builder, "message");
+			json_builder_add_string_value (builder, event->message);
+			json_builder_end_object (builder);
+		}
+		json_builder_end_object (builder);
+	}
+	G_UNLOCK (trace);
+
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	return g_file_set_contents (trace_filename, data, -1, error);
+}
@@ -0,0 +1,25 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean	 gs_trace_is_enabled		(void);
+void		 gs_trace_add_span		(gint64		 begin_time,
+						 const gchar	*category,
+						 const gchar	*name,
+						 const gchar	*message);
+void		 gs_trace_add_instant		(const gchar	*category,
+						 const gchar	*name,
+						 const gchar	*message);
+gboolean	 gs_trace_write			(GError		**error);
+
+G_END_DECLS
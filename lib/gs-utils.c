@@ -101,6 +101,70 @@ gs_utils_get_file_age (GFile *file)
 	return (guint) (now - mtime);
 }
 
+#define GS_UTILS_ETAG_ATTRIBUTE "xattr::gnome-software::etag"
+
+/**
+ * gs_utils_get_file_etag:
+ * @filename: a file name
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ *
+ * Gets the HTTP ETag stored on @filename with gs_utils_set_file_etag(), if
+ * the file system supports extended attributes.
+ *
+ * Returns: (transfer full) (nullable): the ETag, or %NULL if not set
+ *
+ * Since: 40
+ */
+gchar *
+gs_utils_get_file_etag (const gchar *filename, GCancellable *cancellable)
+{
+	const gchar *etag;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileInfo) info = NULL;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	file = g_file_new_for_path (filename);
+	info = g_file_query_info (file, GS_UTILS_ETAG_ATTRIBUTE,
+				  G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+	if (info == NULL)
+		return NULL;
+	etag = g_file_info_get_attribute_string (info, GS_UTILS_ETAG_ATTRIBUTE);
+	if (etag == NULL || *etag == '\0')
+		return NULL;
+	return g_strdup (etag);
+}
+
+/**
+ * gs_utils_set_file_etag:
+ * @filename: a file name
+ * @etag: (nullable): the HTTP ETag to store, or %NULL to clear it
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ *
+ * Stores the HTTP ETag of the resource @filename was downloaded from, so that
+ * it can be revalidated later. This silently does nothing if the file system
+ * does not support extended attributes.
+ *
+ * Returns: %TRUE if the ETag was stored
+ *
+ * Since: 40
+ */
+gboolean
+gs_utils_set_file_etag (const gchar *filename,
+			const gchar *etag,
+			GCancellable *cancellable)
+{
+	g_autoptr(GFile) file = NULL;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	file = g_file_new_for_path (filename);
+	return g_file_set_attribute_string (file, GS_UTILS_ETAG_ATTRIBUTE,
+					    etag != NULL ? etag : "",
+					    G_FILE_QUERY_INFO_NONE,
+					    cancellable, NULL);
+}
+
 static gchar *
 gs_utils_filename_array_return_newest (GPtrArray *array)
 {
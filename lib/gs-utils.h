@@ -36,6 +36,11 @@ typedef enum {
 } GsUtilsCacheFlags;
 
 guint		 gs_utils_get_file_age		(GFile		*file);
+gchar		*gs_utils_get_file_etag		(const gchar	*filename,
+						 GCancellable	*cancellable);
+gboolean	 gs_utils_set_file_etag		(const gchar	*filename,
+						 const gchar	*etag,
+						 GCancellable	*cancellable);
 gchar		*gs_utils_get_content_type	(GFile		*file,
 						 GCancellable	*cancellable,
 						 GError		**error);
@@ -15,6 +15,81 @@
 
 #define	GS_APPSTREAM_MAX_SCREENSHOTS	5
 
+/* Compiling an XPath is a large part of the cost of running it, so the
+ * queries on a silo are compiled once and kept with it, with any values which
+ * change between calls bound to placeholders rather than formatted into the
+ * XPath. The cache is attached to the silo so it goes away when the silo is
+ * rebuilt. */
+G_LOCK_DEFINE_STATIC (query_cache);
+
+static XbQuery *
+gs_appstream_get_query (XbSilo *silo, const gchar *xpath, GError **error)
+{
+#if LIBXMLB_CHECK_VERSION(0, 3, 0)
+	GHashTable *queries;
+	XbQuery *query;
+
+	G_LOCK (query_cache);
+	queries = g_object_get_data (G_OBJECT (silo), "GsAppstream::queries");
+	if (queries == NULL) {
+		queries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+		g_object_set_data_full (G_OBJECT (silo), "GsAppstream::queries", queries,
+					(GDestroyNotify) g_hash_table_unref);
+	}
+	query = g_hash_table_lookup (queries, xpath);
+	if (query == NULL) {
+		query = xb_query_new (silo, xpath, error);
+		if (query != NULL)
+			g_hash_table_insert (queries, g_strdup (xpath), query);
+	}
+	if (query != NULL)
+		g_object_ref (query);
+	G_UNLOCK (query_cache);
+
+	return query;
+#else
+	/* the bound values are kept in the query itself, so it can't be
+	 * shared between threads */
+	return xb_query_new (silo, xpath, error);
+#endif
+}
+
+/* runs @xpath on @silo, binding @values to its placeholders in order; the
+ * placeholders are counted across all the parts of a union, and at most
+ * @limit results are returned, or all of them if it is 0 */
+GPtrArray *
+gs_appstream_silo_query (XbSilo *silo,
+			 const gchar *xpath,
+			 const gchar * const *values,
+			 guint limit,
+			 GError **error)
+{
+	g_autoptr(XbQuery) query = NULL;
+#if LIBXMLB_CHECK_VERSION(0, 3, 0)
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT ();
+#endif
+
+	query = gs_appstream_get_query (silo, xpath, error);
+	if (query == NULL)
+		return NULL;
+#if LIBXMLB_CHECK_VERSION(0, 3, 0)
+	for (guint i = 0; values != NULL && values[i] != NULL; i++)
+		xb_value_bindings_bind_str (xb_query_context_get_bindings (&context), i, values[i], NULL);
+	xb_query_context_set_limit (&context, limit);
+	return xb_silo_query_with_context (silo, query, &context, error);
+#else
+	for (guint i = 0; values != NULL && values[i] != NULL; i++) {
+		if (!xb_query_bind_str (query, i, values[i], error))
+			return NULL;
+	}
+#if LIBXMLB_CHECK_VERSION(0, 2, 0)
+	/* the query is not shared, so the limit can be set on it */
+	xb_query_set_limit (query, limit);
+#endif
+	return xb_silo_query_full (silo, query, error);
+#endif
+}
+
 GsApp *
 gs_appstream_create_app (GsPlugin *plugin, XbSilo *silo, XbNode *component, GError **error)
 {
@@ -275,14 +350,13 @@ gs_appstream_refine_add_addons (GsPlugin *plugin,
 				XbSilo *silo,
 				GError **error)
 {
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[] = { gs_app_get_id (app), NULL };
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) addons = NULL;
 
 	/* get all components */
-	xpath = g_strdup_printf ("components/component/extends[text()='%s']/..",
-				 gs_app_get_id (app));
-	addons = xb_silo_query (silo, xpath, 0, &error_local);
+	addons = gs_appstream_silo_query (silo, "components/component/extends[text()=?]/..",
+					  values, 0, &error_local);
 	if (addons == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -505,7 +579,7 @@ gs_appstream_refine_app_updates (GsPlugin *plugin,
 				 GError **error)
 {
 	AsUrgencyKind urgency_best = AS_URGENCY_KIND_UNKNOWN;
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[] = { gs_app_get_id (app), NULL };
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GHashTable) installed = g_hash_table_new (g_str_hash, g_str_equal);
 	g_autoptr(GPtrArray) releases_inst = NULL;
@@ -517,9 +591,8 @@ gs_appstream_refine_app_updates (GsPlugin *plugin,
 		return TRUE;
 
 	/* find out which releases are already installed */
-	xpath = g_strdup_printf ("component/id[text()='%s']/../releases/*[@version]",
-				 gs_app_get_id (app));
-	releases_inst = xb_silo_query (silo, xpath, 0, &error_local);
+	releases_inst = gs_appstream_silo_query (silo, "component/id[text()=?]/../releases/*[@version]",
+						 values, 0, &error_local);
 	if (releases_inst == NULL) {
 		if (!g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
 		    !g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
@@ -1214,6 +1287,44 @@ gs_appstream_silo_search_component (GPtrArray *array, XbNode *component, const g
 	return matches_sum;
 }
 
+/* The text of every field which the queries in gs_appstream_search() look at,
+ * stored on the app so that a search which is only being narrowed can be
+ * done again in memory, looking at the same fields. */
+static GVariant *
+gs_appstream_get_search_text (XbNode *component)
+{
+	const gchar *xpaths[] = {
+		"mimetypes/mimetype",
+		"pkgname",
+		"summary",
+		"name",
+		"keywords/keyword",
+		"id",
+		"launchable",
+		NULL
+	};
+	const gchar *origin;
+	g_autoptr(GPtrArray) texts = g_ptr_array_new ();
+	g_autoptr(GPtrArray) nodes_all = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+	g_autoptr(XbNode) parent = xb_node_get_parent (component);
+
+	for (guint i = 0; xpaths[i] != NULL; i++) {
+		GPtrArray *nodes = xb_node_query (component, xpaths[i], 0, NULL);
+		if (nodes == NULL)
+			continue;
+		for (guint j = 0; j < nodes->len; j++) {
+			const gchar *text = xb_node_get_text (g_ptr_array_index (nodes, j));
+			if (text != NULL)
+				g_ptr_array_add (texts, (gpointer) text);
+		}
+		g_ptr_array_add (nodes_all, nodes);
+	}
+	origin = parent != NULL ? xb_node_get_attr (parent, "origin") : NULL;
+	if (origin != NULL)
+		g_ptr_array_add (texts, (gpointer) origin);
+	return g_variant_new_strv ((const gchar * const *) texts->pdata, texts->len);
+}
+
 gboolean
 gs_appstream_search (GsPlugin *plugin,
 		     XbSilo *silo,
@@ -1244,7 +1355,7 @@ gs_appstream_search (GsPlugin *plugin,
 	/* add some weighted queries */
 	for (guint i = 0; queries[i].xpath != NULL; i++) {
 		g_autoptr(GError) error_query = NULL;
-		g_autoptr(XbQuery) query = xb_query_new (silo, queries[i].xpath, &error_query);
+		g_autoptr(XbQuery) query = gs_appstream_get_query (silo, queries[i].xpath, &error_query);
 		if (query != NULL) {
 			GsAppstreamSearchHelper *helper = g_new0 (GsAppstreamSearchHelper, 1);
 			helper->match_value = queries[i].match_value;
@@ -1256,7 +1367,7 @@ gs_appstream_search (GsPlugin *plugin,
 	}
 
 	/* get all components */
-	components = xb_silo_query (silo, "components/component", 0, &error_local);
+	components = gs_appstream_silo_query (silo, "components/component", NULL, 0, &error_local);
 	if (components == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -1279,6 +1390,10 @@ gs_appstream_search (GsPlugin *plugin,
 			}
 			g_debug ("add %s", gs_app_get_unique_id (app));
 			gs_app_set_match_value (app, match_value);
+			if (gs_app_get_metadata_variant (app, "GnomeSoftware::SearchText") == NULL) {
+				g_autoptr(GVariant) search_text = gs_appstream_get_search_text (component);
+				gs_app_set_metadata_variant (app, "GnomeSoftware::SearchText", search_text);
+			}
 			gs_app_list_add (list, app);
 		}
 	}
@@ -1286,6 +1401,144 @@ gs_appstream_search (GsPlugin *plugin,
 	return TRUE;
 }
 
+/* The components in each desktop group of a silo. Looking a group up
+ * with an XPath query for every category on every job scans the whole silo
+ * each time, so instead all the categories are read with a single query the
+ * first time they are needed, and the index lives as long as the silo. */
+typedef struct {
+	GPtrArray	*ids;		/* component ID, by component index */
+	GHashTable	*groups;	/* desktop group : GArray of guint, sorted */
+} GsAppstreamCategoryIndex;
+
+G_LOCK_DEFINE_STATIC (category_index);
+
+static void
+gs_appstream_category_index_free (GsAppstreamCategoryIndex *index)
+{
+	g_ptr_array_unref (index->ids);
+	g_hash_table_unref (index->groups);
+	g_slice_free (GsAppstreamCategoryIndex, index);
+}
+
+static GsAppstreamCategoryIndex *
+gs_appstream_category_index_new (XbSilo *silo)
+{
+	GsAppstreamCategoryIndex *index = g_slice_new0 (GsAppstreamCategoryIndex);
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	index->ids = g_ptr_array_new_with_free_func (g_free);
+	index->groups = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, (GDestroyNotify) g_array_unref);
+
+	components = gs_appstream_silo_query (silo, "components/component/categories/..", NULL, 0, &error_local);
+	if (components == NULL) {
+		if (!g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+		    !g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			g_warning ("%s", error_local->message);
+		return index;
+	}
+
+	for (guint i = 0; i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+		const gchar *id = xb_node_query_text (component, "id", NULL);
+		g_autoptr(GPtrArray) categories = NULL;
+		guint component_idx;
+
+		if (id == NULL)
+			continue;
+		categories = xb_node_query (component, "categories/category", 0, NULL);
+		if (categories == NULL)
+			continue;
+
+		component_idx = index->ids->len;
+		g_ptr_array_add (index->ids, g_strdup (id));
+		for (guint j = 0; j < categories->len; j++) {
+			const gchar *category = xb_node_get_text (g_ptr_array_index (categories, j));
+			GArray *members;
+
+			if (category == NULL)
+				continue;
+			members = g_hash_table_lookup (index->groups, category);
+			if (members == NULL) {
+				members = g_array_new (FALSE, FALSE, sizeof (guint));
+				g_hash_table_insert (index->groups, g_strdup (category), members);
+			}
+
+			/* listed twice in the same component */
+			if (members->len > 0 &&
+			    g_array_index (members, guint, members->len - 1) == component_idx)
+				continue;
+			g_array_append_val (members, component_idx);
+		}
+	}
+
+	return index;
+}
+
+/* returns the components in both of two sorted lists */
+static GArray *
+gs_appstream_category_index_intersect (GArray *a, GArray *b)
+{
+	GArray *result = g_array_new (FALSE, FALSE, sizeof (guint));
+	guint i = 0, j = 0;
+
+	if (a == NULL || b == NULL)
+		return result;
+	while (i < a->len && j < b->len) {
+		guint value_a = g_array_index (a, guint, i);
+		guint value_b = g_array_index (b, guint, j);
+		if (value_a < value_b) {
+			i++;
+		} else if (value_a > value_b) {
+			j++;
+		} else {
+			g_array_append_val (result, value_a);
+			i++;
+			j++;
+		}
+	}
+	return result;
+}
+
+/* returns the sorted indexes of the components in @desktop_group, which are
+ * owned by the index of @silo */
+static GArray *
+gs_appstream_category_index_lookup (XbSilo *silo,
+				    const gchar *desktop_group,
+				    GsAppstreamCategoryIndex **index_out)
+{
+	GsAppstreamCategoryIndex *index;
+	GArray *members;
+
+	G_LOCK (category_index);
+
+	index = g_object_get_data (G_OBJECT (silo), "GsAppstream::category-index");
+	if (index == NULL) {
+		index = gs_appstream_category_index_new (silo);
+		g_object_set_data_full (G_OBJECT (silo), "GsAppstream::category-index", index,
+					(GDestroyNotify) gs_appstream_category_index_free);
+	}
+
+	/* a group of two categories is worked out once, then kept */
+	members = g_hash_table_lookup (index->groups, desktop_group);
+	if (members == NULL) {
+		g_auto(GStrv) split = g_strsplit (desktop_group, "::", -1);
+		if (g_strv_length (split) == 2) {
+			members = gs_appstream_category_index_intersect (g_hash_table_lookup (index->groups, split[0]),
+									 g_hash_table_lookup (index->groups, split[1]));
+		} else {
+			members = g_array_new (FALSE, FALSE, sizeof (guint));
+		}
+		g_hash_table_insert (index->groups, g_strdup (desktop_group), members);
+	}
+
+	G_UNLOCK (category_index);
+
+	*index_out = index;
+	return members;
+}
+
 gboolean
 gs_appstream_add_category_apps (GsPlugin *plugin,
 				XbSilo *silo,
@@ -1295,7 +1548,6 @@ gs_appstream_add_category_apps (GsPlugin *plugin,
 				GError **error)
 {
 	GPtrArray *desktop_groups;
-	g_autoptr(GError) error_local = NULL;
 
 	desktop_groups = gs_category_get_desktop_groups (category);
 	if (desktop_groups->len == 0) {
@@ -1304,39 +1556,15 @@ gs_appstream_add_category_apps (GsPlugin *plugin,
 	}
 	for (guint j = 0; j < desktop_groups->len; j++) {
 		const gchar *desktop_group = g_ptr_array_index (desktop_groups, j);
-		g_autofree gchar *xpath = NULL;
-		g_auto(GStrv) split = g_strsplit (desktop_group, "::", -1);
-		g_autoptr(GPtrArray) components = NULL;
-
-		/* generate query */
-		if (g_strv_length (split) == 1) {
-			xpath = g_strdup_printf ("components/component/categories/"
-						 "category[text()='%s']/../..",
-						 split[0]);
-		} else if (g_strv_length (split) == 2) {
-			xpath = g_strdup_printf ("components/component/categories/"
-						 "category[text()='%s']/../"
-						 "category[text()='%s']/../..",
-						 split[0], split[1]);
-		}
-		components = xb_silo_query (silo, xpath, 0, &error_local);
-		if (components == NULL) {
-			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-				return TRUE;
-			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-				return TRUE;
-			g_propagate_error (error, g_steal_pointer (&error_local));
-			return FALSE;
-		}
+		GsAppstreamCategoryIndex *index;
+		GArray *members;
+
+		members = gs_appstream_category_index_lookup (silo, desktop_group, &index);
 
 		/* create app */
-		for (guint i = 0; i < components->len; i++) {
-			XbNode *component = g_ptr_array_index (components, i);
-			g_autoptr(GsApp) app = NULL;
-			const gchar *id = xb_node_query_text (component, "id", NULL);
-			if (id == NULL)
-				continue;
-			app = gs_app_new (id);
+		for (guint i = 0; i < members->len; i++) {
+			const gchar *id = g_ptr_array_index (index->ids, g_array_index (members, guint, i));
+			g_autoptr(GsApp) app = gs_app_new (id);
 			gs_app_add_quirk (app, GS_APP_QUIRK_IS_WILDCARD);
 			gs_app_list_add (list, app);
 		}
@@ -1349,34 +1577,11 @@ static guint
 gs_appstream_count_component_for_groups (GsPlugin *plugin, XbSilo *silo, const gchar *desktop_group)
 {
 	guint limit = 10;
-	g_autofree gchar *xpath = NULL;
-	g_auto(GStrv) split = g_strsplit (desktop_group, "::", -1);
-	g_autoptr(GPtrArray) array = NULL;
-	g_autoptr(GError) error_local = NULL;
+	GsAppstreamCategoryIndex *index;
+	GArray *members;
 
-	if (g_strv_length (split) == 1) { /* "all" group for a parent category */
-		xpath = g_strdup_printf ("components/component/categories/"
-					 "category[text()='%s']/../..",
-					 split[0]);
-	} else if (g_strv_length (split) == 2) {
-		xpath = g_strdup_printf ("components/component/categories/"
-					 "category[text()='%s']/../"
-					 "category[text()='%s']/../..",
-					 split[0], split[1]);
-	} else {
-		return 0;
-	}
-
-	array = xb_silo_query (silo, xpath, limit, &error_local);
-	if (array == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return 0;
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return 0;
-		g_warning ("%s", error_local->message);
-		return 0;
-	}
-	return array->len;
+	members = gs_appstream_category_index_lookup (silo, desktop_group, &index);
+	return MIN (members->len, limit);
 }
 
 /* we're not actually adding categories here, we're just setting the number of
@@ -1424,10 +1629,10 @@ gs_appstream_add_popular (GsPlugin *plugin,
 	g_autoptr(GPtrArray) array = NULL;
 
 	/* find out how many packages are in each category */
-	array = xb_silo_query (silo,
-			       "components/component/kudos/"
-			       "kudo[text()='GnomeSoftware::popular']/../..",
-			       0, &error_local);
+	array = gs_appstream_silo_query (silo,
+					 "components/component/kudos/"
+					 "kudo[text()='GnomeSoftware::popular']/../..",
+					 NULL, 0, &error_local);
 	if (array == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -1458,15 +1663,28 @@ gs_appstream_add_recent (GsPlugin *plugin,
 			 GError **error)
 {
 	guint64 now = (guint64) g_get_real_time () / G_USEC_PER_SEC;
-	g_autofree gchar *xpath = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(XbQuery) query = NULL;
+#if LIBXMLB_CHECK_VERSION(0, 3, 0)
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT ();
+#endif
 
 	/* use predicate conditions to the max */
-	xpath = g_strdup_printf ("components/component/releases/"
-				 "release[@timestamp>%" G_GUINT64_FORMAT "]/../..",
-				 now - (30 * 24 * 60 * 60));
-	array = xb_silo_query (silo, xpath, 0, &error_local);
+	query = gs_appstream_get_query (silo,
+					"components/component/releases/"
+					"release[@timestamp>?]/../..",
+					&error_local);
+	if (query != NULL) {
+#if LIBXMLB_CHECK_VERSION(0, 3, 0)
+		xb_value_bindings_bind_val (xb_query_context_get_bindings (&context), 0,
+					    (guint32) (now - (30 * 24 * 60 * 60)));
+		array = xb_silo_query_with_context (silo, query, &context, &error_local);
+#else
+		if (xb_query_bind_val (query, 0, (guint32) (now - (30 * 24 * 60 * 60)), &error_local))
+			array = xb_silo_query_full (silo, query, &error_local);
+#endif
+	}
 	if (array == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -1485,6 +1703,42 @@ gs_appstream_add_recent (GsPlugin *plugin,
 	return TRUE;
 }
 
+/* adds the IDs matched by @xpath with @value bound, unless already added */
+static gboolean
+gs_appstream_add_alternates_for_query (XbSilo *silo,
+				       const gchar *xpath,
+				       const gchar *value,
+				       GHashTable *ids_added,
+				       GsAppList *list,
+				       GError **error)
+{
+	const gchar *values[] = { value, NULL };
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) ids = NULL;
+
+	ids = gs_appstream_silo_query (silo, xpath, values, 0, &error_local);
+	if (ids == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return TRUE;
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			return TRUE;
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	for (guint i = 0; i < ids->len; i++) {
+		XbNode *n = g_ptr_array_index (ids, i);
+		const gchar *id = xb_node_get_text (n);
+		g_autoptr(GsApp) app2 = NULL;
+
+		if (id == NULL || !g_hash_table_add (ids_added, (gpointer) id))
+			continue;
+		app2 = gs_app_new (id);
+		gs_app_add_quirk (app2, GS_APP_QUIRK_IS_WILDCARD);
+		gs_app_list_add (list, app2);
+	}
+	return TRUE;
+}
+
 gboolean
 gs_appstream_add_alternates (GsPlugin *plugin,
 			     XbSilo *silo,
@@ -1494,51 +1748,37 @@ gs_appstream_add_alternates (GsPlugin *plugin,
 			     GError **error)
 {
 	GPtrArray *sources = gs_app_get_sources (app);
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) ids = NULL;
-	g_autoptr(GString) xpath = g_string_new (NULL);
+	g_autoptr(GHashTable) ids_added = g_hash_table_new (g_str_hash, g_str_equal);
+	const gchar *id_xpaths[] = {
+		/* actual ID */
+		"components/component/id[text()=?]",
+		/* new ID -> old ID */
+		"components/component/id[text()=?]/../provides/id",
+		/* old ID -> new ID */
+		"components/component/provides/id[text()=?]/../../id",
+		NULL
+	};
 
 	/* probably a package we know nothing about */
 	if (gs_app_get_id (app) == NULL)
 		return TRUE;
 
-	/* actual ID */
-	xb_string_append_union (xpath, "components/component/id[text()='%s']",
-				gs_app_get_id (app));
-
-	/* new ID -> old ID */
-	xb_string_append_union (xpath, "components/component/id[text()='%s']/../provides/id",
-				gs_app_get_id (app));
-
-	/* old ID -> new ID */
-	xb_string_append_union (xpath, "components/component/provides/id[text()='%s']/../../id",
-				gs_app_get_id (app));
+	/* each query is compiled once, so run them one at a time rather than
+	 * as a union that is different for every app */
+	for (guint i = 0; id_xpaths[i] != NULL; i++) {
+		if (!gs_appstream_add_alternates_for_query (silo, id_xpaths[i],
+							    gs_app_get_id (app),
+							    ids_added, list, error))
+			return FALSE;
+	}
 
 	/* find apps that use the same pkgname */
 	for (guint j = 0; j < sources->len; j++) {
 		const gchar *source = g_ptr_array_index (sources, j);
-		g_autofree gchar *source_safe = xb_string_escape (source);
-		xb_string_append_union (xpath,
-					"components/component/pkgname[text()='%s']/../id",
-					source_safe);
-	}
-
-	/* do a big query, and return all the unique results */
-	ids = xb_silo_query (silo, xpath->str, 0, &error_local);
-	if (ids == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return TRUE;
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return TRUE;
-		g_propagate_error (error, g_steal_pointer (&error_local));
-		return FALSE;
-	}
-	for (guint i = 0; i < ids->len; i++) {
-		XbNode *n = g_ptr_array_index (ids, i);
-		g_autoptr(GsApp) app2 = NULL;
-		app2 = gs_app_new (xb_node_get_text (n));
-		gs_app_add_quirk (app2, GS_APP_QUIRK_IS_WILDCARD);
-		gs_app_list_add (list, app2);
+		if (!gs_appstream_add_alternates_for_query (silo,
+							    "components/component/pkgname[text()=?]/../id",
+							    source, ids_added, list, error))
+			return FALSE;
 	}
 	return TRUE;
 }
@@ -1554,10 +1794,10 @@ gs_appstream_add_featured (GsPlugin *plugin,
 	g_autoptr(GPtrArray) array = NULL;
 
 	/* find out how many packages are in each category */
-	array = xb_silo_query (silo,
-			       "components/component/custom/value[@key='GnomeSoftware::FeatureTile']/../..|"
-			       "components/component/custom/value[@key='GnomeSoftware::FeatureTile-css']/../..",
-			       0, &error_local);
+	array = gs_appstream_silo_query (silo,
+					 "components/component/custom/value[@key='GnomeSoftware::FeatureTile']/../..|"
+					 "components/component/custom/value[@key='GnomeSoftware::FeatureTile-css']/../..",
+					 NULL, 0, &error_local);
 	if (array == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -1696,3 +1936,116 @@ gs_appstream_component_add_extra_info (GsPlugin *plugin, XbBuilderNode *componen
 		break;
 	}
 }
+
+/* the tile icon sizes to pre-render, in logical pixels; only sizes which
+ * gs_appstream_refine_icon() adds a cached icon for are worth an atlas, as
+ * gs_app_get_icon_for_size() picks a different icon for any other size */
+static const guint gs_appstream_icon_atlas_sizes[] = { 64, 128 };
+
+/**
+ * gs_appstream_get_icon_atlas_sizes:
+ * @n_sizes: (out): return location for the number of sizes
+ *
+ * Gets the tile icon sizes which gs_appstream_get_cached_icons() is used to
+ * pre-render into atlases for.
+ *
+ * Returns: (array length=n_sizes): the sizes, in logical pixels
+ **/
+const guint *
+gs_appstream_get_icon_atlas_sizes (guint *n_sizes)
+{
+	*n_sizes = G_N_ELEMENTS (gs_appstream_icon_atlas_sizes);
+	return gs_appstream_icon_atlas_sizes;
+}
+
+/**
+ * gs_appstream_get_icon_atlas_source_size:
+ * @size: the size of the tile icon, in logical pixels
+ * @scale: the window scale
+ *
+ * Gets the size of the cached icon which gs_app_get_icon_for_size() would
+ * choose for a tile icon of @size at @scale, out of those added by
+ * gs_appstream_refine_icon().
+ *
+ * Returns: the size in device pixels, or 0 if no cached icon is big enough
+ **/
+guint
+gs_appstream_get_icon_atlas_source_size (guint size, guint scale)
+{
+	const guint cached_sizes[] = { 64, 128 };
+
+	for (guint i = 0; i < G_N_ELEMENTS (cached_sizes); i++) {
+		if (cached_sizes[i] >= size)
+			return cached_sizes[i] * scale;
+	}
+	return 0;
+}
+
+/**
+ * gs_appstream_get_cached_icons:
+ * @silo: an #XbSilo
+ * @sz: the size of the cached icons to return, in device pixels
+ * @error: return location for a #GError, or %NULL
+ *
+ * Gets the cached icons of size @sz×@sz of all the components in @silo, as
+ * used by gs_appstream_refine_app(). This is used to pre-render the icons
+ * into an atlas when the silo is compiled.
+ *
+ * Returns: (transfer container) (element-type GIcon): the icons, which may
+ *     be empty, or %NULL on error
+ **/
+GPtrArray *
+gs_appstream_get_cached_icons (XbSilo *silo, guint sz, GError **error)
+{
+	g_autofree gchar *sz_str = g_strdup_printf ("%u", sz);
+	const gchar *values[] = { as_icon_kind_to_string (AS_ICON_KIND_CACHED), sz_str, sz_str, NULL };
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) icons = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GPtrArray) nodes = NULL;
+
+	nodes = gs_appstream_silo_query (silo, "components/component/icon[@type=?][@height=?][@width=?]",
+					 values, 0, &error_local);
+	if (nodes == NULL) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return g_steal_pointer (&icons);
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			return g_steal_pointer (&icons);
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
+	}
+	for (guint i = 0; i < nodes->len; i++) {
+		XbNode *n = g_ptr_array_index (nodes, i);
+		g_autoptr(XbNode) component = xb_node_get_parent (n);
+		g_autoptr(AsIcon) as_icon = gs_appstream_new_icon (component, n, AS_ICON_KIND_CACHED, sz);
+		GIcon *icon = gs_icon_new_for_appstream_icon (as_icon);
+		if (icon != NULL)
+			g_ptr_array_add (icons, icon);
+	}
+	return g_steal_pointer (&icons);
+}
+
+/**
+ * gs_appstream_get_silo_mtime:
+ * @file: the compiled silo
+ *
+ * Gets the full modification time of a silo, to tell whether
+ * xb_builder_ensure() compiled it anew or just loaded it. The age in whole
+ * seconds is not enough for this, as a silo is often compiled within a second
+ * of the previous one.
+ *
+ * Returns: the modification time in microseconds, or 0 if it does not exist
+ **/
+guint64
+gs_appstream_get_silo_mtime (GFile *file)
+{
+	g_autoptr(GFileInfo) info = NULL;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (info == NULL)
+		return 0;
+	return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+	       g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
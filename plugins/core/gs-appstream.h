@@ -13,6 +13,11 @@
 
 G_BEGIN_DECLS
 
+GPtrArray	*gs_appstream_silo_query		(XbSilo		*silo,
+							 const gchar	*xpath,
+							 const gchar * const *values,
+							 guint		 limit,
+							 GError		**error);
 GsApp		*gs_appstream_create_app		(GsPlugin	*plugin,
 							 XbSilo		*silo,
 							 XbNode		*component,
@@ -72,5 +77,12 @@ void		 gs_appstream_component_add_icon	(XbBuilderNode	*component,
 							 const gchar	*str);
 void		 gs_appstream_component_add_provide	(XbBuilderNode	*component,
 							 const gchar	*str);
+GPtrArray	*gs_appstream_get_cached_icons		(XbSilo		*silo,
+							 guint		 sz,
+							 GError		**error);
+const guint	*gs_appstream_get_icon_atlas_sizes	(guint		*n_sizes);
+guint		 gs_appstream_get_icon_atlas_source_size (guint		 size,
+							 guint		 scale);
+guint64		 gs_appstream_get_silo_mtime		(GFile		*file);
 
 G_END_DECLS
@@ -30,8 +30,12 @@ struct GsPluginData {
 	XbSilo			*silo;
 	GRWLock			 silo_lock;
 	GSettings		*settings;
+	gint			 icon_atlas_serial;	/* (atomic) */
 };
 
+/* per atlas, so a large silo does not fill the cache */
+#define GS_PLUGIN_APPSTREAM_ICON_ATLAS_SIZE_MAX	(32 * 1024 * 1024) /* bytes */
+
 void
 gs_plugin_initialize (GsPlugin *plugin)
 {
@@ -489,6 +493,156 @@ gs_plugin_appstream_load_appstream (GsPlugin *plugin,
 	return TRUE;
 }
 
+typedef struct {
+	gchar		*filename;
+	guint		 size;
+	GPtrArray	*icons;
+} GsPluginAppstreamIconAtlas;
+
+typedef struct {
+	GsPlugin	*plugin;
+	gchar		*guid;
+	guint		 scale;
+	gint		 serial;
+	GPtrArray	*atlases;	/* (element-type GsPluginAppstreamIconAtlas) */
+} GsPluginAppstreamIconAtlasHelper;
+
+static void
+gs_plugin_appstream_icon_atlas_free (GsPluginAppstreamIconAtlas *atlas)
+{
+	g_free (atlas->filename);
+	g_ptr_array_unref (atlas->icons);
+	g_slice_free (GsPluginAppstreamIconAtlas, atlas);
+}
+
+static void
+gs_plugin_appstream_icon_atlas_helper_free (GsPluginAppstreamIconAtlasHelper *helper)
+{
+	g_object_unref (helper->plugin);
+	g_free (helper->guid);
+	g_ptr_array_unref (helper->atlases);
+	g_slice_free (GsPluginAppstreamIconAtlasHelper, helper);
+}
+
+static void
+gs_plugin_appstream_build_icon_atlases_thread_cb (GTask *task,
+						  gpointer source_object,
+						  gpointer task_data,
+						  GCancellable *cancellable)
+{
+	GsPluginAppstreamIconAtlasHelper *helper = task_data;
+	GsPluginData *priv = gs_plugin_get_data (helper->plugin);
+
+	for (guint i = 0; i < helper->atlases->len; i++) {
+		GsPluginAppstreamIconAtlas *atlas = g_ptr_array_index (helper->atlases, i);
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GsIconAtlas) icon_atlas = NULL;
+
+		/* the silo has been rebuilt since */
+		if (g_atomic_int_get (&priv->icon_atlas_serial) != helper->serial)
+			break;
+		if (!gs_icon_atlas_build (atlas->filename, helper->guid,
+					  atlas->size, helper->scale, atlas->icons,
+					  GS_PLUGIN_APPSTREAM_ICON_ATLAS_SIZE_MAX,
+					  cancellable, &error_local)) {
+			g_warning ("failed to build icon atlas %s: %s",
+				   atlas->filename, error_local->message);
+			continue;
+		}
+		icon_atlas = gs_icon_atlas_new_from_file (atlas->filename, &error_local);
+		if (icon_atlas == NULL) {
+			g_warning ("failed to load icon atlas %s: %s",
+				   atlas->filename, error_local->message);
+			continue;
+		}
+		if (g_atomic_int_get (&priv->icon_atlas_serial) == helper->serial)
+			gs_icon_add_atlas (icon_atlas);
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/* called with the silo writer lock held, after the silo has been compiled;
+ * any atlases which do not match the silo are rebuilt in a thread so that
+ * the icons fall back to being decoded one by one in the meantime */
+static void
+gs_plugin_appstream_ensure_icon_atlases (GsPlugin *plugin)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	GsPluginAppstreamIconAtlasHelper *helper;
+	const gchar *guid = xb_silo_get_guid (priv->silo);
+	guint scale = gs_plugin_get_scale (plugin);
+	const guint *sizes;
+	guint n_sizes;
+	gint serial;
+	g_autoptr(GPtrArray) atlases = NULL;
+	g_autoptr(GTask) task = NULL;
+
+	/* stop any builds for a previous silo from adding their atlases */
+	serial = g_atomic_int_add (&priv->icon_atlas_serial, 1) + 1;
+
+	atlases = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_plugin_appstream_icon_atlas_free);
+	sizes = gs_appstream_get_icon_atlas_sizes (&n_sizes);
+	for (guint i = 0; i < n_sizes; i++) {
+		GsPluginAppstreamIconAtlas *atlas;
+		guint size = sizes[i];
+		guint sz_cached;
+		g_autofree gchar *basename = NULL;
+		g_autofree gchar *filename = NULL;
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) icons = NULL;
+		g_autoptr(GsIconAtlas) icon_atlas = NULL;
+
+		sz_cached = gs_appstream_get_icon_atlas_source_size (size, scale);
+		g_assert (sz_cached != 0);
+
+		basename = g_strdup_printf ("icons-%ux%u@%u.atlas", size, size, scale);
+		filename = gs_utils_get_cache_filename ("appstream", basename,
+							GS_UTILS_CACHE_FLAG_WRITEABLE |
+							GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+							&error_local);
+		if (filename == NULL) {
+			g_warning ("failed to get icon atlas filename: %s", error_local->message);
+			continue;
+		}
+
+		/* still valid */
+		icon_atlas = gs_icon_atlas_new_from_file (filename, NULL);
+		if (icon_atlas != NULL &&
+		    g_strcmp0 (gs_icon_atlas_get_guid (icon_atlas), guid) == 0) {
+			g_debug ("using %u icons from %s",
+				 gs_icon_atlas_get_n_icons (icon_atlas), filename);
+			gs_icon_add_atlas (icon_atlas);
+			continue;
+		}
+
+		icons = gs_appstream_get_cached_icons (priv->silo, sz_cached, &error_local);
+		if (icons == NULL) {
+			g_warning ("failed to get cached icons: %s", error_local->message);
+			continue;
+		}
+		if (icons->len == 0)
+			continue;
+		atlas = g_slice_new0 (GsPluginAppstreamIconAtlas);
+		atlas->filename = g_steal_pointer (&filename);
+		atlas->size = size;
+		atlas->icons = g_steal_pointer (&icons);
+		g_ptr_array_add (atlases, atlas);
+	}
+	if (atlases->len == 0)
+		return;
+
+	helper = g_slice_new0 (GsPluginAppstreamIconAtlasHelper);
+	helper->plugin = g_object_ref (plugin);
+	helper->guid = g_strdup (guid);
+	helper->scale = scale;
+	helper->serial = serial;
+	helper->atlases = g_steal_pointer (&atlases);
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_set_source_tag (task, gs_plugin_appstream_ensure_icon_atlases);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gs_plugin_appstream_icon_atlas_helper_free);
+	g_task_run_in_thread (task, gs_plugin_appstream_build_icon_atlases_thread_cb);
+}
+
 static gboolean
 gs_plugin_appstream_check_silo (GsPlugin *plugin,
 				GCancellable *cancellable,
@@ -505,6 +659,8 @@ gs_plugin_appstream_check_silo (GsPlugin *plugin,
 	g_autoptr(GRWLockWriterLocker) writer_locker = NULL;
 	g_autoptr(GPtrArray) parent_appdata = g_ptr_array_new_with_free_func (g_free);
 	g_autoptr(GPtrArray) parent_appstream = g_ptr_array_new_with_free_func (g_free);
+	gint64 trace_begin_time;
+	guint64 blob_mtime = 0;
 
 
 	reader_locker = g_rw_lock_reader_locker_new (&priv->silo_lock);
@@ -516,6 +672,7 @@ gs_plugin_appstream_check_silo (GsPlugin *plugin,
 	/* drat! silo needs regenerating */
 	writer_locker = g_rw_lock_writer_locker_new (&priv->silo_lock);
 	g_clear_object (&priv->silo);
+	trace_begin_time = g_get_monotonic_time ();
 
 	/* verbose profiling */
 	if (g_getenv ("GS_XMLB_VERBOSE") != NULL) {
@@ -637,6 +794,9 @@ gs_plugin_appstream_check_silo (GsPlugin *plugin,
 		return FALSE;
 	file = g_file_new_for_path (blobfn);
 	g_debug ("ensuring %s", blobfn);
+	/* only stat the blob when tracing, to tell a compile from a load */
+	if (gs_trace_is_enabled ())
+		blob_mtime = gs_appstream_get_silo_mtime (file);
 	priv->silo = xb_builder_ensure (builder, file,
 					XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
 					XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
@@ -644,6 +804,13 @@ gs_plugin_appstream_check_silo (GsPlugin *plugin,
 	if (priv->silo == NULL)
 		return FALSE;
 
+	/* the blob is only rewritten if it had to be compiled */
+	if (gs_trace_is_enabled ()) {
+		gboolean compiled = blob_mtime == 0 || gs_appstream_get_silo_mtime (file) != blob_mtime;
+		gs_trace_add_span (trace_begin_time, "silo", "silo:appstream",
+				   compiled ? "compiled" : "loaded");
+	}
+
 	/* watch all directories too */
 	for (guint i = 0; i < parent_appstream->len; i++) {
 		const gchar *fn = g_ptr_array_index (parent_appstream, i);
@@ -669,6 +836,9 @@ gs_plugin_appstream_check_silo (GsPlugin *plugin,
 		return FALSE;
 	}
 
+	/* pre-render the tile icons for the new silo */
+	gs_plugin_appstream_ensure_icon_atlases (plugin);
+
 	/* success */
 	return TRUE;
 }
@@ -688,12 +858,13 @@ gs_plugin_url_to_app (GsPlugin *plugin,
 		      GError **error)
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
+	const gchar *values[2] = { NULL };
 	g_autofree gchar *path = NULL;
 	g_autofree gchar *scheme = NULL;
-	g_autofree gchar *xpath = NULL;
+	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_autoptr(GsApp) app = NULL;
-	g_autoptr(XbNode) component = NULL;
+	XbNode *component;
 
 	/* check silo is valid */
 	if (!gs_plugin_appstream_check_silo (plugin, cancellable, error))
@@ -708,10 +879,12 @@ gs_plugin_url_to_app (GsPlugin *plugin,
 
 	/* create app */
 	path = gs_utils_get_url_path (url);
-	xpath = g_strdup_printf ("components/component/id[text()='%s']", path);
-	component = xb_silo_query_first (priv->silo, xpath, NULL);
-	if (component == NULL)
+	values[0] = path;
+	components = gs_appstream_silo_query (priv->silo, "components/component/id[text()=?]",
+					      values, 1, NULL);
+	if (components == NULL)
 		return TRUE;
+	component = g_ptr_array_index (components, 0);
 	app = gs_appstream_create_app (plugin, priv->silo, component, error);
 	if (app == NULL)
 		return FALSE;
@@ -769,16 +942,16 @@ static gboolean
 gs_plugin_appstream_refine_state (GsPlugin *plugin, GsApp *app, GError **error)
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[] = { gs_app_get_id (app), NULL };
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
-	g_autoptr(XbNode) component = NULL;
 
 	locker = g_rw_lock_reader_locker_new (&priv->silo_lock);
 
-	xpath = g_strdup_printf ("component/id[text()='%s']", gs_app_get_id (app));
-	component = xb_silo_query_first (priv->silo, xpath, &error_local);
-	if (component == NULL) {
+	components = gs_appstream_silo_query (priv->silo, "component/id[text()=?]",
+					      values, 1, &error_local);
+	if (components == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
@@ -799,23 +972,25 @@ gs_plugin_refine_from_id (GsPlugin *plugin,
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	const gchar *id;
+	const gchar *values[4] = { NULL };
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
-	g_autoptr(GString) xpath = g_string_new (NULL);
 	g_autoptr(GPtrArray) components = NULL;
 
 	/* not enough info to find */
 	id = gs_app_get_id (app);
 	if (id == NULL)
 		return TRUE;
+	values[0] = values[1] = values[2] = id;
 
 	locker = g_rw_lock_reader_locker_new (&priv->silo_lock);
 
 	/* look in AppStream then fall back to AppData */
-	xb_string_append_union (xpath, "components/component/id[text()='%s']/../pkgname/..", id);
-	xb_string_append_union (xpath, "components/component[@type='webapp']/id[text()='%s']/..", id);
-	xb_string_append_union (xpath, "component/id[text()='%s']/..", id);
-	components = xb_silo_query (priv->silo, xpath->str, 0, &error_local);
+	components = gs_appstream_silo_query (priv->silo,
+					      "components/component/id[text()=?]/../pkgname/..|"
+					      "components/component[@type='webapp']/id[text()=?]/..|"
+					      "component/id[text()=?]/..",
+					      values, 0, &error_local);
 	if (components == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -851,7 +1026,6 @@ gs_plugin_refine_from_pkgname (GsPlugin *plugin,
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	GPtrArray *sources = gs_app_get_sources (app);
-	g_autoptr(GError) error_local = NULL;
 
 	/* not enough info to find */
 	if (sources->len == 0)
@@ -861,18 +1035,21 @@ gs_plugin_refine_from_pkgname (GsPlugin *plugin,
 	for (guint j = 0; j < sources->len; j++) {
 		const gchar *pkgname = g_ptr_array_index (sources, j);
 		g_autoptr(GRWLockReaderLocker) locker = NULL;
-		g_autoptr(GString) xpath = g_string_new (NULL);
-		g_autoptr(XbNode) component = NULL;
+		const gchar *values[] = { pkgname, pkgname, pkgname, pkgname, NULL };
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) components = NULL;
+		XbNode *component;
 
 		locker = g_rw_lock_reader_locker_new (&priv->silo_lock);
 
 		/* prefer actual apps and then fallback to anything else */
-		xb_string_append_union (xpath, "components/component[@type='desktop']/pkgname[text()='%s']/..", pkgname);
-		xb_string_append_union (xpath, "components/component[@type='console']/pkgname[text()='%s']/..", pkgname);
-		xb_string_append_union (xpath, "components/component[@type='webapp']/pkgname[text()='%s']/..", pkgname);
-		xb_string_append_union (xpath, "components/component/pkgname[text()='%s']/..", pkgname);
-		component = xb_silo_query_first (priv->silo, xpath->str, &error_local);
-		if (component == NULL) {
+		components = gs_appstream_silo_query (priv->silo,
+						      "components/component[@type='desktop']/pkgname[text()=?]/..|"
+						      "components/component[@type='console']/pkgname[text()=?]/..|"
+						      "components/component[@type='webapp']/pkgname[text()=?]/..|"
+						      "components/component/pkgname[text()=?]/..",
+						      values, 1, &error_local);
+		if (components == NULL) {
 			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 				continue;
 			if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
@@ -880,6 +1057,7 @@ gs_plugin_refine_from_pkgname (GsPlugin *plugin,
 			g_propagate_error (error, g_steal_pointer (&error_local));
 			return FALSE;
 		}
+		component = g_ptr_array_index (components, 0);
 		if (!gs_appstream_refine_app (plugin, app, priv->silo, component, flags, error))
 			return FALSE;
 		gs_plugin_appstream_set_compulsory_quirk (app, component);
@@ -933,7 +1111,7 @@ gs_plugin_refine_wildcard (GsPlugin *plugin,
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	const gchar *id;
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[2] = { NULL };
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
 	g_autoptr(GPtrArray) components = NULL;
@@ -950,8 +1128,9 @@ gs_plugin_refine_wildcard (GsPlugin *plugin,
 	locker = g_rw_lock_reader_locker_new (&priv->silo_lock);
 
 	/* find all app with package names when matching any prefixes */
-	xpath = g_strdup_printf ("components/component/id[text()='%s']/../pkgname/..", id);
-	components = xb_silo_query (priv->silo, xpath, 0, &error_local);
+	values[0] = id;
+	components = gs_appstream_silo_query (priv->silo, "components/component/id[text()=?]/../pkgname/..",
+					      values, 0, &error_local);
 	if (components == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -178,6 +178,29 @@ gs_plugins_core_generic_updates_func (GsPluginLoader *plugin_loader)
 	}
 }
 
+static void
+gs_plugins_core_icon_atlas_sizes_func (void)
+{
+	const guint *sizes;
+	guint n_sizes;
+
+	/* the tile sizes which get an atlas */
+	sizes = gs_appstream_get_icon_atlas_sizes (&n_sizes);
+	g_assert_cmpuint (n_sizes, ==, 2);
+	g_assert_cmpuint (sizes[0], ==, 64);
+	g_assert_cmpuint (sizes[1], ==, 128);
+
+	/* each is rendered from the cached icon the tile would use */
+	for (guint i = 0; i < n_sizes; i++) {
+		g_assert_cmpuint (gs_appstream_get_icon_atlas_source_size (sizes[i], 1), ==, sizes[i]);
+		g_assert_cmpuint (gs_appstream_get_icon_atlas_source_size (sizes[i], 2), ==, sizes[i] * 2);
+	}
+	g_assert_cmpuint (gs_appstream_get_icon_atlas_source_size (48, 1), ==, 64);
+
+	/* no cached icon is big enough for the feature tiles */
+	g_assert_cmpuint (gs_appstream_get_icon_atlas_source_size (160, 1), ==, 0);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -261,6 +284,8 @@ main (int argc, char **argv)
 	g_assert (ret);
 
 	/* plugin tests go here */
+	g_test_add_func ("/gnome-software/plugins/core/icon-atlas-sizes",
+			 gs_plugins_core_icon_atlas_sizes_func);
 	g_test_add_data_func ("/gnome-software/plugins/core/search-repo-name",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_core_search_repo_name_func);
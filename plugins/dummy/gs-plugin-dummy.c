@@ -23,6 +23,7 @@ struct GsPluginData {
 	GsApp			*cached_origin;
 	GHashTable		*installed_apps;	/* id:1 */
 	GHashTable		*available_apps;	/* id:1 */
+	gint			 setup_count;		/* (atomic) */
 };
 
 /* just flip-flop this every few seconds */
@@ -80,8 +81,43 @@ gs_plugin_initialize (GsPlugin *plugin)
 
 	/* need help from appstream */
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "appstream");
-	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "os-release");
+
+	/* lets the self tests order a setup after this one */
+	if (g_getenv ("GS_SELF_TEST_DUMMY_BEFORE_OS_RELEASE") != NULL)
+		gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_BEFORE, "os-release");
+	else
+		gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_AFTER, "os-release");
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_CONFLICTS, "odrs");
+
+	/* lets the self tests check when the setup is run */
+	if (g_getenv ("GS_SELF_TEST_DUMMY_DEFER_SETUP") != NULL)
+		gs_plugin_add_flags (plugin, GS_PLUGIN_FLAGS_DEFER_SETUP);
+}
+
+gboolean
+gs_plugin_setup (GsPlugin *plugin, GCancellable *cancellable, GError **error)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	const gchar *delay = g_getenv ("GS_SELF_TEST_DUMMY_SETUP_DELAY");
+	g_autoptr(GsApp) app = gs_app_new (NULL);
+
+	/* the loader must never run the setup twice, even when several jobs
+	 * need the plugin at once */
+	if (g_atomic_int_add (&priv->setup_count, 1) > 0) {
+		g_set_error_literal (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_FAILED,
+				     "setup was run more than once");
+		return FALSE;
+	}
+
+	/* lets the self tests have a slow setup, in ms */
+	if (delay != NULL)
+		g_usleep (g_ascii_strtoull (delay, NULL, 10) * 1000);
+
+	/* the self tests look this up to know that setup has run */
+	gs_plugin_cache_add (plugin, "dummy::setup", app);
+	return TRUE;
 }
 
 void
@@ -732,6 +768,17 @@ gs_plugin_add_category_apps (GsPlugin *plugin,
 {
 	g_autoptr(GIcon) icon = g_themed_icon_new ("chiron.desktop");
 	g_autoptr(GsApp) app = gs_app_new ("chiron.desktop");
+
+	/* hang the plugin for 5 seconds */
+	if (g_strcmp0 (gs_category_get_id (category), "hang") == 0) {
+		gs_plugin_dummy_timeout_add (5000, cancellable);
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			gs_utils_error_convert_gio (error);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
 	gs_app_set_name (app, GS_APP_QUALITY_NORMAL, "Chiron");
 	gs_app_set_summary (app, GS_APP_QUALITY_NORMAL, "View and use virtual machines");
 	gs_app_set_url (app, AS_URL_KIND_HOMEPAGE, "http://www.box.org");
@@ -0,0 +1,263 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2013-2017 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#include "config.h"
+
+#include "gnome-software-private.h"
+
+#include "gs-test.h"
+
+/* Each of these tests sets up its own plugin loader in a subprocess, as the
+ * plugins can only be loaded once per process and each test needs them set
+ * up differently. */
+
+static GsPluginLoader *
+gs_plugins_dummy_setup_new_loader (const gchar * const *allowlist)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsPluginLoader) plugin_loader = gs_plugin_loader_new ();
+
+	gs_plugin_loader_add_location (plugin_loader, LOCALPLUGINDIR);
+	gs_plugin_loader_add_location (plugin_loader, LOCALPLUGINDIR_CORE);
+	ret = gs_plugin_loader_setup (plugin_loader,
+				      (gchar **) allowlist,
+				      NULL,
+				      NULL,
+				      &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (gs_plugin_loader_get_enabled (plugin_loader, "dummy"));
+	return g_steal_pointer (&plugin_loader);
+}
+
+static gboolean
+gs_plugins_dummy_setup_has_run (GsPluginLoader *plugin_loader)
+{
+	GsPlugin *plugin = gs_plugin_loader_find_plugin (plugin_loader, "dummy");
+	g_autoptr(GsApp) app_setup = NULL;
+
+	g_assert_nonnull (plugin);
+	app_setup = gs_plugin_cache_lookup (plugin, "dummy::setup");
+	return app_setup != NULL;
+}
+
+static void
+gs_plugins_dummy_setup_defer_func (void)
+{
+	const gchar *allowlist[] = { "dummy", NULL };
+	gboolean ret;
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsPluginLoader) plugin_loader = NULL;
+
+	if (!g_test_subprocess ()) {
+		g_test_trap_subprocess (NULL, 0, 0);
+		g_test_trap_assert_passed ();
+		return;
+	}
+
+	/* the setup has not been run at startup */
+	g_setenv ("GS_SELF_TEST_DUMMY_DEFER_SETUP", "1", TRUE);
+	plugin_loader = gs_plugins_dummy_setup_new_loader (allowlist);
+	g_assert_false (gs_plugins_dummy_setup_has_run (plugin_loader));
+
+	/* nor by the refresh done at startup */
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFRESH,
+					 "age", (guint64) G_MAXUINT,
+					 NULL);
+	ret = gs_plugin_loader_job_action (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_false (gs_plugins_dummy_setup_has_run (plugin_loader));
+
+	/* but it is by the first job which needs the plugin */
+	app = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app, "dummy");
+	g_object_unref (plugin_job);
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					 "app", app,
+					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+					 NULL);
+	ret = gs_plugin_loader_job_action (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (gs_plugins_dummy_setup_has_run (plugin_loader));
+	g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0+");
+}
+
+typedef struct {
+	GMainLoop	*loop;
+	guint		 pending;
+} GsDummySetupHelper;
+
+static void
+gs_plugins_dummy_setup_refine_cb (GObject *source,
+				  GAsyncResult *res,
+				  gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source);
+	GsDummySetupHelper *helper = user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsAppList) list = NULL;
+
+	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (list);
+	if (--helper->pending == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+static void
+gs_plugins_dummy_setup_concurrent_func (void)
+{
+	const gchar *allowlist[] = { "dummy", NULL };
+	GsDummySetupHelper helper = { NULL, 0 };
+	g_autoptr(GsApp) app1 = NULL;
+	g_autoptr(GsApp) app2 = NULL;
+	g_autoptr(GsPluginJob) plugin_job1 = NULL;
+	g_autoptr(GsPluginJob) plugin_job2 = NULL;
+	g_autoptr(GsPluginLoader) plugin_loader = NULL;
+
+	if (!g_test_subprocess ()) {
+		g_test_trap_subprocess (NULL, 0, 0);
+		g_test_trap_assert_passed ();
+		return;
+	}
+
+	g_setenv ("GS_SELF_TEST_DUMMY_DEFER_SETUP", "1", TRUE);
+	g_setenv ("GS_SELF_TEST_DUMMY_SETUP_DELAY", "500", TRUE);
+	plugin_loader = gs_plugins_dummy_setup_new_loader (allowlist);
+	g_assert_false (gs_plugins_dummy_setup_has_run (plugin_loader));
+
+	/* two jobs which both need the slow deferred setup at once */
+	app1 = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app1, "dummy");
+	plugin_job1 = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					  "app", app1,
+					  "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+					  NULL);
+	app2 = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app2, "dummy");
+	plugin_job2 = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					  "app", app2,
+					  "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+					  NULL);
+	helper.loop = g_main_loop_new (NULL, FALSE);
+	helper.pending = 2;
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job1, NULL,
+					    gs_plugins_dummy_setup_refine_cb, &helper);
+	gs_plugin_loader_job_process_async (plugin_loader, plugin_job2, NULL,
+					    gs_plugins_dummy_setup_refine_cb, &helper);
+	g_main_loop_run (helper.loop);
+	g_main_loop_unref (helper.loop);
+	gs_test_flush_main_context ();
+
+	/* the setup was run once, and both jobs waited for it; the dummy
+	 * plugin fails and gets disabled if its setup is run twice */
+	g_assert_true (gs_plugins_dummy_setup_has_run (plugin_loader));
+	g_assert_true (gs_plugin_loader_get_enabled (plugin_loader, "dummy"));
+	g_assert_cmpstr (gs_app_get_license (app1), ==, "GPL-2.0+");
+	g_assert_cmpstr (gs_app_get_license (app2), ==, "GPL-2.0+");
+}
+
+static void
+gs_plugins_dummy_setup_order_func (void)
+{
+	const gchar *allowlist[] = { "dummy", "os-release", NULL };
+	g_autoptr(GsPluginLoader) plugin_loader = NULL;
+
+	if (!g_test_subprocess ()) {
+		g_test_trap_subprocess (NULL, 0, 0);
+		g_test_trap_assert_passed ();
+		return;
+	}
+
+	/* a deferred setup is still run at startup if a plugin which is
+	 * not deferred is ordered after it */
+	g_setenv ("GS_SELF_TEST_DUMMY_DEFER_SETUP", "1", TRUE);
+	g_setenv ("GS_SELF_TEST_DUMMY_BEFORE_OS_RELEASE", "1", TRUE);
+	g_setenv ("GS_SELF_TEST_DUMMY_SETUP_DELAY", "500", TRUE);
+	plugin_loader = gs_plugins_dummy_setup_new_loader (allowlist);
+	g_assert_true (gs_plugins_dummy_setup_has_run (plugin_loader));
+}
+
+static void
+gs_plugins_dummy_setup_timeout_func (void)
+{
+	const gchar *allowlist[] = { "dummy", NULL };
+	gboolean ret;
+	gint64 begin_time;
+	gint64 elapsed;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsApp) app = NULL;
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+	g_autoptr(GsPluginLoader) plugin_loader = NULL;
+
+	if (!g_test_subprocess ()) {
+		g_test_trap_subprocess (NULL, 0, 0);
+		g_test_trap_assert_passed ();
+		return;
+	}
+
+	/* the loader carries on without a setup which takes longer than
+	 * its timeout of 5 seconds */
+	g_setenv ("GS_SELF_TEST_DUMMY_SETUP_DELAY", "7000", TRUE);
+	begin_time = g_get_monotonic_time ();
+	plugin_loader = gs_plugins_dummy_setup_new_loader (allowlist);
+	elapsed = g_get_monotonic_time () - begin_time;
+	g_assert_cmpint (elapsed, >=, 5 * G_USEC_PER_SEC);
+	g_assert_cmpint (elapsed, <, 7 * G_USEC_PER_SEC);
+	g_assert_false (gs_plugins_dummy_setup_has_run (plugin_loader));
+
+	/* but a job which needs the plugin waits for it */
+	app = gs_app_new ("chiron.desktop");
+	gs_app_set_management_plugin (app, "dummy");
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					 "app", app,
+					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+					 NULL);
+	ret = gs_plugin_loader_job_action (plugin_loader, plugin_job, NULL, &error);
+	gs_test_flush_main_context ();
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (gs_plugins_dummy_setup_has_run (plugin_loader));
+	g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0+");
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv,
+#if GLIB_CHECK_VERSION(2, 60, 0)
+		     G_TEST_OPTION_ISOLATE_DIRS,
+#endif
+		     NULL);
+	g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
+
+	/* set all the things required as a dummy test harness */
+	g_setenv ("GS_SELF_TEST_LOCALE", "en_GB", TRUE);
+	g_setenv ("GS_SELF_TEST_DUMMY_ENABLE", "1", TRUE);
+
+	/* only critical and error are fatal */
+	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
+
+	/* plugin tests go here */
+	g_test_add_func ("/gnome-software/plugins/dummy/defer-setup",
+			 gs_plugins_dummy_setup_defer_func);
+	g_test_add_func ("/gnome-software/plugins/dummy/setup-concurrent",
+			 gs_plugins_dummy_setup_concurrent_func);
+	g_test_add_func ("/gnome-software/plugins/dummy/setup-order",
+			 gs_plugins_dummy_setup_order_func);
+	g_test_add_func ("/gnome-software/plugins/dummy/setup-timeout",
+			 gs_plugins_dummy_setup_timeout_func);
+	return g_test_run ();
+}
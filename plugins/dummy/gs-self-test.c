@@ -19,6 +19,7 @@ static guint _status_changed_cnt = 0;
 typedef struct {
 	GError *error;
 	GMainLoop *loop;
+	GPtrArray *results;
 } GsDummyTestHelper;
 
 static GsDummyTestHelper *
@@ -34,6 +35,8 @@ gs_dummy_test_helper_free (GsDummyTestHelper *helper)
 		g_error_free (helper->error);
 	if (helper->loop != NULL)
 		g_main_loop_unref (helper->loop);
+	if (helper->results != NULL)
+		g_ptr_array_unref (helper->results);
 	g_free (helper);
 }
 
@@ -596,6 +599,121 @@ gs_plugins_dummy_wildcard_func (GsPluginLoader *plugin_loader)
 	}
 }
 
+static void
+plugin_job_process_many_cb (GObject *source,
+			    GAsyncResult *res,
+			    gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source);
+	GsDummyTestHelper *helper = (GsDummyTestHelper *) user_data;
+
+	helper->results = gs_plugin_loader_job_process_many_finish (plugin_loader, res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+static gboolean
+gs_plugins_dummy_cancel_cb (gpointer user_data)
+{
+	g_cancellable_cancel (G_CANCELLABLE (user_data));
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_plugins_dummy_process_many_func (GsPluginLoader *plugin_loader)
+{
+	static const GsDesktopMap map[] = {
+		{ "hang", "Hang", { "Dummy::Hang", NULL } },
+		{ "other", "Other", { "Dummy::Other", NULL } },
+		{ NULL }
+	};
+	static const GsDesktopData data = { "dummy", map, "Dummy", NULL, 0 };
+	GsAppList *list;
+	GsCategory *category_hang;
+	GsCategory *category_other;
+	g_autofree gchar *popular_old = g_strdup (g_getenv ("GNOME_SOFTWARE_POPULAR"));
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	g_autoptr(GPtrArray) plugin_jobs = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GsCategory) category = gs_category_new_for_desktop_data (&data);
+	g_autoptr(GsDummyTestHelper) helper = gs_dummy_test_helper_new ();
+	g_autoptr(GsDummyTestHelper) helper2 = gs_dummy_test_helper_new ();
+
+	category_hang = gs_category_find_child (category, "hang");
+	g_assert_nonnull (category_hang);
+	category_other = gs_category_find_child (category, "other");
+	g_assert_nonnull (category_other);
+	g_setenv ("GNOME_SOFTWARE_POPULAR", "zeus.desktop", TRUE);
+
+	/* the job which takes longer than its timeout gets an empty list,
+	 * without failing the others */
+	g_ptr_array_add (plugin_jobs, gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_POPULAR, NULL));
+	g_ptr_array_add (plugin_jobs, gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_CATEGORY_APPS,
+							  "category", category_hang,
+							  "timeout", 1, /* seconds */
+							  NULL));
+	g_ptr_array_add (plugin_jobs, gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_RECENT,
+							  "age", (guint64) G_MAXUINT,
+							  "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+							  NULL));
+
+	/* each of these returns its own object for the same app */
+	for (guint i = 0; i < 2; i++) {
+		g_ptr_array_add (plugin_jobs, gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_CATEGORY_APPS,
+								  "category", category_other,
+								  "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE,
+								  NULL));
+	}
+	helper->loop = g_main_loop_new (NULL, FALSE);
+	gs_plugin_loader_job_process_many_async (plugin_loader, plugin_jobs, NULL,
+						 plugin_job_process_many_cb, helper);
+	g_main_loop_run (helper->loop);
+	gs_test_flush_main_context ();
+	g_assert_no_error (helper->error);
+	g_assert_nonnull (helper->results);
+
+	/* with one list for each job, in order */
+	g_assert_cmpint (helper->results->len, ==, 5);
+	list = g_ptr_array_index (helper->results, 0);
+	g_assert_cmpint (gs_app_list_length (list), ==, 1);
+	g_assert_cmpstr (gs_app_get_id (gs_app_list_index (list, 0)), ==, "zeus.desktop");
+	list = g_ptr_array_index (helper->results, 1);
+	g_assert_cmpint (gs_app_list_length (list), ==, 0);
+
+	/* and every object for the same app is refined */
+	for (guint i = 2; i < helper->results->len; i++) {
+		GsApp *app;
+
+		list = g_ptr_array_index (helper->results, i);
+		g_assert_cmpint (gs_app_list_length (list), ==, 1);
+		app = gs_app_list_index (list, 0);
+		g_assert_cmpstr (gs_app_get_id (app), ==, "chiron.desktop");
+		g_assert_cmpstr (gs_app_get_license (app), ==, "GPL-2.0+");
+	}
+	g_assert_true (gs_app_list_index (g_ptr_array_index (helper->results, 3), 0) !=
+		       gs_app_list_index (g_ptr_array_index (helper->results, 4), 0));
+
+	/* cancelling fails all the jobs */
+	g_ptr_array_set_size (plugin_jobs, 0);
+	g_ptr_array_add (plugin_jobs, gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_CATEGORY_APPS,
+							  "category", category_hang,
+							  NULL));
+	g_ptr_array_add (plugin_jobs, gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_RECENT,
+							  "age", (guint64) G_MAXUINT,
+							  NULL));
+	helper2->loop = g_main_loop_new (NULL, FALSE);
+	gs_plugin_loader_job_process_many_async (plugin_loader, plugin_jobs, cancellable,
+						 plugin_job_process_many_cb, helper2);
+	g_timeout_add (100, gs_plugins_dummy_cancel_cb, cancellable);
+	g_main_loop_run (helper2->loop);
+	gs_test_flush_main_context ();
+	g_assert_error (helper2->error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED);
+	g_assert_null (helper2->results);
+
+	if (popular_old != NULL)
+		g_setenv ("GNOME_SOFTWARE_POPULAR", popular_old, TRUE);
+	else
+		g_unsetenv ("GNOME_SOFTWARE_POPULAR");
+}
+
 static void
 plugin_job_action_cb (GObject *source,
 		      GAsyncResult *res,
@@ -845,6 +963,9 @@ main (int argc, char **argv)
 	g_test_add_data_func ("/gnome-software/plugins/dummy/wildcard",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_wildcard_func);
+	g_test_add_data_func ("/gnome-software/plugins/dummy/process-many",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_dummy_process_many_func);
 	g_test_add_data_func ("/gnome-software/plugins/dummy/plugin-cache",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_dummy_plugin_cache_func);
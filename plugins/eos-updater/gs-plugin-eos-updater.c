@@ -482,8 +482,10 @@ sync_state_from_updater_unlocked (GsPlugin *plugin)
 	}
 }
 
-/* This is called in the main thread, so will end up creating an @updater_proxy
- * which is tied to the main thread’s #GMainContext. */
+/* Setup is deferred, so this is called in a #GTask worker thread the first time
+ * another vfunc is used. No thread-default #GMainContext is pushed there, so
+ * @updater_proxy still ends up tied to the global default #GMainContext, which
+ * is iterated by the main thread. */
 gboolean
 gs_plugin_setup (GsPlugin *plugin,
 		 GCancellable *cancellable,
@@ -498,9 +500,6 @@ gs_plugin_setup (GsPlugin *plugin,
 
 	g_debug ("%s", G_STRFUNC);
 
-	g_mutex_init (&priv->mutex);
-	g_cond_init (&priv->state_change_cond);
-
 	locker = g_mutex_locker_new (&priv->mutex);
 
 	priv->cancellable = g_cancellable_new ();
@@ -583,7 +582,15 @@ gs_plugin_setup (GsPlugin *plugin,
 void
 gs_plugin_initialize (GsPlugin *plugin)
 {
-	gs_plugin_alloc_data (plugin, sizeof(GsPluginData));
+	GsPluginData *priv = gs_plugin_alloc_data (plugin, sizeof(GsPluginData));
+
+	/* initialised here rather than in setup, as destroy is called even if
+	 * the deferred setup never ran */
+	g_mutex_init (&priv->mutex);
+	g_cond_init (&priv->state_change_cond);
+
+	/* the upgrade is only needed once the updates page is shown */
+	gs_plugin_add_flags (plugin, GS_PLUGIN_FLAGS_DEFER_SETUP);
 }
 
 void
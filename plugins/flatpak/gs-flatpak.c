@@ -889,6 +889,9 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 	g_autoptr(GRWLockReaderLocker) reader_locker = NULL;
 	g_autoptr(GRWLockWriterLocker) writer_locker = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autofree gchar *trace_name = NULL;
+	gint64 trace_begin_time;
+	guint64 blob_mtime = 0;
 
 	reader_locker = g_rw_lock_reader_locker_new (&self->silo_lock);
 	/* everything is okay */
@@ -899,6 +902,7 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 	/* drat! silo needs regenerating */
 	writer_locker = g_rw_lock_writer_locker_new (&self->silo_lock);
 	g_clear_object (&self->silo);
+	trace_begin_time = g_get_monotonic_time ();
 
 	/* verbose profiling */
 	if (g_getenv ("GS_XMLB_VERBOSE") != NULL) {
@@ -945,6 +949,9 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 		return FALSE;
 	file = g_file_new_for_path (blobfn);
 	g_debug ("ensuring %s", blobfn);
+	/* only stat the blob when tracing, to tell a compile from a load */
+	if (gs_trace_is_enabled ())
+		blob_mtime = gs_appstream_get_silo_mtime (file);
 	self->silo = xb_builder_ensure (builder, file,
 					XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
 					XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
@@ -952,6 +959,14 @@ gs_flatpak_rescan_appstream_store (GsFlatpak *self,
 	if (self->silo == NULL)
 		return FALSE;
 
+	/* the blob is only rewritten if it had to be compiled */
+	if (gs_trace_is_enabled ()) {
+		gboolean compiled = blob_mtime == 0 || gs_appstream_get_silo_mtime (file) != blob_mtime;
+		trace_name = g_strconcat ("silo:", gs_flatpak_get_id (self), NULL);
+		gs_trace_add_span (trace_begin_time, "silo", trace_name,
+				   compiled ? "compiled" : "loaded");
+	}
+
 	/* success */
 	return TRUE;
 }
@@ -2570,7 +2585,8 @@ gs_flatpak_refine_appstream_from_bytes (GsFlatpak *self,
 					GError **error)
 {
 	const gchar *const *locales = g_get_language_names ();
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[] = { gs_flatpak_app_get_ref_name (app), NULL };
+	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
 	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
 	g_autoptr(XbNode) component_node = NULL;
@@ -2665,10 +2681,9 @@ gs_flatpak_refine_appstream_from_bytes (GsFlatpak *self,
 	}
 
 	/* find app */
-	xpath = g_strdup_printf ("components/component/id[text()='%s']/..",
-				 gs_flatpak_app_get_ref_name (app));
-	component_node = xb_silo_query_first (silo, xpath, NULL);
-	if (component_node == NULL) {
+	components = gs_appstream_silo_query (silo, "components/component/id[text()=?]/..",
+					      values, 1, NULL);
+	if (components == NULL) {
 		g_set_error (error,
 			     GS_PLUGIN_ERROR,
 			     GS_PLUGIN_ERROR_INVALID_FORMAT,
@@ -2676,6 +2691,7 @@ gs_flatpak_refine_appstream_from_bytes (GsFlatpak *self,
 			     gs_flatpak_app_get_ref_name (app));
 		return FALSE;
 	}
+	component_node = g_object_ref (g_ptr_array_index (components, 0));
 
 	/* copy details from AppStream to app */
 	if (!gs_appstream_refine_app (self->plugin, app, silo, component_node, flags, error))
@@ -2705,14 +2721,9 @@ get_renamed_component (GsFlatpak *self,
 {
 	const gchar *origin = gs_app_get_origin (app);
 	const gchar *renamed_to;
-	g_autofree gchar *xpath = NULL;
-#if LIBXMLB_CHECK_VERSION(0, 3, 0)
-	g_autoptr(XbQuery) query = NULL;
-	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT ();
-#else
-	g_autofree gchar *source_safe = NULL;
-#endif
+	const gchar *values[3] = { NULL };
 	g_autoptr(FlatpakRemoteRef) remote_ref = NULL;
+	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbNode) component = NULL;
 
 	remote_ref = flatpak_installation_fetch_remote_ref_sync (self->installation,
@@ -2729,17 +2740,13 @@ get_renamed_component (GsFlatpak *self,
 	if (renamed_to == NULL)
 		return NULL;
 
-#if LIBXMLB_CHECK_VERSION(0, 3, 0)
-	query = xb_silo_lookup_query (silo, "components[@origin=?/component/bundle[@type='flatpak'][text()=?]/..");
-	xb_value_bindings_bind_str (xb_query_context_get_bindings (&context), 0, origin, NULL);
-	xb_value_bindings_bind_str (xb_query_context_get_bindings (&context), 1, renamed_to, NULL);
-	component = xb_silo_query_first_with_context (silo, query, &context, NULL);
-#else
-	source_safe = xb_string_escape (renamed_to);
-	xpath = g_strdup_printf ("components[@origin='%s']/component/bundle[@type='flatpak'][text()='%s']/..",
-				 origin, source_safe);
-	component = xb_silo_query_first (silo, xpath, NULL);
-#endif
+	values[0] = origin;
+	values[1] = renamed_to;
+	components = gs_appstream_silo_query (silo,
+					      "components[@origin=?]/component/bundle[@type='flatpak'][text()=?]/..",
+					      values, 1, NULL);
+	if (components != NULL)
+		component = g_object_ref (g_ptr_array_index (components, 0));
 
 	/* Get the previous name so it can be displayed in the UI */
 	if (component != NULL) {
@@ -2771,19 +2778,20 @@ gs_flatpak_refine_appstream (GsFlatpak *self,
 {
 	const gchar *origin = gs_app_get_origin (app);
 	const gchar *source = gs_app_get_source_default (app);
-	g_autofree gchar *source_safe = NULL;
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[] = { origin, source, NULL };
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbNode) component = NULL;
 
 	if (origin == NULL || source == NULL)
 		return TRUE;
 
 	/* find using source and origin */
-	source_safe = xb_string_escape (source);
-	xpath = g_strdup_printf ("components[@origin='%s']/component/bundle[@type='flatpak'][text()='%s']/..",
-				 origin, source_safe);
-	component = xb_silo_query_first (silo, xpath, &error_local);
+	components = gs_appstream_silo_query (silo,
+					      "components[@origin=?]/component/bundle[@type='flatpak'][text()=?]/..",
+					      values, 1, &error_local);
+	if (components != NULL)
+		component = g_object_ref (g_ptr_array_index (components, 0));
 
 	/* Ensure the gs_flatpak_app_get_ref_*() metadata are set */
 	gs_refine_item_metadata (self, app, NULL, NULL);
@@ -2797,7 +2805,8 @@ gs_flatpak_refine_appstream (GsFlatpak *self,
 		g_autoptr(FlatpakInstalledRef) installed_ref = NULL;
 		g_autoptr(GBytes) appstream_gz = NULL;
 
-		g_debug ("no match for %s: %s", xpath, error_local->message);
+		g_debug ("no match for %s in %s: %s", source, origin,
+			 error_local != NULL ? error_local->message : "no component");
 		/* For apps installed from .flatpak bundles there may not be any remote
 		 * appstream data in @silo for it, so use the appstream data from
 		 * within the app.
@@ -3017,7 +3026,7 @@ gs_flatpak_refine_wildcard (GsFlatpak *self, GsApp *app,
 			    GCancellable *cancellable, GError **error)
 {
 	const gchar *id;
-	g_autofree gchar *xpath = NULL;
+	const gchar *values[2] = { NULL };
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(GRWLockReaderLocker) locker = NULL;
@@ -3034,8 +3043,9 @@ gs_flatpak_refine_wildcard (GsFlatpak *self, GsApp *app,
 	locker = g_rw_lock_reader_locker_new (&self->silo_lock);
 
 	/* find all apps when matching any prefixes */
-	xpath = g_strdup_printf ("components/component/id[text()='%s']/..", id);
-	components = xb_silo_query (self->silo, xpath, 0, &error_local);
+	values[0] = id;
+	components = gs_appstream_silo_query (self->silo, "components/component/id[text()=?]/..",
+					      values, 0, &error_local);
 	if (components == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
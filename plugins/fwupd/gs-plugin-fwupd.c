@@ -29,12 +29,35 @@
  * added or removed or if a device has been updated live.
  */
 
+/* how many devices to ask fwupd about at the same time */
+#define GS_PLUGIN_FWUPD_MAX_PARALLEL_QUERIES	4
+
+/* the upgrades found for a device, which stay valid until either the
+ * device or the remote metadata change */
+typedef struct {
+	GPtrArray		*releases;		/* (nullable), newest first */
+	gchar			*update_details;	/* (nullable) */
+} GsPluginFwupdUpgrades;
+
 struct GsPluginData {
 	FwupdClient		*client;
 	GsApp			*app_current;
 	GsApp			*cached_origin;
+
+	GMutex			 upgrades_mutex;
+	GHashTable		*upgrades;		/* device key : GsPluginFwupdUpgrades */
+	gchar			*upgrades_metadata_stamp;
 };
 
+static void
+gs_plugin_fwupd_upgrades_free (GsPluginFwupdUpgrades *upgrades)
+{
+	if (upgrades->releases != NULL)
+		g_ptr_array_unref (upgrades->releases);
+	g_free (upgrades->update_details);
+	g_slice_free (GsPluginFwupdUpgrades, upgrades);
+}
+
 static void
 gs_plugin_fwupd_error_convert (GError **perror)
 {
@@ -95,9 +118,15 @@ gs_plugin_initialize (GsPlugin *plugin)
 {
 	GsPluginData *priv = gs_plugin_alloc_data (plugin, sizeof(GsPluginData));
 	priv->client = fwupd_client_new ();
+	g_mutex_init (&priv->upgrades_mutex);
+	priv->upgrades = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						(GDestroyNotify) gs_plugin_fwupd_upgrades_free);
 
 	/* set name of MetaInfo file */
 	gs_plugin_set_appstream_id (plugin, "org.gnome.Software.Plugin.Fwupd");
+
+	/* not needed until firmware updates or sources are looked at */
+	gs_plugin_add_flags (plugin, GS_PLUGIN_FLAGS_DEFER_SETUP);
 }
 
 void
@@ -107,6 +136,9 @@ gs_plugin_destroy (GsPlugin *plugin)
 	if (priv->cached_origin != NULL)
 		g_object_unref (priv->cached_origin);
 	g_object_unref (priv->client);
+	g_hash_table_unref (priv->upgrades);
+	g_free (priv->upgrades_metadata_stamp);
+	g_mutex_clear (&priv->upgrades_mutex);
 }
 
 void
@@ -540,6 +572,203 @@ gs_plugin_add_updates_historical (GsPlugin *plugin,
 	return TRUE;
 }
 
+/* identifies the state of a device which its upgrades depend on */
+static gchar *
+gs_plugin_fwupd_build_upgrades_key (FwupdDevice *dev)
+{
+	GPtrArray *checksums = fwupd_device_get_checksums (dev);
+	GString *key = g_string_new (fwupd_device_get_id (dev));
+
+	g_string_append_printf (key, ":%s",
+				fwupd_device_get_version (dev) != NULL ?
+				fwupd_device_get_version (dev) : "");
+	for (guint i = 0; i < checksums->len; i++)
+		g_string_append_printf (key, ":%s", (const gchar *) g_ptr_array_index (checksums, i));
+	return g_string_free (key, FALSE);
+}
+
+/* changes whenever the metadata of any enabled remote is refreshed */
+static gchar *
+gs_plugin_fwupd_build_metadata_stamp (GsPlugin *plugin, GCancellable *cancellable)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	GString *stamp;
+	g_autoptr(GPtrArray) remotes = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	remotes = fwupd_client_get_remotes (priv->client, cancellable, &error_local);
+	if (remotes == NULL) {
+		g_debug ("No remotes found: %s", error_local->message);
+		return NULL;
+	}
+
+	stamp = g_string_new (NULL);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		if (!fwupd_remote_get_enabled (remote))
+			continue;
+		g_string_append_printf (stamp, "%s:%" G_GUINT64_FORMAT ";",
+					fwupd_remote_get_id (remote),
+					fwupd_remote_get_mtime (remote));
+	}
+	return g_string_free (stamp, FALSE);
+}
+
+static gchar *
+gs_plugin_fwupd_build_update_details (GPtrArray *rels)
+{
+	g_autoptr(GString) update_desc = NULL;
+
+	/* add update descriptions for all releases inbetween */
+	if (rels->len <= 1)
+		return NULL;
+	update_desc = g_string_new (NULL);
+	for (guint j = 0; j < rels->len; j++) {
+		FwupdRelease *rel = g_ptr_array_index (rels, j);
+		g_autofree gchar *desc = NULL;
+		if (fwupd_release_get_description (rel) == NULL)
+			continue;
+		desc = as_markup_convert_simple (fwupd_release_get_description (rel), NULL);
+		if (desc == NULL)
+			continue;
+		g_string_append_printf (update_desc,
+					"Version %s:\n%s\n\n",
+					fwupd_release_get_version (rel),
+					desc);
+	}
+	if (update_desc->len <= 2)
+		return NULL;
+	g_string_truncate (update_desc, update_desc->len - 2);
+	return g_string_free (g_steal_pointer (&update_desc), FALSE);
+}
+
+/* takes the result of asking fwupd for the upgrades of @dev */
+static void
+gs_plugin_fwupd_upgrades_add (GsPlugin *plugin,
+			      FwupdDevice *dev,
+			      GPtrArray *rels,
+			      const GError *error)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	GsPluginFwupdUpgrades *upgrades;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	if (rels == NULL) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+		if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO)) {
+			g_debug ("no updates for %s", fwupd_device_get_id (dev));
+		} else if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
+			g_debug ("not supported for %s", fwupd_device_get_id (dev));
+		} else {
+			/* try again next time */
+			g_warning ("failed to get upgrades for %s: %s]",
+				   fwupd_device_get_id (dev),
+				   error->message);
+			return;
+		}
+	}
+
+	upgrades = g_slice_new0 (GsPluginFwupdUpgrades);
+	if (rels != NULL && rels->len > 0) {
+		upgrades->releases = g_ptr_array_ref (rels);
+		upgrades->update_details = gs_plugin_fwupd_build_update_details (rels);
+	}
+
+	locker = g_mutex_locker_new (&priv->upgrades_mutex);
+	g_hash_table_replace (priv->upgrades,
+			      gs_plugin_fwupd_build_upgrades_key (dev),
+			      upgrades);
+}
+
+#if FWUPD_CHECK_VERSION(1,5,0)
+typedef struct {
+	GsPlugin		*plugin;
+	GPtrArray		*devices;
+	guint			 next;
+	guint			 n_pending;
+	GCancellable		*cancellable;
+} GsPluginFwupdUpgradesHelper;
+
+typedef struct {
+	GsPluginFwupdUpgradesHelper	*helper;
+	FwupdDevice			*dev;
+} GsPluginFwupdUpgradesQuery;
+
+static void gs_plugin_fwupd_query_upgrades_next (GsPluginFwupdUpgradesHelper *helper);
+
+static void
+gs_plugin_fwupd_query_upgrades_cb (GObject *source_object,
+				   GAsyncResult *result,
+				   gpointer user_data)
+{
+	GsPluginFwupdUpgradesQuery *query = user_data;
+	GsPluginFwupdUpgradesHelper *helper = query->helper;
+	g_autoptr(GPtrArray) rels = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	rels = fwupd_client_get_upgrades_finish (FWUPD_CLIENT (source_object),
+						 result, &error_local);
+	gs_plugin_fwupd_upgrades_add (helper->plugin, query->dev, rels, error_local);
+	g_object_unref (query->dev);
+	g_slice_free (GsPluginFwupdUpgradesQuery, query);
+
+	helper->n_pending--;
+	gs_plugin_fwupd_query_upgrades_next (helper);
+}
+
+static void
+gs_plugin_fwupd_query_upgrades_next (GsPluginFwupdUpgradesHelper *helper)
+{
+	GsPluginData *priv = gs_plugin_get_data (helper->plugin);
+
+	while (helper->n_pending < GS_PLUGIN_FWUPD_MAX_PARALLEL_QUERIES &&
+	       helper->next < helper->devices->len) {
+		GsPluginFwupdUpgradesQuery *query = g_slice_new0 (GsPluginFwupdUpgradesQuery);
+		query->helper = helper;
+		query->dev = g_object_ref (g_ptr_array_index (helper->devices, helper->next++));
+		helper->n_pending++;
+		fwupd_client_get_upgrades_async (priv->client,
+						 fwupd_device_get_id (query->dev),
+						 helper->cancellable,
+						 gs_plugin_fwupd_query_upgrades_cb,
+						 query);
+	}
+}
+#endif
+
+/* asks fwupd for the upgrades of each of @devices, a few at a time */
+static void
+gs_plugin_fwupd_query_upgrades (GsPlugin *plugin,
+				GPtrArray *devices,
+				GCancellable *cancellable)
+{
+#if FWUPD_CHECK_VERSION(1,5,0)
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	GsPluginFwupdUpgradesHelper helper = { plugin, devices, 0, 0, cancellable };
+
+	/* the replies are dispatched in this thread while it waits */
+	g_main_context_push_thread_default (context);
+	gs_plugin_fwupd_query_upgrades_next (&helper);
+	while (helper.n_pending > 0)
+		g_main_context_iteration (context, TRUE);
+	g_main_context_pop_thread_default (context);
+#else
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		g_autoptr(GPtrArray) rels = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		rels = fwupd_client_get_upgrades (priv->client,
+						  fwupd_device_get_id (dev),
+						  cancellable, &error_local);
+		gs_plugin_fwupd_upgrades_add (plugin, dev, rels, error_local);
+	}
+#endif
+}
+
 gboolean
 gs_plugin_add_updates (GsPlugin *plugin,
 		       GsAppList *list,
@@ -549,6 +778,8 @@ gs_plugin_add_updates (GsPlugin *plugin,
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_to_query = NULL;
+	g_autofree gchar *metadata_stamp = NULL;
 
 	/* get current list of updates */
 	devices = fwupd_client_get_devices (priv->client, cancellable, &error_local);
@@ -563,11 +794,47 @@ gs_plugin_add_updates (GsPlugin *plugin,
 		gs_plugin_fwupd_error_convert (error);
 		return FALSE;
 	}
+
+	/* the upgrades found last time are stale if the metadata changed */
+	metadata_stamp = gs_plugin_fwupd_build_metadata_stamp (plugin, cancellable);
+	g_mutex_lock (&priv->upgrades_mutex);
+	if (metadata_stamp == NULL ||
+	    g_strcmp0 (metadata_stamp, priv->upgrades_metadata_stamp) != 0) {
+		g_hash_table_remove_all (priv->upgrades);
+		g_free (priv->upgrades_metadata_stamp);
+		priv->upgrades_metadata_stamp = g_strdup (metadata_stamp);
+	}
+
+	/* only ask about devices which changed since then */
+	devices_to_query = g_ptr_array_new ();
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		g_autofree gchar *key = NULL;
+
+		/* not going to have results, so save a D-Bus round-trip */
+		if (fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_LOCKED) ||
+		    !fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_SUPPORTED))
+			continue;
+
+		key = gs_plugin_fwupd_build_upgrades_key (dev);
+		if (!g_hash_table_contains (priv->upgrades, key))
+			g_ptr_array_add (devices_to_query, dev);
+	}
+	g_mutex_unlock (&priv->upgrades_mutex);
+
+	if (devices_to_query->len > 0)
+		gs_plugin_fwupd_query_upgrades (plugin, devices_to_query, cancellable);
+	if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		gs_plugin_fwupd_error_convert (error);
+		return FALSE;
+	}
+
 	for (guint i = 0; i < devices->len; i++) {
 		FwupdDevice *dev = g_ptr_array_index (devices, i);
 		FwupdRelease *rel_newest;
 		g_autoptr(GError) error_local2 = NULL;
 		g_autoptr(GPtrArray) rels = NULL;
+		g_autofree gchar *update_details = NULL;
 		g_autoptr(GsApp) app = NULL;
 
 		/* locked device that needs unlocking */
@@ -578,31 +845,19 @@ gs_plugin_add_updates (GsPlugin *plugin,
 			continue;
 		}
 
-		/* not going to have results, so save a D-Bus round-trip */
 		if (!fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_SUPPORTED))
 			continue;
 
-		/* get the releases for this device and filter for validity */
-		rels = fwupd_client_get_upgrades (priv->client,
-						  fwupd_device_get_id (dev),
-						  cancellable, &error_local2);
-		if (rels == NULL) {
-			if (g_error_matches (error_local2,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_NOTHING_TO_DO)) {
-				g_debug ("no updates for %s", fwupd_device_get_id (dev));
-				continue;
-			}
-			if (g_error_matches (error_local2,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_NOT_SUPPORTED)) {
-				g_debug ("not supported for %s", fwupd_device_get_id (dev));
+		/* get the releases for this device */
+		{
+			g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->upgrades_mutex);
+			g_autofree gchar *key = gs_plugin_fwupd_build_upgrades_key (dev);
+			GsPluginFwupdUpgrades *upgrades = g_hash_table_lookup (priv->upgrades, key);
+
+			if (upgrades == NULL || upgrades->releases == NULL)
 				continue;
-			}
-			g_warning ("failed to get upgrades for %s: %s]",
-				   fwupd_device_get_id (dev),
-				   error_local2->message);
-			continue;
+			rels = g_ptr_array_ref (upgrades->releases);
+			update_details = g_strdup (upgrades->update_details);
 		}
 
 		/* normal device update */
@@ -613,28 +868,8 @@ gs_plugin_add_updates (GsPlugin *plugin,
 			g_debug ("%s", error_local2->message);
 			continue;
 		}
-
-		/* add update descriptions for all releases inbetween */
-		if (rels->len > 1) {
-			g_autoptr(GString) update_desc = g_string_new (NULL);
-			for (guint j = 0; j < rels->len; j++) {
-				FwupdRelease *rel = g_ptr_array_index (rels, j);
-				g_autofree gchar *desc = NULL;
-				if (fwupd_release_get_description (rel) == NULL)
-					continue;
-				desc = as_markup_convert_simple (fwupd_release_get_description (rel), NULL);
-				if (desc == NULL)
-					continue;
-				g_string_append_printf (update_desc,
-							"Version %s:\n%s\n\n",
-							fwupd_release_get_version (rel),
-							desc);
-			}
-			if (update_desc->len > 2) {
-				g_string_truncate (update_desc, update_desc->len - 2);
-				gs_app_set_update_details (app, update_desc->str);
-			}
-		}
+		if (update_details != NULL)
+			gs_app_set_update_details (app, update_details);
 		gs_app_list_add (list, app);
 	}
 	return TRUE;
@@ -34,71 +34,45 @@
  * ```
  */
 
-#if !GLIB_CHECK_VERSION(2, 62, 0)
-typedef struct
-{
-  guint8 *data;
-  guint   len;
-  guint   alloc;
-  guint   elt_size;
-  guint   zero_terminated : 1;
-  guint   clear : 1;
-  gatomicrefcount ref_count;
-  GDestroyNotify clear_func;
-} GRealArray;
+#define ODRS_REVIEW_CACHE_AGE_FRESH		86400 /* 1 day */
+#define ODRS_REVIEW_CACHE_AGE_MAX		(7 * 24 * 60 * 60) /* 1 week */
+#define ODRS_REVIEW_NUMBER_RESULTS_MAX		20
+#define ODRS_REVIEW_FETCHES_PENDING_MAX		8
+
+/* The ratings are compiled from ratings.json into a binary table when
+ * they are downloaded, and the table is mapped into memory rather than parsed
+ * each time the plugin is loaded. It contains a #GsOdrsRatingsHeader, then
+ * the #GsOdrsRatingsEntry for each app sorted by app ID, then the app IDs as
+ * nul-terminated strings. All integers are little endian. The header records
+ * the modification time, size and SHA-256 of the ratings.json it was compiled
+ * from. The modification time and size are checked first as they are cheap;
+ * if they differ, as they do whenever a refresh touches the file, the
+ * checksum decides whether the table has to be recompiled or only needs its
+ * header updating. */
+#define ODRS_RATINGS_MAGIC			"GSODRS1"
+#define ODRS_RATINGS_VERSION			3
+#define ODRS_RATINGS_CHECKSUM_LEN		32
 
-static gboolean
-g_array_binary_search (GArray        *array,
-                       gconstpointer  target,
-                       GCompareFunc   compare_func,
-                       guint         *out_match_index)
-{
-  gboolean result = FALSE;
-  GRealArray *_array = (GRealArray *) array;
-  guint left, middle, right;
-  gint val;
-
-  g_return_val_if_fail (_array != NULL, FALSE);
-  g_return_val_if_fail (compare_func != NULL, FALSE);
-
-  if (G_LIKELY(_array->len))
-    {
-      left = 0;
-      right = _array->len - 1;
-
-      while (left <= right)
-        {
-          middle = left + (right - left) / 2;
-
-          val = compare_func (_array->data + (_array->elt_size * middle), target);
-          if (val == 0)
-            {
-              result = TRUE;
-              break;
-            }
-          else if (val < 0)
-            left = middle + 1;
-          else if (/* val > 0 && */ middle > 0)
-            right = middle - 1;
-          else
-            break;  /* element not found */
-        }
-    }
-
-  if (result && out_match_index != NULL)
-    *out_match_index = middle;
-
-  return result;
-}
-#endif  /* glib < 2.62.0 */
+typedef struct {
+	gchar		 magic[8];
+	guint32		 version;
+	guint32		 n_ratings;
+	guint64		 json_mtime;		/* in microseconds */
+	guint64		 json_size;
+	guint8		 json_checksum[ODRS_RATINGS_CHECKSUM_LEN];	/* SHA-256 */
+} GsOdrsRatingsHeader;
 
-#define ODRS_REVIEW_CACHE_AGE_MAX		237000 /* 1 week */
-#define ODRS_REVIEW_NUMBER_RESULTS_MAX		20
+typedef struct {
+	guint32		 app_id_offset;		/* from the start of the file */
+	guint32		 n_star_ratings[6];
+} GsOdrsRatingsEntry;
 
-/* Element in priv->ratings, all allocated in one big block and sorted
- * alphabetically to reduce the number of allocations and fragmentation. */
+G_STATIC_ASSERT (sizeof (GsOdrsRatingsHeader) == 64);
+G_STATIC_ASSERT (sizeof (GsOdrsRatingsEntry) == 28);
+
+/* only used while compiling the table */
 typedef struct {
-	gchar *app_id;  /* (owned) */
+	const gchar *app_id;  /* (unowned) */
 	guint32 n_star_ratings[6];
 } GsOdrsRating;
 
@@ -108,20 +82,16 @@ rating_compare (const GsOdrsRating *a, const GsOdrsRating *b)
 	return g_strcmp0 (a->app_id, b->app_id);
 }
 
-static void
-rating_clear (GsOdrsRating *rating)
-{
-	g_free (rating->app_id);
-}
-
 struct GsPluginData {
 	GSettings		*settings;
 	gchar			*distro;
 	gchar			*user_hash;
 	gchar			*review_server;
-	GArray			*ratings;  /* (element-type GsOdrsRating) (mutex ratings_mutex) (owned) (nullable) */
+	GMappedFile		*ratings;  /* (mutex ratings_mutex) (owned) (nullable) */
 	GMutex			 ratings_mutex;
 	GsApp			*cached_origin;
+	GHashTable		*revalidating;  /* (mutex revalidating_mutex) (owned) (element-type utf8) */
+	GMutex			 revalidating_mutex;
 };
 
 void
@@ -132,6 +102,8 @@ gs_plugin_initialize (GsPlugin *plugin)
 	g_autoptr(GsOsRelease) os_release = NULL;
 
 	g_mutex_init (&priv->ratings_mutex);
+	g_mutex_init (&priv->revalidating_mutex);
+	priv->revalidating = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	priv->settings = g_settings_new ("org.gnome.software");
 	priv->review_server = g_settings_get_string (priv->settings,
 						     "review-server");
@@ -192,30 +164,85 @@ gs_plugin_odrs_load_ratings_for_app (JsonObject *json_app, const gchar *app_id,
 		rating_out->n_star_ratings[i] = (guint64) json_object_get_int_member (json_app, names[i]);
 	}
 
-	rating_out->app_id = g_strdup (app_id);
+	rating_out->app_id = app_id;
 
 	return TRUE;
 }
 
 static gboolean
-gs_plugin_odrs_load_ratings (GsPlugin *plugin, const gchar *fn, GError **error)
+gs_plugin_odrs_get_json_stamp (const gchar *json_fn,
+			       guint64 *mtime_out,
+			       guint64 *size_out,
+			       GError **error)
+{
+	g_autoptr(GFile) file = g_file_new_for_path (json_fn);
+	g_autoptr(GFileInfo) info = NULL;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE,
+				  NULL,
+				  error);
+	if (info == NULL) {
+		gs_utils_error_convert_gio (error);
+		return FALSE;
+	}
+	*mtime_out = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		     g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	*size_out = (guint64) g_file_info_get_size (info);
+	return TRUE;
+}
+
+static gboolean
+gs_plugin_odrs_get_json_checksum (const gchar *json_fn,
+				  guint8 checksum_out[ODRS_RATINGS_CHECKSUM_LEN],
+				  GError **error)
+{
+	gsize checksum_len = ODRS_RATINGS_CHECKSUM_LEN;
+	g_autoptr(GChecksum) checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_autoptr(GMappedFile) mapped = NULL;
+
+	mapped = g_mapped_file_new (json_fn, FALSE, error);
+	if (mapped == NULL)
+		return FALSE;
+	g_checksum_update (checksum,
+			   (const guchar *) g_mapped_file_get_contents (mapped),
+			   g_mapped_file_get_length (mapped));
+	g_checksum_get_digest (checksum, checksum_out, &checksum_len);
+	return TRUE;
+}
+
+static gboolean
+gs_plugin_odrs_compile_ratings (const gchar *json_fn, const gchar *fn, GError **error)
 {
-	GsPluginData *priv = gs_plugin_get_data (plugin);
 	JsonNode *json_root;
 	JsonObject *json_item;
 	g_autoptr(JsonParser) json_parser = NULL;
 	const gchar *app_id;
 	JsonNode *json_app_node;
 	JsonObjectIter iter;
+	GsOdrsRatingsHeader header = { ODRS_RATINGS_MAGIC, 0, 0, 0, 0, { 0, } };
+	guint64 json_mtime;
+	guint64 json_size;
+	gsize strings_offset;
 	g_autoptr(GArray) new_ratings = NULL;
-	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GByteArray) strings = NULL;
+	g_autoptr(GByteArray) table = NULL;
+
+	/* taken before parsing, so a file replaced meanwhile is recompiled */
+	if (!gs_plugin_odrs_get_json_stamp (json_fn, &json_mtime, &json_size, error))
+		return FALSE;
+	if (!gs_plugin_odrs_get_json_checksum (json_fn, header.json_checksum, error))
+		return FALSE;
 
 	/* parse the data and find the success */
 	json_parser = json_parser_new_immutable ();
 #if JSON_CHECK_VERSION(1, 6, 0)
-	if (!json_parser_load_from_mapped_file (json_parser, fn, error)) {
+	if (!json_parser_load_from_mapped_file (json_parser, json_fn, error)) {
 #else
-	if (!json_parser_load_from_file (json_parser, fn, error)) {
+	if (!json_parser_load_from_file (json_parser, json_fn, error)) {
 #endif
 		gs_utils_error_convert_json_glib (error);
 		return FALSE;
@@ -242,7 +269,6 @@ gs_plugin_odrs_load_ratings (GsPlugin *plugin, const gchar *fn, GError **error)
 					 FALSE,  /* don’t clear */
 					 sizeof (GsOdrsRating),
 					 json_object_get_size (json_item));
-	g_array_set_clear_func (new_ratings, (GDestroyNotify) rating_clear);
 
 	/* parse each app */
 	json_object_iter_init (&iter, json_item);
@@ -258,17 +284,189 @@ gs_plugin_odrs_load_ratings (GsPlugin *plugin, const gchar *fn, GError **error)
 			g_array_append_val (new_ratings, rating);
 	}
 
-	/* Allow for binary searches later. */
+	/* allow for binary searches later */
 	g_array_sort (new_ratings, (GCompareFunc) rating_compare);
 
+	/* write the header and entries, followed by the app IDs */
+	header.version = GUINT32_TO_LE (ODRS_RATINGS_VERSION);
+	header.n_ratings = GUINT32_TO_LE (new_ratings->len);
+	header.json_mtime = GUINT64_TO_LE (json_mtime);
+	header.json_size = GUINT64_TO_LE (json_size);
+	strings_offset = sizeof (GsOdrsRatingsHeader) +
+			 (gsize) new_ratings->len * sizeof (GsOdrsRatingsEntry);
+	table = g_byte_array_sized_new (strings_offset);
+	strings = g_byte_array_new ();
+	g_byte_array_append (table, (const guint8 *) &header, sizeof (header));
+	for (guint i = 0; i < new_ratings->len; i++) {
+		const GsOdrsRating *rating = &g_array_index (new_ratings, GsOdrsRating, i);
+		GsOdrsRatingsEntry entry;
+
+		if (strings_offset + strings->len > G_MAXUINT32) {
+			g_set_error_literal (error,
+					     GS_PLUGIN_ERROR,
+					     GS_PLUGIN_ERROR_INVALID_FORMAT,
+					     "too many ratings");
+			return FALSE;
+		}
+		entry.app_id_offset = GUINT32_TO_LE ((guint32) (strings_offset + strings->len));
+		for (guint j = 0; j < 6; j++)
+			entry.n_star_ratings[j] = GUINT32_TO_LE (rating->n_star_ratings[j]);
+		g_byte_array_append (table, (const guint8 *) &entry, sizeof (entry));
+		g_byte_array_append (strings, (const guint8 *) rating->app_id,
+				     strlen (rating->app_id) + 1);
+	}
+
+	/* always end with a nul byte, so a truncated file cannot overrun */
+	g_byte_array_append (strings, (const guint8 *) "", 1);
+	g_byte_array_append (table, strings->data, strings->len);
+
+	g_debug ("compiled %u ratings into %s", new_ratings->len, fn);
+	return g_file_set_contents (fn, (const gchar *) table->data, table->len, error);
+}
+
+static gboolean
+gs_plugin_odrs_load_ratings (GsPlugin *plugin,
+			     const gchar *fn,
+			     const gchar *json_fn,
+			     GError **error)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	const GsOdrsRatingsHeader *header;
+	const gchar *contents;
+	gsize length;
+	guint64 json_mtime;
+	guint64 json_size;
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	mapped = g_mapped_file_new (fn, FALSE, error);
+	if (mapped == NULL)
+		return FALSE;
+	contents = g_mapped_file_get_contents (mapped);
+	length = g_mapped_file_get_length (mapped);
+	header = (const GsOdrsRatingsHeader *) contents;
+	if (length < sizeof (GsOdrsRatingsHeader) + 1 ||
+	    memcmp (header->magic, ODRS_RATINGS_MAGIC, sizeof (header->magic)) != 0 ||
+	    GUINT32_FROM_LE (header->version) != ODRS_RATINGS_VERSION ||
+	    GUINT32_FROM_LE (header->n_ratings) > (length - sizeof (GsOdrsRatingsHeader)) / sizeof (GsOdrsRatingsEntry) ||
+	    contents[length - 1] != '\0') {
+		g_set_error (error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_INVALID_FORMAT,
+			     "%s is not a valid ratings table", fn);
+		return FALSE;
+	}
+
+	/* check it was compiled from the current ratings.json */
+	if (!gs_plugin_odrs_get_json_stamp (json_fn, &json_mtime, &json_size, error))
+		return FALSE;
+	if (GUINT64_FROM_LE (header->json_mtime) != json_mtime ||
+	    GUINT64_FROM_LE (header->json_size) != json_size) {
+		guint8 json_checksum[ODRS_RATINGS_CHECKSUM_LEN];
+		g_autofree gchar *updated = NULL;
+		GsOdrsRatingsHeader *updated_header;
+		g_autoptr(GError) error_local = NULL;
+
+		/* a refresh which got 304 Not Modified only touches the file */
+		if (GUINT64_FROM_LE (header->json_size) != json_size) {
+			g_set_error (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_INVALID_FORMAT,
+				     "%s is out of date", fn);
+			return FALSE;
+		}
+		if (!gs_plugin_odrs_get_json_checksum (json_fn, json_checksum, error))
+			return FALSE;
+		if (memcmp (header->json_checksum, json_checksum, sizeof (json_checksum)) != 0) {
+			g_set_error (error,
+				     GS_PLUGIN_ERROR,
+				     GS_PLUGIN_ERROR_INVALID_FORMAT,
+				     "%s is out of date", fn);
+			return FALSE;
+		}
+
+		/* the mapping stays valid after the file is replaced */
+		updated = g_malloc (length);
+		memcpy (updated, contents, length);
+		updated_header = (GsOdrsRatingsHeader *) updated;
+		updated_header->json_mtime = GUINT64_TO_LE (json_mtime);
+		if (!g_file_set_contents (fn, updated, length, &error_local))
+			g_debug ("failed to update %s: %s", fn, error_local->message);
+	}
+
 	/* Update the shared state */
 	locker = g_mutex_locker_new (&priv->ratings_mutex);
-	g_clear_pointer (&priv->ratings, g_array_unref);
-	priv->ratings = g_steal_pointer (&new_ratings);
+	g_clear_pointer (&priv->ratings, g_mapped_file_unref);
+	priv->ratings = g_steal_pointer (&mapped);
 
 	return TRUE;
 }
 
+/* must be called with ratings_mutex held */
+static const GsOdrsRatingsEntry *
+gs_plugin_odrs_lookup_rating (GsPluginData *priv, const gchar *app_id)
+{
+	const gchar *contents = g_mapped_file_get_contents (priv->ratings);
+	gsize length = g_mapped_file_get_length (priv->ratings);
+	const GsOdrsRatingsHeader *header = (const GsOdrsRatingsHeader *) contents;
+	const GsOdrsRatingsEntry *entries = (const GsOdrsRatingsEntry *) (contents + sizeof (GsOdrsRatingsHeader));
+	guint left = 0;
+	guint right = GUINT32_FROM_LE (header->n_ratings);
+
+	while (left < right) {
+		guint middle = left + (right - left) / 2;
+		guint32 offset = GUINT32_FROM_LE (entries[middle].app_id_offset);
+		gint val;
+
+		/* the file ends with a nul byte, so any offset within it is a
+		 * terminated string */
+		if (offset >= length)
+			return NULL;
+		val = strcmp (contents + offset, app_id);
+		if (val == 0)
+			return &entries[middle];
+		if (val < 0)
+			left = middle + 1;
+		else
+			right = middle;
+	}
+	return NULL;
+}
+
+/* maps the compiled ratings, compiling them from the downloaded JSON first
+ * if they are missing or out of date */
+static gboolean
+gs_plugin_odrs_ensure_ratings (GsPlugin *plugin, GError **error)
+{
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *json_fn = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	fn = gs_utils_get_cache_filename ("odrs",
+					  "ratings.bin",
+					  GS_UTILS_CACHE_FLAG_WRITEABLE |
+					  GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					  error);
+	if (fn == NULL)
+		return FALSE;
+	json_fn = gs_utils_get_cache_filename ("odrs",
+					       "ratings.json",
+					       GS_UTILS_CACHE_FLAG_WRITEABLE |
+					       GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					       error);
+	if (json_fn == NULL)
+		return FALSE;
+	if (g_file_test (fn, G_FILE_TEST_EXISTS)) {
+		if (gs_plugin_odrs_load_ratings (plugin, fn, json_fn, &error_local))
+			return TRUE;
+		g_debug ("recompiling ratings: %s", error_local->message);
+	}
+
+	if (!gs_plugin_odrs_compile_ratings (json_fn, fn, error))
+		return FALSE;
+	return gs_plugin_odrs_load_ratings (plugin, fn, json_fn, error);
+}
+
 gboolean
 gs_plugin_refresh (GsPlugin *plugin,
 		   guint cache_age,
@@ -297,7 +495,7 @@ gs_plugin_refresh (GsPlugin *plugin,
 		if (tmp < cache_age) {
 			g_debug ("%s is only %u seconds old, so ignoring refresh",
 				 cache_filename, tmp);
-			return gs_plugin_odrs_load_ratings (plugin, cache_filename, error);
+			return gs_plugin_odrs_ensure_ratings (plugin, error);
 		}
 	}
 
@@ -322,7 +520,7 @@ gs_plugin_refresh (GsPlugin *plugin,
 		/* don't fail updates if the ratings server is unavailable */
 		return TRUE;
 	}
-	return gs_plugin_odrs_load_ratings (plugin, cache_filename, error);
+	return gs_plugin_odrs_ensure_ratings (plugin, error);
 }
 
 void
@@ -332,10 +530,12 @@ gs_plugin_destroy (GsPlugin *plugin)
 	g_free (priv->user_hash);
 	g_free (priv->distro);
 	g_free (priv->review_server);
-	g_clear_pointer (&priv->ratings, g_array_unref);
+	g_clear_pointer (&priv->ratings, g_mapped_file_unref);
 	g_object_unref (priv->settings);
 	g_object_unref (priv->cached_origin);
 	g_mutex_clear (&priv->ratings_mutex);
+	g_hash_table_unref (priv->revalidating);
+	g_mutex_clear (&priv->revalidating_mutex);
 }
 
 static AsReview *
@@ -656,20 +856,11 @@ gs_plugin_odrs_refine_ratings (GsPlugin *plugin,
 	locker = g_mutex_locker_new (&priv->ratings_mutex);
 
 	if (!priv->ratings) {
-		g_autofree gchar *cache_filename = NULL;
-
 		g_clear_pointer (&locker, g_mutex_locker_free);
 
 		/* Load from the local cache, if available, when in offline or
 		   when refresh/download disabled on start */
-		cache_filename = gs_utils_get_cache_filename ("odrs",
-							      "ratings.json",
-							      GS_UTILS_CACHE_FLAG_WRITEABLE |
-							      GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
-							      error);
-
-		if (!cache_filename ||
-		    !gs_plugin_odrs_load_ratings (plugin, cache_filename, NULL))
+		if (!gs_plugin_odrs_ensure_ratings (plugin, NULL))
 			return TRUE;
 
 		locker = g_mutex_locker_new (&priv->ratings_mutex);
@@ -680,19 +871,15 @@ gs_plugin_odrs_refine_ratings (GsPlugin *plugin,
 
 	for (guint i = 0; i < reviewable_ids->len; i++) {
 		const gchar *id = g_ptr_array_index (reviewable_ids, i);
-		const GsOdrsRating search_rating = { (gchar *) id, { 0, }};
-		guint found_index;
-		const GsOdrsRating *found_rating;
+		const GsOdrsRatingsEntry *found_rating;
 
-		if (!g_array_binary_search (priv->ratings, &search_rating,
-					    (GCompareFunc) rating_compare, &found_index))
+		found_rating = gs_plugin_odrs_lookup_rating (priv, id);
+		if (found_rating == NULL)
 			continue;
 
-		found_rating = &g_array_index (priv->ratings, GsOdrsRating, found_index);
-
 		/* copy into accumulator array */
 		for (guint j = 0; j < 6; j++)
-			ratings_raw[j] += found_rating->n_star_ratings[j];
+			ratings_raw[j] += GUINT32_FROM_LE (found_rating->n_star_ratings[j]);
 		cnt++;
 	}
 	if (cnt == 0)
@@ -752,48 +939,59 @@ gs_plugin_odrs_get_compat_ids (GsApp *app)
 	return g_steal_pointer (&json_node);
 }
 
-static GPtrArray *
-gs_plugin_odrs_fetch_for_app (GsPlugin *plugin, GsApp *app, GError **error)
+static gchar *
+gs_plugin_odrs_get_reviews_cache_filename (const gchar *app_id, GError **error)
+{
+	g_autofree gchar *cachefn_basename = g_strdup_printf ("%s.json", app_id);
+	return gs_utils_get_cache_filename ("odrs",
+					    cachefn_basename,
+					    GS_UTILS_CACHE_FLAG_WRITEABLE |
+					    GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					    error);
+}
+
+/* a request for the reviews of one app, sent as part of a batch */
+typedef struct {
+	GsApp		*app;		/* (owned) */
+	gchar		*cachefn;	/* (owned) */
+	SoupMessage	*msg;		/* (owned) (nullable) */
+	gboolean	 done;
+	GPtrArray	*reviews;	/* (owned) (nullable) (element-type AsReview) */
+	GError		*error;		/* (owned) (nullable) */
+} GsOdrsFetch;
+
+static void
+gs_odrs_fetch_free (GsOdrsFetch *fetch)
+{
+	g_object_unref (fetch->app);
+	g_free (fetch->cachefn);
+	g_clear_object (&fetch->msg);
+	g_clear_pointer (&fetch->reviews, g_ptr_array_unref);
+	g_clear_error (&fetch->error);
+	g_slice_free (GsOdrsFetch, fetch);
+}
+
+static GsOdrsFetch *
+gs_odrs_fetch_new (GsApp *app, const gchar *cachefn)
+{
+	GsOdrsFetch *fetch = g_slice_new0 (GsOdrsFetch);
+	fetch->app = g_object_ref (app);
+	fetch->cachefn = g_strdup (cachefn);
+	return fetch;
+}
+
+static SoupMessage *
+gs_plugin_odrs_new_fetch_message (GsPlugin *plugin, GsApp *app)
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	JsonNode *json_compat_ids;
 	const gchar *version;
-	guint status_code;
-	g_autofree gchar *cachefn_basename = NULL;
-	g_autofree gchar *cachefn = NULL;
+	SoupMessage *msg;
 	g_autofree gchar *data = NULL;
 	g_autofree gchar *uri = NULL;
-	g_autoptr(GFile) cachefn_file = NULL;
-	g_autoptr(GPtrArray) reviews = NULL;
 	g_autoptr(JsonBuilder) builder = NULL;
 	g_autoptr(JsonGenerator) json_generator = NULL;
 	g_autoptr(JsonNode) json_root = NULL;
-	g_autoptr(SoupMessage) msg = NULL;
-
-	/* look in the cache */
-	cachefn_basename = g_strdup_printf ("%s.json", gs_app_get_id (app));
-	cachefn = gs_utils_get_cache_filename ("odrs",
-					       cachefn_basename,
-					       GS_UTILS_CACHE_FLAG_WRITEABLE |
-					       GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
-					       error);
-	if (cachefn == NULL)
-		return NULL;
-	cachefn_file = g_file_new_for_path (cachefn);
-	if (gs_utils_get_file_age (cachefn_file) < ODRS_REVIEW_CACHE_AGE_MAX) {
-		g_autoptr(GMappedFile) mapped_file = NULL;
-
-		mapped_file = g_mapped_file_new (cachefn, FALSE, error);
-		if (mapped_file == NULL)
-			return NULL;
-
-		g_debug ("got review data for %s from %s",
-			 gs_app_get_id (app), cachefn);
-		return gs_plugin_odrs_parse_reviews (plugin,
-						     g_mapped_file_get_contents (mapped_file),
-						     g_mapped_file_get_length (mapped_file),
-						     error);
-	}
 
 	/* not always available */
 	version = gs_app_get_version (app);
@@ -831,13 +1029,26 @@ gs_plugin_odrs_fetch_for_app (GsPlugin *plugin, GsApp *app, GError **error)
 	if (data == NULL)
 		return NULL;
 	uri = g_strdup_printf ("%s/fetch", priv->review_server);
-	g_debug ("Updating ODRS cache for %s from %s to %s; request %s", gs_app_get_id (app),
-		 uri, cachefn, data);
+	g_debug ("Updating ODRS cache for %s from %s; request %s",
+		 gs_app_get_id (app), uri, data);
 	msg = soup_message_new (SOUP_METHOD_POST, uri);
+	if (msg == NULL)
+		return NULL;
 	soup_message_set_request (msg, "application/json; charset=utf-8",
 				  SOUP_MEMORY_COPY, data, strlen (data));
-	status_code = soup_session_send_message (gs_plugin_get_soup_session (plugin), msg);
-	if (status_code != SOUP_STATUS_OK) {
+	return msg;
+}
+
+static GPtrArray *
+gs_plugin_odrs_parse_fetch_response (GsPlugin *plugin,
+				     GsOdrsFetch *fetch,
+				     GError **error)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	SoupMessage *msg = fetch->msg;
+	g_autoptr(GPtrArray) reviews = NULL;
+
+	if (msg->status_code != SOUP_STATUS_OK) {
 		if (!gs_plugin_odrs_parse_success (plugin,
 						   msg->response_body->data,
 						   msg->response_body->length,
@@ -859,32 +1070,189 @@ gs_plugin_odrs_fetch_for_app (GsPlugin *plugin, GsApp *app, GError **error)
 		return NULL;
 
 	/* save to the cache */
-	if (!g_file_set_contents (cachefn,
+	if (!g_file_set_contents (fetch->cachefn,
 				  msg->response_body->data,
 				  msg->response_body->length,
 				  error))
 		return NULL;
 
-	/* success */
 	return g_steal_pointer (&reviews);
 }
 
+typedef struct {
+	GPtrArray	*fetches;	/* (element-type GsOdrsFetch) (unowned) */
+	SoupSession	*soup_session;	/* (unowned) */
+	GMainContext	*context;	/* (unowned) */
+	guint		 n_pending;
+} GsOdrsFetchBatch;
+
+static void
+gs_plugin_odrs_fetch_batch_cb (SoupSession *session,
+			       SoupMessage *msg,
+			       gpointer user_data)
+{
+	GsOdrsFetchBatch *batch = user_data;
+
+	for (guint i = 0; i < batch->fetches->len; i++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (batch->fetches, i);
+		if (fetch->msg == msg)
+			fetch->done = TRUE;
+	}
+	batch->n_pending--;
+	g_main_context_wakeup (batch->context);
+}
+
 static gboolean
-gs_plugin_odrs_refine_reviews (GsPlugin *plugin,
-			       GsApp *app,
-			       GCancellable *cancellable,
-			       GError **error)
+gs_plugin_odrs_fetch_batch_cancelled_cb (GCancellable *cancellable,
+					 gpointer user_data)
+{
+	GsOdrsFetchBatch *batch = user_data;
+
+	for (guint i = 0; i < batch->fetches->len; i++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (batch->fetches, i);
+		if (fetch->msg != NULL && !fetch->done)
+			soup_session_cancel_message (batch->soup_session, fetch->msg,
+						     SOUP_STATUS_CANCELLED);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/* The ODRS API only fetches the reviews for one app per request, so send
+ * the requests for @fetches together and wait for them together, which takes
+ * about as long as the slowest of them rather than the sum of them all. At
+ * most %ODRS_REVIEW_FETCHES_PENDING_MAX are sent at once, so a long list does
+ * not flood the server, and the rest are not sent once @cancellable is
+ * cancelled. */
+static void
+gs_plugin_odrs_fetch_batch (GsPlugin *plugin,
+			    GPtrArray *fetches,
+			    GCancellable *cancellable)
+{
+	GsOdrsFetchBatch batch = { fetches, gs_plugin_get_soup_session (plugin), NULL, 0 };
+	guint next = 0;
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GsMainContextPusher) pusher = gs_main_context_pusher_new (context);
+	g_autoptr(GSource) cancellable_source = NULL;
+
+	batch.context = context;
+	if (cancellable != NULL) {
+		cancellable_source = g_cancellable_source_new (cancellable);
+		g_source_set_callback (cancellable_source,
+				       (GSourceFunc) gs_plugin_odrs_fetch_batch_cancelled_cb,
+				       &batch, NULL);
+		g_source_attach (cancellable_source, context);
+	}
+
+	for (;;) {
+		while (next < fetches->len &&
+		       batch.n_pending < ODRS_REVIEW_FETCHES_PENDING_MAX &&
+		       !g_cancellable_is_cancelled (cancellable)) {
+			GsOdrsFetch *fetch = g_ptr_array_index (fetches, next++);
+
+			fetch->msg = gs_plugin_odrs_new_fetch_message (plugin, fetch->app);
+			if (fetch->msg == NULL) {
+				g_set_error (&fetch->error,
+					     GS_PLUGIN_ERROR,
+					     GS_PLUGIN_ERROR_FAILED,
+					     "failed to create request for %s",
+					     gs_app_get_id (fetch->app));
+				continue;
+			}
+
+			/* the session takes a reference which it drops once done */
+			soup_session_queue_message (batch.soup_session,
+						    g_object_ref (fetch->msg),
+						    gs_plugin_odrs_fetch_batch_cb,
+						    &batch);
+			batch.n_pending++;
+		}
+		if (batch.n_pending == 0)
+			break;
+		g_main_context_iteration (context, TRUE);
+	}
+	if (cancellable_source != NULL)
+		g_source_destroy (cancellable_source);
+
+	/* the ones which were never sent */
+	for (; next < fetches->len; next++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (fetches, next);
+		g_set_error (&fetch->error,
+			     GS_PLUGIN_ERROR,
+			     GS_PLUGIN_ERROR_CANCELLED,
+			     "cancelled before the request for %s was sent",
+			     gs_app_get_id (fetch->app));
+	}
+
+	for (guint i = 0; i < fetches->len; i++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (fetches, i);
+		if (fetch->error != NULL)
+			continue;
+		fetch->reviews = gs_plugin_odrs_parse_fetch_response (plugin, fetch,
+								      &fetch->error);
+	}
+}
+
+static void
+gs_plugin_odrs_revalidate_thread_cb (GTask *task,
+				     gpointer source_object,
+				     gpointer task_data,
+				     GCancellable *cancellable)
+{
+	GsPlugin *plugin = GS_PLUGIN (source_object);
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	GPtrArray *fetches = task_data;
+
+	gs_plugin_odrs_fetch_batch (plugin, fetches, cancellable);
+
+	for (guint i = 0; i < fetches->len; i++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (fetches, i);
+		g_autoptr(GMutexLocker) locker = NULL;
+
+		if (fetch->error != NULL) {
+			g_debug ("failed to revalidate reviews for %s: %s",
+				 gs_app_get_id (fetch->app), fetch->error->message);
+		}
+		locker = g_mutex_locker_new (&priv->revalidating_mutex);
+		g_hash_table_remove (priv->revalidating, gs_app_get_id (fetch->app));
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/* refreshes the cached reviews of @fetches in the background, so they are
+ * up to date the next time they are needed */
+static void
+gs_plugin_odrs_revalidate_reviews (GsPlugin *plugin, GPtrArray *fetches)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->revalidating_mutex);
+	g_autoptr(GPtrArray) fetches_new = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_odrs_fetch_free);
+	g_autoptr(GTask) task = NULL;
+
+	/* only once per app at a time */
+	for (guint i = 0; i < fetches->len; i++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (fetches, i);
+		if (g_hash_table_contains (priv->revalidating, gs_app_get_id (fetch->app)))
+			continue;
+		g_hash_table_add (priv->revalidating, g_strdup (gs_app_get_id (fetch->app)));
+		g_ptr_array_add (fetches_new, gs_odrs_fetch_new (fetch->app, fetch->cachefn));
+	}
+	if (fetches_new->len == 0)
+		return;
+
+	g_debug ("revalidating reviews for %u apps", fetches_new->len);
+	task = g_task_new (plugin, NULL, NULL, NULL);
+	g_task_set_source_tag (task, gs_plugin_odrs_revalidate_reviews);
+	g_task_set_task_data (task, g_steal_pointer (&fetches_new), (GDestroyNotify) g_ptr_array_unref);
+	g_task_run_in_thread (task, gs_plugin_odrs_revalidate_thread_cb);
+}
+
+static void
+gs_plugin_odrs_add_reviews (GsPlugin *plugin, GsApp *app, GPtrArray *reviews)
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
-	AsReview *review;
-	g_autoptr(GPtrArray) reviews = NULL;
 
-	/* get from server */
-	reviews = gs_plugin_odrs_fetch_for_app (plugin, app, error);
-	if (reviews == NULL)
-		return FALSE;
 	for (guint i = 0; i < reviews->len; i++) {
-		review = g_ptr_array_index (reviews, i);
+		AsReview *review = g_ptr_array_index (reviews, i);
 
 		/* save this on the application object so we can use it for
 		 * submitting a new review */
@@ -904,6 +1272,91 @@ gs_plugin_odrs_refine_reviews (GsPlugin *plugin,
 		}
 		gs_app_add_review (app, review);
 	}
+}
+
+/* Reviews are cached per app. Cached reviews younger than
+ * %ODRS_REVIEW_CACHE_AGE_FRESH are used as they are; older ones are still
+ * used straight away, up to %ODRS_REVIEW_CACHE_AGE_MAX, but are refreshed in
+ * the background. Apps with no usable cached reviews are fetched in one
+ * batch. */
+static gboolean
+gs_plugin_odrs_refine_reviews (GsPlugin *plugin,
+			       GsAppList *list,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	g_autoptr(GPtrArray) fetches = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_odrs_fetch_free);
+	g_autoptr(GPtrArray) stale = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_odrs_fetch_free);
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		guint age;
+		g_autofree gchar *cachefn = NULL;
+		g_autoptr(GFile) cachefn_file = NULL;
+
+		/* not valid */
+		if (gs_app_get_kind (app) == AS_COMPONENT_KIND_ADDON)
+			continue;
+		if (gs_app_get_id (app) == NULL)
+			continue;
+		if (gs_app_get_reviews (app)->len > 0)
+			continue;
+
+		/* look in the cache */
+		cachefn = gs_plugin_odrs_get_reviews_cache_filename (gs_app_get_id (app), error);
+		if (cachefn == NULL)
+			return FALSE;
+		cachefn_file = g_file_new_for_path (cachefn);
+		age = gs_utils_get_file_age (cachefn_file);
+		if (age < ODRS_REVIEW_CACHE_AGE_MAX) {
+			g_autoptr(GMappedFile) mapped_file = NULL;
+			g_autoptr(GPtrArray) reviews = NULL;
+			g_autoptr(GError) error_local = NULL;
+
+			mapped_file = g_mapped_file_new (cachefn, FALSE, &error_local);
+			if (mapped_file != NULL) {
+				reviews = gs_plugin_odrs_parse_reviews (plugin,
+									g_mapped_file_get_contents (mapped_file),
+									g_mapped_file_get_length (mapped_file),
+									&error_local);
+			}
+			if (reviews != NULL) {
+				g_debug ("got review data for %s from %s",
+					 gs_app_get_id (app), cachefn);
+				gs_plugin_odrs_add_reviews (plugin, app, reviews);
+				if (age >= ODRS_REVIEW_CACHE_AGE_FRESH)
+					g_ptr_array_add (stale, gs_odrs_fetch_new (app, cachefn));
+				continue;
+			}
+			g_debug ("ignoring cached reviews for %s: %s",
+				 gs_app_get_id (app), error_local->message);
+		}
+
+		g_ptr_array_add (fetches, gs_odrs_fetch_new (app, cachefn));
+	}
+
+	if (stale->len > 0)
+		gs_plugin_odrs_revalidate_reviews (plugin, stale);
+	if (fetches->len == 0)
+		return TRUE;
+
+	gs_plugin_odrs_fetch_batch (plugin, fetches, cancellable);
+	for (guint i = 0; i < fetches->len; i++) {
+		GsOdrsFetch *fetch = g_ptr_array_index (fetches, i);
+
+		if (fetch->reviews != NULL) {
+			gs_plugin_odrs_add_reviews (plugin, fetch->app, fetch->reviews);
+			continue;
+		}
+		if (g_error_matches (fetch->error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_NO_NETWORK)) {
+			g_debug ("failed to refine app %s: %s",
+				 gs_app_get_unique_id (fetch->app), fetch->error->message);
+			continue;
+		}
+		g_propagate_prefixed_error (error, g_steal_pointer (&fetch->error),
+					    "failed to refine app: ");
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -920,15 +1373,6 @@ refine_app (GsPlugin             *plugin,
 	if (gs_app_get_id (app) == NULL)
 		return TRUE;
 
-	/* add reviews if possible */
-	if (flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_REVIEWS) {
-		if (gs_app_get_reviews(app)->len > 0)
-			return TRUE;
-		if (!gs_plugin_odrs_refine_reviews (plugin, app,
-						    cancellable, error))
-			return FALSE;
-	}
-
 	/* add ratings if possible */
 	if (flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_REVIEW_RATINGS ||
 	    flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING) {
@@ -955,6 +1399,12 @@ gs_plugin_refine (GsPlugin             *plugin,
 		      GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING)) == 0)
 		return TRUE;
 
+	/* add reviews if possible */
+	if (flags & GS_PLUGIN_REFINE_FLAGS_REQUIRE_REVIEWS) {
+		if (!gs_plugin_odrs_refine_reviews (plugin, list, cancellable, error))
+			return FALSE;
+	}
+
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app = gs_app_list_index (list, i);
 		g_autoptr(GError) local_error = NULL;
@@ -1003,18 +1453,12 @@ gs_plugin_odrs_sanitize_version (const gchar *version)
 static gboolean
 gs_plugin_odrs_invalidate_cache (AsReview *review, GError **error)
 {
-	g_autofree gchar *cachefn_basename = NULL;
 	g_autofree gchar *cachefn = NULL;
 	g_autoptr(GFile) cachefn_file = NULL;
 
 	/* look in the cache */
-	cachefn_basename = g_strdup_printf ("%s.json",
-					    as_review_get_metadata_item (review, "app_id"));
-	cachefn = gs_utils_get_cache_filename ("odrs",
-					       cachefn_basename,
-					       GS_UTILS_CACHE_FLAG_WRITEABLE |
-					       GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
-					       error);
+	cachefn = gs_plugin_odrs_get_reviews_cache_filename (as_review_get_metadata_item (review, "app_id"),
+							     error);
 	if (cachefn == NULL)
 		return FALSE;
 	cachefn_file = g_file_new_for_path (cachefn);
@@ -32,6 +32,15 @@ G_DEFINE_AUTO_CLEANUP_FREE_FUNC(Header, headerFree, NULL)
 G_DEFINE_AUTO_CLEANUP_FREE_FUNC(rpmts, rpmtsFree, NULL);
 G_DEFINE_AUTO_CLEANUP_FREE_FUNC(rpmdbMatchIterator, rpmdbFreeIterator, NULL);
 
+/* The packages in a deployment, indexed for refine. Deployments are
+ * immutable, so this only needs rebuilding when the checksum changes. */
+typedef struct {
+	gchar			*checksum;
+	GHashTable		*packages;		/* name : RpmOstreePackage */
+	GHashTable		*layered_packages;	/* name */
+	GHashTable		*layered_local_packages; /* NEVRA */
+} DeploymentPackages;
+
 struct GsPluginData {
 	GMutex			 mutex;
 	GsRPMOSTreeOS		*os_proxy;
@@ -40,8 +49,53 @@ struct GsPluginData {
 	OstreeSysroot		*ot_sysroot;
 	DnfContext		*dnf_context;
 	gboolean		 update_triggered;
+	DeploymentPackages	*deployment_packages;	/* (nullable), protected by mutex */
 };
 
+static GHashTable *
+strv_to_set (gchar **strv)
+{
+	GHashTable *set = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (guint i = 0; strv != NULL && strv[i] != NULL; i++)
+		g_hash_table_add (set, g_strdup (strv[i]));
+	return set;
+}
+
+static DeploymentPackages *
+deployment_packages_new (const gchar *checksum,
+                         GPtrArray *pkglist,
+                         gchar **layered_packages,
+                         gchar **layered_local_packages)
+{
+	DeploymentPackages *deployment_packages = g_slice_new0 (DeploymentPackages);
+
+	deployment_packages->checksum = g_strdup (checksum);
+	deployment_packages->packages = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                                       NULL, g_object_unref);
+	for (guint i = 0; i < pkglist->len; i++) {
+		RpmOstreePackage *pkg = g_ptr_array_index (pkglist, i);
+		const gchar *name = rpm_ostree_package_get_name (pkg);
+
+		/* multilib packages share a name; keep the first one */
+		if (!g_hash_table_contains (deployment_packages->packages, name))
+			g_hash_table_insert (deployment_packages->packages, (gpointer) name, g_object_ref (pkg));
+	}
+	deployment_packages->layered_packages = strv_to_set (layered_packages);
+	deployment_packages->layered_local_packages = strv_to_set (layered_local_packages);
+
+	return deployment_packages;
+}
+
+static void
+deployment_packages_free (DeploymentPackages *deployment_packages)
+{
+	g_free (deployment_packages->checksum);
+	g_hash_table_unref (deployment_packages->packages);
+	g_hash_table_unref (deployment_packages->layered_packages);
+	g_hash_table_unref (deployment_packages->layered_local_packages);
+	g_slice_free (DeploymentPackages, deployment_packages);
+}
+
 void
 gs_plugin_initialize (GsPlugin *plugin)
 {
@@ -91,6 +145,7 @@ gs_plugin_destroy (GsPlugin *plugin)
 		g_object_unref (priv->ot_repo);
 	if (priv->dnf_context != NULL)
 		g_object_unref (priv->dnf_context);
+	g_clear_pointer (&priv->deployment_packages, deployment_packages_free);
 	g_mutex_clear (&priv->mutex);
 }
 
@@ -1330,34 +1385,31 @@ find_packages_by_provides (DnfSack *sack,
 
 static gboolean
 resolve_installed_packages_app (GsPlugin *plugin,
-                                GPtrArray *pkglist,
-                                gchar **layered_packages,
-                                gchar **layered_local_packages,
+                                DeploymentPackages *deployment_packages,
                                 GsApp *app)
 {
-	for (guint i = 0; i < pkglist->len; i++) {
-		RpmOstreePackage *pkg = g_ptr_array_index (pkglist, i);
-		if (g_strcmp0 (rpm_ostree_package_get_name (pkg), gs_app_get_source_default (app)) == 0) {
-			gs_app_set_version (app, rpm_ostree_package_get_evr (pkg));
-			if (gs_app_get_state (app) == GS_APP_STATE_UNKNOWN)
-				gs_app_set_state (app, GS_APP_STATE_INSTALLED);
-			if (g_strv_contains ((const gchar * const *) layered_packages,
-			                     rpm_ostree_package_get_name (pkg)) ||
-			    g_strv_contains ((const gchar * const *) layered_local_packages,
-			                     rpm_ostree_package_get_nevra (pkg))) {
-				/* layered packages can always be removed */
-				gs_app_remove_quirk (app, GS_APP_QUIRK_COMPULSORY);
-			} else {
-				/* can't remove packages that are part of the base system */
-				gs_app_add_quirk (app, GS_APP_QUIRK_COMPULSORY);
-			}
-			if (gs_app_get_origin (app) == NULL)
-				gs_app_set_origin (app, "rpm-ostree");
-			return TRUE /* found */;
-		}
-	}
+	RpmOstreePackage *pkg;
 
-	return FALSE /* not found */;
+	pkg = g_hash_table_lookup (deployment_packages->packages, gs_app_get_source_default (app));
+	if (pkg == NULL)
+		return FALSE /* not found */;
+
+	gs_app_set_version (app, rpm_ostree_package_get_evr (pkg));
+	if (gs_app_get_state (app) == GS_APP_STATE_UNKNOWN)
+		gs_app_set_state (app, GS_APP_STATE_INSTALLED);
+	if (g_hash_table_contains (deployment_packages->layered_packages,
+	                           rpm_ostree_package_get_name (pkg)) ||
+	    g_hash_table_contains (deployment_packages->layered_local_packages,
+	                           rpm_ostree_package_get_nevra (pkg))) {
+		/* layered packages can always be removed */
+		gs_app_remove_quirk (app, GS_APP_QUIRK_COMPULSORY);
+	} else {
+		/* can't remove packages that are part of the base system */
+		gs_app_add_quirk (app, GS_APP_QUIRK_COMPULSORY);
+	}
+	if (gs_app_get_origin (app) == NULL)
+		gs_app_set_origin (app, "rpm-ostree");
+	return TRUE /* found */;
 }
 
 static gboolean
@@ -1470,10 +1522,7 @@ gs_plugin_refine (GsPlugin *plugin,
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	g_autoptr(GMutexLocker) locker = NULL;
-	g_autoptr(GPtrArray) pkglist = NULL;
 	g_autoptr(GVariant) default_deployment = NULL;
-	g_auto(GStrv) layered_packages = NULL;
-	g_auto(GStrv) layered_local_packages = NULL;
 	g_autofree gchar *checksum = NULL;
 
 	locker = g_mutex_locker_new (&priv->mutex);
@@ -1485,20 +1534,34 @@ gs_plugin_refine (GsPlugin *plugin,
 	}
 
 	default_deployment = gs_rpmostree_os_dup_default_deployment (priv->os_proxy);
-	g_assert (g_variant_lookup (default_deployment,
-	                            "packages", "^as",
-	                            &layered_packages));
-	g_assert (g_variant_lookup (default_deployment,
-	                            "requested-local-packages", "^as",
-	                            &layered_local_packages));
 	g_assert (g_variant_lookup (default_deployment,
 	                            "checksum", "s",
 	                            &checksum));
 
-	pkglist = rpm_ostree_db_query_all (priv->ot_repo, checksum, cancellable, error);
-	if (pkglist == NULL) {
-		gs_rpmostree_error_convert (error);
-		return FALSE;
+	/* only query the package database when the deployment changed */
+	if (priv->deployment_packages == NULL ||
+	    g_strcmp0 (priv->deployment_packages->checksum, checksum) != 0) {
+		g_autoptr(GPtrArray) pkglist = NULL;
+		g_auto(GStrv) layered_packages = NULL;
+		g_auto(GStrv) layered_local_packages = NULL;
+
+		g_assert (g_variant_lookup (default_deployment,
+		                            "packages", "^as",
+		                            &layered_packages));
+		g_assert (g_variant_lookup (default_deployment,
+		                            "requested-local-packages", "^as",
+		                            &layered_local_packages));
+
+		pkglist = rpm_ostree_db_query_all (priv->ot_repo, checksum, cancellable, error);
+		if (pkglist == NULL) {
+			gs_rpmostree_error_convert (error);
+			return FALSE;
+		}
+
+		g_clear_pointer (&priv->deployment_packages, deployment_packages_free);
+		priv->deployment_packages = deployment_packages_new (checksum, pkglist,
+		                                                     layered_packages,
+		                                                     layered_local_packages);
 	}
 
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
@@ -1530,7 +1593,7 @@ gs_plugin_refine (GsPlugin *plugin,
 			continue;
 
 		/* first try to resolve from installed packages */
-		found = resolve_installed_packages_app (plugin, pkglist, layered_packages, layered_local_packages, app);
+		found = resolve_installed_packages_app (plugin, priv->deployment_packages, app);
 
 		/* if we didn't find anything, try resolving from available packages */
 		if (!found && priv->dnf_context != NULL)
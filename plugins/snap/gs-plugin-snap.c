@@ -14,35 +14,27 @@
 #include <snapd-glib/snapd-glib.h>
 #include <gnome-software.h>
 
+#include "gs-snap-store-cache.h"
+
+/* snapd also refreshes snaps by itself, or when asked on the command line */
+#define LOCAL_SNAPS_MAX_AGE	(30 * G_TIME_SPAN_SECOND)
+
 struct GsPluginData {
 	gchar			*store_name;
 	gchar			*store_hostname;
 	SnapdSystemConfinement	 system_confinement;
 
-	GMutex			 store_snaps_lock;
-	GHashTable		*store_snaps;
-};
-
-typedef struct {
-	SnapdSnap *snap;
-	gboolean full_details;
-} CacheEntry;
+	GsSnapStoreCache	*store_cache;
 
-static CacheEntry *
-cache_entry_new (SnapdSnap *snap, gboolean full_details)
-{
-	CacheEntry *entry = g_slice_new (CacheEntry);
-	entry->snap = g_object_ref (snap);
-	entry->full_details = full_details;
-	return entry;
-}
-
-static void
-cache_entry_free (CacheEntry *entry)
-{
-	g_object_unref (entry->snap);
-	g_slice_free (CacheEntry, entry);
-}
+	/* the installed snaps, fetched in one request and shared by all
+	 * refines until something is installed, removed or updated, or until
+	 * they are old enough that snapd may have changed them itself */
+	GMutex			 local_snaps_lock;
+	GHashTable		*local_snaps;		/* (nullable) name : SnapdSnap */
+	gint64			 local_snaps_time;	/* monotonic */
+	guint			 local_snaps_generation;
+	GHashTable		*local_icons;		/* name:revision : GBytes */
+};
 
 static SnapdAuthData *
 get_auth_data (GsPlugin *plugin)
@@ -117,7 +109,7 @@ gs_plugin_initialize (GsPlugin *plugin)
 	g_autoptr(SnapdClient) client = NULL;
 	g_autoptr (GError) error = NULL;
 
-	g_mutex_init (&priv->store_snaps_lock);
+	g_mutex_init (&priv->local_snaps_lock);
 
 	client = get_client (plugin, &error);
 	if (client == NULL) {
@@ -125,8 +117,8 @@ gs_plugin_initialize (GsPlugin *plugin)
 		return;
 	}
 
-	priv->store_snaps = g_hash_table_new_full (g_str_hash, g_str_equal,
-						   g_free, (GDestroyNotify) cache_entry_free);
+	priv->local_icons = g_hash_table_new_full (g_str_hash, g_str_equal,
+						   g_free, (GDestroyNotify) g_bytes_unref);
 
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_BETTER_THAN, "packagekit");
 	gs_plugin_add_rule (plugin, GS_PLUGIN_RULE_RUN_BEFORE, "icons");
@@ -219,6 +211,28 @@ snapd_error_convert (GError **perror)
 	error->domain = GS_PLUGIN_ERROR;
 }
 
+static void
+setup_store_cache (GsPlugin *plugin)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+
+	filename = gs_utils_get_cache_filename ("snap", "store-cache",
+						GS_UTILS_CACHE_FLAG_WRITEABLE |
+						GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+						&error);
+	if (filename == NULL) {
+		g_warning ("Failed to get snap store cache filename: %s", error->message);
+		g_clear_error (&error);
+	}
+
+	priv->store_cache = gs_snap_store_cache_new (filename);
+	if (!gs_snap_store_cache_load (priv->store_cache, &error) &&
+	    !g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+		g_warning ("Failed to load snap store cache: %s", error->message);
+}
+
 gboolean
 gs_plugin_setup (GsPlugin *plugin, GCancellable *cancellable, GError **error)
 {
@@ -241,45 +255,111 @@ gs_plugin_setup (GsPlugin *plugin, GCancellable *cancellable, GError **error)
 	}
 	priv->system_confinement = snapd_system_information_get_confinement (system_information);
 
+	/* pick up the store snaps fetched before the last restart */
+	setup_store_cache (plugin);
+
 	/* success */
 	return TRUE;
 }
 
-static SnapdSnap *
-store_snap_cache_lookup (GsPlugin *plugin, const gchar *name, gboolean need_details)
+static GHashTable *
+local_snaps_new (GPtrArray *snaps)
+{
+	GHashTable *local_snaps = g_hash_table_new_full (g_str_hash, g_str_equal,
+							 g_free, g_object_unref);
+	for (guint i = 0; i < snaps->len; i++) {
+		SnapdSnap *snap = g_ptr_array_index (snaps, i);
+		g_hash_table_insert (local_snaps,
+				     g_strdup (snapd_snap_get_name (snap)),
+				     g_object_ref (snap));
+	}
+	return local_snaps;
+}
+
+static void
+local_snaps_update_locked (GsPlugin *plugin, GHashTable *local_snaps)
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
-	CacheEntry *entry;
-	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->store_snaps_lock);
 
-	entry = g_hash_table_lookup (priv->store_snaps, name);
-	if (entry == NULL)
-		return NULL;
+	g_clear_pointer (&priv->local_snaps, g_hash_table_unref);
+	priv->local_snaps = g_hash_table_ref (local_snaps);
+	priv->local_snaps_time = g_get_monotonic_time ();
+}
 
-	if (need_details && !entry->full_details)
-		return NULL;
+static void
+local_snaps_update (GsPlugin *plugin, GPtrArray *snaps)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	g_autoptr(GHashTable) local_snaps = local_snaps_new (snaps);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->local_snaps_lock);
 
-	return g_object_ref (entry->snap);
+	local_snaps_update_locked (plugin, local_snaps);
 }
 
+/* called whenever snaps are installed, removed or refreshed */
 static void
-store_snap_cache_update (GsPlugin *plugin, GPtrArray *snaps, gboolean full_details)
+local_snaps_invalidate (GsPlugin *plugin)
 {
 	GsPluginData *priv = gs_plugin_get_data (plugin);
-	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->store_snaps_lock);
-	guint i;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->local_snaps_lock);
 
-	for (i = 0; i < snaps->len; i++) {
-		SnapdSnap *snap = snaps->pdata[i];
-		g_hash_table_insert (priv->store_snaps, g_strdup (snapd_snap_get_name (snap)), cache_entry_new (snap, full_details));
+	g_clear_pointer (&priv->local_snaps, g_hash_table_unref);
+	g_hash_table_remove_all (priv->local_icons);
+	priv->local_snaps_generation++;
+}
+
+/* returns all the installed snaps by name, getting them from snapd in a
+ * single request if they are not already known */
+static GHashTable *
+get_local_snaps (GsPlugin *plugin, SnapdClient *client, GCancellable *cancellable, GError **error)
+{
+	GsPluginData *priv = gs_plugin_get_data (plugin);
+	g_autoptr(GPtrArray) snaps = NULL;
+	g_autoptr(GHashTable) local_snaps = NULL;
+	guint generation;
+
+	{
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->local_snaps_lock);
+		if (priv->local_snaps != NULL &&
+		    g_get_monotonic_time () - priv->local_snaps_time < LOCAL_SNAPS_MAX_AGE)
+			return g_hash_table_ref (priv->local_snaps);
+		generation = priv->local_snaps_generation;
 	}
+
+	/* not holding the lock, so a slow snapd does not block the icon
+	 * lookups and invalidations which share it */
+	snaps = snapd_client_get_snaps_sync (client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, cancellable, error);
+	if (snaps == NULL) {
+		snapd_error_convert (error);
+		return NULL;
+	}
+	local_snaps = local_snaps_new (snaps);
+
+	/* only keep the result if nothing was installed, removed or updated
+	 * while it was being fetched */
+	{
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->local_snaps_lock);
+		if (generation == priv->local_snaps_generation)
+			local_snaps_update_locked (plugin, local_snaps);
+	}
+
+	return g_steal_pointer (&local_snaps);
 }
 
 static GPtrArray *
 find_snaps (GsPlugin *plugin, SnapdFindFlags flags, const gchar *section, const gchar *query, GCancellable *cancellable, GError **error)
 {
+	GsPluginData *priv = gs_plugin_get_data (plugin);
 	g_autoptr(SnapdClient) client = NULL;
 	g_autoptr(GPtrArray) snaps = NULL;
+	gboolean is_section_listing = (section != NULL && query == NULL);
+
+	/* the snaps in a section don't change often */
+	if (is_section_listing) {
+		snaps = gs_snap_store_cache_lookup_section (priv->store_cache, section);
+		if (snaps != NULL)
+			return g_steal_pointer (&snaps);
+	}
 
 	client = get_client (plugin, error);
 	if (client == NULL)
@@ -291,7 +371,15 @@ find_snaps (GsPlugin *plugin, SnapdFindFlags flags, const gchar *section, const
 		return NULL;
 	}
 
-	store_snap_cache_update (plugin, snaps, flags & SNAPD_FIND_FLAGS_MATCH_NAME);
+	if (is_section_listing) {
+		g_autoptr(GError) error_local = NULL;
+
+		gs_snap_store_cache_add_section (priv->store_cache, section, snaps);
+		if (!gs_snap_store_cache_save (priv->store_cache, &error_local))
+			g_warning ("Failed to save snap store cache: %s", error_local->message);
+	} else {
+		gs_snap_store_cache_add (priv->store_cache, snaps, flags & SNAPD_FIND_FLAGS_MATCH_NAME);
+	}
 
 	return g_steal_pointer (&snaps);
 }
@@ -389,8 +477,19 @@ gs_plugin_destroy (GsPlugin *plugin)
 	GsPluginData *priv = gs_plugin_get_data (plugin);
 	g_free (priv->store_name);
 	g_free (priv->store_hostname);
-	g_clear_pointer (&priv->store_snaps, g_hash_table_unref);
-	g_mutex_clear (&priv->store_snaps_lock);
+	if (priv->store_cache != NULL) {
+		guint hits, misses;
+		g_autoptr(GError) error = NULL;
+
+		gs_snap_store_cache_get_stats (priv->store_cache, &hits, &misses);
+		g_debug ("store cache: %u hits, %u misses", hits, misses);
+		if (!gs_snap_store_cache_save (priv->store_cache, &error))
+			g_warning ("Failed to save snap store cache: %s", error->message);
+	}
+	g_clear_object (&priv->store_cache);
+	g_clear_pointer (&priv->local_snaps, g_hash_table_unref);
+	g_clear_pointer (&priv->local_icons, g_hash_table_unref);
+	g_mutex_clear (&priv->local_snaps_lock);
 }
 
 static gboolean
@@ -524,6 +623,7 @@ gs_plugin_add_installed (GsPlugin *plugin,
 		snapd_error_convert (error);
 		return FALSE;
 	}
+	local_snaps_update (plugin, snaps);
 
 	for (i = 0; i < snaps->len; i++) {
 		SnapdSnap *snap = g_ptr_array_index (snaps, i);
@@ -563,13 +663,14 @@ gs_plugin_add_search (GsPlugin *plugin,
 static SnapdSnap *
 get_store_snap (GsPlugin *plugin, const gchar *name, gboolean need_details, GCancellable *cancellable, GError **error)
 {
+	GsPluginData *priv = gs_plugin_get_data (plugin);
 	SnapdSnap *snap = NULL;
 	g_autoptr(GPtrArray) snaps = NULL;
 
 	/* use cached version if available */
-	snap = store_snap_cache_lookup (plugin, name, need_details);
+	snap = gs_snap_store_cache_lookup (priv->store_cache, name, need_details);
 	if (snap != NULL)
-		return g_object_ref (snap);
+		return snap;
 
 	snaps = find_snaps (plugin, SNAPD_FIND_FLAGS_SCOPE_WIDE | SNAPD_FIND_FLAGS_MATCH_NAME, NULL, name, cancellable, error);
 	if (snaps == NULL || snaps->len < 1)
@@ -717,25 +818,50 @@ gs_plugin_add_alternates (GsPlugin *plugin,
 }
 
 static gboolean
-load_snap_icon (GsApp *app, SnapdClient *client, SnapdSnap *snap, GCancellable *cancellable)
+load_snap_icon (GsPlugin *plugin, GsApp *app, SnapdClient *client, SnapdSnap *snap, GCancellable *cancellable)
 {
+	GsPluginData *priv = gs_plugin_get_data (plugin);
 	const gchar *icon_url;
-	g_autoptr(SnapdIcon) icon = NULL;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GBytes) data = NULL;
 	g_autoptr(GIcon) gicon = NULL;
-	g_autoptr(GError) error = NULL;
 
 	icon_url = snapd_snap_get_icon (snap);
 	if (icon_url == NULL || strcmp (icon_url, "") == 0)
 		return FALSE;
 
-	icon = snapd_client_get_icon_sync (client, gs_app_get_metadata_item (app, "snap::name"), cancellable, &error);
-	if (icon == NULL) {
-		if (!g_error_matches (error, SNAPD_ERROR, SNAPD_ERROR_NOT_FOUND))
+	/* the icon only changes when the snap is refreshed */
+	key = g_strdup_printf ("%s:%s", snapd_snap_get_name (snap), snapd_snap_get_revision (snap));
+	{
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->local_snaps_lock);
+		data = g_hash_table_lookup (priv->local_icons, key);
+		if (data != NULL)
+			g_bytes_ref (data);
+	}
+
+	if (data == NULL) {
+		g_autoptr(SnapdIcon) icon = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GMutexLocker) locker = NULL;
+
+		icon = snapd_client_get_icon_sync (client, gs_app_get_metadata_item (app, "snap::name"), cancellable, &error);
+		if (icon != NULL) {
+			data = g_bytes_ref (snapd_icon_get_data (icon));
+		} else if (g_error_matches (error, SNAPD_ERROR, SNAPD_ERROR_NOT_FOUND)) {
+			/* remember there is nothing to get */
+			data = g_bytes_new (NULL, 0);
+		} else {
 			g_warning ("Failed to load snap icon: %s", error->message);
-		return FALSE;
+			return FALSE;
+		}
+
+		locker = g_mutex_locker_new (&priv->local_snaps_lock);
+		g_hash_table_replace (priv->local_icons, g_steal_pointer (&key), g_bytes_ref (data));
 	}
+	if (g_bytes_get_size (data) == 0)
+		return FALSE;
 
-	gicon = g_bytes_icon_new (snapd_icon_get_data (icon));
+	gicon = g_bytes_icon_new (data);
 	gs_app_add_icon (app, gicon);
 
 	return TRUE;
@@ -844,7 +970,7 @@ static gboolean
 load_icon (GsPlugin *plugin, SnapdClient *client, GsApp *app, const gchar *id, SnapdSnap *local_snap, SnapdSnap *store_snap, GCancellable *cancellable)
 {
 	if (local_snap != NULL) {
-		if (load_snap_icon (app, client, local_snap, cancellable))
+		if (load_snap_icon (plugin, app, client, local_snap, cancellable))
 			return TRUE;
 		if (load_desktop_icon (app, local_snap))
 			return TRUE;
@@ -905,6 +1031,7 @@ refine_screenshots (GsApp *app, SnapdSnap *snap)
 static gboolean
 refine_app_with_client (GsPlugin             *plugin,
 			SnapdClient          *client,
+			GHashTable           *local_snaps,
 			GsApp                *app,
 			GsPluginRefineFlags   flags,
 			GCancellable         *cancellable,
@@ -932,8 +1059,12 @@ refine_app_with_client (GsPlugin             *plugin,
 	channel = g_strdup (gs_app_get_branch (app));
 
 	/* get information from locally installed snaps and information we already have */
-	local_snap = snapd_client_get_snap_sync (client, snap_name, cancellable, NULL);
-	store_snap = store_snap_cache_lookup (plugin, snap_name, FALSE);
+	if (local_snaps != NULL && snap_name != NULL) {
+		local_snap = g_hash_table_lookup (local_snaps, snap_name);
+		if (local_snap != NULL)
+			g_object_ref (local_snap);
+	}
+	store_snap = gs_snap_store_cache_lookup (priv->store_cache, snap_name, FALSE);
 	if (store_snap != NULL)
 		store_channel = expand_channel_name (snapd_snap_get_channel (store_snap));
 
@@ -1075,14 +1206,35 @@ gs_plugin_refine (GsPlugin             *plugin,
 		  GError              **error)
 {
 	g_autoptr(SnapdClient) client = NULL;
+	g_autoptr(GHashTable) local_snaps = NULL;
+	g_autoptr(GError) error_local = NULL;
+	gboolean has_snaps = FALSE;
+
+	/* nothing to do */
+	for (guint i = 0; i < gs_app_list_length (list) && !has_snaps; i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		has_snaps = g_strcmp0 (gs_app_get_management_plugin (app), "snap") == 0;
+	}
+	if (!has_snaps)
+		return TRUE;
 
 	client = get_client (plugin, error);
 	if (client == NULL)
 		return FALSE;
 
+	/* all the installed snaps in one request rather than one per app */
+	local_snaps = get_local_snaps (plugin, client, cancellable, &error_local);
+	if (local_snaps == NULL) {
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			gs_utils_error_convert_gio (error);
+			return FALSE;
+		}
+		g_debug ("Failed to get installed snaps: %s", error_local->message);
+	}
+
 	for (guint i = 0; i < gs_app_list_length (list); i++) {
 		GsApp *app = gs_app_list_index (list, i);
-		if (!refine_app_with_client (plugin, client, app, flags, cancellable, error))
+		if (!refine_app_with_client (plugin, client, local_snaps, app, flags, cancellable, error))
 			return FALSE;
 	}
 
@@ -1142,6 +1294,7 @@ gs_plugin_app_install (GsPlugin *plugin,
 		result = snapd_client_refresh_sync (client, name, channel, progress_cb, app, cancellable, &error_local);
 	}
 
+	local_snaps_invalidate (plugin);
 	if (!result) {
 		gs_app_set_state_recover (app);
 		g_propagate_error (error, g_steal_pointer (&error_local));
@@ -1244,6 +1397,7 @@ gs_plugin_app_remove (GsPlugin *plugin,
 		      GError **error)
 {
 	g_autoptr(SnapdClient) client = NULL;
+	gboolean result;
 
 	/* We can only remove apps we know of */
 	if (g_strcmp0 (gs_app_get_management_plugin (app), "snap") != 0)
@@ -1254,7 +1408,9 @@ gs_plugin_app_remove (GsPlugin *plugin,
 		return FALSE;
 
 	gs_app_set_state (app, GS_APP_STATE_REMOVING);
-	if (!snapd_client_remove2_sync (client, SNAPD_REMOVE_FLAGS_NONE, gs_app_get_metadata_item (app, "snap::name"), progress_cb, app, cancellable, error)) {
+	result = snapd_client_remove2_sync (client, SNAPD_REMOVE_FLAGS_NONE, gs_app_get_metadata_item (app, "snap::name"), progress_cb, app, cancellable, error);
+	local_snaps_invalidate (plugin);
+	if (!result) {
 		gs_app_set_state_recover (app);
 		snapd_error_convert (error);
 		return FALSE;
@@ -1319,11 +1475,14 @@ gs_plugin_update (GsPlugin *plugin,
 		/* Get the name of the snap to refresh */
 		GsApp *app = gs_app_list_index (list, i);
 		gchar *name = gs_app_get_metadata_item (app, "snap::name");
+		gboolean result;
 
 		/* Refresh the snap */
 		gs_app_set_state (app, GS_APP_STATE_INSTALLING);
 
-		if (!snapd_client_refresh_sync (client, name, NULL, progress_cb, app, cancellable, error)) {
+		result = snapd_client_refresh_sync (client, name, NULL, progress_cb, app, cancellable, error);
+		local_snaps_invalidate (plugin);
+		if (!result) {
 			gs_app_set_state_recover (app);
 			snapd_error_convert (error);
 			return FALSE;
@@ -12,9 +12,11 @@
 
 #include "gnome-software-private.h"
 
+#include "gs-snap-store-cache.h"
 #include "gs-test.h"
 
 static gboolean snap_installed = FALSE;
+static guint find_section_calls = 0;
 
 SnapdAuthData *
 snapd_login_sync (const gchar *username, const gchar *password, const gchar *otp,
@@ -189,6 +191,7 @@ snapd_client_find_section_sync (SnapdClient *client,
 {
 	GPtrArray *snaps;
 
+	find_section_calls++;
 	snaps = g_ptr_array_new_with_free_func (g_object_unref);
 	g_ptr_array_add (snaps, make_snap ("snap", SNAPD_SNAP_STATUS_AVAILABLE));
 
@@ -343,6 +346,241 @@ gs_plugins_snap_test_func (GsPluginLoader *plugin_loader)
 	g_assert (ret);
 }
 
+static void
+gs_plugins_snap_store_cache_func (GsPluginLoader *plugin_loader)
+{
+	guint calls_before = find_section_calls;
+
+	/* no snap, abort */
+	if (!gs_plugin_loader_get_enabled (plugin_loader, "snap")) {
+		g_test_skip ("not enabled");
+		return;
+	}
+
+	/* the featured section is only fetched from the store once */
+	for (guint i = 0; i < 2; i++) {
+		g_autoptr(GsPluginJob) plugin_job = NULL;
+		g_autoptr(GsAppList) apps = NULL;
+		g_autoptr(GError) error = NULL;
+
+		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_POPULAR, NULL);
+		apps = gs_plugin_loader_job_process (plugin_loader, plugin_job, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_nonnull (apps);
+		g_assert_cmpint (find_section_calls - calls_before, ==, 1);
+	}
+}
+
+static GPtrArray *
+make_snaps (const gchar *prefix, guint n_snaps)
+{
+	GPtrArray *snaps = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (guint i = 0; i < n_snaps; i++) {
+		g_autofree gchar *name = g_strdup_printf ("%s%u", prefix, i);
+		g_ptr_array_add (snaps, make_snap (name, SNAPD_SNAP_STATUS_AVAILABLE));
+	}
+	return snaps;
+}
+
+static void
+gs_snap_store_cache_lookup_func (void)
+{
+	guint hits = 0;
+	guint misses = 0;
+	g_autoptr(GsSnapStoreCache) cache = gs_snap_store_cache_new (NULL);
+	g_autoptr(GPtrArray) snaps = make_snaps ("snap", 2);
+	g_autoptr(GPtrArray) section = NULL;
+	g_autoptr(SnapdSnap) snap = NULL;
+
+	/* nothing cached yet */
+	snap = gs_snap_store_cache_lookup (cache, "snap0", FALSE);
+	g_assert_null (snap);
+
+	/* a summary is only enough if the details are not needed */
+	gs_snap_store_cache_add (cache, snaps, FALSE);
+	snap = gs_snap_store_cache_lookup (cache, "snap0", FALSE);
+	g_assert_nonnull (snap);
+	g_assert_cmpstr (snapd_snap_get_name (snap), ==, "snap0");
+	g_clear_object (&snap);
+	snap = gs_snap_store_cache_lookup (cache, "snap0", TRUE);
+	g_assert_null (snap);
+	gs_snap_store_cache_add (cache, snaps, TRUE);
+	snap = gs_snap_store_cache_lookup (cache, "snap0", TRUE);
+	g_assert_nonnull (snap);
+	g_clear_object (&snap);
+
+	/* the snaps in a section are remembered in order */
+	section = gs_snap_store_cache_lookup_section (cache, "featured");
+	g_assert_null (section);
+	gs_snap_store_cache_add_section (cache, "featured", snaps);
+	section = gs_snap_store_cache_lookup_section (cache, "featured");
+	g_assert_nonnull (section);
+	g_assert_cmpint (section->len, ==, 2);
+	g_assert_cmpstr (snapd_snap_get_name (g_ptr_array_index (section, 0)), ==, "snap0");
+	g_assert_cmpstr (snapd_snap_get_name (g_ptr_array_index (section, 1)), ==, "snap1");
+
+	gs_snap_store_cache_get_stats (cache, &hits, &misses);
+	g_assert_cmpint (hits, ==, 3);
+	g_assert_cmpint (misses, ==, 3);
+}
+
+static void
+gs_snap_store_cache_evict_func (void)
+{
+	g_autoptr(GsSnapStoreCache) cache = gs_snap_store_cache_new (NULL);
+	g_autoptr(GPtrArray) snaps = make_snaps ("snap", 100);
+	g_autoptr(GPtrArray) snaps_more = make_snaps ("more", 1);
+	g_autoptr(SnapdSnap) snap = NULL;
+
+	/* the details of up to 100 snaps are kept */
+	gs_snap_store_cache_add (cache, snaps, TRUE);
+	snap = gs_snap_store_cache_lookup (cache, "snap0", TRUE);
+	g_assert_nonnull (snap);
+	g_clear_object (&snap);
+
+	/* so one more evicts the least recently used */
+	gs_snap_store_cache_add (cache, snaps_more, TRUE);
+	snap = gs_snap_store_cache_lookup (cache, "more0", TRUE);
+	g_assert_nonnull (snap);
+	g_clear_object (&snap);
+	snap = gs_snap_store_cache_lookup (cache, "snap0", TRUE);
+	g_assert_nonnull (snap);
+	g_clear_object (&snap);
+	snap = gs_snap_store_cache_lookup (cache, "snap1", TRUE);
+	g_assert_null (snap);
+	snap = gs_snap_store_cache_lookup (cache, "snap99", TRUE);
+	g_assert_nonnull (snap);
+}
+
+static GVariant *
+make_cache_entry (const gchar *name, gint64 fetched)
+{
+	GVariantBuilder props;
+
+	g_variant_builder_init (&props, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&props, "{sv}", "name", g_variant_new_string (name));
+	return g_variant_new ("(sxa{sv})", name, fetched, &props);
+}
+
+static void
+gs_snap_store_cache_expire_func (void)
+{
+	gboolean ret;
+	gint64 now = g_get_real_time ();
+	const gchar *section_names[] = { "fresh", NULL };
+	GVariantBuilder summaries;
+	GVariantBuilder details;
+	GVariantBuilder sections;
+	g_autofree gchar *tmp_root = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsSnapStoreCache) cache = NULL;
+	g_autoptr(GPtrArray) section = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(SnapdSnap) snap = NULL;
+
+	tmp_root = g_dir_make_tmp ("gnome-software-snap-test-XXXXXX", NULL);
+	g_assert_nonnull (tmp_root);
+	fn = g_build_filename (tmp_root, "store-cache", NULL);
+
+	/* summaries are kept for six hours, and details for one */
+	g_variant_builder_init (&summaries, G_VARIANT_TYPE ("a(sxa{sv})"));
+	g_variant_builder_add_value (&summaries, make_cache_entry ("stale", now - 7 * G_TIME_SPAN_HOUR));
+	g_variant_builder_add_value (&summaries, make_cache_entry ("fresh", now - G_TIME_SPAN_HOUR));
+	g_variant_builder_init (&details, G_VARIANT_TYPE ("a(sxa{sv})"));
+	g_variant_builder_add_value (&details, make_cache_entry ("expiring", now - G_TIME_SPAN_HOUR + G_TIME_SPAN_SECOND));
+	g_variant_builder_init (&sections, G_VARIANT_TYPE ("a(sxas)"));
+	g_variant_builder_add (&sections, "(sx^as)", "stale", now - 7 * G_TIME_SPAN_HOUR, section_names);
+	g_variant_builder_add (&sections, "(sx^as)", "fresh", now - G_TIME_SPAN_HOUR, section_names);
+	variant = g_variant_ref_sink (g_variant_new ("(ua(sxa{sv})a(sxa{sv})a(sxas))",
+						     (guint32) 1, &summaries, &details, &sections));
+	ret = g_file_set_contents (fn, g_variant_get_data (variant),
+				   g_variant_get_size (variant), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* entries which expired before loading are dropped */
+	cache = gs_snap_store_cache_new (fn);
+	ret = gs_snap_store_cache_load (cache, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	snap = gs_snap_store_cache_lookup (cache, "stale", FALSE);
+	g_assert_null (snap);
+	snap = gs_snap_store_cache_lookup (cache, "fresh", FALSE);
+	g_assert_nonnull (snap);
+	g_clear_object (&snap);
+	section = gs_snap_store_cache_lookup_section (cache, "stale");
+	g_assert_null (section);
+	section = gs_snap_store_cache_lookup_section (cache, "fresh");
+	g_assert_nonnull (section);
+	g_assert_cmpint (section->len, ==, 1);
+
+	/* and ones which expire after are dropped when looked up */
+	snap = gs_snap_store_cache_lookup (cache, "expiring", TRUE);
+	g_assert_nonnull (snap);
+	g_clear_object (&snap);
+	g_usleep (2 * G_USEC_PER_SEC);
+	snap = gs_snap_store_cache_lookup (cache, "expiring", TRUE);
+	g_assert_null (snap);
+
+	gs_utils_rmtree (tmp_root, NULL);
+}
+
+static void
+gs_snap_store_cache_save_func (void)
+{
+	gboolean ret;
+	GPtrArray *media;
+	g_autofree gchar *tmp_root = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsSnapStoreCache) cache = NULL;
+	g_autoptr(GsSnapStoreCache) cache2 = NULL;
+	g_autoptr(GPtrArray) snaps = make_snaps ("snap", 1);
+	g_autoptr(GPtrArray) snaps_section = make_snaps ("featured", 2);
+	g_autoptr(GPtrArray) section = NULL;
+	g_autoptr(SnapdSnap) snap = NULL;
+
+	tmp_root = g_dir_make_tmp ("gnome-software-snap-test-XXXXXX", NULL);
+	g_assert_nonnull (tmp_root);
+	fn = g_build_filename (tmp_root, "store-cache", NULL);
+
+	cache = gs_snap_store_cache_new (fn);
+	gs_snap_store_cache_add (cache, snaps, TRUE);
+	gs_snap_store_cache_add_section (cache, "featured", snaps_section);
+	ret = gs_snap_store_cache_save (cache, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (g_file_test (fn, G_FILE_TEST_EXISTS));
+
+	/* the snaps are created again with the same properties */
+	cache2 = gs_snap_store_cache_new (fn);
+	ret = gs_snap_store_cache_load (cache2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	snap = gs_snap_store_cache_lookup (cache2, "snap0", TRUE);
+	g_assert_nonnull (snap);
+	g_assert_cmpstr (snapd_snap_get_summary (snap), ==, "SUMMARY");
+	g_assert_cmpstr (snapd_snap_get_version (snap), ==, "VERSION");
+	g_assert_cmpint (snapd_snap_get_download_size (snap), ==, 500);
+	g_assert_cmpint (snapd_snap_get_status (snap), ==, SNAPD_SNAP_STATUS_AVAILABLE);
+	media = snapd_snap_get_media (snap);
+	g_assert_nonnull (media);
+	g_assert_cmpint (media->len, ==, 2);
+	g_assert_cmpstr (snapd_media_get_url (g_ptr_array_index (media, 1)), ==, "http://example.com/screenshot2.jpg");
+	g_assert_cmpint (snapd_media_get_width (g_ptr_array_index (media, 1)), ==, 1024);
+
+	/* as are the sections */
+	section = gs_snap_store_cache_lookup_section (cache2, "featured");
+	g_assert_nonnull (section);
+	g_assert_cmpint (section->len, ==, 2);
+	g_assert_cmpstr (snapd_snap_get_name (g_ptr_array_index (section, 0)), ==, "featured0");
+	g_assert_cmpstr (snapd_snap_get_name (g_ptr_array_index (section, 1)), ==, "featured1");
+
+	gs_utils_rmtree (tmp_root, NULL);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -377,8 +615,19 @@ main (int argc, char **argv)
 	g_assert (ret);
 
 	/* plugin tests go here */
+	g_test_add_func ("/gnome-software/plugins/snap/store-cache-lookup",
+			 gs_snap_store_cache_lookup_func);
+	g_test_add_func ("/gnome-software/plugins/snap/store-cache-evict",
+			 gs_snap_store_cache_evict_func);
+	g_test_add_func ("/gnome-software/plugins/snap/store-cache-expire",
+			 gs_snap_store_cache_expire_func);
+	g_test_add_func ("/gnome-software/plugins/snap/store-cache-save",
+			 gs_snap_store_cache_save_func);
 	g_test_add_data_func ("/gnome-software/plugins/snap/test",
 			      plugin_loader,
 			      (GTestDataFunc) gs_plugins_snap_test_func);
+	g_test_add_data_func ("/gnome-software/plugins/snap/store-cache",
+			      plugin_loader,
+			      (GTestDataFunc) gs_plugins_snap_store_cache_func);
 	return g_test_run ();
 }
@@ -0,0 +1,739 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-snap-store-cache
+ * @short_description: A bounded cache of snaps from the Snap Store
+ *
+ * Keeps the #SnapdSnap objects returned by the store, so repeatedly refining
+ * the same apps or browsing the same sections does not ask the store again.
+ *
+ * Snaps are held in two tiers: summaries, as returned by searches and section
+ * listings, and full details, as returned by looking up a snap by name. Each
+ * tier has a maximum size, with the least recently used snaps evicted first,
+ * and a maximum age after which a snap is fetched again. The snaps listed in
+ * each section are remembered too.
+ *
+ * The cache can be saved to disk and loaded again on the next start, so
+ * browsing doesn't have to wait for the store until the entries expire.
+ *
+ * All methods are thread safe.
+ *
+ * Since: 40
+ */
+
+#include <config.h>
+
+#include "gs-snap-store-cache.h"
+
+/* details carry the channel map, which goes stale sooner than the summary */
+#define SUMMARIES_MAX_ENTRIES	1000
+#define SUMMARIES_MAX_AGE	(6 * G_TIME_SPAN_HOUR)
+#define DETAILS_MAX_ENTRIES	100
+#define DETAILS_MAX_AGE		G_TIME_SPAN_HOUR
+#define SECTIONS_MAX_ENTRIES	50
+#define SECTIONS_MAX_AGE	(6 * G_TIME_SPAN_HOUR)
+
+/* bump this when changing the format of the saved cache */
+#define CACHE_VERSION		1
+#define CACHE_VARIANT_TYPE	"(ua(sxa{sv})a(sxa{sv})a(sxas))"
+
+typedef struct {
+	GList		 link;		/* in Tier.lru, with the entry as data */
+	gchar		*key;
+	gpointer	 data;
+	GDestroyNotify	 data_free;
+	gint64		 fetched;	/* real time, in µs */
+} Entry;
+
+typedef struct {
+	GHashTable	*entries;	/* key : Entry */
+	GQueue		 lru;		/* of Entry, most recently used first */
+	guint		 max_entries;
+	GTimeSpan	 max_age;
+	GDestroyNotify	 data_free;
+} Tier;
+
+struct _GsSnapStoreCache
+{
+	GObject		 parent_instance;
+
+	GMutex		 lock;
+	gchar		*filename;	/* (nullable) */
+	Tier		 summaries;	/* name : SnapdSnap */
+	Tier		 details;	/* name : SnapdSnap */
+	Tier		 sections;	/* section : GStrv of snap names */
+	gboolean	 dirty;
+	guint		 hits;
+	guint		 misses;
+};
+
+G_DEFINE_TYPE (GsSnapStoreCache, gs_snap_store_cache, G_TYPE_OBJECT)
+
+static void
+entry_free (Entry *entry)
+{
+	g_free (entry->key);
+	entry->data_free (entry->data);
+	g_slice_free (Entry, entry);
+}
+
+static void
+tier_init (Tier *tier, guint max_entries, GTimeSpan max_age, GDestroyNotify data_free)
+{
+	tier->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       NULL, (GDestroyNotify) entry_free);
+	g_queue_init (&tier->lru);
+	tier->max_entries = max_entries;
+	tier->max_age = max_age;
+	tier->data_free = data_free;
+}
+
+static void
+tier_clear (Tier *tier)
+{
+	/* the links belong to the entries */
+	g_queue_init (&tier->lru);
+	g_clear_pointer (&tier->entries, g_hash_table_unref);
+}
+
+static void
+tier_remove (Tier *tier, Entry *entry)
+{
+	g_queue_unlink (&tier->lru, &entry->link);
+	g_hash_table_remove (tier->entries, entry->key);
+}
+
+static Entry *
+tier_lookup (Tier *tier, const gchar *key, gint64 now)
+{
+	Entry *entry;
+
+	entry = g_hash_table_lookup (tier->entries, key);
+	if (entry == NULL)
+		return NULL;
+
+	if (now - entry->fetched > tier->max_age) {
+		tier_remove (tier, entry);
+		return NULL;
+	}
+
+	g_queue_unlink (&tier->lru, &entry->link);
+	g_queue_push_head_link (&tier->lru, &entry->link);
+	return entry;
+}
+
+/* takes ownership of @data */
+static void
+tier_insert (Tier *tier, const gchar *key, gpointer data, gint64 fetched)
+{
+	Entry *entry;
+
+	entry = g_hash_table_lookup (tier->entries, key);
+	if (entry != NULL)
+		tier_remove (tier, entry);
+
+	entry = g_slice_new0 (Entry);
+	entry->link.data = entry;
+	entry->key = g_strdup (key);
+	entry->data = data;
+	entry->data_free = tier->data_free;
+	entry->fetched = fetched;
+	g_queue_push_head_link (&tier->lru, &entry->link);
+	g_hash_table_insert (tier->entries, entry->key, entry);
+
+	while (tier->lru.length > tier->max_entries)
+		tier_remove (tier, g_queue_peek_tail (&tier->lru));
+}
+
+/* snapd-glib objects are plain property bags, so they are saved as the
+ * values of their writable properties and created again from those */
+static GVariant *object_to_variant (GObject *object);
+static GObject *object_from_variant (GType type, GVariant *props);
+
+static GVariant *
+value_to_variant (const GValue *value)
+{
+	GType type = G_VALUE_TYPE (value);
+
+	switch (G_TYPE_FUNDAMENTAL (type)) {
+	case G_TYPE_STRING:
+		if (g_value_get_string (value) == NULL)
+			return NULL;
+		return g_variant_new_string (g_value_get_string (value));
+	case G_TYPE_BOOLEAN:
+		return g_variant_new_boolean (g_value_get_boolean (value));
+	case G_TYPE_INT:
+		return g_variant_new_int32 (g_value_get_int (value));
+	case G_TYPE_UINT:
+		return g_variant_new_uint32 (g_value_get_uint (value));
+	case G_TYPE_INT64:
+		return g_variant_new_int64 (g_value_get_int64 (value));
+	case G_TYPE_UINT64:
+		return g_variant_new_uint64 (g_value_get_uint64 (value));
+	case G_TYPE_DOUBLE:
+		return g_variant_new_double (g_value_get_double (value));
+	case G_TYPE_ENUM:
+		return g_variant_new_int32 (g_value_get_enum (value));
+	case G_TYPE_FLAGS:
+		return g_variant_new_uint32 (g_value_get_flags (value));
+	case G_TYPE_BOXED:
+		if (g_value_get_boxed (value) == NULL)
+			return NULL;
+		if (type == G_TYPE_STRV)
+			return g_variant_new_strv (g_value_get_boxed (value), -1);
+		if (type == G_TYPE_DATE_TIME)
+			return g_variant_new_int64 (g_date_time_to_unix (g_value_get_boxed (value)));
+		if (type == G_TYPE_PTR_ARRAY) {
+			GPtrArray *array = g_value_get_boxed (value);
+			GVariantBuilder builder;
+
+			/* all the arrays in snapd-glib objects hold objects */
+			g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sa{sv})"));
+			for (guint i = 0; i < array->len; i++) {
+				GObject *element = g_ptr_array_index (array, i);
+				g_variant_builder_add (&builder, "(s@a{sv})",
+						       G_OBJECT_TYPE_NAME (element),
+						       object_to_variant (element));
+			}
+			return g_variant_builder_end (&builder);
+		}
+		return NULL;
+	default:
+		return NULL;
+	}
+}
+
+static gboolean
+value_from_variant (GValue *value, GVariant *variant)
+{
+	GType type = G_VALUE_TYPE (value);
+
+#define CHECK_TYPE(t) if (!g_variant_is_of_type (variant, (t))) return FALSE
+	switch (G_TYPE_FUNDAMENTAL (type)) {
+	case G_TYPE_STRING:
+		CHECK_TYPE (G_VARIANT_TYPE_STRING);
+		g_value_set_string (value, g_variant_get_string (variant, NULL));
+		return TRUE;
+	case G_TYPE_BOOLEAN:
+		CHECK_TYPE (G_VARIANT_TYPE_BOOLEAN);
+		g_value_set_boolean (value, g_variant_get_boolean (variant));
+		return TRUE;
+	case G_TYPE_INT:
+		CHECK_TYPE (G_VARIANT_TYPE_INT32);
+		g_value_set_int (value, g_variant_get_int32 (variant));
+		return TRUE;
+	case G_TYPE_UINT:
+		CHECK_TYPE (G_VARIANT_TYPE_UINT32);
+		g_value_set_uint (value, g_variant_get_uint32 (variant));
+		return TRUE;
+	case G_TYPE_INT64:
+		CHECK_TYPE (G_VARIANT_TYPE_INT64);
+		g_value_set_int64 (value, g_variant_get_int64 (variant));
+		return TRUE;
+	case G_TYPE_UINT64:
+		CHECK_TYPE (G_VARIANT_TYPE_UINT64);
+		g_value_set_uint64 (value, g_variant_get_uint64 (variant));
+		return TRUE;
+	case G_TYPE_DOUBLE:
+		CHECK_TYPE (G_VARIANT_TYPE_DOUBLE);
+		g_value_set_double (value, g_variant_get_double (variant));
+		return TRUE;
+	case G_TYPE_ENUM:
+		CHECK_TYPE (G_VARIANT_TYPE_INT32);
+		g_value_set_enum (value, g_variant_get_int32 (variant));
+		return TRUE;
+	case G_TYPE_FLAGS:
+		CHECK_TYPE (G_VARIANT_TYPE_UINT32);
+		g_value_set_flags (value, g_variant_get_uint32 (variant));
+		return TRUE;
+	case G_TYPE_BOXED:
+		if (type == G_TYPE_STRV) {
+			CHECK_TYPE (G_VARIANT_TYPE_STRING_ARRAY);
+			g_value_take_boxed (value, g_variant_dup_strv (variant, NULL));
+			return TRUE;
+		}
+		if (type == G_TYPE_DATE_TIME) {
+			CHECK_TYPE (G_VARIANT_TYPE_INT64);
+			g_value_take_boxed (value, g_date_time_new_from_unix_utc (g_variant_get_int64 (variant)));
+			return TRUE;
+		}
+		if (type == G_TYPE_PTR_ARRAY) {
+			GPtrArray *array;
+			GVariantIter iter;
+			const gchar *type_name;
+			GVariant *props;
+
+			CHECK_TYPE (G_VARIANT_TYPE ("a(sa{sv})"));
+			array = g_ptr_array_new_with_free_func (g_object_unref);
+			g_variant_iter_init (&iter, variant);
+			while (g_variant_iter_loop (&iter, "(&s@a{sv})", &type_name, &props)) {
+				GType element_type = g_type_from_name (type_name);
+				if (element_type == 0 ||
+				    !g_type_is_a (element_type, G_TYPE_OBJECT) ||
+				    G_TYPE_IS_ABSTRACT (element_type))
+					continue;
+				g_ptr_array_add (array, object_from_variant (element_type, props));
+			}
+			g_value_take_boxed (value, array);
+			return TRUE;
+		}
+		return FALSE;
+	default:
+		return FALSE;
+	}
+#undef CHECK_TYPE
+}
+
+static GVariant *
+object_to_variant (GObject *object)
+{
+	g_autofree GParamSpec **pspecs = NULL;
+	guint n_pspecs;
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (object), &n_pspecs);
+	for (guint i = 0; i < n_pspecs; i++) {
+		GParamSpec *pspec = pspecs[i];
+		g_auto(GValue) value = G_VALUE_INIT;
+		GVariant *variant;
+
+		if ((pspec->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE ||
+		    (pspec->flags & G_PARAM_DEPRECATED) != 0)
+			continue;
+
+		g_value_init (&value, pspec->value_type);
+		g_object_get_property (object, pspec->name, &value);
+		variant = value_to_variant (&value);
+		if (variant != NULL)
+			g_variant_builder_add (&builder, "{sv}", pspec->name, variant);
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+static GObject *
+object_from_variant (GType type, GVariant *props)
+{
+	g_autoptr(GTypeClass) klass = g_type_class_ref (type);
+	g_autoptr(GPtrArray) names = g_ptr_array_new ();
+	g_autoptr(GArray) values = g_array_new (FALSE, TRUE, sizeof (GValue));
+	GVariantIter iter;
+	const gchar *name;
+	GVariant *variant;
+
+	g_array_set_clear_func (values, (GDestroyNotify) g_value_unset);
+	g_variant_iter_init (&iter, props);
+	while (g_variant_iter_loop (&iter, "{&sv}", &name, &variant)) {
+		GParamSpec *pspec = g_object_class_find_property (G_OBJECT_CLASS (klass), name);
+		GValue value = G_VALUE_INIT;
+
+		if (pspec == NULL || (pspec->flags & G_PARAM_WRITABLE) == 0)
+			continue;
+
+		g_value_init (&value, pspec->value_type);
+		if (!value_from_variant (&value, variant)) {
+			g_value_unset (&value);
+			continue;
+		}
+		g_ptr_array_add (names, (gpointer) pspec->name);
+		g_array_append_val (values, value);
+	}
+
+	return g_object_new_with_properties (type, names->len,
+					     (const gchar **) names->pdata,
+					     (const GValue *) values->data);
+}
+
+static GVariant *
+tier_snaps_to_variant (Tier *tier)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sxa{sv})"));
+	for (GList *l = tier->lru.head; l != NULL; l = l->next) {
+		Entry *entry = l->data;
+		g_variant_builder_add (&builder, "(sx@a{sv})",
+				       entry->key, entry->fetched,
+				       object_to_variant (entry->data));
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+tier_sections_to_variant (Tier *tier)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sxas)"));
+	for (GList *l = tier->lru.head; l != NULL; l = l->next) {
+		Entry *entry = l->data;
+		g_variant_builder_add (&builder, "(sx^as)",
+				       entry->key, entry->fetched, entry->data);
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
+/* entries are saved most recently used first, so add them in reverse to
+ * get the same order back */
+static void
+tier_snaps_from_variant (Tier *tier, GVariant *entries, gint64 now)
+{
+	for (gsize i = g_variant_n_children (entries); i > 0; i--) {
+		const gchar *name;
+		gint64 fetched;
+		g_autoptr(GVariant) props = NULL;
+
+		g_variant_get_child (entries, i - 1, "(&sx@a{sv})", &name, &fetched, &props);
+		if (now - fetched > tier->max_age)
+			continue;
+		tier_insert (tier, name, object_from_variant (SNAPD_TYPE_SNAP, props), fetched);
+	}
+}
+
+static void
+tier_sections_from_variant (Tier *tier, GVariant *entries, gint64 now)
+{
+	for (gsize i = g_variant_n_children (entries); i > 0; i--) {
+		const gchar *section;
+		gint64 fetched;
+		gchar **names = NULL;
+
+		g_variant_get_child (entries, i - 1, "(&sx^as)", &section, &fetched, &names);
+		if (now - fetched > tier->max_age) {
+			g_strfreev (names);
+			continue;
+		}
+		tier_insert (tier, section, names, fetched);
+	}
+}
+
+/**
+ * gs_snap_store_cache_lookup:
+ * @self: a #GsSnapStoreCache
+ * @name: the name of a snap
+ * @need_details: %TRUE if the summary returned by a search is not enough
+ *
+ * Looks up a snap which was fetched from the store recently.
+ *
+ * Returns: (transfer full) (nullable): a #SnapdSnap, or %NULL if not cached
+ *
+ * Since: 40
+ */
+SnapdSnap *
+gs_snap_store_cache_lookup (GsSnapStoreCache *self, const gchar *name, gboolean need_details)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	gint64 now = g_get_real_time ();
+	Entry *entry;
+
+	g_return_val_if_fail (GS_IS_SNAP_STORE_CACHE (self), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	locker = g_mutex_locker_new (&self->lock);
+	entry = tier_lookup (&self->details, name, now);
+	if (entry == NULL && !need_details)
+		entry = tier_lookup (&self->summaries, name, now);
+	if (entry == NULL) {
+		self->misses++;
+		return NULL;
+	}
+
+	self->hits++;
+	return g_object_ref (entry->data);
+}
+
+static void
+gs_snap_store_cache_add_locked (GsSnapStoreCache *self, GPtrArray *snaps, gboolean full_details, gint64 now)
+{
+	Tier *tier = full_details ? &self->details : &self->summaries;
+
+	for (guint i = 0; i < snaps->len; i++) {
+		SnapdSnap *snap = g_ptr_array_index (snaps, i);
+		tier_insert (tier, snapd_snap_get_name (snap), g_object_ref (snap), now);
+	}
+	self->dirty = TRUE;
+}
+
+/**
+ * gs_snap_store_cache_add:
+ * @self: a #GsSnapStoreCache
+ * @snaps: (element-type SnapdSnap): snaps fetched from the store
+ * @full_details: %TRUE if the snaps came from looking up a snap by name
+ *
+ * Adds snaps to the cache, replacing any older copies.
+ *
+ * Since: 40
+ */
+void
+gs_snap_store_cache_add (GsSnapStoreCache *self, GPtrArray *snaps, gboolean full_details)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_SNAP_STORE_CACHE (self));
+	g_return_if_fail (snaps != NULL);
+
+	locker = g_mutex_locker_new (&self->lock);
+	gs_snap_store_cache_add_locked (self, snaps, full_details, g_get_real_time ());
+}
+
+/**
+ * gs_snap_store_cache_lookup_section:
+ * @self: a #GsSnapStoreCache
+ * @section: the name of a store section
+ *
+ * Looks up the snaps listed in a section recently. If any of them have
+ * since been dropped from the cache, the whole section is treated as
+ * not cached.
+ *
+ * Returns: (transfer container) (element-type SnapdSnap) (nullable): the
+ *   snaps in the section, or %NULL if not cached
+ *
+ * Since: 40
+ */
+GPtrArray *
+gs_snap_store_cache_lookup_section (GsSnapStoreCache *self, const gchar *section)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GPtrArray) snaps = NULL;
+	gint64 now = g_get_real_time ();
+	Entry *entry;
+	gchar **names;
+
+	g_return_val_if_fail (GS_IS_SNAP_STORE_CACHE (self), NULL);
+	g_return_val_if_fail (section != NULL, NULL);
+
+	locker = g_mutex_locker_new (&self->lock);
+	entry = tier_lookup (&self->sections, section, now);
+	if (entry == NULL) {
+		self->misses++;
+		return NULL;
+	}
+
+	names = entry->data;
+	snaps = g_ptr_array_new_full (g_strv_length (names), g_object_unref);
+	for (guint i = 0; names[i] != NULL; i++) {
+		Entry *snap_entry = tier_lookup (&self->summaries, names[i], now);
+		if (snap_entry == NULL)
+			snap_entry = tier_lookup (&self->details, names[i], now);
+		if (snap_entry == NULL) {
+			self->misses++;
+			return NULL;
+		}
+		g_ptr_array_add (snaps, g_object_ref (snap_entry->data));
+	}
+
+	self->hits++;
+	return g_steal_pointer (&snaps);
+}
+
+/**
+ * gs_snap_store_cache_add_section:
+ * @self: a #GsSnapStoreCache
+ * @section: the name of a store section
+ * @snaps: (element-type SnapdSnap): the snaps listed in @section
+ *
+ * Adds the snaps listed in a section to the cache, and remembers which
+ * snaps they were.
+ *
+ * Since: 40
+ */
+void
+gs_snap_store_cache_add_section (GsSnapStoreCache *self, const gchar *section, GPtrArray *snaps)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	gint64 now = g_get_real_time ();
+	gchar **names;
+
+	g_return_if_fail (GS_IS_SNAP_STORE_CACHE (self));
+	g_return_if_fail (section != NULL);
+	g_return_if_fail (snaps != NULL);
+
+	names = g_new0 (gchar *, snaps->len + 1);
+	for (guint i = 0; i < snaps->len; i++)
+		names[i] = g_strdup (snapd_snap_get_name (g_ptr_array_index (snaps, i)));
+
+	locker = g_mutex_locker_new (&self->lock);
+	gs_snap_store_cache_add_locked (self, snaps, FALSE, now);
+	tier_insert (&self->sections, section, names, now);
+}
+
+/**
+ * gs_snap_store_cache_load:
+ * @self: a #GsSnapStoreCache
+ * @error: a #GError, or %NULL
+ *
+ * Loads the entries saved by gs_snap_store_cache_save(), apart from those
+ * which have expired since.
+ *
+ * Returns: %TRUE for success, or if the cache is not saved to disk
+ *
+ * Since: 40
+ */
+gboolean
+gs_snap_store_cache_load (GsSnapStoreCache *self, GError **error)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autofree gchar *contents = NULL;
+	gsize length;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	g_autoptr(GVariant) summaries = NULL;
+	g_autoptr(GVariant) details = NULL;
+	g_autoptr(GVariant) sections = NULL;
+	guint32 version;
+	gint64 now = g_get_real_time ();
+
+	g_return_val_if_fail (GS_IS_SNAP_STORE_CACHE (self), FALSE);
+
+	if (self->filename == NULL)
+		return TRUE;
+
+	if (!g_file_get_contents (self->filename, &contents, &length, error))
+		return FALSE;
+	bytes = g_bytes_new_take (g_steal_pointer (&contents), length);
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_VARIANT_TYPE),
+								bytes, FALSE));
+	g_variant_get (variant, "(u@a(sxa{sv})@a(sxa{sv})@a(sxas))",
+		       &version, &summaries, &details, &sections);
+	if (version != CACHE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "Unsupported snap store cache version %u", version);
+		return FALSE;
+	}
+
+	locker = g_mutex_locker_new (&self->lock);
+	tier_snaps_from_variant (&self->summaries, summaries, now);
+	tier_snaps_from_variant (&self->details, details, now);
+	tier_sections_from_variant (&self->sections, sections, now);
+	return TRUE;
+}
+
+/**
+ * gs_snap_store_cache_save:
+ * @self: a #GsSnapStoreCache
+ * @error: a #GError, or %NULL
+ *
+ * Saves the cache to disk, if anything was added since it was last saved.
+ *
+ * Returns: %TRUE for success, or if the cache is not saved to disk
+ *
+ * Since: 40
+ */
+gboolean
+gs_snap_store_cache_save (GsSnapStoreCache *self, GError **error)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GVariant) variant = NULL;
+
+	g_return_val_if_fail (GS_IS_SNAP_STORE_CACHE (self), FALSE);
+
+	if (self->filename == NULL)
+		return TRUE;
+
+	locker = g_mutex_locker_new (&self->lock);
+	if (!self->dirty)
+		return TRUE;
+	variant = g_variant_ref_sink (g_variant_new ("(u@a(sxa{sv})@a(sxa{sv})@a(sxas))",
+						     (guint32) CACHE_VERSION,
+						     tier_snaps_to_variant (&self->summaries),
+						     tier_snaps_to_variant (&self->details),
+						     tier_sections_to_variant (&self->sections)));
+	self->dirty = FALSE;
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	return g_file_set_contents (self->filename,
+				    g_variant_get_data (variant),
+				    g_variant_get_size (variant),
+				    error);
+}
+
+/**
+ * gs_snap_store_cache_get_stats:
+ * @self: a #GsSnapStoreCache
+ * @hits: (out) (optional): return location for the number of lookups
+ *   answered from the cache
+ * @misses: (out) (optional): return location for the number of lookups
+ *   which were not
+ *
+ * Gets how well the cache has been doing since it was created.
+ *
+ * Since: 40
+ */
+void
+gs_snap_store_cache_get_stats (GsSnapStoreCache *self, guint *hits, guint *misses)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (GS_IS_SNAP_STORE_CACHE (self));
+
+	locker = g_mutex_locker_new (&self->lock);
+	if (hits != NULL)
+		*hits = self->hits;
+	if (misses != NULL)
+		*misses = self->misses;
+}
+
+static void
+gs_snap_store_cache_finalize (GObject *object)
+{
+	GsSnapStoreCache *self = GS_SNAP_STORE_CACHE (object);
+
+	tier_clear (&self->summaries);
+	tier_clear (&self->details);
+	tier_clear (&self->sections);
+	g_free (self->filename);
+	g_mutex_clear (&self->lock);
+
+	G_OBJECT_CLASS (gs_snap_store_cache_parent_class)->finalize (object);
+}
+
+static void
+gs_snap_store_cache_class_init (GsSnapStoreCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = gs_snap_store_cache_finalize;
+
+	/* the types held in arrays are looked up by name when loading */
+	g_type_ensure (SNAPD_TYPE_APP);
+	g_type_ensure (SNAPD_TYPE_CHANNEL);
+	g_type_ensure (SNAPD_TYPE_MEDIA);
+	g_type_ensure (SNAPD_TYPE_PRICE);
+}
+
+static void
+gs_snap_store_cache_init (GsSnapStoreCache *self)
+{
+	g_mutex_init (&self->lock);
+	tier_init (&self->summaries, SUMMARIES_MAX_ENTRIES, SUMMARIES_MAX_AGE, g_object_unref);
+	tier_init (&self->details, DETAILS_MAX_ENTRIES, DETAILS_MAX_AGE, g_object_unref);
+	tier_init (&self->sections, SECTIONS_MAX_ENTRIES, SECTIONS_MAX_AGE, (GDestroyNotify) g_strfreev);
+}
+
+/**
+ * gs_snap_store_cache_new:
+ * @filename: (nullable): where to save the cache, or %NULL to keep it
+ *   in memory only
+ *
+ * Creates a new, empty cache.
+ *
+ * Returns: (transfer full): a #GsSnapStoreCache
+ *
+ * Since: 40
+ */
+GsSnapStoreCache *
+gs_snap_store_cache_new (const gchar *filename)
+{
+	GsSnapStoreCache *self = g_object_new (GS_TYPE_SNAP_STORE_CACHE, NULL);
+	self->filename = g_strdup (filename);
+	return self;
+}
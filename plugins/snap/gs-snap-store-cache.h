@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <snapd-glib/snapd-glib.h>
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_SNAP_STORE_CACHE (gs_snap_store_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsSnapStoreCache, gs_snap_store_cache, GS, SNAP_STORE_CACHE, GObject)
+
+GsSnapStoreCache *gs_snap_store_cache_new		(const gchar		 *filename);
+
+SnapdSnap	*gs_snap_store_cache_lookup		(GsSnapStoreCache	 *self,
+							 const gchar		 *name,
+							 gboolean		  need_details);
+void		 gs_snap_store_cache_add		(GsSnapStoreCache	 *self,
+							 GPtrArray		 *snaps,
+							 gboolean		  full_details);
+GPtrArray	*gs_snap_store_cache_lookup_section	(GsSnapStoreCache	 *self,
+							 const gchar		 *section);
+void		 gs_snap_store_cache_add_section	(GsSnapStoreCache	 *self,
+							 const gchar		 *section,
+							 GPtrArray		 *snaps);
+
+gboolean	 gs_snap_store_cache_load		(GsSnapStoreCache	 *self,
+							 GError			**error);
+gboolean	 gs_snap_store_cache_save		(GsSnapStoreCache	 *self,
+							 GError			**error);
+
+void		 gs_snap_store_cache_get_stats		(GsSnapStoreCache	 *self,
+							 guint			 *hits,
+							 guint			 *misses);
+
+G_END_DECLS
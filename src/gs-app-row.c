@@ -393,7 +393,7 @@ gs_app_row_actually_refresh (GsAppRow *app_row)
 					 gtk_image_get_pixel_size (GTK_IMAGE (priv->image)),
 					 gtk_widget_get_scale_factor (priv->image),
 					 "application-x-executable");
-	gtk_image_set_from_gicon (GTK_IMAGE (priv->image), icon, GTK_ICON_SIZE_DIALOG);
+	gs_image_set_from_icon (GTK_IMAGE (priv->image), icon, GTK_ICON_SIZE_DIALOG);
 
 	context = gtk_widget_get_style_context (priv->image);
 	if (missing_search_result)
@@ -848,6 +848,19 @@ gs_app_row_set_show_update (GsAppRow *app_row, gboolean show_update)
 	gs_app_row_schedule_refresh (app_row);
 }
 
+/**
+ * gs_app_row_refresh:
+ *
+ * Redraw the row from the app, for properties of the app which change
+ * without a notification, such as its size
+ **/
+void
+gs_app_row_refresh (GsAppRow *app_row)
+{
+	g_return_if_fail (GS_IS_APP_ROW (app_row));
+	gs_app_row_schedule_refresh (app_row);
+}
+
 GtkWidget *
 gs_app_row_new (GsApp *app)
 {
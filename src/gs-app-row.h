@@ -28,6 +28,7 @@ struct _GsAppRowClass
 
 GtkWidget	*gs_app_row_new				(GsApp		*app);
 void		 gs_app_row_unreveal			(GsAppRow	*app_row);
+void		 gs_app_row_refresh			(GsAppRow	*app_row);
 void		 gs_app_row_set_colorful		(GsAppRow	*app_row,
 							 gboolean	 colorful);
 void		 gs_app_row_set_show_buttons		(GsAppRow	*app_row,
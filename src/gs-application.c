@@ -37,6 +37,7 @@
 #include "gs-update-monitor.h"
 #include "gs-shell-search-provider.h"
 #include "gs-folders.h"
+#include "gs-screenshot-cache.h"
 
 #define ENABLE_REPOS_DIALOG_CONF_KEY "enable-repos-dialog"
 
@@ -264,6 +265,8 @@ gs_application_shell_loaded_cb (GsShell *shell, GsApplication *app)
 {
 	g_signal_handler_disconnect (app->shell, app->shell_loaded_handler_id);
 	app->shell_loaded_handler_id = 0;
+
+	gs_trace_add_instant ("startup", "shell-loaded", NULL);
 }
 
 static void
@@ -999,6 +1002,7 @@ gs_application_startup (GApplication *application)
 {
 	GSettings *settings;
 	GsApplication *app = GS_APPLICATION (application);
+	gint64 trace_begin_time = g_get_monotonic_time ();
 	G_APPLICATION_CLASS (gs_application_parent_class)->startup (application);
 
 	hdy_init ();
@@ -1027,6 +1031,18 @@ gs_application_startup (GApplication *application)
 	gs_folders_convert ();
 
 	gs_application_update_software_sources_presence (application);
+
+	gs_trace_add_span (trace_begin_time, "startup", "gs_application_startup", NULL);
+}
+
+static void
+gs_application_shutdown (GApplication *application)
+{
+	/* the screenshot cache lives until exit and is never disposed, so
+	 * write the index if a save is still waiting on its timer */
+	gs_screenshot_cache_flush_default ();
+
+	G_APPLICATION_CLASS (gs_application_parent_class)->shutdown (application);
 }
 
 static void
@@ -1248,6 +1264,7 @@ gs_application_class_init (GsApplicationClass *klass)
 
 	application_class->startup = gs_application_startup;
 	application_class->activate = gs_application_activate;
+	application_class->shutdown = gs_application_shutdown;
 	application_class->handle_local_options = gs_application_handle_local_options;
 	application_class->open = gs_application_open;
 	application_class->dbus_register = gs_application_dbus_register;
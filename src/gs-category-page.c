@@ -154,10 +154,11 @@ gs_category_page_get_apps_cb (GObject *source_object,
 	g_signal_handler_unblock (self->sort_name_button, self->sort_name_handler_id);
 }
 
-static gboolean
-_max_results_sort_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+_max_results_sort_key_cb (GsApp *app, gpointer user_data)
 {
-	return gs_app_get_rating (app1) < gs_app_get_rating (app2);
+	/* best rated first */
+	return g_strdup_printf ("%03i", 100 - gs_app_get_rating (app));
 }
 
 static gint
@@ -336,7 +337,7 @@ gs_category_page_reload (GsPage *page)
 					 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
 							 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
 					 NULL);
-	gs_plugin_job_set_sort_func (plugin_job, _max_results_sort_cb);
+	gs_plugin_job_set_sort_key_func (plugin_job, _max_results_sort_key_cb);
 	gs_plugin_loader_job_process_async (self->plugin_loader,
 					    plugin_job,
 					    self->cancellable,
@@ -322,6 +322,80 @@ gs_image_set_from_pixbuf_with_scale (GtkImage *image, const GdkPixbuf *pixbuf, g
 	cairo_surface_destroy (surface);
 }
 
+/* Surfaces which are shown by at least one image, keyed by icon, size and
+ * scale. Each image would otherwise get its own copy of the pixels, as
+ * gtk_image_set_from_surface() needs a surface rather than the shared
+ * pixbuf. An entry removes itself when the last image drops its surface.
+ * Only used from the main thread. */
+static GHashTable *icon_surfaces = NULL;	/* (owned) key : (unowned) cairo_surface_t */
+static const cairo_user_data_key_t icon_surface_key;
+
+static void
+gs_image_icon_surface_destroy_cb (gpointer data)
+{
+	const gchar *key = data;
+	g_hash_table_remove (icon_surfaces, key);
+}
+
+/**
+ * gs_image_set_from_icon:
+ * @image: a #GtkImage
+ * @icon: a #GIcon
+ * @icon_size: the #GtkIconSize to use if falling back to the icon theme
+ *
+ * Sets @image to show @icon at the pixel size of @image, sharing the
+ * decoded surface with other images showing the same icon at the same size.
+ * Icons which are not backed by a file, such as themed icons, are loaded
+ * through the icon theme as gtk_image_set_from_gicon() would.
+ **/
+void
+gs_image_set_from_icon (GtkImage *image, GIcon *icon, GtkIconSize icon_size)
+{
+	gint pixel_size = gtk_image_get_pixel_size (image);
+	gint scale = gtk_widget_get_scale_factor (GTK_WIDGET (image));
+	cairo_surface_t *surface;
+	gchar *key;
+	g_autofree gchar *icon_str = NULL;
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
+	g_autoptr(GError) error = NULL;
+
+	if (pixel_size <= 0 || !G_IS_FILE_ICON (icon)) {
+		gtk_image_set_from_gicon (image, icon, icon_size);
+		return;
+	}
+
+	/* already shown by another image */
+	if (icon_surfaces == NULL)
+		icon_surfaces = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	icon_str = g_icon_to_string (icon);
+	key = g_strdup_printf ("%i@%i:%s", pixel_size, scale, icon_str);
+	surface = g_hash_table_lookup (icon_surfaces, key);
+	if (surface != NULL) {
+		g_free (key);
+		gtk_image_set_from_surface (image, surface);
+		return;
+	}
+
+	pixbuf = gs_icon_load_pixbuf (icon, (guint) pixel_size, (guint) scale, &error);
+	if (pixbuf == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED))
+			g_debug ("failed to load icon: %s", error->message);
+		g_free (key);
+		gtk_image_set_from_gicon (image, icon, icon_size);
+		return;
+	}
+	surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
+	if (surface == NULL) {
+		g_free (key);
+		return;
+	}
+	g_hash_table_insert (icon_surfaces, key, surface);
+	cairo_surface_set_user_data (surface, &icon_surface_key, key,
+				     gs_image_icon_surface_destroy_cb);
+	gtk_image_set_from_surface (image, surface);
+	cairo_surface_destroy (surface);
+}
+
 gboolean
 gs_utils_is_current_desktop (const gchar *name)
 {
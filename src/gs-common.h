@@ -29,6 +29,9 @@ GtkResponseType
 void	gs_image_set_from_pixbuf_with_scale	(GtkImage		*image,
 						 const GdkPixbuf	*pixbuf,
 						 gint			 scale);
+void	gs_image_set_from_icon			(GtkImage		*image,
+						 GIcon			*icon,
+						 GtkIconSize		 icon_size);
 
 gboolean	 gs_utils_is_current_desktop	(const gchar	*name);
 gchar		*gs_utils_set_key_colors_in_css	(const gchar	*css,
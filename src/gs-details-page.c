@@ -25,6 +25,7 @@
 #include "gs-history-dialog.h"
 #include "gs-origin-popover-row.h"
 #include "gs-screenshot-image.h"
+#include "gs-screenshot-loader.h"
 #include "gs-star-widget.h"
 #include "gs-review-histogram.h"
 #include "gs-review-dialog.h"
@@ -53,6 +54,7 @@ struct _GsDetailsPage
 	GsApp			*app_local_file;
 	GsShell			*shell;
 	SoupSession		*session;
+	GsScreenshotLoader	*screenshot_loader;
 	gboolean		 enable_reviews;
 	gboolean		 show_all_reviews;
 	GSettings		*settings;
@@ -552,6 +554,21 @@ gs_details_page_load_main_screenshot (GsDetailsPage *self,
 	gs_screenshot_image_load_async (ssmain, NULL);
 }
 
+/* screenshots closest to the selected one are loaded first */
+static void
+gs_details_page_prioritize_screenshots (GsDetailsPage *self,
+					GtkListBox *list,
+					gint selected)
+{
+	GtkListBoxRow *row;
+
+	for (gint i = 0; (row = gtk_list_box_get_row_at_index (list, i)) != NULL; i++) {
+		GsScreenshotImage *ssthumb = GS_SCREENSHOT_IMAGE (gtk_bin_get_child (GTK_BIN (row)));
+		gs_screenshot_loader_set_priority (self->screenshot_loader, ssthumb,
+						   1 + (guint) ABS (i - selected));
+	}
+}
+
 static void
 gs_details_page_screenshot_selected_cb (GtkListBox *list,
                                         GtkListBoxRow *row,
@@ -567,6 +584,8 @@ gs_details_page_screenshot_selected_cb (GtkListBox *list,
 	ss = gs_screenshot_image_get_screenshot (ssthumb);
 
 	gs_details_page_load_main_screenshot (self, ss);
+	gs_details_page_prioritize_screenshots (self, list,
+						gtk_list_box_row_get_index (row));
 }
 
 static void
@@ -585,6 +604,9 @@ gs_details_page_refresh_screenshots (GsDetailsPage *self)
 	/* reset the visibility of screenshots */
 	gtk_widget_show (self->box_details_screenshot);
 
+	/* stop loading the screenshots of the previous app */
+	gs_screenshot_loader_clear (self->screenshot_loader);
+
 	/* treat screenshots differently */
 	if (gs_app_get_kind (self->app) == AS_COMPONENT_KIND_FONT) {
 		gs_container_remove_all (GTK_CONTAINER (self->box_details_screenshot_thumbnails));
@@ -609,7 +631,8 @@ gs_details_page_refresh_screenshots (GsDetailsPage *self)
 			gs_screenshot_image_set_size (GS_SCREENSHOT_IMAGE (ssimg),
 						      640,
 						      48);
-			gs_screenshot_image_load_async (GS_SCREENSHOT_IMAGE (ssimg), NULL);
+			gs_screenshot_loader_add (self->screenshot_loader,
+						  GS_SCREENSHOT_IMAGE (ssimg), i);
 			gtk_container_add (GTK_CONTAINER (self->box_details_screenshot_main), ssimg);
 			gtk_widget_set_visible (ssimg, TRUE);
 		}
@@ -665,7 +688,14 @@ gs_details_page_refresh_screenshots (GsDetailsPage *self)
 						      AS_IMAGE_NORMAL_HEIGHT);
 			gtk_style_context_add_class (gtk_widget_get_style_context (ssmain),
 						     "screenshot-image-main");
-			gs_screenshot_image_load_async (GS_SCREENSHOT_IMAGE (ssmain), NULL);
+
+			/* the visible screenshot goes first; when offline
+			 * every load is from the cache and so is immediate */
+			if (is_offline)
+				gs_screenshot_image_load_async (GS_SCREENSHOT_IMAGE (ssmain), NULL);
+			else
+				gs_screenshot_loader_add (self->screenshot_loader,
+							  GS_SCREENSHOT_IMAGE (ssmain), 0);
 
 			/* when we're offline, the load will be immediate, so we
 			 * can check if it succeeded, and just skip it and its
@@ -690,7 +720,9 @@ gs_details_page_refresh_screenshots (GsDetailsPage *self)
 					      AS_IMAGE_THUMBNAIL_HEIGHT);
 		gtk_style_context_add_class (gtk_widget_get_style_context (ssimg),
 					     "screenshot-image-thumb");
-		gs_screenshot_image_load_async (GS_SCREENSHOT_IMAGE (ssimg), NULL);
+		gs_screenshot_loader_add (self->screenshot_loader,
+					  GS_SCREENSHOT_IMAGE (ssimg),
+					  1 + num_screenshots_loaded);
 		gtk_list_box_insert (GTK_LIST_BOX (list), ssimg, -1);
 		gtk_widget_set_visible (ssimg, TRUE);
 		++num_screenshots_loaded;
@@ -2958,6 +2990,7 @@ gs_details_page_dispose (GObject *object)
 	g_clear_object (&self->cancellable);
 	g_clear_object (&self->app_cancellable);
 	g_clear_object (&self->session);
+	g_clear_object (&self->screenshot_loader);
 	g_clear_object (&self->size_group_origin_popover);
 	g_clear_object (&self->button_details_rating_style_provider);
 
@@ -3096,6 +3129,7 @@ gs_details_page_init (GsDetailsPage *self)
 	/* setup networking */
 	self->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, gs_user_agent (),
 	                                               NULL);
+	self->screenshot_loader = gs_screenshot_loader_new ();
 	self->settings = g_settings_new ("org.gnome.software");
 	g_signal_connect_swapped (self->settings, "changed",
 				  G_CALLBACK (settings_changed_cb),
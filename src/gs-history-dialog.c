@@ -28,16 +28,12 @@ struct _GsHistoryDialog
 
 G_DEFINE_TYPE (GsHistoryDialog, gs_history_dialog, GTK_TYPE_DIALOG)
 
-static gint
-history_sort_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+history_sort_key_cb (GsApp *app, gpointer user_data)
 {
-	guint64 timestamp_a = gs_app_get_install_date (app1);
-	guint64 timestamp_b = gs_app_get_install_date (app2);
-	if (timestamp_a < timestamp_b)
-		return 1;
-	if (timestamp_a > timestamp_b)
-		return -1;
-	return 0;
+	/* newest first */
+	return g_strdup_printf ("%016" G_GINT64_MODIFIER "x",
+				G_MAXUINT64 - gs_app_get_install_date (app));
 }
 
 void
@@ -54,7 +50,7 @@ gs_history_dialog_set_app (GsHistoryDialog *dialog, GsApp *app)
 	/* add each history package to the dialog */
 	gs_container_remove_all (GTK_CONTAINER (dialog->list_box));
 	history = gs_app_get_history (app);
-	gs_app_list_sort (history, history_sort_cb, NULL);
+	gs_app_list_sort_by_key (history, history_sort_key_cb, NULL);
 	for (i = 0; i < gs_app_list_length (history); i++) {
 		g_autoptr(GDateTime) datetime = NULL;
 		g_autofree gchar *date_str = NULL;
@@ -17,8 +17,13 @@
 #include "gs-installed-page.h"
 #include "gs-common.h"
 #include "gs-app-row.h"
+#include "gs-size-service.h"
 #include "gs-utils.h"
 
+/* rows are built this many at a time in an idle, so the first ones can be
+ * shown without waiting for all of them */
+#define GS_INSTALLED_PAGE_ROWS_PER_BATCH	50
+
 struct _GsInstalledPage
 {
 	GsPage			 parent_instance;
@@ -34,6 +39,11 @@ struct _GsInstalledPage
 	GsShell			*shell;
 	GSettings		*settings;
 	guint			 pending_apps_counter;
+	GsAppList		*rows_to_add;		/* (owned) (nullable) */
+	guint			 rows_to_add_idx;
+	guint			 add_rows_id;
+	GsSizeService		*size_service;
+	guint			 request_sizes_id;
 
 	GtkWidget		*list_box_install;
 	GtkWidget		*scrolledwindow_install;
@@ -56,6 +66,7 @@ typedef enum {
 
 static void gs_installed_page_pending_apps_changed_cb (GsPluginLoader *plugin_loader,
                                                        GsInstalledPage *self);
+static gchar *gs_installed_page_get_app_sort_key (GsApp *app);
 
 static void
 gs_installed_page_invalidate (GsInstalledPage *self)
@@ -138,19 +149,41 @@ gs_installed_page_invalidate_sort_idle (gpointer user_data)
 	return G_SOURCE_REMOVE;
 }
 
+static gboolean
+should_show_installed_size (GsInstalledPage *self)
+{
+	return g_settings_get_boolean (self->settings,
+				       "installed-page-show-size");
+}
+
 static void
 gs_installed_page_notify_state_changed_cb (GsApp *app,
                                            GParamSpec *pspec,
                                            GsAppRow *app_row)
 {
-	g_idle_add (gs_installed_page_invalidate_sort_idle, g_object_ref (app_row));
-}
+	GtkWidget *page = gtk_widget_get_ancestor (GTK_WIDGET (app_row), GS_TYPE_INSTALLED_PAGE);
+	GsAppState state = gs_app_get_state (app);
+	GsAppState state_old;
+
+	state_old = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (app_row), "GnomeSoftware::State"));
+	g_object_set_data (G_OBJECT (app_row), "GnomeSoftware::State", GUINT_TO_POINTER (state));
+
+	/* finishing an install, update or removal changes the size, but the
+	 * app flipping between installed and updatable does not */
+	if (page != NULL &&
+	    (state_old == GS_APP_STATE_INSTALLING || state_old == GS_APP_STATE_REMOVING) &&
+	    state != GS_APP_STATE_INSTALLING && state != GS_APP_STATE_REMOVING) {
+		GsInstalledPage *self = GS_INSTALLED_PAGE (page);
+
+		gs_size_service_invalidate (self->size_service, app);
+		if (gs_app_is_installed (app) &&
+		    !gs_app_has_quirk (app, GS_APP_QUIRK_COMPULSORY) &&
+		    should_show_installed_size (self) &&
+		    gs_size_service_request (self->size_service, app, TRUE))
+			gs_app_row_refresh (app_row);
+	}
 
-static gboolean
-should_show_installed_size (GsInstalledPage *self)
-{
-	return g_settings_get_boolean (self->settings,
-				       "installed-page-show-size");
+	g_idle_add (gs_installed_page_invalidate_sort_idle, g_object_ref (app_row));
 }
 
 static gboolean
@@ -169,16 +202,24 @@ static void
 gs_installed_page_add_app (GsInstalledPage *self, GsAppList *list, GsApp *app)
 {
 	GtkWidget *app_row;
+	gboolean show_installed_size;
 
+	show_installed_size = !gs_app_has_quirk (app, GS_APP_QUIRK_COMPULSORY) && should_show_installed_size (self);
 	app_row = g_object_new (GS_TYPE_APP_ROW,
 				"app", app,
 				"show-buttons", TRUE,
 				"show-source", gs_utils_list_has_component_fuzzy (list, app),
-				"show-installed-size", !gs_app_has_quirk (app, GS_APP_QUIRK_COMPULSORY) && should_show_installed_size (self),
+				"show-installed-size", show_installed_size,
 				NULL);
 
+	/* set from the cache, or worked out in the background */
+	if (show_installed_size)
+		gs_size_service_request (self->size_service, app, FALSE);
+
 	g_signal_connect (app_row, "button-clicked",
 			  G_CALLBACK (gs_installed_page_app_remove_cb), self);
+	g_object_set_data (G_OBJECT (app_row), "GnomeSoftware::State",
+			   GUINT_TO_POINTER (gs_app_get_state (app)));
 	g_signal_connect_object (app, "notify::state",
 				 G_CALLBACK (gs_installed_page_notify_state_changed_cb),
 				 app_row, 0);
@@ -193,13 +234,123 @@ gs_installed_page_add_app (GsInstalledPage *self, GsAppList *list, GsApp *app)
 	gtk_widget_set_visible (app_row, gs_installed_page_is_actual_app (app));
 }
 
+static void
+gs_installed_page_sizes_changed_cb (GsSizeService *size_service,
+                                    GsAppList *list,
+                                    GsInstalledPage *self)
+{
+	g_autoptr(GHashTable) changed = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_autoptr(GList) children = NULL;
+
+	/* the sizes change without any notification */
+	for (guint i = 0; i < gs_app_list_length (list); i++)
+		g_hash_table_add (changed, gs_app_list_index (list, i));
+	children = gtk_container_get_children (GTK_CONTAINER (self->list_box_install));
+	for (GList *l = children; l != NULL; l = l->next) {
+		GsAppRow *app_row = GS_APP_ROW (l->data);
+		if (g_hash_table_contains (changed, gs_app_row_get_app (app_row)))
+			gs_app_row_refresh (app_row);
+	}
+}
+
+/* move the rows which are scrolled into view to the front of the queue for
+ * working out installed sizes */
+static gboolean
+gs_installed_page_request_sizes_idle_cb (gpointer user_data)
+{
+	GsInstalledPage *self = GS_INSTALLED_PAGE (user_data);
+	GtkListBox *list_box = GTK_LIST_BOX (self->list_box_install);
+	GtkListBoxRow *row;
+	gint list_box_x, list_box_y;
+	gint top, bottom;
+
+	self->request_sizes_id = 0;
+
+	/* the part of the list box which is visible, in its own coordinates */
+	if (!gtk_widget_translate_coordinates (self->list_box_install,
+					       self->scrolledwindow_install,
+					       0, 0, &list_box_x, &list_box_y))
+		return G_SOURCE_REMOVE;
+	top = MAX (-list_box_y, 0);
+	bottom = -list_box_y + gtk_widget_get_allocated_height (self->scrolledwindow_install);
+
+	for (row = gtk_list_box_get_row_at_y (list_box, top);
+	     row != NULL;
+	     row = gtk_list_box_get_row_at_index (list_box, gtk_list_box_row_get_index (row) + 1)) {
+		GtkAllocation allocation;
+
+		if (!gtk_widget_get_visible (GTK_WIDGET (row)))
+			continue;
+		gtk_widget_get_allocation (GTK_WIDGET (row), &allocation);
+		if (allocation.y > bottom)
+			break;
+		if (gs_size_service_request (self->size_service,
+					     gs_app_row_get_app (GS_APP_ROW (row)),
+					     TRUE))
+			gs_app_row_refresh (GS_APP_ROW (row));
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_installed_page_queue_request_sizes (GsInstalledPage *self)
+{
+	if (self->request_sizes_id != 0 || !should_show_installed_size (self))
+		return;
+	self->request_sizes_id = g_idle_add (gs_installed_page_request_sizes_idle_cb, self);
+}
+
+static void
+gs_installed_page_vadjustment_changed_cb (GtkAdjustment *adjustment,
+                                          GsInstalledPage *self)
+{
+	gs_installed_page_queue_request_sizes (self);
+}
+
+static gboolean
+gs_installed_page_add_rows_idle_cb (gpointer user_data)
+{
+	GsInstalledPage *self = GS_INSTALLED_PAGE (user_data);
+	guint len = gs_app_list_length (self->rows_to_add);
+	guint end = MIN (self->rows_to_add_idx + GS_INSTALLED_PAGE_ROWS_PER_BATCH, len);
+
+	for (; self->rows_to_add_idx < end; self->rows_to_add_idx++) {
+		GsApp *app = gs_app_list_index (self->rows_to_add, self->rows_to_add_idx);
+		gs_installed_page_add_app (self, self->rows_to_add, app);
+	}
+	gs_installed_page_queue_request_sizes (self);
+	if (self->rows_to_add_idx < len)
+		return G_SOURCE_CONTINUE;
+
+	/* all done */
+	self->add_rows_id = 0;
+	g_clear_object (&self->rows_to_add);
+	gs_installed_page_pending_apps_changed_cb (self->plugin_loader, self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_installed_page_cancel_add_rows (GsInstalledPage *self)
+{
+	g_clear_handle_id (&self->add_rows_id, g_source_remove);
+	g_clear_handle_id (&self->request_sizes_id, g_source_remove);
+	g_clear_object (&self->rows_to_add);
+	self->rows_to_add_idx = 0;
+	if (self->size_service != NULL)
+		gs_size_service_cancel (self->size_service);
+}
+
+static gchar *
+gs_installed_page_get_app_sort_key_cb (GsApp *app, gpointer user_data)
+{
+	return gs_installed_page_get_app_sort_key (app);
+}
+
 static void
 gs_installed_page_get_installed_cb (GObject *source_object,
                                     GAsyncResult *res,
                                     gpointer user_data)
 {
-	guint i;
-	GsApp *app;
 	GsInstalledPage *self = GS_INSTALLED_PAGE (user_data);
 	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
 	g_autoptr(GError) error = NULL;
@@ -219,10 +370,14 @@ gs_installed_page_get_installed_cb (GObject *source_object,
 			g_warning ("failed to get installed apps: %s", error->message);
 		goto out;
 	}
-	for (i = 0; i < gs_app_list_length (list); i++) {
-		app = gs_app_list_index (list, i);
-		gs_installed_page_add_app (self, list, app);
-	}
+
+	/* build the rows in the order they are shown, so the ones at the top
+	 * appear first */
+	gs_app_list_sort_by_key (list, gs_installed_page_get_app_sort_key_cb, NULL);
+	self->rows_to_add = g_steal_pointer (&list);
+	self->rows_to_add_idx = 0;
+	self->add_rows_id = g_idle_add (gs_installed_page_add_rows_idle_cb, self);
+	return;
 out:
 	gs_installed_page_pending_apps_changed_cb (plugin_loader, self);
 }
@@ -238,22 +393,19 @@ gs_installed_page_load (GsInstalledPage *self)
 	self->waiting = TRUE;
 
 	/* remove old entries */
+	gs_installed_page_cancel_add_rows (self);
 	gs_container_remove_all (GTK_CONTAINER (self->list_box_install));
 
+	/* only what the rows need to be sorted and drawn; the description
+	 * decides whether the row is shown at all, and the installed size is
+	 * worked out in the background by the size service */
 	flags = GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON |
 		GS_PLUGIN_REFINE_FLAGS_REQUIRE_HISTORY |
 		GS_PLUGIN_REFINE_FLAGS_REQUIRE_SETUP_ACTION |
 		GS_PLUGIN_REFINE_FLAGS_REQUIRE_VERSION |
-		GS_PLUGIN_REFINE_FLAGS_REQUIRE_PERMISSIONS |
 		GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_HOSTNAME |
 		GS_PLUGIN_REFINE_FLAGS_REQUIRE_PROVENANCE |
-		GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION |
-		GS_PLUGIN_REFINE_FLAGS_REQUIRE_LICENSE |
-		GS_PLUGIN_REFINE_FLAGS_REQUIRE_CATEGORIES |
-		GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING;
-
-	if (should_show_installed_size (self))
-		flags |= GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE;
+		GS_PLUGIN_REFINE_FLAGS_REQUIRE_DESCRIPTION;
 
 	/* get installed apps */
 	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_INSTALLED,
@@ -519,6 +671,14 @@ gs_installed_page_has_app (GsInstalledPage *self,
 	gboolean ret = FALSE;
 	g_autoptr(GList) children = NULL;
 
+	/* rows which are still to be built */
+	for (guint i = self->rows_to_add_idx;
+	     self->rows_to_add != NULL && i < gs_app_list_length (self->rows_to_add);
+	     i++) {
+		if (gs_app_list_index (self->rows_to_add, i) == app)
+			return TRUE;
+	}
+
 	children = gtk_container_get_children (GTK_CONTAINER (self->list_box_install));
 	for (GList *l = children; l; l = l->next) {
 		GsAppRow *app_row = GS_APP_ROW (l->data);
@@ -572,6 +732,7 @@ gs_installed_page_setup (GsPage *page,
                          GError **error)
 {
 	GsInstalledPage *self = GS_INSTALLED_PAGE (page);
+	GtkAdjustment *adj;
 
 	g_return_val_if_fail (GS_IS_INSTALLED_PAGE (self), TRUE);
 
@@ -583,6 +744,11 @@ gs_installed_page_setup (GsPage *page,
 
 	self->cancellable = g_object_ref (cancellable);
 
+	self->size_service = gs_size_service_new (plugin_loader);
+	g_signal_connect_object (self->size_service, "sizes-changed",
+				 G_CALLBACK (gs_installed_page_sizes_changed_cb),
+				 self, 0);
+
 	/* setup installed */
 	g_signal_connect (self->list_box_install, "row-activated",
 			  G_CALLBACK (gs_installed_page_app_row_activated_cb), self);
@@ -592,6 +758,15 @@ gs_installed_page_setup (GsPage *page,
 	gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box_install),
 				    gs_installed_page_sort_func,
 				    self, NULL);
+
+	/* get the sizes of the rows scrolled into view first */
+	adj = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (self->scrolledwindow_install));
+	g_signal_connect_object (adj, "value-changed",
+				 G_CALLBACK (gs_installed_page_vadjustment_changed_cb),
+				 self, 0);
+	g_signal_connect_object (adj, "changed",
+				 G_CALLBACK (gs_installed_page_vadjustment_changed_cb),
+				 self, 0);
 	return TRUE;
 }
 
@@ -663,6 +838,11 @@ gs_installed_page_dispose (GObject *object)
 {
 	GsInstalledPage *self = GS_INSTALLED_PAGE (object);
 
+	g_clear_handle_id (&self->add_rows_id, g_source_remove);
+	g_clear_handle_id (&self->request_sizes_id, g_source_remove);
+	g_clear_object (&self->rows_to_add);
+	g_clear_object (&self->size_service);
+
 	g_clear_object (&self->sizegroup_image);
 	g_clear_object (&self->sizegroup_name);
 	g_clear_object (&self->sizegroup_desc);
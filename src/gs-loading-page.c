@@ -24,6 +24,7 @@ typedef struct {
 	GtkWidget		*progressbar;
 	GtkWidget		*label;
 	guint			 progress_pulse_id;
+	gint64			 load_begin_time;
 } GsLoadingPagePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (GsLoadingPage, gs_loading_page, GS_TYPE_PAGE)
@@ -107,6 +108,8 @@ gs_loading_page_refresh_cb (GObject *source_object, GAsyncResult *res, gpointer
 		priv->progress_pulse_id = 0;
 	}
 
+	gs_trace_add_span (priv->load_begin_time, "startup", "loading-page", NULL);
+
 	/* UI is good to go */
 	g_signal_emit (self, signals[SIGNAL_REFRESHED], 0);
 }
@@ -136,6 +139,7 @@ gs_loading_page_load (GsLoadingPage *self)
 	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFRESH,
 					 "age", cache_age,
 					 NULL);
+	priv->load_begin_time = g_get_monotonic_time ();
 	gs_plugin_loader_job_process_async (priv->plugin_loader, plugin_job,
 					priv->cancellable,
 					gs_loading_page_refresh_cb,
@@ -19,11 +19,13 @@
 
 #include "gs-application.h"
 #include "gs-debug.h"
+#include "gs-trace.h"
 
 int
 main (int argc, char **argv)
 {
 	int status = 0;
+	g_autoptr(GError) error = NULL;
 	g_autoptr(GDesktopAppInfo) appinfo = NULL;
 	g_autoptr(GsApplication) application = NULL;
 	g_autoptr(GsDebug) debug = gs_debug_new_from_environment ();
@@ -47,5 +49,10 @@ main (int argc, char **argv)
 	appinfo = g_desktop_app_info_new ("org.gnome.Software.desktop");
 	g_set_application_name (g_app_info_get_name (G_APP_INFO (appinfo)));
 	status = g_application_run (G_APPLICATION (application), argc, argv);
+
+	/* save everything recorded since the overview was first painted */
+	if (!gs_trace_write (&error))
+		g_warning ("failed to write startup trace: %s", error->message);
+
 	return status;
 }
@@ -12,6 +12,7 @@
 #include <glib/gi18n.h>
 #include <handy.h>
 #include <math.h>
+#include <string.h>
 
 #include "gs-shell.h"
 #include "gs-overview-page.h"
@@ -21,8 +22,10 @@
 #include "gs-category-tile.h"
 #include "gs-hiding-box.h"
 #include "gs-common.h"
+#include "gs-overview-snapshot.h"
 
 #define N_TILES					9
+#define SNAPSHOT_SAVE_DELAY			2 /* seconds */
 
 struct _GsOverviewPage
 {
@@ -43,6 +46,9 @@ struct _GsOverviewPage
 	GHashTable		*category_hash;		/* id : GsCategory */
 	GSettings		*settings;
 	GsApp			*third_party_repo;
+	GsOverviewSnapshot	*snapshot;
+	gboolean		 has_snapshot;
+	guint			 snapshot_save_id;
 
 	GtkWidget		*infobar_third_party;
 	GtkWidget		*label_third_party;
@@ -79,7 +85,15 @@ enum {
 
 static guint signals [SIGNAL_LAST] = { 0 };
 
+typedef enum {
+	GS_OVERVIEW_PAGE_SECTION_FEATURED,
+	GS_OVERVIEW_PAGE_SECTION_POPULAR,
+	GS_OVERVIEW_PAGE_SECTION_RECENT,
+	GS_OVERVIEW_PAGE_SECTION_CATEGORY,
+} GsOverviewPageSection;
+
 typedef struct {
+        GsOverviewPageSection section;
         GsCategory	*category;
         GsOverviewPage	*self;
         const gchar	*title;
@@ -129,6 +143,34 @@ filter_category (GsApp *app, gpointer user_data)
 	return !gs_app_has_category (app, category);
 }
 
+/* saves the trace on each first paint, as there is no later point at which
+ * startup is known to be over */
+static gboolean
+gs_overview_page_trace_draw_cb (GtkWidget *widget, cairo_t *cr, gpointer user_data)
+{
+	const gchar *name = user_data;
+	g_autoptr(GError) error_local = NULL;
+
+	g_signal_handlers_disconnect_by_func (widget, gs_overview_page_trace_draw_cb, user_data);
+	gs_trace_add_instant ("overview", name, NULL);
+	if (!gs_trace_write (&error_local))
+		g_warning ("failed to write startup trace: %s", error_local->message);
+	return FALSE;
+}
+
+/* records when @widget is first drawn after being filled in */
+static void
+gs_overview_page_trace_first_paint (GtkWidget *widget, const gchar *name)
+{
+	if (!gs_trace_is_enabled ())
+		return;
+	if (g_object_get_data (G_OBJECT (widget), "GnomeSoftware::TraceFirstPaint") != NULL)
+		return;
+	g_object_set_data (G_OBJECT (widget), "GnomeSoftware::TraceFirstPaint", GINT_TO_POINTER (TRUE));
+	g_signal_connect_after (widget, "draw",
+				G_CALLBACK (gs_overview_page_trace_draw_cb), (gpointer) name);
+}
+
 static void
 gs_overview_page_decrement_action_cnt (GsOverviewPage *self)
 {
@@ -151,26 +193,22 @@ gs_overview_page_decrement_action_cnt (GsOverviewPage *self)
 }
 
 static void
-gs_overview_page_get_popular_cb (GObject *source_object,
-                                 GAsyncResult *res,
-                                 gpointer user_data)
+gs_overview_page_set_popular (GsOverviewPage *self, GsAppList *list, const GError *error)
 {
-	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
 	guint i;
 	GsApp *app;
 	GtkWidget *tile;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GsAppList) list = NULL;
 
 	/* get popular apps */
-	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
 	if (list == NULL) {
 		if (!g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED))
 			g_warning ("failed to get popular apps: %s", error->message);
 		goto out;
 	}
 
+	/* Don't show apps from the category that's currently featured as the category of the day */
+	gs_app_list_filter (list, filter_category, self->category_of_day);
+
 	/* not enough to show */
 	if (gs_app_list_length (list) < N_TILES) {
 		g_warning ("Only %u apps for popular list, hiding",
@@ -180,8 +218,6 @@ gs_overview_page_get_popular_cb (GObject *source_object,
 		goto out;
 	}
 
-	/* Don't show apps from the category that's currently featured as the category of the day */
-	gs_app_list_filter (list, filter_category, self->category_of_day);
 	gs_app_list_randomize (list);
 
 	gs_container_remove_all (GTK_CONTAINER (self->box_popular));
@@ -195,6 +231,7 @@ gs_overview_page_get_popular_cb (GObject *source_object,
 	}
 	gtk_widget_set_visible (self->box_popular, TRUE);
 	gtk_widget_set_visible (self->popular_heading, TRUE);
+	gs_overview_page_trace_first_paint (self->box_popular, "first-paint:popular");
 
 	self->empty = FALSE;
 
@@ -203,24 +240,22 @@ out:
 }
 
 static void
-gs_overview_page_get_recent_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+gs_overview_page_set_recent (GsOverviewPage *self, GsAppList *list, const GError *error)
 {
-	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
 	guint i;
 	GsApp *app;
 	GtkWidget *tile;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GsAppList) list = NULL;
 
 	/* get recent apps */
-	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
 	if (list == NULL) {
 		if (!g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED))
 			g_warning ("failed to get recent apps: %s", error->message);
 		goto out;
 	}
 
+	/* Don't show apps from the category that's currently featured as the category of the day */
+	gs_app_list_filter (list, filter_category, self->category_of_day);
+
 	/* not enough to show */
 	if (gs_app_list_length (list) < N_TILES) {
 		g_warning ("Only %u apps for recent list, hiding",
@@ -230,8 +265,6 @@ gs_overview_page_get_recent_cb (GObject *source_object, GAsyncResult *res, gpoin
 		goto out;
 	}
 
-	/* Don't show apps from the category that's currently featured as the category of the day */
-	gs_app_list_filter (list, filter_category, self->category_of_day);
 	gs_app_list_randomize (list);
 
 	gs_container_remove_all (GTK_CONTAINER (self->box_recent));
@@ -245,6 +278,7 @@ gs_overview_page_get_recent_cb (GObject *source_object, GAsyncResult *res, gpoin
 	}
 	gtk_widget_set_visible (self->box_recent, TRUE);
 	gtk_widget_set_visible (self->recent_heading, TRUE);
+	gs_overview_page_trace_first_paint (self->box_recent, "first-paint:recent");
 
 	self->empty = FALSE;
 
@@ -268,13 +302,9 @@ gs_overview_page_category_more_cb (GtkButton *button, GsOverviewPage *self)
 }
 
 static void
-gs_overview_page_get_category_apps_cb (GObject *source_object,
-                                       GAsyncResult *res,
-                                       gpointer user_data)
+gs_overview_page_set_category_apps (LoadData *load_data, GsAppList *list, const GError *error)
 {
-	LoadData *load_data = (LoadData *) user_data;
 	GsOverviewPage *self = load_data->self;
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
 	guint i;
 	GsApp *app;
 	GtkWidget *box;
@@ -282,11 +312,8 @@ gs_overview_page_get_category_apps_cb (GObject *source_object,
 	GtkWidget *headerbox;
 	GtkWidget *label;
 	GtkWidget *tile;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GsAppList) list = NULL;
 
 	/* get popular apps */
-	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
 	if (list == NULL) {
 		if (g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED))
 			goto out;
@@ -348,11 +375,11 @@ gs_overview_page_get_category_apps_cb (GObject *source_object,
 			  G_CALLBACK (app_tile_clicked), self);
 		gtk_container_add (GTK_CONTAINER (box), tile);
 	}
+	gs_overview_page_trace_first_paint (self->box_popular_rotating, "first-paint:category-apps");
 
 	self->empty = FALSE;
 
 out:
-	load_data_free (load_data);
 	gs_overview_page_decrement_action_cnt (self);
 }
 
@@ -373,16 +400,8 @@ filter_hi_res_icon (GsApp *app, gpointer user_data)
 }
 
 static void
-gs_overview_page_get_featured_cb (GObject *source_object,
-                                  GAsyncResult *res,
-                                  gpointer user_data)
+gs_overview_page_set_featured (GsOverviewPage *self, GsAppList *list, const GError *error)
 {
-	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
-	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GsAppList) list = NULL;
-
-	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
 	if (g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED))
 		goto out;
 
@@ -405,6 +424,7 @@ gs_overview_page_get_featured_cb (GObject *source_object,
 
 	gtk_widget_set_visible (self->featured_carousel, gs_app_list_length (list) > 0);
 	gs_featured_carousel_set_apps (GS_FEATURED_CAROUSEL (self->featured_carousel), list);
+	gs_overview_page_trace_first_paint (self->featured_carousel, "first-paint:featured");
 
 	self->empty = self->empty && (gs_app_list_length (list) == 0);
 
@@ -412,6 +432,166 @@ out:
 	gs_overview_page_decrement_action_cnt (self);
 }
 
+static gchar *
+load_data_get_section_id (LoadData *load_data)
+{
+	switch (load_data->section) {
+	case GS_OVERVIEW_PAGE_SECTION_FEATURED:
+		return g_strdup ("featured");
+	case GS_OVERVIEW_PAGE_SECTION_POPULAR:
+		return g_strdup ("popular");
+	case GS_OVERVIEW_PAGE_SECTION_RECENT:
+		return g_strdup ("recent");
+	case GS_OVERVIEW_PAGE_SECTION_CATEGORY:
+		return g_strdup_printf ("category:%s", gs_category_get_id (load_data->category));
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+static void
+gs_overview_page_save_snapshot_cb (GObject *source_object,
+				   GAsyncResult *res,
+				   gpointer user_data)
+{
+	GsOverviewSnapshot *snapshot = GS_OVERVIEW_SNAPSHOT (source_object);
+	g_autoptr(GError) error_local = NULL;
+
+	if (!gs_overview_snapshot_save_finish (snapshot, res, &error_local))
+		g_warning ("failed to save overview snapshot: %s", error_local->message);
+}
+
+static gboolean
+gs_overview_page_save_snapshot_timeout_cb (gpointer user_data)
+{
+	GsOverviewPage *self = GS_OVERVIEW_PAGE (user_data);
+	self->snapshot_save_id = 0;
+	gs_overview_snapshot_save_async (self->snapshot, NULL,
+					 gs_overview_page_save_snapshot_cb, NULL);
+	return G_SOURCE_REMOVE;
+}
+
+/* whether the section was shown, rather than hidden as failed or too short */
+static gboolean
+load_data_was_shown (LoadData *load_data, GsAppList *list)
+{
+	if (load_data->section == GS_OVERVIEW_PAGE_SECTION_FEATURED)
+		return gs_app_list_length (list) > 0;
+	return gs_app_list_length (list) >= N_TILES;
+}
+
+/* remember what was shown, so that the next start can show it straight away */
+static void
+gs_overview_page_save_snapshot (GsOverviewPage *self, GPtrArray *sections, GPtrArray *lists)
+{
+	if (self->snapshot == NULL)
+		self->snapshot = gs_overview_snapshot_new ();
+
+	/* the rotating categories replace all the previous ones, as long as
+	 * there is at least one to replace them with */
+	for (guint i = 0; i < sections->len; i++) {
+		LoadData *load_data = g_ptr_array_index (sections, i);
+		GsAppList *list = g_ptr_array_index (lists, i);
+		if (load_data->section == GS_OVERVIEW_PAGE_SECTION_CATEGORY &&
+		    load_data_was_shown (load_data, list)) {
+			g_autoptr(GPtrArray) section_ids = gs_overview_snapshot_get_section_ids (self->snapshot);
+			for (guint j = 0; j < section_ids->len; j++) {
+				const gchar *section_id = g_ptr_array_index (section_ids, j);
+				if (g_str_has_prefix (section_id, "category:"))
+					gs_overview_snapshot_remove (self->snapshot, section_id);
+			}
+			break;
+		}
+	}
+
+	for (guint i = 0; i < sections->len; i++) {
+		LoadData *load_data = g_ptr_array_index (sections, i);
+		GsAppList *list = g_ptr_array_index (lists, i);
+		g_autofree gchar *section_id = NULL;
+
+		/* keep what was saved last time rather than an empty section */
+		if (!load_data_was_shown (load_data, list))
+			continue;
+
+		/* the carousel shows every app, the other sections a row of
+		 * tiles; only the carousel uses the key colors */
+		section_id = load_data_get_section_id (load_data);
+		if (load_data->section == GS_OVERVIEW_PAGE_SECTION_FEATURED) {
+			gs_overview_snapshot_set_apps (self->snapshot, section_id, list, TRUE);
+		} else {
+			gs_app_list_truncate (list, N_TILES);
+			gs_overview_snapshot_set_apps (self->snapshot, section_id, list, FALSE);
+		}
+	}
+
+	/* the sections are reloaded several times as the plugins settle, so
+	 * only write the last of them */
+	if (self->snapshot_save_id != 0)
+		g_source_remove (self->snapshot_save_id);
+	self->snapshot_save_id = g_timeout_add_seconds (SNAPSHOT_SAVE_DELAY,
+							gs_overview_page_save_snapshot_timeout_cb,
+							self);
+}
+
+static void
+gs_overview_page_load_sections_cb (GObject *source_object,
+                                   GAsyncResult *res,
+                                   gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
+	g_autoptr(GPtrArray) sections = user_data;
+	g_autoptr(GPtrArray) lists = NULL;
+	g_autoptr(GError) error = NULL;
+
+	lists = gs_plugin_loader_job_process_many_finish (plugin_loader, res, &error);
+
+	/* replace the previous categories, which may have come from the
+	 * snapshot, only once there is something to replace them with */
+	for (guint i = 0; i < sections->len; i++) {
+		LoadData *load_data = g_ptr_array_index (sections, i);
+		if (load_data->section == GS_OVERVIEW_PAGE_SECTION_CATEGORY) {
+			gs_container_remove_all (GTK_CONTAINER (load_data->self->box_popular_rotating));
+			break;
+		}
+	}
+
+	for (guint i = 0; i < sections->len; i++) {
+		LoadData *load_data = g_ptr_array_index (sections, i);
+		GsAppList *list = (lists != NULL) ? g_ptr_array_index (lists, i) : NULL;
+
+		switch (load_data->section) {
+		case GS_OVERVIEW_PAGE_SECTION_FEATURED:
+			gs_overview_page_set_featured (load_data->self, list, error);
+			break;
+		case GS_OVERVIEW_PAGE_SECTION_POPULAR:
+			gs_overview_page_set_popular (load_data->self, list, error);
+			break;
+		case GS_OVERVIEW_PAGE_SECTION_RECENT:
+			gs_overview_page_set_recent (load_data->self, list, error);
+			break;
+		case GS_OVERVIEW_PAGE_SECTION_CATEGORY:
+			gs_overview_page_set_category_apps (load_data, list, error);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+
+	if (lists != NULL && sections->len > 0) {
+		LoadData *load_data = g_ptr_array_index (sections, 0);
+		gs_overview_page_save_snapshot (load_data->self, sections, lists);
+	}
+}
+
+static LoadData *
+load_data_new (GsOverviewPage *self, GsOverviewPageSection section)
+{
+	LoadData *load_data = g_slice_new0 (LoadData);
+	load_data->section = section;
+	load_data->self = g_object_ref (self);
+	return load_data;
+}
+
 static void
 category_tile_clicked (GsCategoryTile *tile, gpointer data)
 {
@@ -465,8 +645,10 @@ gs_overview_page_get_categories_cb (GObject *source_object,
 	}
 
 out:
-	if (added_cnt > 0)
+	if (added_cnt > 0) {
 		self->empty = FALSE;
+		gs_overview_page_trace_first_paint (self->flowbox_categories, "first-paint:categories");
+	}
 	gtk_widget_set_visible (self->category_heading, added_cnt > 0);
 
 	gs_overview_page_decrement_action_cnt (self);
@@ -623,65 +805,51 @@ static void
 gs_overview_page_load (GsOverviewPage *self)
 {
 	guint i;
+	g_autoptr(GPtrArray) plugin_jobs = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(GPtrArray) sections = g_ptr_array_new_with_free_func ((GDestroyNotify) load_data_free);
 
 	self->empty = TRUE;
 
+	/* all the app sections are fetched as one batch, so that apps are
+	 * only refined once however many sections they are in */
 	if (!self->loading_featured) {
-		g_autoptr(GsPluginJob) plugin_job = NULL;
-
 		self->loading_featured = TRUE;
-		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_FEATURED,
-						 "max-results", 5,
-						 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
-						 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
-								 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
-						 NULL);
-		gs_plugin_loader_job_process_async (self->plugin_loader,
-						    plugin_job,
-						    self->cancellable,
-						    gs_overview_page_get_featured_cb,
-						    self);
-		self->action_cnt++;
+		g_ptr_array_add (plugin_jobs,
+				 gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_FEATURED,
+						     "max-results", 5,
+						     "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+						     "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+								     GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+						     NULL));
+		g_ptr_array_add (sections, load_data_new (self, GS_OVERVIEW_PAGE_SECTION_FEATURED));
 	}
 
 	if (!self->loading_popular) {
-		g_autoptr(GsPluginJob) plugin_job = NULL;
-
 		self->loading_popular = TRUE;
-		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_POPULAR,
-						 "max-results", 20,
-						 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
-								 GS_PLUGIN_REFINE_FLAGS_REQUIRE_CATEGORIES |
-								 GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
-						 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
-								 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
-						 NULL);
-		gs_plugin_loader_job_process_async (self->plugin_loader,
-						    plugin_job,
-						    self->cancellable,
-						    gs_overview_page_get_popular_cb,
-						    self);
-		self->action_cnt++;
+		g_ptr_array_add (plugin_jobs,
+				 gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_POPULAR,
+						     "max-results", 20,
+						     "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
+								     GS_PLUGIN_REFINE_FLAGS_REQUIRE_CATEGORIES |
+								     GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+						     "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+								     GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+						     NULL));
+		g_ptr_array_add (sections, load_data_new (self, GS_OVERVIEW_PAGE_SECTION_POPULAR));
 	}
 
 	if (!self->loading_recent) {
-		g_autoptr(GsPluginJob) plugin_job = NULL;
-
 		self->loading_recent = TRUE;
-		plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_RECENT,
-						 "age", (guint64) (60 * 60 * 24 * 60),
-						 "max-results", 20,
-						 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
-								 GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
-						 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
-								 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
-						 NULL);
-		gs_plugin_loader_job_process_async (self->plugin_loader,
-						    plugin_job,
-						    self->cancellable,
-						    gs_overview_page_get_recent_cb,
-						    self);
-		self->action_cnt++;
+		g_ptr_array_add (plugin_jobs,
+				 gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_RECENT,
+						     "age", (guint64) (60 * 60 * 24 * 60),
+						     "max-results", 20,
+						     "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
+								     GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+						     "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+								     GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+						     NULL));
+		g_ptr_array_add (sections, load_data_new (self, GS_OVERVIEW_PAGE_SECTION_RECENT));
 	}
 
 	if (!self->loading_popular_rotating) {
@@ -689,16 +857,12 @@ gs_overview_page_load (GsOverviewPage *self)
 		g_autoptr(GPtrArray) cats_random = NULL;
 		cats_random = gs_overview_page_get_random_categories ();
 
-		/* remove existing widgets, if any */
-		gs_container_remove_all (GTK_CONTAINER (self->box_popular_rotating));
-
 		/* load all the categories */
 		for (i = 0; i < cats_random->len && i < MAX_CATS; i++) {
 			LoadData *load_data;
 			const gchar *cat_id;
 			g_autoptr(GsCategory) category = NULL;
 			GsCategory *featured_category = NULL;
-			g_autoptr(GsPluginJob) plugin_job = NULL;
 
 			cat_id = g_ptr_array_index (cats_random, i);
 			if (i == 0) {
@@ -708,28 +872,33 @@ gs_overview_page_load (GsOverviewPage *self)
 			category = gs_category_manager_lookup (gs_plugin_loader_get_category_manager (self->plugin_loader), cat_id);
 			featured_category = gs_category_find_child (category, "featured");
 
-			load_data = g_slice_new0 (LoadData);
+			load_data = load_data_new (self, GS_OVERVIEW_PAGE_SECTION_CATEGORY);
 			load_data->category = g_steal_pointer (&category);
-			load_data->self = g_object_ref (self);
 			load_data->title = gs_overview_page_get_category_label (cat_id);
-			plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_CATEGORY_APPS,
-							 "max-results", 20,
-							 "category", featured_category,
-							 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
-									 GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
-							 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
-									 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
-							 NULL);
-			gs_plugin_loader_job_process_async (self->plugin_loader,
-							    plugin_job,
-							    self->cancellable,
-							    gs_overview_page_get_category_apps_cb,
-							    load_data);
-			self->action_cnt++;
+			g_ptr_array_add (plugin_jobs,
+					 gs_plugin_job_newv (GS_PLUGIN_ACTION_GET_CATEGORY_APPS,
+							     "max-results", 20,
+							     "category", featured_category,
+							     "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_RATING |
+									     GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON,
+							     "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
+									     GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
+							     NULL));
+			g_ptr_array_add (sections, load_data);
 		}
 		self->loading_popular_rotating = TRUE;
 	}
 
+	if (plugin_jobs->len > 0) {
+		/* every section decrements this when it is shown */
+		self->action_cnt += sections->len;
+		gs_plugin_loader_job_process_many_async (self->plugin_loader,
+							 plugin_jobs,
+							 self->cancellable,
+							 gs_overview_page_load_sections_cb,
+							 g_steal_pointer (&sections));
+	}
+
 	if (!self->loading_categories) {
 		g_autoptr(GsPluginJob) plugin_job = NULL;
 		self->loading_categories = TRUE;
@@ -792,6 +961,62 @@ third_party_response_cb (GtkInfoBar *info_bar,
 	refresh_third_party_repo (self);
 }
 
+/* show the sections from the last run while the live ones are loaded */
+static void
+gs_overview_page_paint_snapshot (GsOverviewPage *self)
+{
+	GsCategoryManager *category_manager = gs_plugin_loader_get_category_manager (self->plugin_loader);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) section_ids = NULL;
+
+	self->snapshot = gs_overview_snapshot_load (&error_local);
+	if (self->snapshot == NULL) {
+		g_debug ("not showing overview snapshot: %s", error_local->message);
+		return;
+	}
+
+	/* the setters each decrement this, so only emit ::refreshed once */
+	self->empty = TRUE;
+	self->action_cnt++;
+
+	section_ids = gs_overview_snapshot_get_section_ids (self->snapshot);
+	for (guint i = 0; i < section_ids->len; i++) {
+		const gchar *section_id = g_ptr_array_index (section_ids, i);
+		g_autoptr(GsAppList) list = gs_overview_snapshot_get_apps (self->snapshot, section_id);
+
+		if (g_strcmp0 (section_id, "featured") == 0) {
+			self->action_cnt++;
+			gs_overview_page_set_featured (self, list, NULL);
+		} else if (g_strcmp0 (section_id, "popular") == 0) {
+			self->action_cnt++;
+			gs_overview_page_set_popular (self, list, NULL);
+		} else if (g_strcmp0 (section_id, "recent") == 0) {
+			self->action_cnt++;
+			gs_overview_page_set_recent (self, list, NULL);
+		} else if (g_str_has_prefix (section_id, "category:")) {
+			const gchar *cat_id = section_id + strlen ("category:");
+			LoadData *load_data;
+			g_autoptr(GsCategory) category = NULL;
+
+			category = gs_category_manager_lookup (category_manager, cat_id);
+			if (category == NULL)
+				continue;
+			load_data = load_data_new (self, GS_OVERVIEW_PAGE_SECTION_CATEGORY);
+			load_data->category = g_steal_pointer (&category);
+			load_data->title = gs_overview_page_get_category_label (cat_id);
+			self->action_cnt++;
+			gs_overview_page_set_category_apps (load_data, list, NULL);
+			load_data_free (load_data);
+		}
+	}
+
+	gs_overview_page_decrement_action_cnt (self);
+	self->has_snapshot = !self->empty;
+
+	/* the live sections still need loading */
+	self->cache_valid = FALSE;
+}
+
 static gboolean
 gs_overview_page_setup (GsPage *page,
                         GsShell *shell,
@@ -851,6 +1076,8 @@ gs_overview_page_setup (GsPage *page,
 		gtk_container_add (GTK_CONTAINER (self->box_recent), tile);
 	}
 
+	gs_overview_page_paint_snapshot (self);
+
 	return TRUE;
 }
 
@@ -946,6 +1173,18 @@ gs_overview_page_dispose (GObject *object)
 	g_clear_object (&self->cancellable);
 	g_clear_object (&self->settings);
 	g_clear_object (&self->third_party_repo);
+
+	/* the page goes away as the app quits, which would not wait for a
+	 * worker thread, so write any pending snapshot now */
+	if (self->snapshot_save_id != 0) {
+		g_autoptr(GError) error_local = NULL;
+
+		g_source_remove (self->snapshot_save_id);
+		self->snapshot_save_id = 0;
+		if (!gs_overview_snapshot_save (self->snapshot, &error_local))
+			g_warning ("failed to save overview snapshot: %s", error_local->message);
+	}
+	g_clear_object (&self->snapshot);
 	g_clear_pointer (&self->category_of_day, g_free);
 	g_clear_pointer (&self->category_hash, g_hash_table_unref);
 
@@ -1008,3 +1247,19 @@ gs_overview_page_new (void)
 {
 	return GS_OVERVIEW_PAGE (g_object_new (GS_TYPE_OVERVIEW_PAGE, NULL));
 }
+
+/**
+ * gs_overview_page_has_snapshot:
+ * @self: a #GsOverviewPage
+ *
+ * Gets whether the page was able to show the sections saved by a previous
+ * run, so that it can be shown before the live sections have loaded.
+ *
+ * Returns: %TRUE if the page is showing something
+ */
+gboolean
+gs_overview_page_has_snapshot (GsOverviewPage *self)
+{
+	g_return_val_if_fail (GS_IS_OVERVIEW_PAGE (self), FALSE);
+	return self->has_snapshot;
+}
@@ -0,0 +1,640 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-overview-snapshot
+ * @short_description: A cache of what the overview page last showed
+ *
+ * A #GsOverviewSnapshot records the apps shown in each section of the
+ * overview page, with just enough of each app to draw its tile: the unique
+ * ID, name, summary, rating, icons and key colors.
+ *
+ * The overview page saves a snapshot whenever it has loaded its sections and
+ * paints from the saved snapshot when it is created, so something is shown
+ * straight away while the live results are still being queried.
+ *
+ * The snapshot is tied to the GUIDs of the plugins’ compiled metadata silos,
+ * and gs_overview_snapshot_load() fails if any of them have changed since it
+ * was saved.
+ *
+ * The file is a serialised #GVariant of type
+ * `(sa(sa(usssia(suu)a(dddd))))`, containing the combined silo GUIDs and
+ * the list of sections, each with its ID and apps.
+ *
+ * Since: 40
+ */
+
+#include "config.h"
+
+#include <gdk/gdk.h>
+#include <xmlb.h>
+
+#include "gs-overview-snapshot.h"
+
+#define GS_OVERVIEW_SNAPSHOT_VARIANT_TYPE	"(sa(sa(usssia(suu)a(dddd))))"
+#define GS_OVERVIEW_SNAPSHOT_APP_TYPE		"(usssia(suu)a(dddd))"
+
+typedef struct {
+	gchar		*id;
+	GVariant	*apps;		/* (owned), of type a GS_OVERVIEW_SNAPSHOT_APP_TYPE */
+} GsOverviewSnapshotSection;
+
+struct _GsOverviewSnapshot
+{
+	GObject		 parent_instance;
+
+	GPtrArray	*sections;	/* (element-type GsOverviewSnapshotSection) */
+};
+
+G_DEFINE_TYPE (GsOverviewSnapshot, gs_overview_snapshot, G_TYPE_OBJECT)
+
+static void
+gs_overview_snapshot_section_free (GsOverviewSnapshotSection *section)
+{
+	g_free (section->id);
+	g_variant_unref (section->apps);
+	g_free (section);
+}
+
+static void
+gs_overview_snapshot_finalize (GObject *object)
+{
+	GsOverviewSnapshot *self = GS_OVERVIEW_SNAPSHOT (object);
+
+	g_ptr_array_unref (self->sections);
+
+	G_OBJECT_CLASS (gs_overview_snapshot_parent_class)->finalize (object);
+}
+
+static void
+gs_overview_snapshot_class_init (GsOverviewSnapshotClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gs_overview_snapshot_finalize;
+}
+
+static void
+gs_overview_snapshot_init (GsOverviewSnapshot *self)
+{
+	self->sections = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_overview_snapshot_section_free);
+}
+
+/**
+ * gs_overview_snapshot_new:
+ *
+ * Creates a new, empty snapshot.
+ *
+ * Returns: (transfer full): a #GsOverviewSnapshot
+ *
+ * Since: 40
+ **/
+GsOverviewSnapshot *
+gs_overview_snapshot_new (void)
+{
+	return g_object_new (GS_TYPE_OVERVIEW_SNAPSHOT, NULL);
+}
+
+static gchar *
+gs_overview_snapshot_get_filename (GsUtilsCacheFlags flags, GError **error)
+{
+	return gs_utils_get_cache_filename ("overview", "snapshot", flags, error);
+}
+
+static void
+gs_overview_snapshot_add_silo_guid (GString *str, const gchar *kind)
+{
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(XbSilo) silo = xb_silo_new ();
+
+	filename = gs_utils_get_cache_filename (kind, "components.xmlb",
+						GS_UTILS_CACHE_FLAG_NONE, NULL);
+	if (filename == NULL || !g_file_test (filename, G_FILE_TEST_EXISTS))
+		return;
+
+	/* this only maps the file and reads the header */
+	file = g_file_new_for_path (filename);
+	if (!xb_silo_load_from_file (silo, file, XB_SILO_LOAD_FLAG_NONE, NULL, NULL))
+		return;
+	g_string_append_printf (str, "%s=%s;", kind, xb_silo_get_guid (silo));
+}
+
+/* the GUIDs of every compiled silo in the cache, which change whenever any
+ * plugin rebuilds its metadata */
+static gchar *
+gs_overview_snapshot_get_catalog_guid (void)
+{
+	const gchar *name;
+	g_autofree gchar *cachedir = NULL;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) kinds = g_ptr_array_new_with_free_func (g_free);
+	GString *str = g_string_new (NULL);
+
+	/* the appstream plugin may only have a system-wide cache */
+	g_ptr_array_add (kinds, g_strdup ("appstream"));
+	cachedir = g_build_filename (g_get_user_cache_dir (), "gnome-software", NULL);
+	dir = g_dir_open (cachedir, 0, NULL);
+	while (dir != NULL && (name = g_dir_read_name (dir)) != NULL) {
+		if (g_strcmp0 (name, "appstream") != 0)
+			g_ptr_array_add (kinds, g_strdup (name));
+	}
+	g_ptr_array_sort (kinds, (GCompareFunc) g_strcmp0);
+
+	for (guint i = 0; i < kinds->len; i++)
+		gs_overview_snapshot_add_silo_guid (str, g_ptr_array_index (kinds, i));
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * gs_overview_snapshot_load:
+ * @error: return location for a #GError, or %NULL
+ *
+ * Loads the snapshot saved by gs_overview_snapshot_save().
+ *
+ * This fails if there is no snapshot, or with %G_IO_ERROR_INVALID_DATA if
+ * the metadata silos have changed since it was saved.
+ *
+ * Returns: (transfer full): a #GsOverviewSnapshot, or %NULL on error
+ *
+ * Since: 40
+ **/
+GsOverviewSnapshot *
+gs_overview_snapshot_load (GError **error)
+{
+	GVariantIter iter;
+	const gchar *guid;
+	const gchar *id;
+	GVariant *apps;
+	g_autofree gchar *catalog_guid = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autoptr(GVariant) data = NULL;
+	g_autoptr(GVariant) sections = NULL;
+	g_autoptr(GsOverviewSnapshot) self = NULL;
+
+	filename = gs_overview_snapshot_get_filename (GS_UTILS_CACHE_FLAG_NONE, error);
+	if (filename == NULL)
+		return NULL;
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+	bytes = g_mapped_file_get_bytes (mapped);
+	data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GS_OVERVIEW_SNAPSHOT_VARIANT_TYPE),
+							     bytes, FALSE));
+	g_variant_get (data, "(&s@a(sa" GS_OVERVIEW_SNAPSHOT_APP_TYPE "))", &guid, &sections);
+
+	catalog_guid = gs_overview_snapshot_get_catalog_guid ();
+	if (g_strcmp0 (guid, catalog_guid) != 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "%s was saved for different metadata", filename);
+		return NULL;
+	}
+
+	self = gs_overview_snapshot_new ();
+	g_variant_iter_init (&iter, sections);
+	while (g_variant_iter_next (&iter, "(&s@a" GS_OVERVIEW_SNAPSHOT_APP_TYPE ")", &id, &apps)) {
+		GsOverviewSnapshotSection *section = g_new0 (GsOverviewSnapshotSection, 1);
+		section->id = g_strdup (id);
+		section->apps = apps;
+		g_ptr_array_add (self->sections, section);
+	}
+	return g_steal_pointer (&self);
+}
+
+/* drops the icons whose files have gone since they were recorded */
+static GVariant *
+gs_overview_snapshot_filter_apps (GVariant *apps)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariantIter *icons_iter;
+	GVariant *key_colors;
+	const gchar *unique_id;
+	const gchar *name;
+	const gchar *summary;
+	const gchar *icon_str;
+	guint32 kind;
+	gint32 rating;
+	guint width, scale;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" GS_OVERVIEW_SNAPSHOT_APP_TYPE));
+	g_variant_iter_init (&iter, apps);
+	while (g_variant_iter_next (&iter, "(u&s&s&sia(suu)@a(dddd))",
+				    &kind, &unique_id, &name, &summary, &rating,
+				    &icons_iter, &key_colors)) {
+		GVariantBuilder icons_builder;
+
+		g_variant_builder_init (&icons_builder, G_VARIANT_TYPE ("a(suu)"));
+		while (g_variant_iter_next (icons_iter, "(&suu)", &icon_str, &width, &scale)) {
+			/* file icons are stored as native paths */
+			if (g_path_is_absolute (icon_str) &&
+			    !g_file_test (icon_str, G_FILE_TEST_EXISTS))
+				continue;
+			g_variant_builder_add (&icons_builder, "(suu)", icon_str, width, scale);
+		}
+		g_variant_iter_free (icons_iter);
+
+		g_variant_builder_add (&builder, "(usssia(suu)@a(dddd))",
+				       kind, unique_id, name, summary, rating,
+				       &icons_builder, key_colors);
+		g_variant_unref (key_colors);
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/* the sections as they are now, so they can be written from another thread */
+static GVariant *
+gs_overview_snapshot_get_sections (GsOverviewSnapshot *self)
+{
+	GVariantBuilder sections;
+
+	g_variant_builder_init (&sections, G_VARIANT_TYPE ("a(sa" GS_OVERVIEW_SNAPSHOT_APP_TYPE ")"));
+	for (guint i = 0; i < self->sections->len; i++) {
+		GsOverviewSnapshotSection *section = g_ptr_array_index (self->sections, i);
+		g_variant_builder_add (&sections, "(s@a" GS_OVERVIEW_SNAPSHOT_APP_TYPE ")",
+				       section->id, section->apps);
+	}
+	return g_variant_ref_sink (g_variant_builder_end (&sections));
+}
+
+/* this checks for the icon files and reads the silo headers, so should not
+ * be called from the main thread */
+static gboolean
+gs_overview_snapshot_write (GVariant *sections, GError **error)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	const gchar *id;
+	GVariant *apps;
+	g_autofree gchar *catalog_guid = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	filename = gs_overview_snapshot_get_filename (GS_UTILS_CACHE_FLAG_WRITEABLE |
+						      GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+						      error);
+	if (filename == NULL)
+		return FALSE;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sa" GS_OVERVIEW_SNAPSHOT_APP_TYPE ")"));
+	g_variant_iter_init (&iter, sections);
+	while (g_variant_iter_next (&iter, "(&s@a" GS_OVERVIEW_SNAPSHOT_APP_TYPE ")", &id, &apps)) {
+		g_variant_builder_add (&builder, "(s@a" GS_OVERVIEW_SNAPSHOT_APP_TYPE ")",
+				       id, gs_overview_snapshot_filter_apps (apps));
+		g_variant_unref (apps);
+	}
+	catalog_guid = gs_overview_snapshot_get_catalog_guid ();
+	data = g_variant_ref_sink (g_variant_new ("(sa(sa" GS_OVERVIEW_SNAPSHOT_APP_TYPE "))",
+						  catalog_guid, &builder));
+	g_debug ("writing overview snapshot to %s", filename);
+	return g_file_set_contents (filename,
+				    g_variant_get_data (data),
+				    (gssize) g_variant_get_size (data),
+				    error);
+}
+
+/**
+ * gs_overview_snapshot_save:
+ * @self: a #GsOverviewSnapshot
+ * @error: return location for a #GError, or %NULL
+ *
+ * Saves the snapshot to the cache, tied to the current metadata silos.
+ *
+ * This blocks on disk I/O; use gs_overview_snapshot_save_async() from the
+ * main thread.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 40
+ **/
+gboolean
+gs_overview_snapshot_save (GsOverviewSnapshot *self, GError **error)
+{
+	g_autoptr(GVariant) sections = NULL;
+
+	g_return_val_if_fail (GS_IS_OVERVIEW_SNAPSHOT (self), FALSE);
+
+	sections = gs_overview_snapshot_get_sections (self);
+	return gs_overview_snapshot_write (sections, error);
+}
+
+static void
+gs_overview_snapshot_save_thread_cb (GTask *task,
+				     gpointer source_object,
+				     gpointer task_data,
+				     GCancellable *cancellable)
+{
+	GVariant *sections = task_data;
+	g_autoptr(GError) error_local = NULL;
+
+	if (!gs_overview_snapshot_write (sections, &error_local))
+		g_task_return_error (task, g_steal_pointer (&error_local));
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gs_overview_snapshot_save_async:
+ * @self: a #GsOverviewSnapshot
+ * @cancellable: (nullable): a #GCancellable, or %NULL
+ * @callback: (nullable): function to call when the snapshot is saved
+ * @user_data: data to pass to @callback
+ *
+ * Saves the snapshot in a worker thread, as gs_overview_snapshot_save() does.
+ *
+ * The sections are copied before this returns, so @self may be changed while
+ * the save is in progress.
+ *
+ * Since: 40
+ **/
+void
+gs_overview_snapshot_save_async (GsOverviewSnapshot *self,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GS_IS_OVERVIEW_SNAPSHOT (self));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gs_overview_snapshot_save_async);
+	g_task_set_task_data (task, gs_overview_snapshot_get_sections (self),
+			      (GDestroyNotify) g_variant_unref);
+	g_task_run_in_thread (task, gs_overview_snapshot_save_thread_cb);
+}
+
+/**
+ * gs_overview_snapshot_save_finish:
+ * @self: a #GsOverviewSnapshot
+ * @result: the #GAsyncResult
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes an operation started with gs_overview_snapshot_save_async().
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 40
+ **/
+gboolean
+gs_overview_snapshot_save_finish (GsOverviewSnapshot *self,
+				  GAsyncResult *result,
+				  GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static GsOverviewSnapshotSection *
+gs_overview_snapshot_find (GsOverviewSnapshot *self, const gchar *section_id, guint *idx)
+{
+	for (guint i = 0; i < self->sections->len; i++) {
+		GsOverviewSnapshotSection *section = g_ptr_array_index (self->sections, i);
+		if (g_strcmp0 (section->id, section_id) == 0) {
+			if (idx != NULL)
+				*idx = i;
+			return section;
+		}
+	}
+	return NULL;
+}
+
+static GVariant *
+gs_overview_snapshot_serialize_app (GsApp *app, gboolean with_key_colors)
+{
+	GPtrArray *icons = gs_app_get_icons (app);
+	GVariantBuilder icons_builder;
+	GVariantBuilder key_colors_builder;
+
+	/* only icons which can be loaded without asking a plugin */
+	g_variant_builder_init (&icons_builder, G_VARIANT_TYPE ("a(suu)"));
+	for (guint i = 0; icons != NULL && i < icons->len; i++) {
+		GIcon *icon = g_ptr_array_index (icons, i);
+		g_autofree gchar *icon_str = NULL;
+
+		/* files which have gone are dropped when saving, off the
+		 * main thread */
+		if (G_IS_FILE_ICON (icon)) {
+			GFile *file = g_file_icon_get_file (G_FILE_ICON (icon));
+			if (!g_file_is_native (file))
+				continue;
+		} else if (!G_IS_THEMED_ICON (icon)) {
+			continue;
+		}
+		icon_str = g_icon_to_string (icon);
+		if (icon_str == NULL)
+			continue;
+		g_variant_builder_add (&icons_builder, "(suu)", icon_str,
+				       gs_icon_get_width (icon),
+				       gs_icon_get_scale (icon));
+	}
+
+	/* these are calculated from the icon on demand, which is slow, so
+	 * they are only saved for the sections which use them */
+	g_variant_builder_init (&key_colors_builder, G_VARIANT_TYPE ("a(dddd)"));
+	if (with_key_colors) {
+		GArray *key_colors = gs_app_get_key_colors (app);
+		for (guint i = 0; i < key_colors->len; i++) {
+			GdkRGBA *color = &g_array_index (key_colors, GdkRGBA, i);
+			g_variant_builder_add (&key_colors_builder, "(dddd)",
+					       color->red, color->green,
+					       color->blue, color->alpha);
+		}
+	}
+
+	return g_variant_new (GS_OVERVIEW_SNAPSHOT_APP_TYPE,
+			      (guint32) gs_app_get_kind (app),
+			      gs_app_get_unique_id (app),
+			      gs_app_get_name (app) != NULL ? gs_app_get_name (app) : "",
+			      gs_app_get_summary (app) != NULL ? gs_app_get_summary (app) : "",
+			      (gint32) gs_app_get_rating (app),
+			      &icons_builder,
+			      &key_colors_builder);
+}
+
+/**
+ * gs_overview_snapshot_set_apps:
+ * @self: a #GsOverviewSnapshot
+ * @section_id: an ID for the section, e.g. `featured`
+ * @list: the apps shown in the section, in the order they are shown
+ * @with_key_colors: whether to save the key colors of the apps
+ *
+ * Records the apps shown in a section, replacing anything previously recorded
+ * for it. New sections are added after the existing ones.
+ *
+ * The apps are read immediately, so @list may be changed afterwards.
+ *
+ * Since: 40
+ **/
+void
+gs_overview_snapshot_set_apps (GsOverviewSnapshot *self,
+			       const gchar *section_id,
+			       GsAppList *list,
+			       gboolean with_key_colors)
+{
+	GsOverviewSnapshotSection *section;
+	GVariantBuilder apps;
+
+	g_return_if_fail (GS_IS_OVERVIEW_SNAPSHOT (self));
+	g_return_if_fail (section_id != NULL);
+	g_return_if_fail (GS_IS_APP_LIST (list));
+
+	g_variant_builder_init (&apps, G_VARIANT_TYPE ("a" GS_OVERVIEW_SNAPSHOT_APP_TYPE));
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		if (gs_app_get_unique_id (app) == NULL)
+			continue;
+		g_variant_builder_add_value (&apps, gs_overview_snapshot_serialize_app (app, with_key_colors));
+	}
+
+	section = gs_overview_snapshot_find (self, section_id, NULL);
+	if (section == NULL) {
+		section = g_new0 (GsOverviewSnapshotSection, 1);
+		section->id = g_strdup (section_id);
+		g_ptr_array_add (self->sections, section);
+	} else {
+		g_variant_unref (section->apps);
+	}
+	section->apps = g_variant_ref_sink (g_variant_builder_end (&apps));
+}
+
+static GsApp *
+gs_overview_snapshot_deserialize_app (GVariant *value)
+{
+	GVariantIter *icons_iter = NULL;
+	GVariantIter *key_colors_iter = NULL;
+	const gchar *unique_id;
+	const gchar *name;
+	const gchar *summary;
+	const gchar *icon_str;
+	guint32 kind;
+	gint32 rating;
+	guint width, scale;
+	gdouble red, green, blue, alpha;
+	g_autoptr(GArray) key_colors = g_array_new (FALSE, FALSE, sizeof (GdkRGBA));
+	GsApp *app;
+
+	g_variant_get (value, "(u&s&s&sia(suu)a(dddd))",
+		       &kind, &unique_id, &name, &summary, &rating,
+		       &icons_iter, &key_colors_iter);
+
+	app = gs_app_new (NULL);
+	gs_app_set_from_unique_id (app, unique_id, (AsComponentKind) kind);
+	if (name[0] != '\0')
+		gs_app_set_name (app, GS_APP_QUALITY_LOWEST, name);
+	if (summary[0] != '\0')
+		gs_app_set_summary (app, GS_APP_QUALITY_LOWEST, summary);
+	gs_app_set_rating (app, rating);
+
+	while (g_variant_iter_next (icons_iter, "(&suu)", &icon_str, &width, &scale)) {
+		g_autoptr(GIcon) icon = g_icon_new_for_string (icon_str, NULL);
+		if (icon == NULL)
+			continue;
+		gs_icon_set_width (icon, width);
+		gs_icon_set_scale (icon, MAX (scale, 1));
+		gs_app_add_icon (app, icon);
+	}
+	g_variant_iter_free (icons_iter);
+
+	while (g_variant_iter_next (key_colors_iter, "(dddd)", &red, &green, &blue, &alpha)) {
+		GdkRGBA color = { red, green, blue, alpha };
+		g_array_append_val (key_colors, color);
+	}
+	g_variant_iter_free (key_colors_iter);
+	if (key_colors->len > 0)
+		gs_app_set_key_colors (app, key_colors);
+
+	return app;
+}
+
+/**
+ * gs_overview_snapshot_get_apps:
+ * @self: a #GsOverviewSnapshot
+ * @section_id: an ID for the section, e.g. `featured`
+ *
+ * Creates placeholder apps for those recorded in a section. The apps only
+ * have the properties needed to draw their tiles and will need to be refined
+ * before being used for anything else.
+ *
+ * Returns: (transfer full) (nullable): a new #GsAppList, or %NULL if the
+ *    section is not in the snapshot
+ *
+ * Since: 40
+ **/
+GsAppList *
+gs_overview_snapshot_get_apps (GsOverviewSnapshot *self, const gchar *section_id)
+{
+	GsOverviewSnapshotSection *section;
+	GsAppList *list;
+	GVariantIter iter;
+	GVariant *value;
+
+	g_return_val_if_fail (GS_IS_OVERVIEW_SNAPSHOT (self), NULL);
+	g_return_val_if_fail (section_id != NULL, NULL);
+
+	section = gs_overview_snapshot_find (self, section_id, NULL);
+	if (section == NULL)
+		return NULL;
+
+	list = gs_app_list_new ();
+	g_variant_iter_init (&iter, section->apps);
+	while ((value = g_variant_iter_next_value (&iter)) != NULL) {
+		g_autoptr(GsApp) app = gs_overview_snapshot_deserialize_app (value);
+		gs_app_list_add (list, app);
+		g_variant_unref (value);
+	}
+	return list;
+}
+
+/**
+ * gs_overview_snapshot_remove:
+ * @self: a #GsOverviewSnapshot
+ * @section_id: an ID for the section, e.g. `featured`
+ *
+ * Removes a section from the snapshot, if it is there.
+ *
+ * Since: 40
+ **/
+void
+gs_overview_snapshot_remove (GsOverviewSnapshot *self, const gchar *section_id)
+{
+	guint idx;
+
+	g_return_if_fail (GS_IS_OVERVIEW_SNAPSHOT (self));
+	g_return_if_fail (section_id != NULL);
+
+	if (gs_overview_snapshot_find (self, section_id, &idx) != NULL)
+		g_ptr_array_remove_index (self->sections, idx);
+}
+
+/**
+ * gs_overview_snapshot_get_section_ids:
+ * @self: a #GsOverviewSnapshot
+ *
+ * Gets the IDs of the sections in the snapshot, in the order they were added.
+ *
+ * Returns: (transfer container) (element-type utf8): the section IDs, which
+ *    are valid until the snapshot is next changed
+ *
+ * Since: 40
+ **/
+GPtrArray *
+gs_overview_snapshot_get_section_ids (GsOverviewSnapshot *self)
+{
+	GPtrArray *ids;
+
+	g_return_val_if_fail (GS_IS_OVERVIEW_SNAPSHOT (self), NULL);
+
+	ids = g_ptr_array_new ();
+	for (guint i = 0; i < self->sections->len; i++) {
+		GsOverviewSnapshotSection *section = g_ptr_array_index (self->sections, i);
+		g_ptr_array_add (ids, section->id);
+	}
+	return ids;
+}
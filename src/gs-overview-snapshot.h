@@ -0,0 +1,44 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "gnome-software-private.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_OVERVIEW_SNAPSHOT (gs_overview_snapshot_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsOverviewSnapshot, gs_overview_snapshot, GS, OVERVIEW_SNAPSHOT, GObject)
+
+GsOverviewSnapshot *gs_overview_snapshot_new		(void);
+GsOverviewSnapshot *gs_overview_snapshot_load		(GError			**error);
+gboolean	 gs_overview_snapshot_save		(GsOverviewSnapshot	 *self,
+							 GError			**error);
+void		 gs_overview_snapshot_save_async	(GsOverviewSnapshot	 *self,
+							 GCancellable		 *cancellable,
+							 GAsyncReadyCallback	  callback,
+							 gpointer		  user_data);
+gboolean	 gs_overview_snapshot_save_finish	(GsOverviewSnapshot	 *self,
+							 GAsyncResult		 *result,
+							 GError			**error);
+
+void		 gs_overview_snapshot_set_apps		(GsOverviewSnapshot	 *self,
+							 const gchar		 *section_id,
+							 GsAppList		 *list,
+							 gboolean		  with_key_colors);
+GsAppList	*gs_overview_snapshot_get_apps		(GsOverviewSnapshot	 *self,
+							 const gchar		 *section_id);
+void		 gs_overview_snapshot_remove		(GsOverviewSnapshot	 *self,
+							 const gchar		 *section_id);
+GPtrArray	*gs_overview_snapshot_get_section_ids	(GsOverviewSnapshot	 *self);
+
+G_END_DECLS
@@ -93,7 +93,7 @@ gs_popular_tile_refresh (GsAppTile *self)
 					 gtk_image_get_pixel_size (GTK_IMAGE (tile->image)),
 					 gtk_widget_get_scale_factor (tile->image),
 					 "application-x-executable");
-	gtk_image_set_from_gicon (GTK_IMAGE (tile->image), icon, GTK_ICON_SIZE_DIALOG);
+	gs_image_set_from_icon (GTK_IMAGE (tile->image), icon, GTK_ICON_SIZE_DIALOG);
 
 	gtk_label_set_label (GTK_LABEL (tile->label), gs_app_get_name (app));
 }
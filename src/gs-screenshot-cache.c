@@ -0,0 +1,989 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-screenshot-cache
+ * @title: GsScreenshotCache
+ * @stability: Unstable
+ * @short_description: A size-limited on-disk store for screenshots
+ *
+ * Screenshots are stored once per URL as downloaded (the original) and
+ * any number of size variants are derived locally from that original.
+ *
+ * An index file records the size, last use and last validation time of
+ * every entry, so the store can be opened without stat-ing every file. When
+ * the total size goes over the configured budget the least recently used
+ * entries are removed.
+ *
+ * Stale entries are revalidated in the background using `If-Modified-Since`,
+ * with requests batched so that opening a details page does not send a burst
+ * of requests to the server.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+
+#include "gnome-software-private.h"
+#include "gs-screenshot-cache.h"
+
+/* wait this long before sending the queued revalidation requests */
+#define GS_SCREENSHOT_CACHE_REVALIDATE_DELAY	5 /* s */
+
+/* maximum number of revalidation requests in flight at any one time */
+#define GS_SCREENSHOT_CACHE_REVALIDATE_PARALLEL	2
+
+/* coalesce index writes, as every lookup updates the last-used time */
+#define GS_SCREENSHOT_CACHE_SAVE_DELAY		2 /* s */
+
+#define GS_SCREENSHOT_CACHE_INDEX_FILENAME	"index.ini"
+
+typedef struct {
+	gchar		*checksum;
+	gchar		*filename;	/* same for all size variants */
+	gchar		*url;		/* nullable, if recovered from disk */
+	GHashTable	*variants;	/* sizedir : size in bytes */
+	guint64		 size;
+	gint64		 atime;		/* last used, µs */
+	gint64		 mtime;		/* last validated with the server, µs */
+} GsScreenshotCacheEntry;
+
+struct _GsScreenshotCache
+{
+	GObject			 parent_instance;
+
+	gchar			*kind;
+	gchar			*cachedir;
+	gchar			*index_fn;
+	GHashTable		*entries;	/* checksum : GsScreenshotCacheEntry */
+	gboolean		 loaded;
+	guint64			 size;
+	guint64			 size_max;
+	guint			 age_max;
+	guint			 save_id;
+
+	SoupSession		*session;
+	GQueue			 revalidate_queue;	/* of URLs */
+	GHashTable		*revalidate_pending;	/* URLs queued or in flight */
+	guint			 revalidate_id;
+	guint			 revalidate_in_flight;
+};
+
+G_DEFINE_TYPE (GsScreenshotCache, gs_screenshot_cache, G_TYPE_OBJECT)
+
+static GsScreenshotCache *default_cache = NULL;
+
+static GsScreenshotCacheEntry *
+gs_screenshot_cache_entry_new (const gchar *checksum, const gchar *filename)
+{
+	GsScreenshotCacheEntry *entry = g_slice_new0 (GsScreenshotCacheEntry);
+	entry->checksum = g_strdup (checksum);
+	entry->filename = g_strdup (filename);
+	entry->variants = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, NULL);
+	return entry;
+}
+
+static void
+gs_screenshot_cache_entry_free (GsScreenshotCacheEntry *entry)
+{
+	g_free (entry->checksum);
+	g_free (entry->filename);
+	g_free (entry->url);
+	g_hash_table_unref (entry->variants);
+	g_slice_free (GsScreenshotCacheEntry, entry);
+}
+
+static gchar *
+gs_screenshot_cache_get_sizedir (guint width, guint height)
+{
+	if (width == GS_SCREENSHOT_CACHE_SIZE_ORIGINAL ||
+	    height == GS_SCREENSHOT_CACHE_SIZE_ORIGINAL)
+		return g_strdup ("unknown");
+	return g_strdup_printf ("%ux%u", width, height);
+}
+
+static gchar *
+gs_screenshot_cache_build_filename (GsScreenshotCache *self,
+				    GsScreenshotCacheEntry *entry,
+				    const gchar *sizedir)
+{
+	return g_build_filename (self->cachedir, sizedir, entry->filename, NULL);
+}
+
+static void
+gs_screenshot_cache_entry_set_variant (GsScreenshotCache *self,
+				       GsScreenshotCacheEntry *entry,
+				       const gchar *sizedir,
+				       gsize size)
+{
+	gpointer size_old;
+
+	if (g_hash_table_lookup_extended (entry->variants, sizedir, NULL, &size_old)) {
+		entry->size -= GPOINTER_TO_SIZE (size_old);
+		self->size -= GPOINTER_TO_SIZE (size_old);
+	}
+	g_hash_table_insert (entry->variants, g_strdup (sizedir), GSIZE_TO_POINTER (size));
+	entry->size += size;
+	self->size += size;
+}
+
+static void
+gs_screenshot_cache_insert (GsScreenshotCache *self, GsScreenshotCacheEntry *entry)
+{
+	g_hash_table_insert (self->entries, entry->checksum, entry);
+}
+
+/* the index is missing or corrupt, so recover whatever is already on disk,
+ * which also adopts the per-size directories used by previous versions */
+static void
+gs_screenshot_cache_rebuild_index (GsScreenshotCache *self)
+{
+	const gchar *sizedir;
+	g_autoptr(GDir) dir = NULL;
+
+	dir = g_dir_open (self->cachedir, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((sizedir = g_dir_read_name (dir)) != NULL) {
+		const gchar *fn;
+		g_autofree gchar *path = g_build_filename (self->cachedir, sizedir, NULL);
+		g_autoptr(GDir) dir_size = NULL;
+
+		if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+			continue;
+		dir_size = g_dir_open (path, 0, NULL);
+		if (dir_size == NULL)
+			continue;
+		while ((fn = g_dir_read_name (dir_size)) != NULL) {
+			GsScreenshotCacheEntry *entry;
+			g_autofree gchar *checksum = NULL;
+			g_autofree gchar *path_fn = g_build_filename (path, fn, NULL);
+			g_autoptr(GFile) file = g_file_new_for_path (path_fn);
+			g_autoptr(GFileInfo) info = NULL;
+			gint64 mtime;
+
+			/* not a "<sha256>-<basename>" filename */
+			if (strlen (fn) <= 65 || fn[64] != '-')
+				continue;
+			info = g_file_query_info (file,
+						  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+						  G_FILE_ATTRIBUTE_TIME_MODIFIED,
+						  G_FILE_QUERY_INFO_NONE,
+						  NULL, NULL);
+			if (info == NULL)
+				continue;
+			checksum = g_strndup (fn, 64);
+			entry = g_hash_table_lookup (self->entries, checksum);
+			if (entry == NULL) {
+				entry = gs_screenshot_cache_entry_new (checksum, fn);
+				gs_screenshot_cache_insert (self, entry);
+			}
+			mtime = (gint64) g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC;
+			entry->atime = MAX (entry->atime, mtime);
+			entry->mtime = MAX (entry->mtime, mtime);
+			gs_screenshot_cache_entry_set_variant (self, entry, sizedir,
+							       (gsize) g_file_info_get_size (info));
+		}
+	}
+	g_debug ("rebuilt screenshot cache index with %u entries of %" G_GUINT64_FORMAT " bytes",
+		 g_hash_table_size (self->entries), self->size);
+}
+
+static gboolean
+gs_screenshot_cache_load_index (GsScreenshotCache *self, GError **error)
+{
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+	g_auto(GStrv) groups = NULL;
+
+	if (!g_key_file_load_from_file (kf, self->index_fn, G_KEY_FILE_NONE, error))
+		return FALSE;
+	groups = g_key_file_get_groups (kf, NULL);
+	for (guint i = 0; groups[i] != NULL; i++) {
+		GsScreenshotCacheEntry *entry;
+		g_autofree gchar *filename = NULL;
+		g_auto(GStrv) variants = NULL;
+
+		filename = g_key_file_get_string (kf, groups[i], "Filename", NULL);
+		if (filename == NULL)
+			continue;
+		entry = gs_screenshot_cache_entry_new (groups[i], filename);
+		entry->url = g_key_file_get_string (kf, groups[i], "Url", NULL);
+		entry->atime = g_key_file_get_int64 (kf, groups[i], "LastUsed", NULL);
+		entry->mtime = g_key_file_get_int64 (kf, groups[i], "LastValidated", NULL);
+		variants = g_key_file_get_string_list (kf, groups[i], "Variants", NULL, NULL);
+		for (guint j = 0; variants != NULL && variants[j] != NULL; j++) {
+			gchar *tmp = strrchr (variants[j], ':');
+			if (tmp == NULL)
+				continue;
+			*tmp = '\0';
+			gs_screenshot_cache_entry_set_variant (self, entry, variants[j],
+							       (gsize) g_ascii_strtoull (tmp + 1, NULL, 10));
+		}
+		gs_screenshot_cache_insert (self, entry);
+	}
+	return TRUE;
+}
+
+static void
+gs_screenshot_cache_ensure_loaded (GsScreenshotCache *self)
+{
+	g_autoptr(GError) error_local = NULL;
+
+	if (self->loaded)
+		return;
+	self->loaded = TRUE;
+	if (!gs_screenshot_cache_load_index (self, &error_local)) {
+		g_debug ("failed to load screenshot cache index: %s",
+			 error_local->message);
+		gs_screenshot_cache_rebuild_index (self);
+	}
+}
+
+/**
+ * gs_screenshot_cache_save:
+ * @self: a #GsScreenshotCache
+ * @error: a #GError, or %NULL
+ *
+ * Writes the index to disk. This is done automatically shortly after any
+ * change, so this only needs to be called when the caller requires the
+ * index to be up to date, e.g. on shutdown.
+ *
+ * Returns: %TRUE for success
+ */
+gboolean
+gs_screenshot_cache_save (GsScreenshotCache *self, GError **error)
+{
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), FALSE);
+
+	if (self->save_id != 0) {
+		g_source_remove (self->save_id);
+		self->save_id = 0;
+	}
+	if (!self->loaded)
+		return TRUE;
+
+	g_hash_table_iter_init (&iter, self->entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GsScreenshotCacheEntry *entry = value;
+		GHashTableIter iter_variants;
+		gpointer key_variant, value_variant;
+		g_autoptr(GPtrArray) variants = g_ptr_array_new_with_free_func (g_free);
+
+		g_key_file_set_string (kf, entry->checksum, "Filename", entry->filename);
+		if (entry->url != NULL)
+			g_key_file_set_string (kf, entry->checksum, "Url", entry->url);
+		g_key_file_set_int64 (kf, entry->checksum, "LastUsed", entry->atime);
+		g_key_file_set_int64 (kf, entry->checksum, "LastValidated", entry->mtime);
+		g_hash_table_iter_init (&iter_variants, entry->variants);
+		while (g_hash_table_iter_next (&iter_variants, &key_variant, &value_variant)) {
+			g_ptr_array_add (variants,
+					 g_strdup_printf ("%s:%" G_GSIZE_FORMAT,
+							  (const gchar *) key_variant,
+							  GPOINTER_TO_SIZE (value_variant)));
+		}
+		g_key_file_set_string_list (kf, entry->checksum, "Variants",
+					    (const gchar * const *) variants->pdata,
+					    variants->len);
+	}
+	if (!gs_mkdir_parent (self->index_fn, error))
+		return FALSE;
+	return g_key_file_save_to_file (kf, self->index_fn, error);
+}
+
+static gboolean
+gs_screenshot_cache_save_cb (gpointer user_data)
+{
+	GsScreenshotCache *self = GS_SCREENSHOT_CACHE (user_data);
+	g_autoptr(GError) error_local = NULL;
+
+	self->save_id = 0;
+	if (!gs_screenshot_cache_save (self, &error_local))
+		g_warning ("failed to save screenshot cache index: %s", error_local->message);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_screenshot_cache_schedule_save (GsScreenshotCache *self)
+{
+	if (self->save_id != 0)
+		return;
+	self->save_id = g_timeout_add_seconds (GS_SCREENSHOT_CACHE_SAVE_DELAY,
+					       gs_screenshot_cache_save_cb,
+					       self);
+}
+
+static GsScreenshotCacheEntry *
+gs_screenshot_cache_get_entry (GsScreenshotCache *self, const gchar *url)
+{
+	g_autofree gchar *checksum = NULL;
+
+	gs_screenshot_cache_ensure_loaded (self);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, url, -1);
+	return g_hash_table_lookup (self->entries, checksum);
+}
+
+static GsScreenshotCacheEntry *
+gs_screenshot_cache_ensure_entry (GsScreenshotCache *self, const gchar *url)
+{
+	GsScreenshotCacheEntry *entry;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *filename = NULL;
+
+	gs_screenshot_cache_ensure_loaded (self);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, url, -1);
+	entry = g_hash_table_lookup (self->entries, checksum);
+	if (entry == NULL) {
+		basename = g_path_get_basename (url);
+		filename = g_strdup_printf ("%s-%s", checksum, basename);
+		entry = gs_screenshot_cache_entry_new (checksum, filename);
+		gs_screenshot_cache_insert (self, entry);
+	}
+	if (entry->url == NULL)
+		entry->url = g_strdup (url);
+	return entry;
+}
+
+static void
+gs_screenshot_cache_remove_entry (GsScreenshotCache *self,
+				  GsScreenshotCacheEntry *entry)
+{
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init (&iter, entry->variants);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		g_autofree gchar *fn = gs_screenshot_cache_build_filename (self, entry, key);
+		g_autoptr(GError) error_local = NULL;
+		if (g_file_test (fn, G_FILE_TEST_EXISTS) &&
+		    !gs_utils_unlink (fn, &error_local))
+			g_warning ("failed to remove %s: %s", fn, error_local->message);
+	}
+	self->size -= MIN (self->size, entry->size);
+	g_hash_table_remove (self->entries, entry->checksum);
+	gs_screenshot_cache_schedule_save (self);
+}
+
+static gint
+gs_screenshot_cache_entry_sort_atime_cb (gconstpointer a, gconstpointer b)
+{
+	GsScreenshotCacheEntry *entry1 = *((GsScreenshotCacheEntry **) a);
+	GsScreenshotCacheEntry *entry2 = *((GsScreenshotCacheEntry **) b);
+	if (entry1->atime < entry2->atime)
+		return -1;
+	if (entry1->atime > entry2->atime)
+		return 1;
+	return 0;
+}
+
+static void
+gs_screenshot_cache_evict (GsScreenshotCache *self)
+{
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GPtrArray) entries = NULL;
+
+	if (self->size_max == 0 || self->size <= self->size_max)
+		return;
+
+	/* never remove the most recently used entry, which is probably the
+	 * one that has just been added and is about to be shown */
+	entries = g_ptr_array_sized_new (g_hash_table_size (self->entries));
+	g_hash_table_iter_init (&iter, self->entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (entries, value);
+	g_ptr_array_sort (entries, gs_screenshot_cache_entry_sort_atime_cb);
+	for (guint i = 0; i + 1 < entries->len && self->size > self->size_max; i++) {
+		GsScreenshotCacheEntry *entry = g_ptr_array_index (entries, i);
+		g_debug ("evicting %s from screenshot cache", entry->filename);
+		gs_screenshot_cache_remove_entry (self, entry);
+	}
+}
+
+/**
+ * gs_screenshot_cache_lookup:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ * @width: the width in device pixels, or %GS_SCREENSHOT_CACHE_SIZE_ORIGINAL
+ * @height: the height in device pixels, or %GS_SCREENSHOT_CACHE_SIZE_ORIGINAL
+ *
+ * Finds a cached file for the given URL and size, marking it as recently
+ * used. The system-wide screenshot cache is also checked.
+ *
+ * Returns: (transfer full) (nullable): a filename, or %NULL if not cached
+ */
+gchar *
+gs_screenshot_cache_lookup (GsScreenshotCache *self,
+			    const gchar *url,
+			    guint width,
+			    guint height)
+{
+	GsScreenshotCacheEntry *entry;
+	gpointer size;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *cache_kind = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *resource = NULL;
+	g_autofree gchar *sizedir = NULL;
+
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), NULL);
+	g_return_val_if_fail (url != NULL, NULL);
+
+	sizedir = gs_screenshot_cache_get_sizedir (width, height);
+	entry = gs_screenshot_cache_get_entry (self, url);
+	if (entry != NULL &&
+	    g_hash_table_lookup_extended (entry->variants, sizedir, NULL, &size)) {
+		filename = gs_screenshot_cache_build_filename (self, entry, sizedir);
+		if (g_file_test (filename, G_FILE_TEST_EXISTS)) {
+			entry->atime = g_get_real_time ();
+			gs_screenshot_cache_schedule_save (self);
+			return g_steal_pointer (&filename);
+		}
+
+		/* removed behind our back */
+		g_hash_table_remove (entry->variants, sizedir);
+		entry->size -= MIN (entry->size, GPOINTER_TO_SIZE (size));
+		self->size -= MIN (self->size, GPOINTER_TO_SIZE (size));
+		if (g_hash_table_size (entry->variants) == 0)
+			g_hash_table_remove (self->entries, entry->checksum);
+		gs_screenshot_cache_schedule_save (self);
+	}
+
+	/* not in the index, but may be provided by the OS vendor or have been
+	 * written by an older version */
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, url, -1);
+	basename = g_path_get_basename (url);
+	resource = g_strdup_printf ("%s-%s", checksum, basename);
+	cache_kind = g_build_filename (self->kind, sizedir, NULL);
+	g_clear_pointer (&filename, g_free);
+	filename = gs_utils_get_cache_filename (cache_kind, resource,
+						GS_UTILS_CACHE_FLAG_NONE, NULL);
+	if (filename == NULL || !g_file_test (filename, G_FILE_TEST_EXISTS))
+		return NULL;
+	if (g_str_has_prefix (filename, self->cachedir))
+		gs_screenshot_cache_add (self, url, width, height);
+	return g_steal_pointer (&filename);
+}
+
+/**
+ * gs_screenshot_cache_get_filename:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ * @width: the width in device pixels, or %GS_SCREENSHOT_CACHE_SIZE_ORIGINAL
+ * @height: the height in device pixels, or %GS_SCREENSHOT_CACHE_SIZE_ORIGINAL
+ * @error: a #GError, or %NULL
+ *
+ * Gets a writable filename for the given URL and size, creating the parent
+ * directory if required. Once the file has been written the caller should
+ * use gs_screenshot_cache_add() to account for it.
+ *
+ * Returns: (transfer full): a filename, or %NULL on error
+ */
+gchar *
+gs_screenshot_cache_get_filename (GsScreenshotCache *self,
+				  const gchar *url,
+				  guint width,
+				  guint height,
+				  GError **error)
+{
+	GsScreenshotCacheEntry *entry;
+	g_autofree gchar *cache_kind = NULL;
+	g_autofree gchar *sizedir = NULL;
+
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), NULL);
+	g_return_val_if_fail (url != NULL, NULL);
+
+	entry = gs_screenshot_cache_ensure_entry (self, url);
+	sizedir = gs_screenshot_cache_get_sizedir (width, height);
+	cache_kind = g_build_filename (self->kind, sizedir, NULL);
+	return gs_utils_get_cache_filename (cache_kind, entry->filename,
+					    GS_UTILS_CACHE_FLAG_WRITEABLE |
+					    GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+					    error);
+}
+
+/**
+ * gs_screenshot_cache_add:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ * @width: the width in device pixels, or %GS_SCREENSHOT_CACHE_SIZE_ORIGINAL
+ * @height: the height in device pixels, or %GS_SCREENSHOT_CACHE_SIZE_ORIGINAL
+ *
+ * Adds a file previously written to the location returned by
+ * gs_screenshot_cache_get_filename() to the index, evicting the least
+ * recently used entries if this takes the cache over budget.
+ */
+void
+gs_screenshot_cache_add (GsScreenshotCache *self,
+			 const gchar *url,
+			 guint width,
+			 guint height)
+{
+	GsScreenshotCacheEntry *entry;
+	GStatBuf st;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *sizedir = NULL;
+
+	g_return_if_fail (GS_IS_SCREENSHOT_CACHE (self));
+	g_return_if_fail (url != NULL);
+
+	entry = gs_screenshot_cache_ensure_entry (self, url);
+	sizedir = gs_screenshot_cache_get_sizedir (width, height);
+	filename = gs_screenshot_cache_build_filename (self, entry, sizedir);
+	if (g_stat (filename, &st) != 0) {
+		g_warning ("cannot add %s to screenshot cache: %s",
+			   filename, g_strerror (errno));
+		return;
+	}
+	gs_screenshot_cache_entry_set_variant (self, entry, sizedir, (gsize) st.st_size);
+	entry->atime = g_get_real_time ();
+	if (g_strcmp0 (sizedir, "unknown") == 0)
+		entry->mtime = entry->atime;
+	gs_screenshot_cache_schedule_save (self);
+	gs_screenshot_cache_evict (self);
+}
+
+/**
+ * gs_screenshot_cache_add_original:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ * @data: the image data as downloaded
+ * @length: size of @data
+ * @error: a #GError, or %NULL
+ *
+ * Stores the downloaded image as the original for @url, from which all
+ * the size variants are derived.
+ *
+ * Returns: %TRUE for success
+ */
+gboolean
+gs_screenshot_cache_add_original (GsScreenshotCache *self,
+				  const gchar *url,
+				  const gchar *data,
+				  gsize length,
+				  GError **error)
+{
+	g_autofree gchar *filename = NULL;
+
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), FALSE);
+	g_return_val_if_fail (url != NULL, FALSE);
+
+	filename = gs_screenshot_cache_get_filename (self, url,
+						     GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+						     GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+						     error);
+	if (filename == NULL)
+		return FALSE;
+	if (!g_file_set_contents (filename, data, (gssize) length, error))
+		return FALSE;
+	gs_screenshot_cache_add (self, url,
+				 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+				 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	return TRUE;
+}
+
+/**
+ * gs_screenshot_cache_invalidate:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ *
+ * Removes the original and all the size variants for @url.
+ */
+void
+gs_screenshot_cache_invalidate (GsScreenshotCache *self, const gchar *url)
+{
+	GsScreenshotCacheEntry *entry;
+
+	g_return_if_fail (GS_IS_SCREENSHOT_CACHE (self));
+	g_return_if_fail (url != NULL);
+
+	entry = gs_screenshot_cache_get_entry (self, url);
+	if (entry != NULL)
+		gs_screenshot_cache_remove_entry (self, entry);
+}
+
+/**
+ * gs_screenshot_cache_needs_revalidate:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ *
+ * Checks if the cached copy of @url was last validated with the server
+ * longer ago than the maximum age.
+ *
+ * Returns: %TRUE if the server should be asked if the image has changed
+ */
+gboolean
+gs_screenshot_cache_needs_revalidate (GsScreenshotCache *self, const gchar *url)
+{
+	GsScreenshotCacheEntry *entry;
+	gint64 age;
+
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), FALSE);
+	g_return_val_if_fail (url != NULL, FALSE);
+
+	/* a value of 0 means to never check */
+	if (self->age_max == 0)
+		return FALSE;
+	entry = gs_screenshot_cache_get_entry (self, url);
+	if (entry == NULL)
+		return FALSE;
+	age = (g_get_real_time () - entry->mtime) / G_USEC_PER_SEC;
+	return age < 0 || age >= (gint64) self->age_max;
+}
+
+typedef struct {
+	GsScreenshotCache	*self;
+	gchar			*url;
+} GsScreenshotCacheHelper;
+
+static void
+gs_screenshot_cache_helper_free (GsScreenshotCacheHelper *helper)
+{
+	g_object_unref (helper->self);
+	g_free (helper->url);
+	g_slice_free (GsScreenshotCacheHelper, helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GsScreenshotCacheHelper, gs_screenshot_cache_helper_free)
+
+static void gs_screenshot_cache_revalidate_dispatch (GsScreenshotCache *self);
+
+/* whether the original is on disk with the size it was saved with, so a
+ * 304 for it can be trusted */
+static gboolean
+gs_screenshot_cache_entry_is_intact (GsScreenshotCache *self,
+				     GsScreenshotCacheEntry *entry)
+{
+	GStatBuf buf;
+	gpointer size;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *sizedir = NULL;
+
+	sizedir = gs_screenshot_cache_get_sizedir (GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+						   GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	if (!g_hash_table_lookup_extended (entry->variants, sizedir, NULL, &size))
+		return FALSE;
+	filename = gs_screenshot_cache_build_filename (self, entry, sizedir);
+	if (g_stat (filename, &buf) != 0)
+		return FALSE;
+	return buf.st_size > 0 && (gsize) buf.st_size == GPOINTER_TO_SIZE (size);
+}
+
+static void
+gs_screenshot_cache_revalidate_cb (SoupSession *session,
+				   SoupMessage *msg,
+				   gpointer user_data)
+{
+	g_autoptr(GsScreenshotCacheHelper) helper = user_data;
+	GsScreenshotCache *self = helper->self;
+	GsScreenshotCacheEntry *entry;
+
+	self->revalidate_in_flight--;
+	g_hash_table_remove (self->revalidate_pending, helper->url);
+
+	if (msg->status_code == SOUP_STATUS_CANCELLED)
+		return;
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		g_debug ("screenshot %s has not been modified", helper->url);
+		entry = gs_screenshot_cache_get_entry (self, helper->url);
+		if (entry != NULL) {
+			entry->mtime = g_get_real_time ();
+			gs_screenshot_cache_schedule_save (self);
+		}
+	} else if (msg->status_code == SOUP_STATUS_OK) {
+		g_autoptr(GError) error_local = NULL;
+
+		/* all the derived sizes are now out of date too */
+		g_debug ("screenshot %s has been modified", helper->url);
+		gs_screenshot_cache_invalidate (self, helper->url);
+		if (!gs_screenshot_cache_add_original (self, helper->url,
+						       msg->response_body->data,
+						       (gsize) msg->response_body->length,
+						       &error_local)) {
+			g_warning ("failed to save screenshot %s: %s",
+				   helper->url, error_local->message);
+		}
+	} else if (msg->status_code != SOUP_STATUS_CANT_RESOLVE) {
+		g_debug ("failed to revalidate screenshot %s: %u %s",
+			 helper->url, msg->status_code, msg->reason_phrase);
+	}
+
+	gs_screenshot_cache_revalidate_dispatch (self);
+}
+
+static void
+gs_screenshot_cache_revalidate_dispatch (GsScreenshotCache *self)
+{
+	if (self->session == NULL) {
+		self->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT,
+							       gs_user_agent (),
+							       NULL);
+	}
+
+	while (self->revalidate_in_flight < GS_SCREENSHOT_CACHE_REVALIDATE_PARALLEL &&
+	       !g_queue_is_empty (&self->revalidate_queue)) {
+		GsScreenshotCacheEntry *entry;
+		GsScreenshotCacheHelper *helper;
+		g_autofree gchar *url = g_queue_pop_head (&self->revalidate_queue);
+		g_autofree gchar *mod_date = NULL;
+		g_autoptr(SoupMessage) msg = NULL;
+		SoupDate *date;
+
+		entry = gs_screenshot_cache_get_entry (self, url);
+		msg = soup_message_new (SOUP_METHOD_GET, url);
+		if (entry == NULL || msg == NULL) {
+			g_hash_table_remove (self->revalidate_pending, url);
+			continue;
+		}
+
+		/* a damaged original is downloaded again in full */
+		if (gs_screenshot_cache_entry_is_intact (self, entry)) {
+			date = soup_date_new_from_time_t ((time_t) (entry->mtime / G_USEC_PER_SEC));
+			mod_date = soup_date_to_string (date, SOUP_DATE_HTTP);
+			soup_date_free (date);
+			soup_message_headers_append (msg->request_headers,
+						     "If-Modified-Since", mod_date);
+		} else {
+			g_debug ("screenshot %s is damaged, so downloading it again", url);
+		}
+
+		helper = g_slice_new0 (GsScreenshotCacheHelper);
+		helper->self = g_object_ref (self);
+		helper->url = g_steal_pointer (&url);
+		self->revalidate_in_flight++;
+		soup_session_queue_message (self->session,
+					    g_steal_pointer (&msg),
+					    gs_screenshot_cache_revalidate_cb,
+					    helper);
+	}
+}
+
+static gboolean
+gs_screenshot_cache_revalidate_timeout_cb (gpointer user_data)
+{
+	GsScreenshotCache *self = GS_SCREENSHOT_CACHE (user_data);
+	self->revalidate_id = 0;
+	gs_screenshot_cache_revalidate_dispatch (self);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * gs_screenshot_cache_queue_revalidate:
+ * @self: a #GsScreenshotCache
+ * @url: the screenshot URL
+ *
+ * Queues a background check with the server to see if the cached copy of
+ * @url is still current. Requests are sent in small batches after a short
+ * delay, and if the image has changed the new version will be used the next
+ * time the screenshot is shown.
+ */
+void
+gs_screenshot_cache_queue_revalidate (GsScreenshotCache *self, const gchar *url)
+{
+	g_return_if_fail (GS_IS_SCREENSHOT_CACHE (self));
+	g_return_if_fail (url != NULL);
+
+	if (g_hash_table_contains (self->revalidate_pending, url))
+		return;
+	g_hash_table_add (self->revalidate_pending, g_strdup (url));
+	g_queue_push_tail (&self->revalidate_queue, g_strdup (url));
+	if (self->revalidate_id == 0) {
+		self->revalidate_id = g_timeout_add_seconds (GS_SCREENSHOT_CACHE_REVALIDATE_DELAY,
+							     gs_screenshot_cache_revalidate_timeout_cb,
+							     self);
+	}
+}
+
+/**
+ * gs_screenshot_cache_set_size_max:
+ * @self: a #GsScreenshotCache
+ * @size_max: the maximum size in bytes, or 0 for no limit
+ *
+ * Sets the byte budget for all cached screenshots.
+ */
+void
+gs_screenshot_cache_set_size_max (GsScreenshotCache *self, guint64 size_max)
+{
+	g_return_if_fail (GS_IS_SCREENSHOT_CACHE (self));
+	self->size_max = size_max;
+	if (self->loaded)
+		gs_screenshot_cache_evict (self);
+}
+
+/**
+ * gs_screenshot_cache_get_size_max:
+ * @self: a #GsScreenshotCache
+ *
+ * Gets the byte budget for all cached screenshots.
+ *
+ * Returns: the maximum size in bytes, or 0 for no limit
+ */
+guint64
+gs_screenshot_cache_get_size_max (GsScreenshotCache *self)
+{
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), 0);
+	return self->size_max;
+}
+
+/**
+ * gs_screenshot_cache_get_size:
+ * @self: a #GsScreenshotCache
+ *
+ * Gets the total size of all cached screenshots as recorded in the index.
+ *
+ * Returns: size in bytes
+ */
+guint64
+gs_screenshot_cache_get_size (GsScreenshotCache *self)
+{
+	g_return_val_if_fail (GS_IS_SCREENSHOT_CACHE (self), 0);
+	gs_screenshot_cache_ensure_loaded (self);
+	return self->size;
+}
+
+/**
+ * gs_screenshot_cache_set_age_max:
+ * @self: a #GsScreenshotCache
+ * @age_max: the age in seconds, or 0 to never revalidate
+ *
+ * Sets how long a cached screenshot is considered current before the
+ * server is asked whether it has changed.
+ */
+void
+gs_screenshot_cache_set_age_max (GsScreenshotCache *self, guint age_max)
+{
+	g_return_if_fail (GS_IS_SCREENSHOT_CACHE (self));
+	self->age_max = age_max;
+}
+
+static void
+gs_screenshot_cache_dispose (GObject *object)
+{
+	GsScreenshotCache *self = GS_SCREENSHOT_CACHE (object);
+
+	if (self->save_id != 0) {
+		g_autoptr(GError) error_local = NULL;
+		if (!gs_screenshot_cache_save (self, &error_local))
+			g_warning ("failed to save screenshot cache index: %s", error_local->message);
+	}
+	if (self->revalidate_id != 0) {
+		g_source_remove (self->revalidate_id);
+		self->revalidate_id = 0;
+	}
+	if (self->session != NULL)
+		soup_session_abort (self->session);
+	g_clear_object (&self->session);
+
+	G_OBJECT_CLASS (gs_screenshot_cache_parent_class)->dispose (object);
+}
+
+static void
+gs_screenshot_cache_finalize (GObject *object)
+{
+	GsScreenshotCache *self = GS_SCREENSHOT_CACHE (object);
+
+	g_queue_foreach (&self->revalidate_queue, (GFunc) g_free, NULL);
+	g_queue_clear (&self->revalidate_queue);
+	g_hash_table_unref (self->revalidate_pending);
+	g_hash_table_unref (self->entries);
+	g_free (self->kind);
+	g_free (self->cachedir);
+	g_free (self->index_fn);
+
+	G_OBJECT_CLASS (gs_screenshot_cache_parent_class)->finalize (object);
+}
+
+static void
+gs_screenshot_cache_class_init (GsScreenshotCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->dispose = gs_screenshot_cache_dispose;
+	object_class->finalize = gs_screenshot_cache_finalize;
+}
+
+static void
+gs_screenshot_cache_init (GsScreenshotCache *self)
+{
+	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       NULL, (GDestroyNotify) gs_screenshot_cache_entry_free);
+	self->revalidate_pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+							  g_free, NULL);
+	g_queue_init (&self->revalidate_queue);
+}
+
+/**
+ * gs_screenshot_cache_new:
+ * @kind: the cache kind, e.g. "screenshots"
+ *
+ * Creates a new screenshot store. The index is loaded on first use.
+ *
+ * Returns: (transfer full): a #GsScreenshotCache
+ */
+GsScreenshotCache *
+gs_screenshot_cache_new (const gchar *kind)
+{
+	GsScreenshotCache *self;
+	self = g_object_new (GS_TYPE_SCREENSHOT_CACHE, NULL);
+	self->kind = g_strdup (kind);
+	self->index_fn = gs_utils_get_cache_filename (kind,
+						      GS_SCREENSHOT_CACHE_INDEX_FILENAME,
+						      GS_UTILS_CACHE_FLAG_WRITEABLE,
+						      NULL);
+	self->cachedir = g_path_get_dirname (self->index_fn);
+	return self;
+}
+
+/**
+ * gs_screenshot_cache_get_default:
+ *
+ * Gets the screenshot store shared by the whole process, configured from
+ * the `screenshot-cache-size-maximum` and `screenshot-cache-age-maximum`
+ * settings.
+ *
+ * Returns: (transfer none): a #GsScreenshotCache
+ */
+GsScreenshotCache *
+gs_screenshot_cache_get_default (void)
+{
+	if (default_cache == NULL) {
+		g_autoptr(GSettings) settings = g_settings_new ("org.gnome.software");
+		default_cache = gs_screenshot_cache_new ("screenshots");
+		gs_screenshot_cache_set_size_max (default_cache,
+						  (guint64) g_settings_get_uint (settings, "screenshot-cache-size-maximum") * 1024 * 1024);
+		gs_screenshot_cache_set_age_max (default_cache,
+						 g_settings_get_uint (settings, "screenshot-cache-age-maximum"));
+	}
+	return default_cache;
+}
+
+/**
+ * gs_screenshot_cache_flush_default:
+ *
+ * Saves the index of the store returned by gs_screenshot_cache_get_default()
+ * if it has changes waiting to be saved, as the process is about to exit and
+ * the store is never disposed. Does nothing if the store was never used.
+ */
+void
+gs_screenshot_cache_flush_default (void)
+{
+	g_autoptr(GError) error_local = NULL;
+
+	if (default_cache == NULL || default_cache->save_id == 0)
+		return;
+	if (!gs_screenshot_cache_save (default_cache, &error_local))
+		g_warning ("failed to save screenshot cache index: %s", error_local->message);
+}
@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* the original image as downloaded, used to derive all the other sizes */
+#define GS_SCREENSHOT_CACHE_SIZE_ORIGINAL	G_MAXUINT
+
+#define GS_TYPE_SCREENSHOT_CACHE (gs_screenshot_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsScreenshotCache, gs_screenshot_cache, GS, SCREENSHOT_CACHE, GObject)
+
+GsScreenshotCache *gs_screenshot_cache_new		(const gchar		*kind);
+GsScreenshotCache *gs_screenshot_cache_get_default	(void);
+void		 gs_screenshot_cache_flush_default	(void);
+
+void		 gs_screenshot_cache_set_size_max	(GsScreenshotCache	*self,
+							 guint64		 size_max);
+guint64		 gs_screenshot_cache_get_size_max	(GsScreenshotCache	*self);
+guint64		 gs_screenshot_cache_get_size		(GsScreenshotCache	*self);
+void		 gs_screenshot_cache_set_age_max	(GsScreenshotCache	*self,
+							 guint			 age_max);
+
+gchar		*gs_screenshot_cache_lookup		(GsScreenshotCache	*self,
+							 const gchar		*url,
+							 guint			 width,
+							 guint			 height);
+gchar		*gs_screenshot_cache_get_filename	(GsScreenshotCache	*self,
+							 const gchar		*url,
+							 guint			 width,
+							 guint			 height,
+							 GError			**error);
+void		 gs_screenshot_cache_add		(GsScreenshotCache	*self,
+							 const gchar		*url,
+							 guint			 width,
+							 guint			 height);
+gboolean	 gs_screenshot_cache_add_original	(GsScreenshotCache	*self,
+							 const gchar		*url,
+							 const gchar		*data,
+							 gsize			 length,
+							 GError			**error);
+void		 gs_screenshot_cache_invalidate		(GsScreenshotCache	*self,
+							 const gchar		*url);
+gboolean	 gs_screenshot_cache_needs_revalidate	(GsScreenshotCache	*self,
+							 const gchar		*url);
+void		 gs_screenshot_cache_queue_revalidate	(GsScreenshotCache	*self,
+							 const gchar		*url);
+gboolean	 gs_screenshot_cache_save		(GsScreenshotCache	*self,
+							 GError			**error);
+
+G_END_DECLS
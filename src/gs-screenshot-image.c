@@ -13,10 +13,14 @@
 #include <glib/gi18n.h>
 
 #include "gs-screenshot-image.h"
+#include "gs-screenshot-cache.h"
 #include "gs-common.h"
 
 #define SPINNER_TIMEOUT_SECS 2
 
+/* how often to redraw a partially downloaded screenshot */
+#define PROGRESSIVE_UPDATE_INTERVAL_USEC (100 * 1000)
+
 struct _GsScreenshotImage
 {
 	GtkBin		 parent_instance;
@@ -28,9 +32,13 @@ struct _GsScreenshotImage
 	GtkWidget	*image1;
 	GtkWidget	*image2;
 	GtkWidget	*label_error;
-	GSettings	*settings;
 	SoupSession	*session;
 	SoupMessage	*message;
+	GdkPixbufLoader	*pixbuf_loader;
+	GCancellable	*cancellable;
+	gulong		 cancelled_id;
+	gint64		 progressive_update_time;
+	gchar		*url;
 	gchar		*filename;
 	const gchar	*current_image;
 	guint		 width;
@@ -42,6 +50,13 @@ struct _GsScreenshotImage
 
 G_DEFINE_TYPE (GsScreenshotImage, gs_screenshot_image, GTK_TYPE_BIN)
 
+enum {
+	SIGNAL_LOADED,
+	SIGNAL_LAST
+};
+
+static guint signals [SIGNAL_LAST] = { 0 };
+
 AsScreenshot *
 gs_screenshot_image_get_screenshot (GsScreenshotImage *ssimg)
 {
@@ -237,82 +252,224 @@ gs_screenshot_image_save_downloaded_img (GsScreenshotImage *ssimg,
 					 GdkPixbuf *pixbuf,
 					 GError **error)
 {
-	gboolean ret;
-	const GPtrArray *images;
+	GsScreenshotCache *cache = gs_screenshot_cache_get_default ();
+	guint width = ssimg->width * ssimg->scale;
+	guint height = ssimg->height * ssimg->scale;
+	g_autofree gchar *filename = NULL;
+
+	filename = gs_screenshot_cache_get_filename (cache, ssimg->url,
+						     width, height, error);
+	if (filename == NULL)
+		return FALSE;
+	if (!gs_pixbuf_save_filename (pixbuf, filename, width, height, error))
+		return FALSE;
+	gs_screenshot_cache_add (cache, ssimg->url, width, height);
+
+	g_free (ssimg->filename);
+	ssimg->filename = g_steal_pointer (&filename);
+	return TRUE;
+}
+
+/* any other size of the same screenshot can be derived from the original
+ * without downloading it again, e.g. the thumbnail when the screenshot only
+ * has one image */
+static gchar *
+gs_screenshot_image_get_cached (GsScreenshotCache *cache,
+				const gchar *url,
+				guint width,
+				guint height)
+{
+	gint original_width = 0;
+	gint original_height = 0;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *filename_original = NULL;
+	g_autoptr(GdkPixbuf) pixbuf = NULL;
 	g_autoptr(GError) error_local = NULL;
-	g_autofree char *filename = NULL;
-	g_autofree char *size_dir = NULL;
-	g_autofree char *cache_kind = NULL;
-	g_autofree char *basename = NULL;
-	guint width = ssimg->width;
-	guint height = ssimg->height;
-
-	ret = gs_pixbuf_save_filename (pixbuf, ssimg->filename,
-				      ssimg->width * ssimg->scale,
-				      ssimg->height * ssimg->scale,
-				      error);
 
-	if (!ret)
-		return FALSE;
+	filename = gs_screenshot_cache_lookup (cache, url, width, height);
+	if (filename != NULL)
+		return g_steal_pointer (&filename);
+	if (width == GS_SCREENSHOT_CACHE_SIZE_ORIGINAL ||
+	    height == GS_SCREENSHOT_CACHE_SIZE_ORIGINAL)
+		return NULL;
+	filename_original = gs_screenshot_cache_lookup (cache, url,
+							GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+							GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	if (filename_original == NULL)
+		return NULL;
+
+	/* already the correct size */
+	if (gdk_pixbuf_get_file_info (filename_original,
+				      &original_width,
+				      &original_height) != NULL &&
+	    (guint) original_width == width &&
+	    (guint) original_height == height)
+		return g_steal_pointer (&filename_original);
+
+	pixbuf = gdk_pixbuf_new_from_file (filename_original, &error_local);
+	if (pixbuf == NULL) {
+		g_debug ("failed to load cached screenshot %s: %s",
+			 filename_original, error_local->message);
+		gs_screenshot_cache_invalidate (cache, url);
+		return NULL;
+	}
+	filename = gs_screenshot_cache_get_filename (cache, url, width, height,
+						     &error_local);
+	if (filename == NULL) {
+		g_warning ("Failed to get cache filename for screenshot '%s': %s",
+			   url, error_local->message);
+		return NULL;
+	}
+	if (!gs_pixbuf_save_filename (pixbuf, filename, width, height, &error_local)) {
+		g_warning ("Failed to save screenshot '%s': %s",
+			   filename, error_local->message);
+		return NULL;
+	}
+	gs_screenshot_cache_add (cache, url, width, height);
+	return g_steal_pointer (&filename);
+}
+
+static void
+gs_screenshot_image_stop_progressive (GsScreenshotImage *ssimg)
+{
+	if (ssimg->pixbuf_loader == NULL)
+		return;
+	g_signal_handlers_disconnect_by_data (ssimg->pixbuf_loader, ssimg);
+	gdk_pixbuf_loader_close (ssimg->pixbuf_loader, NULL);
+	g_clear_object (&ssimg->pixbuf_loader);
+}
 
-	if (ssimg->screenshot == NULL)
-		return TRUE;
+static void
+gs_screenshot_image_size_prepared_cb (GdkPixbufLoader *loader,
+				      gint width,
+				      gint height,
+				      gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	gint64 width_max = (gint64) ssimg->width * ssimg->scale;
+	gint64 height_max = (gint64) ssimg->height * ssimg->scale;
 
-	images = as_screenshot_get_images (ssimg->screenshot);
-	if (images->len > 1)
-		return TRUE;
+	if (width <= 0 || height <= 0)
+		return;
 
-	if (width == AS_IMAGE_THUMBNAIL_WIDTH &&
-	    height == AS_IMAGE_THUMBNAIL_HEIGHT) {
-		width = AS_IMAGE_NORMAL_WIDTH;
-		height = AS_IMAGE_NORMAL_HEIGHT;
+	/* decode straight to the size being shown, keeping the aspect ratio */
+	if ((gint64) width * height_max > (gint64) height * width_max) {
+		height_max = MAX ((gint64) height * width_max / width, 1);
 	} else {
-		width = AS_IMAGE_THUMBNAIL_WIDTH;
-		height = AS_IMAGE_THUMBNAIL_HEIGHT;
+		width_max = MAX ((gint64) width * height_max / height, 1);
 	}
+	gdk_pixbuf_loader_set_size (loader, (gint) width_max, (gint) height_max);
+}
 
-	width *= ssimg->scale;
-	height *= ssimg->scale;
-	basename = g_path_get_basename (ssimg->filename);
-	size_dir = g_strdup_printf ("%ux%u", width, height);
-	cache_kind = g_build_filename ("screenshots", size_dir, NULL);
-	filename = gs_utils_get_cache_filename (cache_kind, basename,
-						GS_UTILS_CACHE_FLAG_WRITEABLE |
-						GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
-						&error_local);
-
-        if (filename == NULL) {
-		/* if we cannot get a cache filename, warn about that but do not
-		 * set a user's visible error because this is a complementary
-		 * operation */
-                g_warning ("Failed to get cache filename for counterpart "
-                           "screenshot '%s' in folder '%s': %s", basename,
-                           cache_kind, error_local->message);
-                return TRUE;
-        }
-
-	ret = gs_pixbuf_save_filename (pixbuf, filename,
-					width, height,
-					&error_local);
-
-	if (!ret) {
-		/* if we cannot save this screenshot, warn about that but do not
-		 * set a user's visible error because this is a complementary
-		 * operation */
-                g_warning ("Failed to save screenshot '%s': %s", filename,
-                           error_local->message);
-        }
+static void
+gs_screenshot_image_area_prepared_cb (GdkPixbufLoader *loader,
+				      gpointer user_data)
+{
+	GdkPixbuf *pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
 
-	return TRUE;
+	/* the parts which have not been decoded yet are undefined */
+	if (pixbuf != NULL)
+		gdk_pixbuf_fill (pixbuf, 0x00000000);
 }
 
 static void
-gs_screenshot_image_complete_cb (SoupSession *session,
-				 SoupMessage *msg,
-				 gpointer user_data)
+gs_screenshot_image_area_updated_cb (GdkPixbufLoader *loader,
+				     gint x,
+				     gint y,
+				     gint width,
+				     gint height,
+				     gpointer user_data)
 {
-	g_autoptr(GsScreenshotImage) ssimg = GS_SCREENSHOT_IMAGE (user_data);
-	gboolean ret;
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	GdkPixbuf *pixbuf;
+	GtkWidget *image;
+	gint64 now = g_get_monotonic_time ();
+
+	if (now - ssimg->progressive_update_time < PROGRESSIVE_UPDATE_INTERVAL_USEC)
+		return;
+	ssimg->progressive_update_time = now;
+
+	pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+	if (pixbuf == NULL)
+		return;
+	image = gtk_stack_get_visible_child (GTK_STACK (ssimg->stack));
+	if (image != ssimg->image1 && image != ssimg->image2)
+		return;
+	gs_image_set_from_pixbuf_with_scale (GTK_IMAGE (image), pixbuf, (gint) ssimg->scale);
+}
+
+static void
+gs_screenshot_image_got_chunk_cb (SoupMessage *msg,
+				  SoupBuffer *chunk,
+				  gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	g_autoptr(GError) error_local = NULL;
+
+	if (ssimg->pixbuf_loader == NULL || msg->status_code != SOUP_STATUS_OK)
+		return;
+	if (!gdk_pixbuf_loader_write (ssimg->pixbuf_loader,
+				      (const guchar *) chunk->data,
+				      chunk->length,
+				      &error_local)) {
+		/* not fatal, the whole image is decoded once downloaded */
+		g_debug ("failed to progressively load %s: %s",
+			 ssimg->url, error_local->message);
+		gs_screenshot_image_stop_progressive (ssimg);
+	}
+}
+
+/* decode the screenshot as it arrives so that large images are shown
+ * before they have finished downloading */
+static void
+gs_screenshot_image_start_progressive (GsScreenshotImage *ssimg)
+{
+	gs_screenshot_image_stop_progressive (ssimg);
+	if (ssimg->width == G_MAXUINT || ssimg->height == G_MAXUINT)
+		return;
+
+	ssimg->pixbuf_loader = gdk_pixbuf_loader_new ();
+	ssimg->progressive_update_time = 0;
+	g_signal_connect (ssimg->pixbuf_loader, "size-prepared",
+			  G_CALLBACK (gs_screenshot_image_size_prepared_cb), ssimg);
+	g_signal_connect (ssimg->pixbuf_loader, "area-prepared",
+			  G_CALLBACK (gs_screenshot_image_area_prepared_cb), ssimg);
+	g_signal_connect (ssimg->pixbuf_loader, "area-updated",
+			  G_CALLBACK (gs_screenshot_image_area_updated_cb), ssimg);
+	g_signal_connect (ssimg->message, "got-chunk",
+			  G_CALLBACK (gs_screenshot_image_got_chunk_cb), ssimg);
+}
+
+static void
+gs_screenshot_image_disconnect_cancellable (GsScreenshotImage *ssimg)
+{
+	if (ssimg->cancellable == NULL)
+		return;
+	g_cancellable_disconnect (ssimg->cancellable, ssimg->cancelled_id);
+	ssimg->cancelled_id = 0;
+	g_clear_object (&ssimg->cancellable);
+}
+
+static void
+gs_screenshot_image_cancel_message (GsScreenshotImage *ssimg)
+{
+	g_autoptr(SoupMessage) msg = g_steal_pointer (&ssimg->message);
+
+	if (ssimg->load_timeout_id) {
+		g_source_remove (ssimg->load_timeout_id);
+		ssimg->load_timeout_id = 0;
+	}
+	gs_screenshot_image_stop_progressive (ssimg);
+	if (msg == NULL)
+		return;
+	g_signal_handlers_disconnect_by_data (msg, ssimg);
+	soup_session_cancel_message (ssimg->session, msg, SOUP_STATUS_CANCELLED);
+}
+
+static void
+gs_screenshot_image_complete (GsScreenshotImage *ssimg, SoupMessage *msg)
+{
+	GsScreenshotCache *cache;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GdkPixbuf) pixbuf = NULL;
 	g_autoptr(GInputStream) stream = NULL;
@@ -326,12 +483,6 @@ gs_screenshot_image_complete_cb (SoupSession *session,
 	if (msg->status_code == SOUP_STATUS_CANCELLED || ssimg->session == NULL)
 		return;
 
-	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
-		g_debug ("screenshot has not been modified");
-		as_screenshot_show_image (ssimg);
-		gs_screenshot_image_stop_spinner (ssimg);
-		return;
-	}
 	if (msg->status_code != SOUP_STATUS_OK) {
 		/* Ignore failures due to being offline */
 		if (msg->status_code != SOUP_STATUS_CANT_RESOLVE)
@@ -366,16 +517,31 @@ gs_screenshot_image_complete_cb (SoupSession *session,
 		return;
 	}
 
+	/* keep the original, which all the other sizes are derived from */
+	cache = gs_screenshot_cache_get_default ();
+	if (!gs_screenshot_cache_add_original (cache, ssimg->url,
+					       msg->response_body->data,
+					       (gsize) msg->response_body->length,
+					       &error)) {
+		g_warning ("Failed to save screenshot '%s': %s",
+			   ssimg->url, error->message);
+		/* TRANSLATORS: this is when we try create the cache directory
+		 * but we were out of space or permission was denied */
+		gs_screenshot_image_set_error (ssimg, _("Could not create cache"));
+		return;
+	}
+
 	/* is image size destination size unknown or exactly the correct size */
 	if (ssimg->width == G_MAXUINT || ssimg->height == G_MAXUINT ||
 	    (ssimg->width * ssimg->scale == (guint) gdk_pixbuf_get_width (pixbuf) &&
 	     ssimg->height * ssimg->scale == (guint) gdk_pixbuf_get_height (pixbuf))) {
-		ret = g_file_set_contents (ssimg->filename,
-					   msg->response_body->data,
-					   msg->response_body->length,
-					   &error);
-		if (!ret) {
-			gs_screenshot_image_set_error (ssimg, error->message);
+		g_free (ssimg->filename);
+		ssimg->filename = gs_screenshot_cache_lookup (cache, ssimg->url,
+							      GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+							      GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+		if (ssimg->filename == NULL) {
+			/* TRANSLATORS: possibly image file corrupt or not an image */
+			gs_screenshot_image_set_error (ssimg, _("Failed to load image"));
 			return;
 		}
 	} else if (!gs_screenshot_image_save_downloaded_img (ssimg, pixbuf,
@@ -388,6 +554,23 @@ gs_screenshot_image_complete_cb (SoupSession *session,
 	as_screenshot_show_image (ssimg);
 }
 
+static void
+gs_screenshot_image_complete_cb (SoupSession *session,
+				 SoupMessage *msg,
+				 gpointer user_data)
+{
+	g_autoptr(GsScreenshotImage) ssimg = GS_SCREENSHOT_IMAGE (user_data);
+
+	/* cancelled by loading another screenshot, or destroyed */
+	if (msg != ssimg->message)
+		return;
+
+	gs_screenshot_image_disconnect_cancellable (ssimg);
+	gs_screenshot_image_stop_progressive (ssimg);
+	gs_screenshot_image_complete (ssimg, msg);
+	g_signal_emit (ssimg, signals[SIGNAL_LOADED], 0);
+}
+
 void
 gs_screenshot_image_set_screenshot (GsScreenshotImage *ssimg,
 				    AsScreenshot *screenshot)
@@ -420,45 +603,6 @@ gs_screenshot_image_set_size (GsScreenshotImage *ssimg,
 	gtk_widget_set_size_request (ssimg->stack, (gint) width, (gint) height);
 }
 
-static gchar *
-gs_screenshot_get_cachefn_for_url (const gchar *url)
-{
-	g_autofree gchar *basename = NULL;
-	g_autofree gchar *checksum = NULL;
-	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, url, -1);
-	basename = g_path_get_basename (url);
-	return g_strdup_printf ("%s-%s", checksum, basename);
-}
-
-static void
-gs_screenshot_soup_msg_set_modified_request (SoupMessage *msg, GFile *file)
-{
-#ifndef GLIB_VERSION_2_62
-	GTimeVal time_val;
-#endif
-	g_autoptr(GDateTime) date_time = NULL;
-	g_autoptr(GFileInfo) info = NULL;
-	g_autofree gchar *mod_date = NULL;
-
-	info = g_file_query_info (file,
-				  G_FILE_ATTRIBUTE_TIME_MODIFIED,
-				  G_FILE_QUERY_INFO_NONE,
-				  NULL,
-				  NULL);
-	if (info == NULL)
-		return;
-#ifdef GLIB_VERSION_2_62
-	date_time = g_file_info_get_modification_date_time (info);
-#else
-	g_file_info_get_modification_time (info, &time_val);
-	date_time = g_date_time_new_from_timeval_local (&time_val);
-#endif
-	mod_date = g_date_time_format (date_time, "%a, %d %b %Y %H:%M:%S %Z");
-	soup_message_headers_append (msg->request_headers,
-				     "If-Modified-Since",
-				     mod_date);
-}
-
 static gboolean
 gs_screenshot_show_spinner_cb (gpointer user_data)
 {
@@ -470,23 +614,26 @@ gs_screenshot_show_spinner_cb (gpointer user_data)
 	return FALSE;
 }
 
-void
-gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
-				GCancellable *cancellable)
+/* returns %TRUE if the screenshot is being downloaded */
+static gboolean
+gs_screenshot_image_start_load (GsScreenshotImage *ssimg)
 {
 	AsImage *im = NULL;
+	GsScreenshotCache *cache;
 	const gchar *url;
-	g_autofree gchar *basename = NULL;
-	g_autofree gchar *cache_kind = NULL;
+	guint width;
+	guint height;
 	g_autofree gchar *cachefn_thumb = NULL;
-	g_autofree gchar *sizedir = NULL;
 	g_autoptr(SoupURI) base_uri = NULL;
 
-	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
+	g_return_val_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg), FALSE);
+
+	g_return_val_if_fail (AS_IS_SCREENSHOT (ssimg->screenshot), FALSE);
+	g_return_val_if_fail (ssimg->width != 0, FALSE);
+	g_return_val_if_fail (ssimg->height != 0, FALSE);
 
-	g_return_if_fail (AS_IS_SCREENSHOT (ssimg->screenshot));
-	g_return_if_fail (ssimg->width != 0);
-	g_return_if_fail (ssimg->height != 0);
+	/* whatever was being downloaded is no longer wanted */
+	gs_screenshot_image_cancel_message (ssimg);
 
 	/* load an image according to the scale factor */
 	ssimg->scale = (guint) gtk_widget_get_scale_factor (GTK_WIDGET (ssimg));
@@ -505,7 +652,7 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		/* TRANSLATORS: this is when we request a screenshot size that
 		 * the generator did not create or the parser did not add */
 		gs_screenshot_image_set_error (ssimg, _("Screenshot size not found"));
-		return;
+		return FALSE;
 	}
 
 	/* check if the URL points to a local file */
@@ -515,40 +662,31 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 		ssimg->filename = g_strdup (url + 7);
 		if (g_file_test (ssimg->filename, G_FILE_TEST_EXISTS)) {
 			as_screenshot_show_image (ssimg);
-			return;
+			return FALSE;
 		}
 	}
 
-	basename = gs_screenshot_get_cachefn_for_url (url);
+	cache = gs_screenshot_cache_get_default ();
+	g_free (ssimg->url);
+	ssimg->url = g_strdup (url);
 	if (ssimg->width == G_MAXUINT || ssimg->height == G_MAXUINT) {
-		sizedir = g_strdup ("unknown");
+		width = GS_SCREENSHOT_CACHE_SIZE_ORIGINAL;
+		height = GS_SCREENSHOT_CACHE_SIZE_ORIGINAL;
 	} else {
-		sizedir = g_strdup_printf ("%ux%u", ssimg->width * ssimg->scale, ssimg->height * ssimg->scale);
+		width = ssimg->width * ssimg->scale;
+		height = ssimg->height * ssimg->scale;
 	}
-	cache_kind = g_build_filename ("screenshots", sizedir, NULL);
 	g_free (ssimg->filename);
-	ssimg->filename = gs_utils_get_cache_filename (cache_kind,
-						       basename,
-						       GS_UTILS_CACHE_FLAG_NONE,
-						       NULL);
-	g_assert (ssimg->filename != NULL);
-
-	/* does local file already exist and has recently been downloaded */
-	if (g_file_test (ssimg->filename, G_FILE_TEST_EXISTS)) {
-		guint64 age_max;
-		g_autoptr(GFile) file = NULL;
-
-		/* show the image we have in cache while we're checking for the
-		 * new screenshot (which probably won't have changed) */
-		as_screenshot_show_image (ssimg);
+	ssimg->filename = gs_screenshot_image_get_cached (cache, url, width, height);
 
-		/* verify the cache age against the maximum allowed */
-		age_max = g_settings_get_uint (ssimg->settings,
-					       "screenshot-cache-age-maximum");
-		file = g_file_new_for_path (ssimg->filename);
-		/* image new enough, not re-requesting from server */
-		if (age_max > 0 && gs_utils_get_file_age (file) < age_max)
-			return;
+	/* show the image we have in cache, and check for a new screenshot
+	 * (which probably won't have changed) in the background so it is
+	 * used the next time */
+	if (ssimg->filename != NULL) {
+		as_screenshot_show_image (ssimg);
+		if (gs_screenshot_cache_needs_revalidate (cache, url))
+			gs_screenshot_cache_queue_revalidate (cache, url);
+		return FALSE;
 	}
 
 	/* if we're not showing a full-size image, we try loading a blurred
@@ -556,84 +694,93 @@ gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
 	if (!ssimg->showing_image &&
 	    ssimg->width > AS_IMAGE_THUMBNAIL_WIDTH &&
 	    ssimg->height > AS_IMAGE_THUMBNAIL_HEIGHT) {
-		const gchar *url_thumb;
-		g_autofree gchar *basename_thumb = NULL;
-		g_autofree gchar *cache_kind_thumb = NULL;
 		im = as_screenshot_get_image (ssimg->screenshot,
 					      AS_IMAGE_THUMBNAIL_WIDTH * ssimg->scale,
 					      AS_IMAGE_THUMBNAIL_HEIGHT * ssimg->scale);
-		url_thumb = as_image_get_url (im);
-		basename_thumb = gs_screenshot_get_cachefn_for_url (url_thumb);
-		cache_kind_thumb = g_build_filename ("screenshots", "112x63", NULL);
-		cachefn_thumb = gs_utils_get_cache_filename (cache_kind_thumb,
-							     basename_thumb,
-							     GS_UTILS_CACHE_FLAG_NONE,
-							     NULL);
-		g_assert (cachefn_thumb != NULL);
-		if (g_file_test (cachefn_thumb, G_FILE_TEST_EXISTS))
-			gs_screenshot_image_show_blurred (ssimg, cachefn_thumb);
-	}
-
-	/* re-request the cache filename, which might be different as it needs
-	 * to be writable this time */
-	g_free (ssimg->filename);
-	ssimg->filename = gs_utils_get_cache_filename (cache_kind,
-						       basename,
-						       GS_UTILS_CACHE_FLAG_WRITEABLE |
-						       GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
-						       NULL);
-	if (ssimg->filename == NULL) {
-		/* TRANSLATORS: this is when we try create the cache directory
-		 * but we were out of space or permission was denied */
-		gs_screenshot_image_set_error (ssimg, _("Could not create cache"));
-		return;
+		if (im != NULL) {
+			const gchar *url_thumb = as_image_get_url (im);
+			cachefn_thumb = gs_screenshot_cache_lookup (cache, url_thumb,
+								    AS_IMAGE_THUMBNAIL_WIDTH * ssimg->scale,
+								    AS_IMAGE_THUMBNAIL_HEIGHT * ssimg->scale);
+			if (cachefn_thumb == NULL) {
+				cachefn_thumb = gs_screenshot_cache_lookup (cache, url_thumb,
+									    GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+									    GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+			}
+			if (cachefn_thumb != NULL)
+				gs_screenshot_image_show_blurred (ssimg, cachefn_thumb);
+		}
 	}
 
 	/* download file */
-	g_debug ("downloading %s to %s", url, ssimg->filename);
+	g_debug ("downloading %s", url);
 	base_uri = soup_uri_new (url);
 	if (base_uri == NULL || !SOUP_URI_VALID_FOR_HTTP (base_uri)) {
 		/* TRANSLATORS: this is when we try to download a screenshot
 		 * that was not a valid URL */
 		gs_screenshot_image_set_error (ssimg, _("Screenshot not valid"));
-		return;
-	}
-
-	if (ssimg->load_timeout_id) {
-		g_source_remove (ssimg->load_timeout_id);
-		ssimg->load_timeout_id = 0;
-	}
-
-	/* cancel any previous messages */
-	if (ssimg->message != NULL) {
-		soup_session_cancel_message (ssimg->session,
-		                             ssimg->message,
-		                             SOUP_STATUS_CANCELLED);
-		g_clear_object (&ssimg->message);
+		return FALSE;
 	}
 
 	ssimg->message = soup_message_new_from_uri (SOUP_METHOD_GET, base_uri);
 	if (ssimg->message == NULL) {
 		/* TRANSLATORS: this is when networking is not available */
 		gs_screenshot_image_set_error (ssimg, _("Screenshot not available"));
-		return;
-	}
-
-	/* not all servers support If-Modified-Since, but worst case we just
-	 * re-download the entire file again every 30 days */
-	if (g_file_test (ssimg->filename, G_FILE_TEST_EXISTS)) {
-		g_autoptr(GFile) file = g_file_new_for_path (ssimg->filename);
-		gs_screenshot_soup_msg_set_modified_request (ssimg->message, file);
+		return FALSE;
 	}
 
 	ssimg->load_timeout_id = g_timeout_add_seconds (SPINNER_TIMEOUT_SECS,
 		gs_screenshot_show_spinner_cb, ssimg);
 
+	gs_screenshot_image_start_progressive (ssimg);
+
 	/* send async */
 	soup_session_queue_message (ssimg->session,
 				    g_object_ref (ssimg->message) /* transfer full */,
 				    gs_screenshot_image_complete_cb,
 				    g_object_ref (ssimg));
+	return TRUE;
+}
+
+/* only ever cancelled from the main thread; the handler is disconnected
+ * once the download finishes or the widget is destroyed */
+static void
+gs_screenshot_image_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (user_data);
+	gs_screenshot_image_cancel_message (ssimg);
+}
+
+/**
+ * gs_screenshot_image_load_async:
+ * @ssimg: a #GsScreenshotImage
+ * @cancellable: a #GCancellable, or %NULL
+ *
+ * Loads the screenshot, from the cache if possible. The #GsScreenshotImage::loaded
+ * signal is emitted once the image is shown or has failed to load, which
+ * happens before this returns if no download was required. Cancelling
+ * @cancellable stops the download, and then the signal is not emitted.
+ */
+void
+gs_screenshot_image_load_async (GsScreenshotImage *ssimg,
+				GCancellable *cancellable)
+{
+	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
+
+	gs_screenshot_image_disconnect_cancellable (ssimg);
+	if (cancellable != NULL && g_cancellable_is_cancelled (cancellable))
+		return;
+	if (gs_screenshot_image_start_load (ssimg)) {
+		/* stop the download too if the caller gives up on it */
+		if (cancellable != NULL) {
+			ssimg->cancellable = g_object_ref (cancellable);
+			ssimg->cancelled_id = g_cancellable_connect (cancellable,
+								     G_CALLBACK (gs_screenshot_image_cancelled_cb),
+								     ssimg, NULL);
+		}
+		return;
+	}
+	g_signal_emit (ssimg, signals[SIGNAL_LOADED], 0);
 }
 
 gboolean
@@ -647,21 +794,12 @@ gs_screenshot_image_destroy (GtkWidget *widget)
 {
 	GsScreenshotImage *ssimg = GS_SCREENSHOT_IMAGE (widget);
 
-	if (ssimg->load_timeout_id) {
-		g_source_remove (ssimg->load_timeout_id);
-		ssimg->load_timeout_id = 0;
-	}
-
-	if (ssimg->message != NULL) {
-		soup_session_cancel_message (ssimg->session,
-		                             ssimg->message,
-		                             SOUP_STATUS_CANCELLED);
-		g_clear_object (&ssimg->message);
-	}
+	gs_screenshot_image_disconnect_cancellable (ssimg);
+	gs_screenshot_image_cancel_message (ssimg);
 	g_clear_object (&ssimg->screenshot);
 	g_clear_object (&ssimg->session);
-	g_clear_object (&ssimg->settings);
 
+	g_clear_pointer (&ssimg->url, g_free);
 	g_clear_pointer (&ssimg->filename, g_free);
 
 	GTK_WIDGET_CLASS (gs_screenshot_image_parent_class)->destroy (widget);
@@ -672,7 +810,6 @@ gs_screenshot_image_init (GsScreenshotImage *ssimg)
 {
 	AtkObject *accessible;
 
-	ssimg->settings = g_settings_new ("org.gnome.software");
 	ssimg->showing_image = FALSE;
 
 	gtk_widget_set_has_window (GTK_WIDGET (ssimg), FALSE);
@@ -711,6 +848,12 @@ gs_screenshot_image_class_init (GsScreenshotImageClass *klass)
 	widget_class->destroy = gs_screenshot_image_destroy;
 	widget_class->draw = gs_screenshot_image_draw;
 
+	signals [SIGNAL_LOADED] =
+		g_signal_new ("loaded",
+			      G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
+
 	gtk_widget_class_set_template_from_resource (widget_class,
 						     "/org/gnome/Software/gs-screenshot-image.ui");
 
@@ -0,0 +1,267 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-screenshot-loader
+ * @title: GsScreenshotLoader
+ * @stability: Unstable
+ * @short_description: Loads screenshots in priority order
+ *
+ * Rather than every #GsScreenshotImage starting its download at once, the
+ * images are queued here and only a few are loaded at a time. The visible
+ * screenshot should be given priority 0, with its neighbours having
+ * increasingly larger values so that the screenshots furthest away from
+ * the one being looked at are deferred until last.
+ *
+ * Images which are already cached are shown as soon as they are dispatched
+ * and do not hold up the queue.
+ */
+
+#include "config.h"
+
+#include "gs-screenshot-loader.h"
+
+/* the number of screenshots downloading at any one time */
+#define GS_SCREENSHOT_LOADER_MAX_PARALLEL	2
+
+typedef struct {
+	GsScreenshotImage	*ssimg;
+	guint			 priority;
+	guint64			 serial;	/* keeps the sort stable */
+	gulong			 loaded_id;
+	gulong			 destroy_id;
+} GsScreenshotLoaderItem;
+
+struct _GsScreenshotLoader
+{
+	GObject			 parent_instance;
+
+	GPtrArray		*pending;	/* of GsScreenshotLoaderItem */
+	GPtrArray		*active;	/* of GsScreenshotLoaderItem */
+	GCancellable		*cancellable;
+	guint64			 serial;
+	gboolean		 dispatching;
+};
+
+G_DEFINE_TYPE (GsScreenshotLoader, gs_screenshot_loader, G_TYPE_OBJECT)
+
+static void
+gs_screenshot_loader_item_free (GsScreenshotLoaderItem *item)
+{
+	if (item->loaded_id != 0)
+		g_signal_handler_disconnect (item->ssimg, item->loaded_id);
+	if (item->destroy_id != 0)
+		g_signal_handler_disconnect (item->ssimg, item->destroy_id);
+	g_object_unref (item->ssimg);
+	g_slice_free (GsScreenshotLoaderItem, item);
+}
+
+static GsScreenshotLoaderItem *
+gs_screenshot_loader_find (GPtrArray *array, GsScreenshotImage *ssimg, guint *idx)
+{
+	for (guint i = 0; i < array->len; i++) {
+		GsScreenshotLoaderItem *item = g_ptr_array_index (array, i);
+		if (item->ssimg == ssimg) {
+			if (idx != NULL)
+				*idx = i;
+			return item;
+		}
+	}
+	return NULL;
+}
+
+static void gs_screenshot_loader_dispatch (GsScreenshotLoader *self);
+
+static void
+gs_screenshot_loader_loaded_cb (GsScreenshotImage *ssimg, gpointer user_data)
+{
+	GsScreenshotLoader *self = GS_SCREENSHOT_LOADER (user_data);
+	guint idx;
+
+	if (gs_screenshot_loader_find (self->active, ssimg, &idx) == NULL)
+		return;
+	g_ptr_array_remove_index (self->active, idx);
+	gs_screenshot_loader_dispatch (self);
+}
+
+/* a destroyed image never emits ::loaded, so give up its slot */
+static void
+gs_screenshot_loader_destroy_cb (GsScreenshotImage *ssimg, gpointer user_data)
+{
+	GsScreenshotLoader *self = GS_SCREENSHOT_LOADER (user_data);
+	guint idx;
+
+	if (gs_screenshot_loader_find (self->pending, ssimg, &idx) != NULL) {
+		g_ptr_array_remove_index (self->pending, idx);
+		return;
+	}
+	if (gs_screenshot_loader_find (self->active, ssimg, &idx) != NULL) {
+		g_ptr_array_remove_index (self->active, idx);
+		gs_screenshot_loader_dispatch (self);
+	}
+}
+
+static GsScreenshotLoaderItem *
+gs_screenshot_loader_pop_best (GsScreenshotLoader *self)
+{
+	GsScreenshotLoaderItem *best = NULL;
+	guint best_idx = 0;
+
+	for (guint i = 0; i < self->pending->len; i++) {
+		GsScreenshotLoaderItem *item = g_ptr_array_index (self->pending, i);
+		if (best == NULL ||
+		    item->priority < best->priority ||
+		    (item->priority == best->priority && item->serial < best->serial)) {
+			best = item;
+			best_idx = i;
+		}
+	}
+	if (best != NULL)
+		g_ptr_array_remove_index (self->pending, best_idx);
+	return best;
+}
+
+static void
+gs_screenshot_loader_dispatch (GsScreenshotLoader *self)
+{
+	/* images which are cached complete synchronously, in which case the
+	 * loaded handler ends up back here */
+	if (self->dispatching)
+		return;
+	self->dispatching = TRUE;
+	while (self->active->len < GS_SCREENSHOT_LOADER_MAX_PARALLEL) {
+		GsScreenshotLoaderItem *item = gs_screenshot_loader_pop_best (self);
+		if (item == NULL)
+			break;
+		g_ptr_array_add (self->active, item);
+		item->loaded_id = g_signal_connect (item->ssimg, "loaded",
+						    G_CALLBACK (gs_screenshot_loader_loaded_cb),
+						    self);
+		gs_screenshot_image_load_async (item->ssimg, self->cancellable);
+	}
+	self->dispatching = FALSE;
+}
+
+/**
+ * gs_screenshot_loader_add:
+ * @self: a #GsScreenshotLoader
+ * @ssimg: a #GsScreenshotImage with the screenshot and size already set
+ * @priority: the priority, where lower values are loaded first
+ *
+ * Queues @ssimg to be loaded. If there is a free slot the image starts
+ * loading straight away.
+ */
+void
+gs_screenshot_loader_add (GsScreenshotLoader *self,
+			  GsScreenshotImage *ssimg,
+			  guint priority)
+{
+	GsScreenshotLoaderItem *item;
+	guint idx;
+
+	g_return_if_fail (GS_IS_SCREENSHOT_LOADER (self));
+	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
+
+	/* already loading, so it would be restarted by loading it again */
+	if (gs_screenshot_loader_find (self->active, ssimg, NULL) != NULL)
+		return;
+	item = gs_screenshot_loader_find (self->pending, ssimg, &idx);
+	if (item != NULL) {
+		item->priority = MIN (item->priority, priority);
+	} else {
+		item = g_slice_new0 (GsScreenshotLoaderItem);
+		item->ssimg = g_object_ref (ssimg);
+		item->priority = priority;
+		item->serial = self->serial++;
+		item->destroy_id = g_signal_connect (ssimg, "destroy",
+						     G_CALLBACK (gs_screenshot_loader_destroy_cb),
+						     self);
+		g_ptr_array_add (self->pending, item);
+	}
+	gs_screenshot_loader_dispatch (self);
+}
+
+/**
+ * gs_screenshot_loader_set_priority:
+ * @self: a #GsScreenshotLoader
+ * @ssimg: a #GsScreenshotImage
+ * @priority: the priority, where lower values are loaded first
+ *
+ * Changes the priority of an image which has not started loading yet,
+ * for instance when a different screenshot has been selected.
+ */
+void
+gs_screenshot_loader_set_priority (GsScreenshotLoader *self,
+				   GsScreenshotImage *ssimg,
+				   guint priority)
+{
+	GsScreenshotLoaderItem *item;
+
+	g_return_if_fail (GS_IS_SCREENSHOT_LOADER (self));
+	g_return_if_fail (GS_IS_SCREENSHOT_IMAGE (ssimg));
+
+	item = gs_screenshot_loader_find (self->pending, ssimg, NULL);
+	if (item != NULL)
+		item->priority = priority;
+}
+
+/**
+ * gs_screenshot_loader_clear:
+ * @self: a #GsScreenshotLoader
+ *
+ * Cancels all the images being loaded and drops the queue, e.g. when
+ * showing a different application. The downloads which are in progress are
+ * stopped too.
+ */
+void
+gs_screenshot_loader_clear (GsScreenshotLoader *self)
+{
+	g_return_if_fail (GS_IS_SCREENSHOT_LOADER (self));
+
+	/* drop the queue first so that nothing new gets dispatched as the
+	 * active images get cancelled */
+	g_ptr_array_set_size (self->pending, 0);
+	g_cancellable_cancel (self->cancellable);
+	g_clear_object (&self->cancellable);
+	self->cancellable = g_cancellable_new ();
+	g_ptr_array_set_size (self->active, 0);
+}
+
+static void
+gs_screenshot_loader_dispose (GObject *object)
+{
+	GsScreenshotLoader *self = GS_SCREENSHOT_LOADER (object);
+
+	g_cancellable_cancel (self->cancellable);
+	g_clear_object (&self->cancellable);
+	g_clear_pointer (&self->pending, g_ptr_array_unref);
+	g_clear_pointer (&self->active, g_ptr_array_unref);
+
+	G_OBJECT_CLASS (gs_screenshot_loader_parent_class)->dispose (object);
+}
+
+static void
+gs_screenshot_loader_class_init (GsScreenshotLoaderClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->dispose = gs_screenshot_loader_dispose;
+}
+
+static void
+gs_screenshot_loader_init (GsScreenshotLoader *self)
+{
+	self->pending = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_screenshot_loader_item_free);
+	self->active = g_ptr_array_new_with_free_func ((GDestroyNotify) gs_screenshot_loader_item_free);
+	self->cancellable = g_cancellable_new ();
+}
+
+GsScreenshotLoader *
+gs_screenshot_loader_new (void)
+{
+	return GS_SCREENSHOT_LOADER (g_object_new (GS_TYPE_SCREENSHOT_LOADER, NULL));
+}
@@ -0,0 +1,30 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "gs-screenshot-image.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_SCREENSHOT_LOADER (gs_screenshot_loader_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsScreenshotLoader, gs_screenshot_loader, GS, SCREENSHOT_LOADER, GObject)
+
+GsScreenshotLoader *gs_screenshot_loader_new		(void);
+void		 gs_screenshot_loader_add		(GsScreenshotLoader	*self,
+							 GsScreenshotImage	*ssimg,
+							 guint			 priority);
+void		 gs_screenshot_loader_set_priority	(GsScreenshotLoader	*self,
+							 GsScreenshotImage	*ssimg,
+							 guint			 priority);
+void		 gs_screenshot_loader_clear		(GsScreenshotLoader	*self);
+
+G_END_DECLS
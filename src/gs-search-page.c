@@ -197,14 +197,14 @@ gs_search_page_waiting_show_cb (gpointer user_data)
 }
 
 static gchar *
-gs_search_page_get_app_sort_key (GsApp *app)
+gs_search_page_get_app_sort_key (GsApp *app, gpointer user_data)
 {
 	GString *key = g_string_sized_new (64);
 
 	/* sort apps before runtimes and extensions */
 	switch (gs_app_get_kind (app)) {
 	case AS_COMPONENT_KIND_DESKTOP_APP:
-		g_string_append (key, "9:");
+		g_string_append (key, "0:");
 		break;
 	default:
 		g_string_append (key, "1:");
@@ -214,35 +214,25 @@ gs_search_page_get_app_sort_key (GsApp *app)
 	/* sort missing codecs before applications */
 	switch (gs_app_get_state (app)) {
 	case GS_APP_STATE_UNAVAILABLE:
-		g_string_append (key, "9:");
+		g_string_append (key, "0:");
 		break;
 	default:
 		g_string_append (key, "1:");
 		break;
 	}
 
-	/* sort by the search key */
-	g_string_append_printf (key, "%05x:", gs_app_get_match_value (app));
+	/* sort by the search key, best first */
+	g_string_append_printf (key, "%08x:", G_MAXUINT - gs_app_get_match_value (app));
 
-	/* sort by rating */
-	g_string_append_printf (key, "%03i:", gs_app_get_rating (app));
+	/* sort by rating, best first */
+	g_string_append_printf (key, "%03i:", 100 - gs_app_get_rating (app));
 
-	/* sort by kudos */
-	g_string_append_printf (key, "%03u:", gs_app_get_kudos_percentage (app));
+	/* sort by kudos, most first */
+	g_string_append_printf (key, "%03u:", 100 - gs_app_get_kudos_percentage (app));
 
 	return g_string_free (key, FALSE);
 }
 
-static gboolean
-gs_search_page_sort_cb (GsApp *app1, GsApp *app2, gpointer user_data)
-{
-	g_autofree gchar *key1 = NULL;
-	g_autofree gchar *key2 = NULL;
-	key1 = gs_search_page_get_app_sort_key (app1);
-	key2 = gs_search_page_get_app_sort_key (app2);
-	return g_strcmp0 (key2, key1);
-}
-
 static void
 gs_search_page_load (GsSearchPage *self)
 {
@@ -274,7 +264,7 @@ gs_search_page_load (GsSearchPage *self)
 					 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
 							 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
 					 NULL);
-	gs_plugin_job_set_sort_func (plugin_job, gs_search_page_sort_cb);
+	gs_plugin_job_set_sort_key_func (plugin_job, gs_search_page_get_app_sort_key);
 	gs_plugin_job_set_sort_func_data (plugin_job, self);
 	gs_plugin_loader_job_process_async (self->plugin_loader, plugin_job,
 					    self->search_cancellable,
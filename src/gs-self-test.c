@@ -8,9 +8,15 @@
 
 #include "config.h"
 
+#include <glib/gstdio.h>
+
 #include "gnome-software-private.h"
 
 #include "gs-css.h"
+#include "gs-overview-snapshot.h"
+#include "gs-screenshot-cache.h"
+#include "gs-shell-search-provider.h"
+#include "gs-size-service.h"
 #include "gs-test.h"
 
 static void
@@ -40,6 +46,258 @@ gs_css_func (void)
 	g_assert_cmpstr (tmp, ==, "color: white;");
 }
 
+static void
+gs_overview_snapshot_func (void)
+{
+	gboolean ret;
+	GArray *key_colors_loaded;
+	GPtrArray *icons;
+	GsApp *app_loaded;
+	GdkRGBA color = { 0.25, 0.5, 0.75, 1.0 };
+	g_autoptr(GArray) key_colors = g_array_new (FALSE, FALSE, sizeof (GdkRGBA));
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path ("/nonexistent/snapshot.png");
+	g_autoptr(GIcon) icon_file = g_file_icon_new (file);
+	g_autoptr(GIcon) icon_themed = g_themed_icon_new ("org.example.Snapshot");
+	g_autoptr(GPtrArray) section_ids = NULL;
+	g_autoptr(GsApp) app = gs_app_new ("org.example.Snapshot");
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsAppList) list_loaded = NULL;
+	g_autoptr(GsOverviewSnapshot) snapshot = gs_overview_snapshot_new ();
+	g_autoptr(GsOverviewSnapshot) snapshot_loaded = NULL;
+
+	/* nothing saved yet */
+	snapshot_loaded = gs_overview_snapshot_load (&error);
+	g_assert_null (snapshot_loaded);
+	g_clear_error (&error);
+
+	gs_app_set_kind (app, AS_COMPONENT_KIND_DESKTOP_APP);
+	gs_app_set_name (app, GS_APP_QUALITY_NORMAL, "Snapshot");
+	gs_app_set_summary (app, GS_APP_QUALITY_NORMAL, "Remembers things");
+	gs_app_set_rating (app, 80);
+	gs_icon_set_width (icon_themed, 64);
+	gs_app_add_icon (app, icon_themed);
+
+	/* an icon file which has gone is dropped when saving */
+	gs_app_add_icon (app, icon_file);
+	g_array_append_val (key_colors, color);
+	gs_app_set_key_colors (app, key_colors);
+	gs_app_list_add (list, app);
+
+	gs_overview_snapshot_set_apps (snapshot, "featured", list, TRUE);
+	gs_overview_snapshot_set_apps (snapshot, "popular", list, FALSE);
+	ret = gs_overview_snapshot_save (snapshot, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the sections and apps are loaded in the same order */
+	snapshot_loaded = gs_overview_snapshot_load (&error);
+	g_assert_no_error (error);
+	g_assert_nonnull (snapshot_loaded);
+	section_ids = gs_overview_snapshot_get_section_ids (snapshot_loaded);
+	g_assert_cmpint (section_ids->len, ==, 2);
+	g_assert_cmpstr (g_ptr_array_index (section_ids, 0), ==, "featured");
+	g_assert_cmpstr (g_ptr_array_index (section_ids, 1), ==, "popular");
+
+	list_loaded = gs_overview_snapshot_get_apps (snapshot_loaded, "featured");
+	g_assert_nonnull (list_loaded);
+	g_assert_cmpint (gs_app_list_length (list_loaded), ==, 1);
+	app_loaded = gs_app_list_index (list_loaded, 0);
+	g_assert_cmpstr (gs_app_get_unique_id (app_loaded), ==, gs_app_get_unique_id (app));
+	g_assert_cmpint (gs_app_get_kind (app_loaded), ==, AS_COMPONENT_KIND_DESKTOP_APP);
+	g_assert_cmpstr (gs_app_get_name (app_loaded), ==, "Snapshot");
+	g_assert_cmpstr (gs_app_get_summary (app_loaded), ==, "Remembers things");
+	g_assert_cmpint (gs_app_get_rating (app_loaded), ==, 80);
+	icons = gs_app_get_icons (app_loaded);
+	g_assert_nonnull (icons);
+	g_assert_cmpint (icons->len, ==, 1);
+	g_assert_true (g_icon_equal (g_ptr_array_index (icons, 0), icon_themed));
+	g_assert_cmpint (gs_icon_get_width (g_ptr_array_index (icons, 0)), ==, 64);
+	key_colors_loaded = gs_app_get_key_colors (app_loaded);
+	g_assert_cmpint (key_colors_loaded->len, ==, 1);
+	g_assert_true (gdk_rgba_equal (&g_array_index (key_colors_loaded, GdkRGBA, 0), &color));
+	g_clear_object (&list_loaded);
+
+	/* sections without key colors are still loaded */
+	list_loaded = gs_overview_snapshot_get_apps (snapshot_loaded, "popular");
+	g_assert_nonnull (list_loaded);
+	g_assert_cmpint (gs_app_list_length (list_loaded), ==, 1);
+	g_assert_null (gs_overview_snapshot_get_apps (snapshot_loaded, "recent"));
+}
+
+static void
+gs_screenshot_cache_func (void)
+{
+	gboolean ret;
+	gchar data[1024] = { '\0' };
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsScreenshotCache) cache = gs_screenshot_cache_new ("screenshots-test");
+	g_autoptr(GsScreenshotCache) cache2 = NULL;
+	g_autoptr(GsScreenshotCache) cache3 = NULL;
+
+	/* room for two originals */
+	gs_screenshot_cache_set_size_max (cache, 2 * sizeof (data) + 100);
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache), ==, 0);
+	fn = gs_screenshot_cache_lookup (cache, "http://foo.bar/a.png",
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	g_assert_null (fn);
+
+	ret = gs_screenshot_cache_add_original (cache, "http://foo.bar/a.png",
+						data, sizeof (data), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = gs_screenshot_cache_add_original (cache, "http://foo.bar/b.png",
+						data, sizeof (data), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache), ==, 2 * sizeof (data));
+	g_assert_false (gs_screenshot_cache_needs_revalidate (cache, "http://foo.bar/a.png"));
+
+	/* use a.png, so b.png is the least recently used */
+	fn = gs_screenshot_cache_lookup (cache, "http://foo.bar/a.png",
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	g_assert_nonnull (fn);
+	g_assert_true (g_file_test (fn, G_FILE_TEST_EXISTS));
+	g_clear_pointer (&fn, g_free);
+
+	/* going over budget evicts b.png */
+	ret = gs_screenshot_cache_add_original (cache, "http://foo.bar/c.png",
+						data, sizeof (data), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache), ==, 2 * sizeof (data));
+	fn = gs_screenshot_cache_lookup (cache, "http://foo.bar/b.png",
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	g_assert_null (fn);
+
+	/* the index is persisted */
+	ret = gs_screenshot_cache_save (cache, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	cache2 = gs_screenshot_cache_new ("screenshots-test");
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache2), ==, 2 * sizeof (data));
+	fn = gs_screenshot_cache_lookup (cache2, "http://foo.bar/c.png",
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	g_assert_nonnull (fn);
+
+	/* invalidating removes the files */
+	gs_screenshot_cache_invalidate (cache2, "http://foo.bar/c.png");
+	g_assert_false (g_file_test (fn, G_FILE_TEST_EXISTS));
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache2), ==, sizeof (data));
+	g_clear_pointer (&fn, g_free);
+
+	/* a file removed behind the cache's back drops the whole entry */
+	fn = gs_screenshot_cache_lookup (cache2, "http://foo.bar/a.png",
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	g_assert_nonnull (fn);
+	g_assert_cmpint (g_unlink (fn), ==, 0);
+	g_clear_pointer (&fn, g_free);
+	fn = gs_screenshot_cache_lookup (cache2, "http://foo.bar/a.png",
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL,
+					 GS_SCREENSHOT_CACHE_SIZE_ORIGINAL);
+	g_assert_null (fn);
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache2), ==, 0);
+	ret = gs_screenshot_cache_save (cache2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	cache3 = gs_screenshot_cache_new ("screenshots-test");
+	g_assert_cmpint (gs_screenshot_cache_get_size (cache3), ==, 0);
+}
+
+static void
+gs_size_service_func (void)
+{
+	g_autoptr(GsApp) app = gs_app_new ("org.example.Size");
+	g_autoptr(GsPluginLoader) plugin_loader = gs_plugin_loader_new ();
+	g_autoptr(GsSizeService) size_service = gs_size_service_new (plugin_loader);
+
+	/* a size which is already known is cached */
+	gs_app_set_version (app, "1.0");
+	gs_app_set_size_installed (app, 1234);
+	g_assert_true (gs_size_service_request (size_service, app, FALSE));
+
+	/* and is forgotten by both the cache and the app when invalidated */
+	gs_size_service_invalidate (size_service, app);
+	g_assert_cmpint (gs_app_get_size_installed (app), ==, 0);
+
+	/* so the stale size is not cached again, and it is worked out anew */
+	g_assert_false (gs_size_service_request (size_service, app, FALSE));
+	g_assert_cmpint (gs_app_get_size_installed (app), ==, 0);
+
+	/* a new size is cached in its place */
+	gs_app_set_size_installed (app, 5678);
+	g_assert_true (gs_size_service_request (size_service, app, FALSE));
+	gs_app_set_size_installed (app, 0);
+	g_assert_true (gs_size_service_request (size_service, app, FALSE));
+	g_assert_cmpint (gs_app_get_size_installed (app), ==, 5678);
+
+	gs_size_service_cancel (size_service);
+}
+
+static GsApp *
+gs_search_provider_app_new (const gchar *id, const gchar * const *search_text)
+{
+	GsApp *app = gs_app_new (id);
+	g_autoptr(GVariant) tmp = g_variant_ref_sink (g_variant_new_strv (search_text, -1));
+	gs_app_set_metadata_variant (app, "GnomeSoftware::SearchText", tmp);
+	return app;
+}
+
+static void
+gs_search_provider_func (void)
+{
+	const gchar *firefox_text[] = { "org.mozilla.Firefox", "Firefox", "Web Browser", NULL };
+	const gchar *firewall_text[] = { "org.example.Firewall", "Firewall", "Block connections", NULL };
+	gchar *terms_fire[] = { (gchar *) "fire", NULL };
+	gchar *terms_firef[] = { (gchar *) "firef", NULL };
+	gchar *terms_firefox_web[] = { (gchar *) "firefox", (gchar *) "web", NULL };
+	gchar *terms_water[] = { (gchar *) "water", NULL };
+	g_autoptr(GsApp) firefox = gs_search_provider_app_new ("org.mozilla.Firefox", firefox_text);
+	g_autoptr(GsApp) firewall = gs_search_provider_app_new ("org.example.Firewall", firewall_text);
+	g_autoptr(GsApp) unknown = gs_app_new ("org.example.Fireworks");
+	g_autoptr(GsAppList) candidates = gs_app_list_new ();
+	g_autoptr(GsAppList) list = NULL;
+	g_autoptr(GsAppList) list2 = NULL;
+	g_autoptr(GsShellSearchProvider) provider = gs_shell_search_provider_new ();
+
+	/* nothing to narrow yet */
+	list = gs_shell_search_provider_narrow_candidates (provider, terms_fire);
+	g_assert_null (list);
+
+	/* no plugin loader is set up, so any search job would fail; narrowing
+	 * filters the earlier results without one */
+	gs_app_list_add (candidates, firefox);
+	gs_app_list_add (candidates, firewall);
+	gs_shell_search_provider_set_candidates (provider, candidates, terms_fire);
+	list = gs_shell_search_provider_narrow_candidates (provider, terms_firef);
+	g_assert_nonnull (list);
+	g_assert_cmpint (gs_app_list_length (list), ==, 1);
+	g_assert_true (gs_app_list_index (list, 0) == firefox);
+
+	/* the narrowed results are narrowed again */
+	list2 = gs_shell_search_provider_narrow_candidates (provider, terms_firefox_web);
+	g_assert_nonnull (list2);
+	g_assert_cmpint (gs_app_list_length (list2), ==, 1);
+	g_assert_true (gs_app_list_index (list2, 0) == firefox);
+	g_clear_object (&list2);
+
+	/* terms which do not extend the earlier ones need a new search */
+	list2 = gs_shell_search_provider_narrow_candidates (provider, terms_water);
+	g_assert_null (list2);
+
+	/* as do candidates which do not record what they matched */
+	gs_app_list_add (candidates, unknown);
+	gs_shell_search_provider_set_candidates (provider, candidates, terms_fire);
+	list2 = gs_shell_search_provider_narrow_candidates (provider, terms_firef);
+	g_assert_null (list2);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -55,6 +313,10 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	g_test_add_func ("/gnome-software/src/css", gs_css_func);
+	g_test_add_func ("/gnome-software/src/overview-snapshot", gs_overview_snapshot_func);
+	g_test_add_func ("/gnome-software/src/screenshot-cache", gs_screenshot_cache_func);
+	g_test_add_func ("/gnome-software/src/search-provider", gs_search_provider_func);
+	g_test_add_func ("/gnome-software/src/size-service", gs_size_service_func);
 
 	return g_test_run ();
 }
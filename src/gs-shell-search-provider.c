@@ -24,6 +24,8 @@
 typedef struct {
 	GsShellSearchProvider *provider;
 	GDBusMethodInvocation *invocation;
+	GCancellable *cancellable;
+	gchar **terms;
 } PendingSearch;
 
 struct _GsShellSearchProvider {
@@ -35,6 +37,9 @@ struct _GsShellSearchProvider {
 
 	GHashTable *metas_cache;
 	GsAppList *search_results;
+	GsAppList *search_candidates;	/* (nullable): every match for @search_terms */
+	gchar **search_terms;	/* (nullable): the terms @search_candidates are for */
+	AsPool *as_pool;	/* (nullable): only used to tokenize search terms */
 };
 
 G_DEFINE_TYPE (GsShellSearchProvider, gs_shell_search_provider, G_TYPE_OBJECT)
@@ -43,26 +48,64 @@ static void
 pending_search_free (PendingSearch *search)
 {
 	g_object_unref (search->invocation);
+	g_object_unref (search->cancellable);
+	g_strfreev (search->terms);
 	g_slice_free (PendingSearch, search);
 }
 
-static gint
-search_sort_by_kudo_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+search_sort_key_kudo_cb (GsApp *app, gpointer user_data)
 {
-	guint pa, pb;
-	pa = gs_app_get_kudos_percentage (app1);
-	pb = gs_app_get_kudos_percentage (app2);
-	if (pa < pb)
-		return 1;
-	else if (pa > pb)
-		return -1;
-	return 0;
+	/* most kudos first */
+	return g_strdup_printf ("%03u", 100 - gs_app_get_kudos_percentage (app));
+}
+
+static gchar *
+gs_shell_search_provider_get_app_sort_key (GsApp *app, gpointer user_data)
+{
+	GString *key = g_string_sized_new (64);
+
+	/* sort available apps before installed ones */
+	switch (gs_app_get_state (app)) {
+	case GS_APP_STATE_AVAILABLE:
+		g_string_append (key, "0:");
+		break;
+	default:
+		g_string_append (key, "1:");
+		break;
+	}
+
+	/* sort apps before runtimes and extensions */
+	switch (gs_app_get_kind (app)) {
+	case AS_COMPONENT_KIND_DESKTOP_APP:
+		g_string_append (key, "0:");
+		break;
+	default:
+		g_string_append (key, "1:");
+		break;
+	}
+
+	/* sort by the search key, best first */
+	g_string_append_printf (key, "%08x:", G_MAXUINT - gs_app_get_match_value (app));
+
+	/* tie-break with id */
+	g_string_append (key, gs_app_get_unique_id (app));
+
+	return g_string_free (key, FALSE);
 }
 
 static void
-search_done_cb (GObject *source,
-		GAsyncResult *res,
-		gpointer user_data)
+search_return_empty (PendingSearch *search)
+{
+	g_dbus_method_invocation_return_value (search->invocation, g_variant_new ("(as)", NULL));
+	pending_search_free (search);
+	g_application_release (g_application_get_default ());
+}
+
+static void
+search_refine_done_cb (GObject *source,
+		       GAsyncResult *res,
+		       gpointer user_data)
 {
 	PendingSearch *search = user_data;
 	GsShellSearchProvider *self = search->provider;
@@ -75,14 +118,12 @@ search_done_cb (GObject *source,
 
 	list = gs_plugin_loader_job_process_finish (self->plugin_loader, res, NULL);
 	if (list == NULL) {
-		g_dbus_method_invocation_return_value (search->invocation, g_variant_new ("(as)", NULL));
-		pending_search_free (search);
-		g_application_release (g_application_get_default ());
-		return;	
+		search_return_empty (search);
+		return;
 	}
 
 	/* sort by kudos, as there is no ratings data by default */
-	gs_app_list_sort (list, search_sort_by_kudo_cb, NULL);
+	gs_app_list_sort_by_key (list, search_sort_key_kudo_cb, NULL);
 
 	g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
 	for (i = 0; i < gs_app_list_length (list); i++) {
@@ -100,48 +141,75 @@ search_done_cb (GObject *source,
 	g_application_release (g_application_get_default ());
 }
 
-static gchar *
-gs_shell_search_provider_get_app_sort_key (GsApp *app)
+/* only the best few of the candidates are shown, so only those need icons */
+static void
+search_refine_results (PendingSearch *search, GsAppList *candidates)
 {
-	GString *key = g_string_sized_new (64);
+	GsShellSearchProvider *self = search->provider;
+	g_autoptr(GsAppList) list = gs_app_list_copy (candidates);
+	g_autoptr(GsPluginJob) plugin_job = NULL;
 
-	/* sort available apps before installed ones */
-	switch (gs_app_get_state (app)) {
-	case GS_APP_STATE_AVAILABLE:
-		g_string_append (key, "9:");
-		break;
-	default:
-		g_string_append (key, "1:");
-		break;
+	gs_app_list_sort_by_key_truncate (list, gs_shell_search_provider_get_app_sort_key,
+					  NULL, GS_SHELL_SEARCH_PROVIDER_MAX_RESULTS);
+	if (gs_app_list_length (list) == 0) {
+		gs_app_list_remove_all (self->search_results);
+		search_return_empty (search);
+		return;
 	}
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					 "list", list,
+					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON |
+					                 GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_HOSTNAME,
+					 NULL);
+	gs_plugin_loader_job_process_async (self->plugin_loader, plugin_job,
+					    search->cancellable,
+					    search_refine_done_cb,
+					    search);
+}
 
-	/* sort apps before runtimes and extensions */
-	switch (gs_app_get_kind (app)) {
-	case AS_COMPONENT_KIND_DESKTOP_APP:
-		g_string_append (key, "9:");
-		break;
-	default:
-		g_string_append (key, "1:");
-		break;
-	}
+static void
+search_done_cb (GObject *source,
+		GAsyncResult *res,
+		gpointer user_data)
+{
+	PendingSearch *search = user_data;
+	GsShellSearchProvider *self = search->provider;
+	g_autoptr(GsAppList) list = NULL;
 
-	/* sort by the search key */
-	g_string_append_printf (key, "%05x:", gs_app_get_match_value (app));
+	list = gs_plugin_loader_job_process_finish (self->plugin_loader, res, NULL);
+	if (list == NULL) {
+		gs_app_list_remove_all (self->search_results);
+		search_return_empty (search);
+		return;
+	}
 
-	/* tie-break with id */
-	g_string_append (key, gs_app_get_unique_id (app));
+	/* keep every match so the next subsearch can narrow them, unless the
+	 * search was cut short and a narrower one could find others */
+	if (search->cancellable == self->cancellable &&
+	    !gs_app_list_has_flag (list, GS_APP_LIST_FLAG_IS_TRUNCATED))
+		gs_shell_search_provider_set_candidates (self, list, search->terms);
 
-	return g_string_free (key, FALSE);
+	search_refine_results (search, list);
 }
 
-static gboolean
-gs_shell_search_provider_sort_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static PendingSearch *
+pending_search_new (GsShellSearchProvider *self,
+		    GDBusMethodInvocation *invocation,
+		    gchar **terms)
 {
-	g_autofree gchar *key1 = NULL;
-	g_autofree gchar *key2 = NULL;
-	key1 = gs_shell_search_provider_get_app_sort_key (app1);
-	key2 = gs_shell_search_provider_get_app_sort_key (app2);
-	return g_strcmp0 (key2, key1);
+	PendingSearch *pending_search;
+
+	g_cancellable_cancel (self->cancellable);
+	g_clear_object (&self->cancellable);
+	self->cancellable = g_cancellable_new ();
+	g_application_hold (g_application_get_default ());
+
+	pending_search = g_slice_new (PendingSearch);
+	pending_search->provider = self;
+	pending_search->invocation = g_object_ref (invocation);
+	pending_search->cancellable = g_object_ref (self->cancellable);
+	pending_search->terms = g_strdupv (terms);
+	return pending_search;
 }
 
 static void
@@ -155,32 +223,31 @@ execute_search (GsShellSearchProvider  *self,
 
 	value = g_strjoinv (" ", terms);
 
-	g_cancellable_cancel (self->cancellable);
-	g_clear_object (&self->cancellable);
+	g_clear_object (&self->search_candidates);
+	g_clear_pointer (&self->search_terms, g_strfreev);
 
 	/* don't attempt searches for a single character */
 	if (g_strv_length (terms) == 1 &&
 	    g_utf8_strlen (terms[0], -1) == 1) {
+		g_cancellable_cancel (self->cancellable);
+		g_clear_object (&self->cancellable);
 		g_dbus_method_invocation_return_value (invocation, g_variant_new ("(as)", NULL));
 		return;
 	}
 
-	pending_search = g_slice_new (PendingSearch);
-	pending_search->provider = self;
-	pending_search->invocation = g_object_ref (invocation);
-
-	g_application_hold (g_application_get_default ());
-	self->cancellable = g_cancellable_new ();
+	pending_search = pending_search_new (self, invocation, terms);
 
+	/* only ask for as many results as are shown, so a broad search does
+	 * not refine every match; a subsearch only narrows results which were
+	 * not truncated, and icons are refined in search_refine_results() */
 	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_SEARCH,
 					 "search", value,
-					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_ICON |
-					                 GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_HOSTNAME,
+					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_ORIGIN_HOSTNAME,
 					 "max-results", GS_SHELL_SEARCH_PROVIDER_MAX_RESULTS,
 					 "dedupe-flags", GS_APP_LIST_FILTER_FLAG_PREFER_INSTALLED |
 							 GS_APP_LIST_FILTER_FLAG_KEY_ID_PROVIDES,
 					 NULL);
-	gs_plugin_job_set_sort_func (plugin_job, gs_shell_search_provider_sort_cb);
+	gs_plugin_job_set_sort_key_func (plugin_job, gs_shell_search_provider_get_app_sort_key);
 	gs_plugin_job_set_sort_func_data (plugin_job, self);
 	gs_plugin_loader_job_process_async (self->plugin_loader, plugin_job,
 					    self->cancellable,
@@ -188,6 +255,134 @@ execute_search (GsShellSearchProvider  *self,
 					    pending_search);
 }
 
+/* whether @terms only adds to, or lengthens, the terms in @previous_terms,
+ * which is what gnome-shell does as the user keeps typing */
+static gboolean
+search_terms_narrow (gchar **previous_terms, gchar **terms)
+{
+	if (g_strv_length (terms) < g_strv_length (previous_terms))
+		return FALSE;
+	for (guint i = 0; previous_terms[i] != NULL; i++) {
+		if (!g_str_has_prefix (terms[i], previous_terms[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* uses the text which gs_appstream_search() matched against, so narrowing
+ * looks at the same fields as a full search */
+static gboolean
+search_app_matches (GsApp *app, gchar **tokens, gboolean *known)
+{
+	GVariant *tmp = gs_app_get_metadata_variant (app, "GnomeSoftware::SearchText");
+	g_autofree const gchar **texts = NULL;
+
+	if (tmp == NULL) {
+		*known = FALSE;
+		return FALSE;
+	}
+	texts = g_variant_get_strv (tmp, NULL);
+	for (guint i = 0; tokens[i] != NULL; i++) {
+		gboolean found = FALSE;
+		for (guint j = 0; texts[j] != NULL && !found; j++)
+			found = g_str_match_string (tokens[i], texts[j], TRUE);
+		if (!found)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * gs_shell_search_provider_set_candidates:
+ * @self: a #GsShellSearchProvider
+ * @candidates: every app which matches @terms
+ * @terms: the search terms
+ *
+ * Remembers the results of a search, so that a subsearch which narrows
+ * @terms can filter them instead of searching again.
+ **/
+void
+gs_shell_search_provider_set_candidates (GsShellSearchProvider *self,
+					 GsAppList *candidates,
+					 gchar **terms)
+{
+	g_return_if_fail (GS_IS_SHELL_SEARCH_PROVIDER (self));
+	g_return_if_fail (GS_IS_APP_LIST (candidates));
+
+	g_set_object (&self->search_candidates, candidates);
+	g_strfreev (self->search_terms);
+	self->search_terms = g_strdupv (terms);
+}
+
+/**
+ * gs_shell_search_provider_narrow_candidates:
+ * @self: a #GsShellSearchProvider
+ * @terms: the search terms
+ *
+ * Narrows the candidates of the last search to the ones which still match
+ * @terms, and remembers them as the candidates for @terms.
+ *
+ * Returns: (transfer full) (nullable): the matching apps, or %NULL if the
+ * candidates can't be reused, for instance because @terms do not extend the
+ * previous terms, or a candidate came from a plugin which does not record
+ * what it matched against
+ **/
+GsAppList *
+gs_shell_search_provider_narrow_candidates (GsShellSearchProvider *self,
+					    gchar **terms)
+{
+	g_autofree gchar *value = NULL;
+	g_auto(GStrv) tokens = NULL;
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+
+	g_return_val_if_fail (GS_IS_SHELL_SEARCH_PROVIDER (self), NULL);
+
+	if (self->search_candidates == NULL ||
+	    self->search_terms == NULL ||
+	    !search_terms_narrow (self->search_terms, terms))
+		return NULL;
+
+	/* tokenize the same way as the plugin loader does */
+	if (self->as_pool == NULL)
+		self->as_pool = as_pool_new ();
+	value = g_strjoinv (" ", terms);
+	tokens = as_pool_build_search_tokens (self->as_pool, value);
+	if (tokens == NULL)
+		return NULL;
+
+	for (guint i = 0; i < gs_app_list_length (self->search_candidates); i++) {
+		GsApp *app = gs_app_list_index (self->search_candidates, i);
+		gboolean known = TRUE;
+		if (search_app_matches (app, tokens, &known))
+			gs_app_list_add (list, app);
+		if (!known)
+			return NULL;
+	}
+
+	g_debug ("narrowed %u candidates to %u",
+		 gs_app_list_length (self->search_candidates),
+		 gs_app_list_length (list));
+	gs_shell_search_provider_set_candidates (self, list, terms);
+	return g_steal_pointer (&list);
+}
+
+static gboolean
+execute_subsearch (GsShellSearchProvider  *self,
+		   GDBusMethodInvocation  *invocation,
+		   gchar		 **terms)
+{
+	PendingSearch *pending_search;
+	g_autoptr(GsAppList) list = NULL;
+
+	list = gs_shell_search_provider_narrow_candidates (self, terms);
+	if (list == NULL)
+		return FALSE;
+
+	pending_search = pending_search_new (self, invocation, terms);
+	search_refine_results (pending_search, list);
+	return TRUE;
+}
+
 static gboolean
 handle_get_initial_result_set (GsShellSearchProvider2	*skeleton,
 			       GDBusMethodInvocation	 *invocation,
@@ -211,6 +406,8 @@ handle_get_subsearch_result_set (GsShellSearchProvider2	*skeleton,
 	GsShellSearchProvider *self = user_data;
 
 	g_debug ("****** GetSubSearchResultSet");
+	if (execute_subsearch (self, invocation, terms))
+		return TRUE;
 	execute_search (self, invocation, terms);
 	return TRUE;
 }
@@ -361,6 +558,9 @@ search_provider_dispose (GObject *obj)
 	}
 
 	g_clear_object (&self->search_results);
+	g_clear_object (&self->search_candidates);
+	g_clear_pointer (&self->search_terms, g_strfreev);
+	g_clear_object (&self->as_pool);
 	g_clear_object (&self->plugin_loader);
 	g_clear_object (&self->skeleton);
 
@@ -24,3 +24,8 @@ void			 gs_shell_search_provider_unregister	(GsShellSearchProvider	 *self);
 GsShellSearchProvider	*gs_shell_search_provider_new		(void);
 void			 gs_shell_search_provider_setup		(GsShellSearchProvider	 *provider,
 								 GsPluginLoader		 *loader);
+void			 gs_shell_search_provider_set_candidates	(GsShellSearchProvider	 *self,
+								 GsAppList		 *candidates,
+								 gchar			**terms);
+GsAppList		*gs_shell_search_provider_narrow_candidates	(GsShellSearchProvider	 *self,
+								 gchar			**terms);
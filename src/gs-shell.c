@@ -786,6 +786,16 @@ initial_refresh_done (GsLoadingPage *loading_page, gpointer data)
 	/* if the "loaded" signal handler didn't change the mode, kick off async
 	 * overview page refresh, and switch to the page once done */
 	if (gs_shell_get_mode (shell) == GS_SHELL_MODE_LOADING) {
+		GsOverviewPage *overview_page = GS_OVERVIEW_PAGE (shell->pages[GS_SHELL_MODE_OVERVIEW]);
+
+		/* the overview is already showing what it showed last time,
+		 * so switch to it now and let it update in the background */
+		if (gs_overview_page_has_snapshot (overview_page)) {
+			gs_page_reload (GS_PAGE (overview_page));
+			overview_page_refresh_done (overview_page, shell);
+			return;
+		}
+
 		g_signal_connect (shell->pages[GS_SHELL_MODE_OVERVIEW], "refreshed",
 		                  G_CALLBACK (overview_page_refresh_done), shell);
 		gs_page_reload (GS_PAGE (shell->pages[GS_SHELL_MODE_OVERVIEW]));
@@ -0,0 +1,467 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+/**
+ * SECTION:gs-size-service
+ * @short_description: Works out installed sizes in the background
+ *
+ * Working out how much disk space an installed app uses can mean walking
+ * its files, so it is too slow to do for every installed app before the
+ * installed page is shown.
+ *
+ * A #GsSizeService instead works out the installed sizes of the apps passed
+ * to gs_size_service_request() in the background, a small batch at a time,
+ * and emits #GsSizeService::sizes-changed as each batch finishes. Apps which
+ * are requested as urgent, such as those scrolled into view, go to the front
+ * of the queue.
+ *
+ * Sizes are cached on disk by app unique ID and version, so on later runs
+ * they are known straight away. An app’s entry is dropped when
+ * gs_size_service_invalidate() is called, which should happen whenever it is
+ * installed, updated or removed.
+ *
+ * Since: 40
+ */
+
+#include "config.h"
+
+#include "gs-size-service.h"
+
+/* the number of apps refined in each background job */
+#define GS_SIZE_SERVICE_BATCH_SIZE	20
+
+/* how long to wait for more changes before writing the cache */
+#define GS_SIZE_SERVICE_SAVE_DELAY	5 /* seconds */
+
+#define GS_SIZE_SERVICE_VARIANT_TYPE	"a{s(st)}"
+
+typedef struct {
+	gchar		*version;
+	guint64		 size;
+} GsSizeServiceEntry;
+
+struct _GsSizeService
+{
+	GObject		 parent_instance;
+
+	GsPluginLoader	*plugin_loader;
+	GCancellable	*cancellable;
+	GHashTable	*entries;	/* unique ID : GsSizeServiceEntry */
+	GHashTable	*attempted;	/* unique IDs the plugins had no size for */
+	gboolean	 entries_dirty;
+	guint		 save_id;
+	GQueue		 queue;		/* (element-type GsApp) (owned) */
+	guint		 process_id;
+	gboolean	 busy;
+};
+
+G_DEFINE_TYPE (GsSizeService, gs_size_service, G_TYPE_OBJECT)
+
+enum {
+	SIGNAL_SIZES_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals [SIGNAL_LAST] = { 0 };
+
+static void
+gs_size_service_entry_free (GsSizeServiceEntry *entry)
+{
+	g_free (entry->version);
+	g_free (entry);
+}
+
+static gchar *
+gs_size_service_get_filename (GsUtilsCacheFlags flags, GError **error)
+{
+	return gs_utils_get_cache_filename ("sizes", "installed", flags, error);
+}
+
+static void
+gs_size_service_load (GsSizeService *self)
+{
+	GVariantIter iter;
+	const gchar *unique_id;
+	const gchar *version;
+	guint64 size;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	filename = gs_size_service_get_filename (GS_UTILS_CACHE_FLAG_NONE, NULL);
+	if (filename == NULL)
+		return;
+	mapped = g_mapped_file_new (filename, FALSE, &error_local);
+	if (mapped == NULL) {
+		g_debug ("no installed sizes cached: %s", error_local->message);
+		return;
+	}
+	bytes = g_mapped_file_get_bytes (mapped);
+	data = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GS_SIZE_SERVICE_VARIANT_TYPE),
+							     bytes, FALSE));
+	g_variant_iter_init (&iter, data);
+	while (g_variant_iter_next (&iter, "{&s(&st)}", &unique_id, &version, &size)) {
+		GsSizeServiceEntry *entry = g_new0 (GsSizeServiceEntry, 1);
+		entry->version = g_strdup (version);
+		entry->size = size;
+		g_hash_table_replace (self->entries, g_strdup (unique_id), entry);
+	}
+	g_debug ("loaded %u cached installed sizes", g_hash_table_size (self->entries));
+}
+
+static void
+gs_size_service_save (GsSizeService *self)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder;
+	gpointer key, value;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	if (!self->entries_dirty)
+		return;
+	self->entries_dirty = FALSE;
+
+	filename = gs_size_service_get_filename (GS_UTILS_CACHE_FLAG_WRITEABLE |
+						 GS_UTILS_CACHE_FLAG_CREATE_DIRECTORY,
+						 &error_local);
+	if (filename == NULL) {
+		g_warning ("failed to save installed sizes: %s", error_local->message);
+		return;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE (GS_SIZE_SERVICE_VARIANT_TYPE));
+	g_hash_table_iter_init (&iter, self->entries);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		GsSizeServiceEntry *entry = value;
+		g_variant_builder_add (&builder, "{s(st)}",
+				       (const gchar *) key, entry->version, entry->size);
+	}
+	data = g_variant_ref_sink (g_variant_builder_end (&builder));
+	if (!g_file_set_contents (filename,
+				  g_variant_get_data (data),
+				  (gssize) g_variant_get_size (data),
+				  &error_local))
+		g_warning ("failed to save installed sizes: %s", error_local->message);
+}
+
+static gboolean
+gs_size_service_save_cb (gpointer user_data)
+{
+	GsSizeService *self = GS_SIZE_SERVICE (user_data);
+	self->save_id = 0;
+	gs_size_service_save (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gs_size_service_entries_changed (GsSizeService *self)
+{
+	self->entries_dirty = TRUE;
+	if (self->save_id == 0) {
+		self->save_id = g_timeout_add_seconds (GS_SIZE_SERVICE_SAVE_DELAY,
+						       gs_size_service_save_cb, self);
+	}
+}
+
+static const gchar *
+gs_size_service_get_version (GsApp *app)
+{
+	return gs_app_get_version (app) != NULL ? gs_app_get_version (app) : "";
+}
+
+/* record the size if the app already has one, or set it from the cache */
+static gboolean
+gs_size_service_lookup (GsSizeService *self, GsApp *app)
+{
+	const gchar *unique_id = gs_app_get_unique_id (app);
+	guint64 size = gs_app_get_size_installed (app);
+	GsSizeServiceEntry *entry;
+
+	entry = g_hash_table_lookup (self->entries, unique_id);
+	/* including %GS_APP_SIZE_UNKNOWABLE, which is an answer too */
+	if (size != 0) {
+		if (entry == NULL ||
+		    entry->size != size ||
+		    g_strcmp0 (entry->version, gs_size_service_get_version (app)) != 0) {
+			entry = g_new0 (GsSizeServiceEntry, 1);
+			entry->version = g_strdup (gs_size_service_get_version (app));
+			entry->size = size;
+			g_hash_table_replace (self->entries, g_strdup (unique_id), entry);
+			gs_size_service_entries_changed (self);
+		}
+		return TRUE;
+	}
+	if (entry != NULL &&
+	    g_strcmp0 (entry->version, gs_size_service_get_version (app)) == 0) {
+		gs_app_set_size_installed (app, entry->size);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void gs_size_service_queue_process (GsSizeService *self);
+
+static void
+gs_size_service_refine_cb (GObject *source_object,
+			   GAsyncResult *res,
+			   gpointer user_data)
+{
+	GsPluginLoader *plugin_loader = GS_PLUGIN_LOADER (source_object);
+	g_autoptr(GsSizeService) self = GS_SIZE_SERVICE (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GsAppList) list = NULL;
+
+	self->busy = FALSE;
+
+	list = gs_plugin_loader_job_process_finish (plugin_loader, res, &error);
+	if (list == NULL) {
+		if (!g_error_matches (error, GS_PLUGIN_ERROR, GS_PLUGIN_ERROR_CANCELLED))
+			g_warning ("failed to get installed sizes: %s", error->message);
+		gs_size_service_queue_process (self);
+		return;
+	}
+
+	for (guint i = 0; i < gs_app_list_length (list); i++) {
+		GsApp *app = gs_app_list_index (list, i);
+		if (!gs_size_service_lookup (self, app))
+			g_hash_table_add (self->attempted, g_strdup (gs_app_get_unique_id (app)));
+	}
+	g_signal_emit (self, signals[SIGNAL_SIZES_CHANGED], 0, list);
+
+	gs_size_service_queue_process (self);
+}
+
+static gboolean
+gs_size_service_process_cb (gpointer user_data)
+{
+	GsSizeService *self = GS_SIZE_SERVICE (user_data);
+	GsApp *app;
+	g_autoptr(GsAppList) list = gs_app_list_new ();
+	g_autoptr(GsPluginJob) plugin_job = NULL;
+
+	self->process_id = 0;
+
+	while (gs_app_list_length (list) < GS_SIZE_SERVICE_BATCH_SIZE &&
+	       (app = g_queue_pop_head (&self->queue)) != NULL) {
+		/* may have been refined by something else meanwhile */
+		if (!gs_size_service_lookup (self, app))
+			gs_app_list_add (list, app);
+		g_object_unref (app);
+	}
+	if (gs_app_list_length (list) == 0)
+		return G_SOURCE_REMOVE;
+
+	g_debug ("getting installed sizes for %u apps, %u to go",
+		 gs_app_list_length (list), g_queue_get_length (&self->queue));
+	self->busy = TRUE;
+	plugin_job = gs_plugin_job_newv (GS_PLUGIN_ACTION_REFINE,
+					 "list", list,
+					 "refine-flags", GS_PLUGIN_REFINE_FLAGS_REQUIRE_SIZE,
+					 NULL);
+	gs_plugin_loader_job_process_async (self->plugin_loader,
+					    plugin_job,
+					    self->cancellable,
+					    gs_size_service_refine_cb,
+					    g_object_ref (self));
+	return G_SOURCE_REMOVE;
+}
+
+/* only one batch runs at a time, and only when nothing more important is
+ * waiting in the main loop */
+static void
+gs_size_service_queue_process (GsSizeService *self)
+{
+	if (self->busy || self->process_id != 0 || g_queue_is_empty (&self->queue))
+		return;
+	self->process_id = g_idle_add_full (G_PRIORITY_LOW,
+					    gs_size_service_process_cb,
+					    self, NULL);
+}
+
+/**
+ * gs_size_service_request:
+ * @self: a #GsSizeService
+ * @app: a #GsApp
+ * @urgent: %TRUE to work out the size before those of other apps
+ *
+ * Sets the installed size of @app from the cache if it is there, and
+ * otherwise queues it to be worked out in the background.
+ * #GsSizeService::sizes-changed is emitted once it has been.
+ *
+ * Returns: %TRUE if @app now has an installed size, %FALSE if it was queued
+ *
+ * Since: 40
+ **/
+gboolean
+gs_size_service_request (GsSizeService *self, GsApp *app, gboolean urgent)
+{
+	GList *link;
+
+	g_return_val_if_fail (GS_IS_SIZE_SERVICE (self), FALSE);
+	g_return_val_if_fail (GS_IS_APP (app), FALSE);
+
+	if (gs_app_get_unique_id (app) == NULL)
+		return FALSE;
+	if (gs_size_service_lookup (self, app))
+		return TRUE;
+	if (g_hash_table_contains (self->attempted, gs_app_get_unique_id (app)))
+		return FALSE;
+
+	link = g_queue_find (&self->queue, app);
+	if (link != NULL) {
+		if (!urgent)
+			return FALSE;
+		g_queue_unlink (&self->queue, link);
+		g_queue_push_head_link (&self->queue, link);
+	} else if (urgent) {
+		g_queue_push_head (&self->queue, g_object_ref (app));
+	} else {
+		g_queue_push_tail (&self->queue, g_object_ref (app));
+	}
+	gs_size_service_queue_process (self);
+	return FALSE;
+}
+
+/**
+ * gs_size_service_invalidate:
+ * @self: a #GsSizeService
+ * @app: a #GsApp
+ *
+ * Forgets the cached installed size of @app, for example because it has been
+ * installed, updated or removed. The installed size set on @app is cleared
+ * too, so that it is worked out again.
+ *
+ * Since: 40
+ **/
+void
+gs_size_service_invalidate (GsSizeService *self, GsApp *app)
+{
+	g_return_if_fail (GS_IS_SIZE_SERVICE (self));
+	g_return_if_fail (GS_IS_APP (app));
+
+	/* otherwise the next lookup would cache the old size again */
+	gs_app_set_size_installed (app, 0);
+
+	if (gs_app_get_unique_id (app) == NULL)
+		return;
+	g_hash_table_remove (self->attempted, gs_app_get_unique_id (app));
+	if (g_hash_table_remove (self->entries, gs_app_get_unique_id (app)))
+		gs_size_service_entries_changed (self);
+}
+
+/**
+ * gs_size_service_cancel:
+ * @self: a #GsSizeService
+ *
+ * Stops working out the sizes of all the queued apps.
+ *
+ * Since: 40
+ **/
+void
+gs_size_service_cancel (GsSizeService *self)
+{
+	g_return_if_fail (GS_IS_SIZE_SERVICE (self));
+
+	g_cancellable_cancel (self->cancellable);
+	g_object_unref (self->cancellable);
+	self->cancellable = g_cancellable_new ();
+
+	g_queue_foreach (&self->queue, (GFunc) g_object_unref, NULL);
+	g_queue_clear (&self->queue);
+	g_clear_handle_id (&self->process_id, g_source_remove);
+}
+
+static void
+gs_size_service_dispose (GObject *object)
+{
+	GsSizeService *self = GS_SIZE_SERVICE (object);
+
+	if (self->cancellable != NULL)
+		g_cancellable_cancel (self->cancellable);
+	g_queue_foreach (&self->queue, (GFunc) g_object_unref, NULL);
+	g_queue_clear (&self->queue);
+	g_clear_handle_id (&self->process_id, g_source_remove);
+	g_clear_handle_id (&self->save_id, g_source_remove);
+	gs_size_service_save (self);
+
+	g_clear_object (&self->plugin_loader);
+	g_clear_object (&self->cancellable);
+
+	G_OBJECT_CLASS (gs_size_service_parent_class)->dispose (object);
+}
+
+static void
+gs_size_service_finalize (GObject *object)
+{
+	GsSizeService *self = GS_SIZE_SERVICE (object);
+
+	g_hash_table_unref (self->entries);
+	g_hash_table_unref (self->attempted);
+
+	G_OBJECT_CLASS (gs_size_service_parent_class)->finalize (object);
+}
+
+static void
+gs_size_service_class_init (GsSizeServiceClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->dispose = gs_size_service_dispose;
+	object_class->finalize = gs_size_service_finalize;
+
+	/**
+	 * GsSizeService::sizes-changed:
+	 * @list: the #GsAppList of apps whose sizes were worked out
+	 *
+	 * Emitted when the installed sizes of a batch of requested apps have
+	 * been worked out.
+	 *
+	 * Since: 40
+	 */
+	signals [SIGNAL_SIZES_CHANGED] =
+		g_signal_new ("sizes-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__OBJECT,
+			      G_TYPE_NONE, 1, GS_TYPE_APP_LIST);
+}
+
+static void
+gs_size_service_init (GsSizeService *self)
+{
+	self->cancellable = g_cancellable_new ();
+	self->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, (GDestroyNotify) gs_size_service_entry_free);
+	self->attempted = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_queue_init (&self->queue);
+}
+
+/**
+ * gs_size_service_new:
+ * @plugin_loader: a #GsPluginLoader
+ *
+ * Creates a new size service, loading any sizes cached by previous runs.
+ *
+ * Returns: (transfer full): a #GsSizeService
+ *
+ * Since: 40
+ **/
+GsSizeService *
+gs_size_service_new (GsPluginLoader *plugin_loader)
+{
+	GsSizeService *self;
+
+	g_return_val_if_fail (GS_IS_PLUGIN_LOADER (plugin_loader), NULL);
+
+	self = g_object_new (GS_TYPE_SIZE_SERVICE, NULL);
+	self->plugin_loader = g_object_ref (plugin_loader);
+	gs_size_service_load (self);
+	return self;
+}
@@ -0,0 +1,31 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ * vi:set noexpandtab tabstop=8 shiftwidth=8:
+ *
+ * Copyright (C) 2021 Endless OS Foundation LLC
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "gnome-software-private.h"
+
+G_BEGIN_DECLS
+
+#define GS_TYPE_SIZE_SERVICE (gs_size_service_get_type ())
+
+G_DECLARE_FINAL_TYPE (GsSizeService, gs_size_service, GS, SIZE_SERVICE, GObject)
+
+GsSizeService	*gs_size_service_new		(GsPluginLoader		*plugin_loader);
+
+gboolean	 gs_size_service_request	(GsSizeService		*self,
+						 GsApp			*app,
+						 gboolean		 urgent);
+void		 gs_size_service_invalidate	(GsSizeService		*self,
+						 GsApp			*app);
+void		 gs_size_service_cancel		(GsSizeService		*self);
+
+G_END_DECLS
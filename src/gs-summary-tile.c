@@ -64,7 +64,7 @@ gs_summary_tile_refresh (GsAppTile *self)
 					 gtk_image_get_pixel_size (GTK_IMAGE (tile->image)),
 					 gtk_widget_get_scale_factor (tile->image),
 					 "application-x-executable");
-	gtk_image_set_from_gicon (GTK_IMAGE (tile->image), icon, GTK_ICON_SIZE_DIALOG);
+	gs_image_set_from_icon (GTK_IMAGE (tile->image), icon, GTK_ICON_SIZE_DIALOG);
 
 	context = gtk_widget_get_style_context (tile->image);
 	if (gs_app_get_use_drop_shadow (app))
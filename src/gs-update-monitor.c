@@ -277,14 +277,11 @@ _filter_by_app_kind (GsApp *app, gpointer user_data)
 	return gs_app_get_kind (app) == kind;
 }
 
-static gboolean
-_sort_by_rating_cb (GsApp *app1, GsApp *app2, gpointer user_data)
+static gchar *
+_sort_key_rating_cb (GsApp *app, gpointer user_data)
 {
-	if (gs_app_get_rating (app1) < gs_app_get_rating (app2))
-		return -1;
-	if (gs_app_get_rating (app1) > gs_app_get_rating (app2))
-		return 1;
-	return 0;
+	/* ratings start at -1 for unknown */
+	return g_strdup_printf ("%03i", gs_app_get_rating (app) + 1);
 }
 
 static GNotification *
@@ -301,7 +298,7 @@ _build_autoupdated_notification (GsUpdateMonitor *monitor, GsAppList *list)
 	gs_app_list_filter (list_apps,
 			    _filter_by_app_kind,
 			    GUINT_TO_POINTER(AS_COMPONENT_KIND_DESKTOP_APP));
-	gs_app_list_sort (list_apps, _sort_by_rating_cb, NULL);
+	gs_app_list_sort_by_key (list_apps, _sort_key_rating_cb, NULL);
 	/* FIXME: add the applications that are currently active that use one
 	 * of the updated runtimes */
 	if (gs_app_list_length (list_apps) == 0) {